@@ -0,0 +1,1018 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file arraytype.c
+ *
+ * Homogeneous arrays of unboxed ints or floats.
+ *
+ * A list stores a pointer to a boxed object per element, so numeric
+ * work over a list pays for a type check, a pointer chase and often
+ * an allocation per element. An array stores its elements contiguously
+ * as 'long' or 'double', and its reductions and elementwise arithmetic
+ * run over whole blocks at a time using SSE2 (when available).
+ * Elements are only boxed when they are read individually.
+ */
+
+#include "arraytype.h"
+#include "numconv.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && \
+        defined(__GNUC__)
+#define ARRAY_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/** Type member table for LuciArrayObj */
+LuciObjectType obj_array_t = {
+    "array",
+    sizeof(LuciArrayObj),
+    TYPEID_ARRAY,
+
+    LuciArray_copy,
+    LuciArray_deepcopy,
+    unary_nil,
+    LuciArray_asbool,
+    LuciArray_len,
+    LuciArray_neg,
+    LuciObject_lgnot,
+    unary_nil,
+
+    LuciArray_add,
+    LuciArray_sub,
+    LuciArray_mul,
+    LuciArray_div,
+    binary_nil,
+    binary_nil,
+    LuciArray_eq,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    LuciObject_lgor,
+    LuciObject_lgand,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+
+    LuciArray_contains,
+    LuciArray_next,
+    LuciArray_cget,
+
+    LuciArray_cput,
+
+    LuciArray_print,
+    LuciArray_mark,
+    LuciArray_finalize,
+    NULL,       /* hash0 */
+    NULL        /* hash1 */
+};
+
+/** elementwise arithmetic operations */
+typedef enum { ARRAY_ADD, ARRAY_SUB, ARRAY_MUL, ARRAY_DIV } ArrayOp;
+
+/** names of each ArrayOp, for error messages */
+static const char *array_op_names[] = { "add", "subtract", "multiply", "divide" };
+
+/*
+ * Elementwise kernels. Each computes dst[i] = dst[i] op src[i], or
+ * dst[i] = dst[i] op x when src is NULL.
+ */
+
+/** defines an elementwise kernel over doubles */
+#define F64_KERNEL(name, vop, op) \
+static void name(double *dst, const double *src, double x, long n) \
+{ \
+    long i = 0; \
+    F64_KERNEL_SSE2(vop) \
+    for (; i < n; i++) { \
+        dst[i] = dst[i] op (src ? src[i] : x); \
+    } \
+}
+
+#ifdef ARRAY_SSE2
+#define F64_KERNEL_SSE2(vop) \
+    __m128d vx = _mm_set1_pd(x); \
+    for (; i + 2 <= n; i += 2) { \
+        __m128d b = src ? _mm_loadu_pd(src + i) : vx; \
+        _mm_storeu_pd(dst + i, vop(_mm_loadu_pd(dst + i), b)); \
+    }
+#else
+#define F64_KERNEL_SSE2(vop)
+#endif
+
+F64_KERNEL(f64_add, _mm_add_pd, +)
+F64_KERNEL(f64_sub, _mm_sub_pd, -)
+F64_KERNEL(f64_mul, _mm_mul_pd, *)
+F64_KERNEL(f64_div, _mm_div_pd, /)
+
+/** the sign bit is set if r = a + b overflowed */
+#define ADD_OVF(a, b, r)    (((a) ^ (r)) & ((b) ^ (r)))
+/** the sign bit is set if r = a - b overflowed */
+#define SUB_OVF(a, b, r)    (((a) ^ (b)) & ((a) ^ (r)))
+
+/**
+ * Defines an elementwise kernel over longs, returning true if any
+ * result overflowed, since an array can't hold a larger int
+ */
+#define I64_KERNEL(name, vop, op, ovf_op) \
+static bool name(long *dst, const long *src, long x, long n) \
+{ \
+    long i = 0, ovf = 0; \
+    I64_KERNEL_SSE2(vop, ovf_op) \
+    for (; i < n; i++) { \
+        long a = dst[i], b = src ? src[i] : x; \
+        dst[i] = (long)((unsigned long)a op (unsigned long)b); \
+        ovf |= ovf_op(a, b, dst[i]); \
+    } \
+    return ovf < 0; \
+}
+
+#if defined(ARRAY_SSE2) && defined(__x86_64__)
+/* the overflow sign bits of every lane are ORed together */
+#define I64_KERNEL_SSE2(vop, ovf_op) \
+    __m128i vx = _mm_set1_epi64x(x), vovf = _mm_setzero_si128(); \
+    for (; i + 2 <= n; i += 2) { \
+        __m128i b = src ? _mm_loadu_si128((const __m128i *)(src + i)) : vx; \
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i)); \
+        __m128i r = vop(a, b); \
+        vovf = _mm_or_si128(vovf, ovf_op##_SSE2(a, b, r)); \
+        _mm_storeu_si128((__m128i *)(dst + i), r); \
+    } \
+    if (_mm_movemask_pd(_mm_castsi128_pd(vovf))) { \
+        ovf = -1; \
+    }
+#define ADD_OVF_SSE2(a, b, r) \
+    _mm_and_si128(_mm_xor_si128(a, r), _mm_xor_si128(b, r))
+#define SUB_OVF_SSE2(a, b, r) \
+    _mm_and_si128(_mm_xor_si128(a, b), _mm_xor_si128(a, r))
+#else
+#define I64_KERNEL_SSE2(vop, ovf_op)
+#endif
+
+I64_KERNEL(i64_add, _mm_add_epi64, +, ADD_OVF)
+I64_KERNEL(i64_sub, _mm_sub_epi64, -, SUB_OVF)
+
+/* SSE2 has no 64-bit integer multiply or divide */
+static bool i64_mul(long *dst, const long *src, long x, long n)
+{
+    long i;
+    bool ovf = false;
+    for (i = 0; i < n; i++) {
+        ovf |= __builtin_mul_overflow(dst[i], src ? src[i] : x, &dst[i]);
+    }
+    return ovf;
+}
+
+static bool i64_div(long *dst, const long *src, long x, long n)
+{
+    long i;
+    bool ovf = false;
+    for (i = 0; i < n; i++) {
+        long d = src ? src[i] : x;
+        if (d == 0) {
+            LUCI_DIE("%s\n", "Divide by zero");
+        } else if (d == -1 && dst[i] == LONG_MIN) {
+            /* LONG_MIN / -1 overflows */
+            ovf = true;
+        } else {
+            dst[i] /= d;
+        }
+    }
+    return ovf;
+}
+
+static void (*f64_kernels[])(double *, const double *, double, long) = {
+    f64_add, f64_sub, f64_mul, f64_div
+};
+
+static bool (*i64_kernels[])(long *, const long *, long, long) = {
+    i64_add, i64_sub, i64_mul, i64_div
+};
+
+/** Sums n doubles */
+static double f64_sum(const double *v, long n)
+{
+    long i = 0;
+    double sum = 0;
+#ifdef ARRAY_SSE2
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(v + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(v + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++) {
+        sum += v[i];
+    }
+    return sum;
+}
+
+/** Computes the dot product of n doubles */
+static double f64_dot(const double *a, const double *b, long n)
+{
+    long i = 0;
+    double sum = 0;
+#ifdef ARRAY_SSE2
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0,
+                _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1,
+                _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+/** Finds the minimum (or maximum, if max is true) of n > 0 doubles */
+static double f64_extreme(const double *v, long n, bool max)
+{
+    long i = 0;
+    double best = v[0];
+#ifdef ARRAY_SSE2
+    if (n >= 2) {
+        __m128d acc = _mm_loadu_pd(v);
+        for (i = 2; i + 2 <= n; i += 2) {
+            __m128d x = _mm_loadu_pd(v + i);
+            acc = max ? _mm_max_pd(acc, x) : _mm_min_pd(acc, x);
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        best = (max == (lanes[0] > lanes[1])) ? lanes[0] : lanes[1];
+    }
+#endif
+    for (; i < n; i++) {
+        if (max ? v[i] > best : v[i] < best) {
+            best = v[i];
+        }
+    }
+    return best;
+}
+
+/**
+ * A sum of ints, kept in a long until it overflows
+ *
+ * The part that doesn't fit is carried as a LuciIntObj or
+ * LuciBigIntObj, so the total is exact.
+ */
+typedef struct i64_total_ {
+    long small;         /**< running sum that fits in a long */
+    LuciObject *big;    /**< carried sum, or NULL */
+} I64Total;
+
+/** Adds an object to the carried part of an I64Total */
+static void i64_total_carry(I64Total *t, LuciObject *o)
+{
+    t->big = t->big ? t->big->type->add(t->big, o) : o;
+}
+
+/** Adds x to an I64Total */
+static inline void i64_total_add(I64Total *t, long x)
+{
+    long next;
+    if (__builtin_add_overflow(t->small, x, &next)) {
+        i64_total_carry(t, LuciInt_new(t->small));
+        next = x;
+    }
+    t->small = next;
+}
+
+/** Returns the value of an I64Total as a LuciIntObj or LuciBigIntObj */
+static LuciObject *i64_total_result(I64Total *t)
+{
+    LuciObject *res = LuciInt_new(t->small);
+    return t->big ? t->big->type->add(t->big, res) : res;
+}
+
+/** Sums n longs */
+static LuciObject *i64_sum(const long *v, long n)
+{
+    I64Total t = {0, NULL};
+    long i = 0;
+#if defined(ARRAY_SSE2) && defined(__x86_64__)
+    /* sum in two lanes while neither overflows, otherwise start over
+     * with an exact sum */
+    __m128i acc = _mm_setzero_si128(), vovf = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(v + i));
+        __m128i r = _mm_add_epi64(acc, x);
+        vovf = _mm_or_si128(vovf, ADD_OVF_SSE2(acc, x, r));
+        acc = r;
+    }
+    if (_mm_movemask_pd(_mm_castsi128_pd(vovf))) {
+        i = 0;
+    } else {
+        long lanes[2];
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        i64_total_add(&t, lanes[0]);
+        i64_total_add(&t, lanes[1]);
+    }
+#endif
+    for (; i < n; i++) {
+        i64_total_add(&t, v[i]);
+    }
+    return i64_total_result(&t);
+}
+
+/** Computes the dot product of n longs */
+static LuciObject *i64_dot(const long *a, const long *b, long n)
+{
+    I64Total t = {0, NULL};
+    long i, p;
+    for (i = 0; i < n; i++) {
+        if (__builtin_mul_overflow(a[i], b[i], &p)) {
+            LuciObject *x = LuciInt_new(a[i]);
+            i64_total_carry(&t, x->type->mul(x, LuciInt_new(b[i])));
+        } else {
+            i64_total_add(&t, p);
+        }
+    }
+    return i64_total_result(&t);
+}
+
+/** Finds the minimum (or maximum, if max is true) of n > 0 longs */
+static long i64_extreme(const long *v, long n, bool max)
+{
+    long b0 = v[0], b1 = v[0];
+    long i = 1;
+    /* two independent chains, since SSE2 has no 64-bit compare */
+    for (; i + 2 <= n; i += 2) {
+        if (max ? v[i] > b0 : v[i] < b0) {
+            b0 = v[i];
+        }
+        if (max ? v[i + 1] > b1 : v[i + 1] < b1) {
+            b1 = v[i + 1];
+        }
+    }
+    for (; i < n; i++) {
+        if (max ? v[i] > b0 : v[i] < b0) {
+            b0 = v[i];
+        }
+    }
+    return (max == (b0 > b1)) ? b0 : b1;
+}
+
+/**
+ * Creates a new LuciArrayObj of zeros
+ *
+ * @param kind element type
+ * @param count number of elements
+ * @returns new LuciArrayObj
+ */
+LuciObject *LuciArray_new(LuciArrayKind kind, long count)
+{
+    LuciArrayObj *o = (LuciArrayObj*)gc_malloc(&obj_array_t);
+    o->kind = kind;
+    o->count = count;
+    o->size = (count > INIT_ARRAY_SIZE) ? count : INIT_ARRAY_SIZE;
+    /* longs and doubles are the same size */
+    o->v.i = alloc(o->size * sizeof(*o->v.i));
+    return (LuciObject *)o;
+}
+
+/**
+ * Returns a new LuciArrayObj with the elements of a converted to kind
+ *
+ * Floats are truncated when converted to ints.
+ *
+ * @param a LuciArrayObj
+ * @param kind element type of the result
+ * @returns new LuciArrayObj
+ */
+LuciObject *LuciArray_convert(LuciObject *a, LuciArrayKind kind)
+{
+    LuciArrayObj *src = AS_ARRAY(a);
+    LuciObject *res = LuciArray_new(kind, src->count);
+    long i;
+
+    if (src->kind == kind) {
+        memcpy(AS_ARRAY(res)->v.i, src->v.i, src->count * sizeof(*src->v.i));
+    } else if (kind == ARRAY_FLOAT) {
+        for (i = 0; i < src->count; i++) {
+            AS_ARRAY(res)->v.f[i] = (double)src->v.i[i];
+        }
+    } else {
+        for (i = 0; i < src->count; i++) {
+            AS_ARRAY(res)->v.i[i] = (long)src->v.f[i];
+        }
+    }
+    return res;
+}
+
+/**
+ * Returns the elements of a LuciArrayObj as doubles
+ *
+ * @param a LuciArrayObj
+ * @param tmp set to true if the caller must free the result
+ * @returns elements of a, converted if necessary
+ */
+static double *array_floats(LuciObject *a, bool *tmp)
+{
+    LuciArrayObj *arr = AS_ARRAY(a);
+
+    *tmp = (arr->kind == ARRAY_INT);
+    if (!*tmp) {
+        return arr->v.f;
+    }
+
+    double *f = alloc((arr->count + 1) * sizeof(*f));
+    long i;
+    for (i = 0; i < arr->count; i++) {
+        f[i] = (double)arr->v.i[i];
+    }
+    return f;
+}
+
+/**
+ * Boxes the element at index idx of a LuciArrayObj
+ *
+ * @param a LuciArrayObj
+ * @param idx index in bounds
+ * @returns new LuciIntObj or LuciFloatObj
+ */
+static LuciObject *array_get(LuciObject *a, long idx)
+{
+    if (AS_ARRAY(a)->kind == ARRAY_INT) {
+        return LuciInt_new(AS_ARRAY(a)->v.i[idx]);
+    } else {
+        return LuciFloat_new(AS_ARRAY(a)->v.f[idx]);
+    }
+}
+
+/**
+ * Creates a LuciArrayObj from a LuciListObj of numbers
+ *
+ * The array holds ints if every item in the list is an int,
+ * otherwise it holds floats.
+ *
+ * @param list LuciListObj
+ * @returns new LuciArrayObj
+ */
+LuciObject *LuciArray_from_list(LuciObject *list)
+{
+    LuciArrayKind kind = ARRAY_INT;
+    long i, count = AS_LIST(list)->count;
+
+    for (i = 0; i < count; i++) {
+        LuciObject *item = AS_LIST(list)->items[i];
+        if (ISTYPE(item, obj_float_t)) {
+            kind = ARRAY_FLOAT;
+        } else if (!ISTYPE(item, obj_int_t)) {
+            LUCI_DIE("Cannot put an object of type %s into an array\n",
+                    item->type->type_name);
+        }
+    }
+
+    LuciObject *res = LuciArray_new(kind, count);
+    for (i = 0; i < count; i++) {
+        LuciObject *item = AS_LIST(list)->items[i];
+        if (kind == ARRAY_INT) {
+            AS_ARRAY(res)->v.i[i] = AS_INT(item)->i;
+        } else if (ISTYPE(item, obj_int_t)) {
+            AS_ARRAY(res)->v.f[i] = (double)AS_INT(item)->i;
+        } else {
+            AS_ARRAY(res)->v.f[i] = AS_FLOAT(item)->f;
+        }
+    }
+    return res;
+}
+
+/**
+ * Creates a LuciListObj from the elements of a LuciArrayObj
+ *
+ * @param a LuciArrayObj
+ * @returns new LuciListObj
+ */
+LuciObject *LuciArray_to_list(LuciObject *a)
+{
+    LuciObject *list = LuciList_new_sized(AS_ARRAY(a)->count);
+    long i;
+
+    for (i = 0; i < AS_ARRAY(a)->count; i++) {
+        LuciList_append(list, array_get(a, i));
+    }
+    return list;
+}
+
+/**
+ * Shallow copy of a LuciArrayObj
+ *
+ * Like lists, arrays are shared by reference.
+ *
+ * @param orig LuciArrayObj
+ * @returns orig
+ */
+LuciObject* LuciArray_copy(LuciObject *orig)
+{
+    return orig;
+}
+
+/**
+ * Deep copies a LuciArrayObj
+ *
+ * @param orig LuciArrayObj to copy
+ * @returns new copy of orig
+ */
+LuciObject* LuciArray_deepcopy(LuciObject *orig)
+{
+    return LuciArray_convert(orig, AS_ARRAY(orig)->kind);
+}
+
+/**
+ * Returns a boolean representation of a LuciArrayObj
+ *
+ * @param o LuciArrayObj
+ * @returns LuciIntObj (true if not empty)
+ */
+LuciObject* LuciArray_asbool(LuciObject *o)
+{
+    return LuciBool(AS_ARRAY(o)->count > 0);
+}
+
+/**
+ * Returns the length of a LuciArrayObj
+ *
+ * @param o LuciArrayObj
+ * @returns length of o
+ */
+LuciObject* LuciArray_len(LuciObject *o)
+{
+    return LuciInt_new(AS_ARRAY(o)->count);
+}
+
+/**
+ * Negates every element of a LuciArrayObj
+ *
+ * @param o LuciArrayObj
+ * @returns new LuciArrayObj
+ */
+LuciObject* LuciArray_neg(LuciObject *o)
+{
+    LuciObject *res = LuciArray_new(AS_ARRAY(o)->kind, AS_ARRAY(o)->count);
+
+    if (AS_ARRAY(o)->kind == ARRAY_INT) {
+        if (i64_sub(AS_ARRAY(res)->v.i, AS_ARRAY(o)->v.i, 0,
+                    AS_ARRAY(o)->count)) {
+            LUCI_DIE("%s", "Cannot negate an int array holding the "
+                    "smallest int\n");
+        }
+    } else {
+        f64_sub(AS_ARRAY(res)->v.f, AS_ARRAY(o)->v.f, 0, AS_ARRAY(o)->count);
+    }
+    return res;
+}
+
+/**
+ * Applies an elementwise operation to a LuciArrayObj and either
+ * another LuciArrayObj of the same length or a number
+ *
+ * The result holds floats if either operand does.
+ *
+ * @param a LuciArrayObj
+ * @param b LuciArrayObj, LuciIntObj or LuciFloatObj
+ * @param op operation
+ * @returns new LuciArrayObj
+ */
+static LuciObject *array_arith(LuciObject *a, LuciObject *b, ArrayOp op)
+{
+    LuciArrayKind kind = AS_ARRAY(a)->kind;
+    long n = AS_ARRAY(a)->count;
+
+    if (ISTYPE(b, obj_array_t)) {
+        if (AS_ARRAY(b)->count != n) {
+            LUCI_DIE("Cannot %s arrays of different lengths (%ld and %ld)\n",
+                    array_op_names[op], n, AS_ARRAY(b)->count);
+        }
+        if (AS_ARRAY(b)->kind == ARRAY_FLOAT) {
+            kind = ARRAY_FLOAT;
+        }
+    } else if (ISTYPE(b, obj_float_t)) {
+        kind = ARRAY_FLOAT;
+    } else if (!ISTYPE(b, obj_int_t)) {
+        LUCI_DIE("Cannot %s an array and an object of type %s\n",
+                array_op_names[op], b->type->type_name);
+    }
+
+    LuciObject *res = LuciArray_convert(a, kind);
+
+    if (kind == ARRAY_INT) {
+        bool ovf;
+        if (ISTYPE(b, obj_array_t)) {
+            ovf = i64_kernels[op](AS_ARRAY(res)->v.i, AS_ARRAY(b)->v.i, 0, n);
+        } else {
+            ovf = i64_kernels[op](AS_ARRAY(res)->v.i, NULL, AS_INT(b)->i, n);
+        }
+        if (ovf) {
+            LUCI_DIE("Cannot %s int arrays where a result overflows a "
+                    "long\n", array_op_names[op]);
+        }
+        return res;
+    }
+
+    if (ISTYPE(b, obj_array_t)) {
+        bool tmp;
+        double *f = array_floats(b, &tmp);
+        if (op == ARRAY_DIV) {
+            long i;
+            for (i = 0; i < n; i++) {
+                if (f[i] == 0.0) {
+                    LUCI_DIE("%s\n", "Divide by zero");
+                }
+            }
+        }
+        f64_kernels[op](AS_ARRAY(res)->v.f, f, 0, n);
+        if (tmp) {
+            free(f);
+        }
+    } else {
+        double x = ISTYPE(b, obj_int_t) ? (double)AS_INT(b)->i : AS_FLOAT(b)->f;
+        if (op == ARRAY_DIV && x == 0.0) {
+            LUCI_DIE("%s\n", "Divide by zero");
+        }
+        f64_kernels[op](AS_ARRAY(res)->v.f, NULL, x, n);
+    }
+    return res;
+}
+
+/**
+ * Adds a LuciArrayObj and an array or number elementwise
+ *
+ * @param a LuciArrayObj
+ * @param b LuciArrayObj or number
+ * @returns new LuciArrayObj
+ */
+LuciObject* LuciArray_add(LuciObject *a, LuciObject *b)
+{
+    return array_arith(a, b, ARRAY_ADD);
+}
+
+/**
+ * Subtracts an array or number from a LuciArrayObj elementwise
+ *
+ * @param a LuciArrayObj
+ * @param b LuciArrayObj or number
+ * @returns new LuciArrayObj
+ */
+LuciObject* LuciArray_sub(LuciObject *a, LuciObject *b)
+{
+    return array_arith(a, b, ARRAY_SUB);
+}
+
+/**
+ * Multiplies a LuciArrayObj and an array or number elementwise
+ *
+ * @param a LuciArrayObj
+ * @param b LuciArrayObj or number
+ * @returns new LuciArrayObj
+ */
+LuciObject* LuciArray_mul(LuciObject *a, LuciObject *b)
+{
+    return array_arith(a, b, ARRAY_MUL);
+}
+
+/**
+ * Divides a LuciArrayObj by an array or number elementwise
+ *
+ * @param a LuciArrayObj
+ * @param b LuciArrayObj or number
+ * @returns new LuciArrayObj
+ */
+LuciObject* LuciArray_div(LuciObject *a, LuciObject *b)
+{
+    return array_arith(a, b, ARRAY_DIV);
+}
+
+/**
+ * Determines if two LuciArrayObjs hold equal values
+ *
+ * @param a LuciArrayObj
+ * @param b LuciArrayObj
+ * @returns 1 if equal, 0 otherwise
+ */
+LuciObject* LuciArray_eq(LuciObject *a, LuciObject *b)
+{
+    if (!ISTYPE(b, obj_array_t)) {
+        LUCI_DIE("Cannot compare an array to an object of type %s\n",
+                b->type->type_name);
+    }
+
+    long i, n = AS_ARRAY(a)->count;
+    if (AS_ARRAY(b)->count != n) {
+        return LuciFalseObj;
+    }
+
+    if (AS_ARRAY(a)->kind == ARRAY_INT && AS_ARRAY(b)->kind == ARRAY_INT) {
+        return LuciBool(memcmp(AS_ARRAY(a)->v.i, AS_ARRAY(b)->v.i,
+                    n * sizeof(long)) == 0);
+    }
+
+    bool tmpa, tmpb;
+    double *fa = array_floats(a, &tmpa);
+    double *fb = array_floats(b, &tmpb);
+    for (i = 0; i < n && fa[i] == fb[i]; i++)
+        ;
+    if (tmpa) {
+        free(fa);
+    }
+    if (tmpb) {
+        free(fb);
+    }
+    return LuciBool(i == n);
+}
+
+/**
+ * Appends a number to a LuciArrayObj
+ *
+ * @param a LuciArrayObj
+ * @param x LuciIntObj or LuciFloatObj (floats only into float arrays)
+ * @returns LuciNilObj
+ */
+LuciObject* LuciArray_append(LuciObject *a, LuciObject *x)
+{
+    LuciArrayObj *arr = AS_ARRAY(a);
+
+    if (arr->count >= arr->size) {
+        arr->size *= 2;
+        arr->v.i = realloc(arr->v.i, arr->size * sizeof(*arr->v.i));
+        if (!arr->v.i) {
+            LUCI_DIE("%s", "Failed to dynamically expand array while appending\n");
+        }
+    }
+
+    if (ISTYPE(x, obj_int_t)) {
+        if (arr->kind == ARRAY_INT) {
+            arr->v.i[arr->count++] = AS_INT(x)->i;
+        } else {
+            arr->v.f[arr->count++] = (double)AS_INT(x)->i;
+        }
+    } else if (ISTYPE(x, obj_float_t) && arr->kind == ARRAY_FLOAT) {
+        arr->v.f[arr->count++] = AS_FLOAT(x)->f;
+    } else {
+        LUCI_DIE("Cannot append an object of type %s to an array of %ss\n",
+                x->type->type_name, arr->kind == ARRAY_INT ? "int" : "float");
+    }
+    return LuciNilObj;
+}
+
+/**
+ * Sums the elements of a LuciArrayObj
+ *
+ * @param a LuciArrayObj
+ * @returns LuciIntObj or LuciFloatObj sum
+ */
+LuciObject* LuciArray_sum(LuciObject *a)
+{
+    if (AS_ARRAY(a)->kind == ARRAY_INT) {
+        return i64_sum(AS_ARRAY(a)->v.i, AS_ARRAY(a)->count);
+    } else {
+        return LuciFloat_new(f64_sum(AS_ARRAY(a)->v.f, AS_ARRAY(a)->count));
+    }
+}
+
+/**
+ * Finds the minimum or maximum element of a LuciArrayObj
+ *
+ * @param a non-empty LuciArrayObj
+ * @param max true to find the maximum
+ * @returns LuciIntObj or LuciFloatObj
+ */
+static LuciObject *array_extreme(LuciObject *a, bool max)
+{
+    if (AS_ARRAY(a)->count == 0) {
+        LUCI_DIE("Can't find %s of an empty array\n", max ? "max" : "min");
+    }
+
+    if (AS_ARRAY(a)->kind == ARRAY_INT) {
+        return LuciInt_new(i64_extreme(AS_ARRAY(a)->v.i,
+                    AS_ARRAY(a)->count, max));
+    } else {
+        return LuciFloat_new(f64_extreme(AS_ARRAY(a)->v.f,
+                    AS_ARRAY(a)->count, max));
+    }
+}
+
+/**
+ * Finds the minimum element of a LuciArrayObj
+ *
+ * @param a LuciArrayObj
+ * @returns minimum
+ */
+LuciObject* LuciArray_min(LuciObject *a)
+{
+    return array_extreme(a, false);
+}
+
+/**
+ * Finds the maximum element of a LuciArrayObj
+ *
+ * @param a LuciArrayObj
+ * @returns maximum
+ */
+LuciObject* LuciArray_max(LuciObject *a)
+{
+    return array_extreme(a, true);
+}
+
+/**
+ * Computes the dot product of two LuciArrayObjs of equal length
+ *
+ * @param a LuciArrayObj
+ * @param b LuciArrayObj
+ * @returns LuciIntObj if both arrays hold ints, else LuciFloatObj
+ */
+LuciObject* LuciArray_dot(LuciObject *a, LuciObject *b)
+{
+    long n = AS_ARRAY(a)->count;
+
+    if (AS_ARRAY(b)->count != n) {
+        LUCI_DIE("Cannot compute dot product of arrays of different "
+                "lengths (%ld and %ld)\n", n, AS_ARRAY(b)->count);
+    }
+
+    if (AS_ARRAY(a)->kind == ARRAY_INT && AS_ARRAY(b)->kind == ARRAY_INT) {
+        return i64_dot(AS_ARRAY(a)->v.i, AS_ARRAY(b)->v.i, n);
+    }
+
+    bool tmpa, tmpb;
+    double *fa = array_floats(a, &tmpa);
+    double *fb = array_floats(b, &tmpb);
+    double dot = f64_dot(fa, fb, n);
+    if (tmpa) {
+        free(fa);
+    }
+    if (tmpb) {
+        free(fb);
+    }
+    return LuciFloat_new(dot);
+}
+
+/**
+ * Determines whether a LuciArrayObj contains a number
+ *
+ * @param a LuciArrayObj
+ * @param x object
+ * @returns 1 if a contains x, 0 otherwise
+ */
+LuciObject* LuciArray_contains(LuciObject *a, LuciObject *x)
+{
+    LuciArrayObj *arr = AS_ARRAY(a);
+    long i;
+
+    if (ISTYPE(x, obj_int_t) && arr->kind == ARRAY_INT) {
+        for (i = 0; i < arr->count; i++) {
+            if (arr->v.i[i] == AS_INT(x)->i) {
+                return LuciTrueObj;
+            }
+        }
+    } else if (ISTYPE(x, obj_int_t) || ISTYPE(x, obj_float_t)) {
+        double f = ISTYPE(x, obj_int_t) ? (double)AS_INT(x)->i : AS_FLOAT(x)->f;
+        for (i = 0; i < arr->count; i++) {
+            double y = (arr->kind == ARRAY_INT) ?
+                (double)arr->v.i[i] : arr->v.f[i];
+            if (y == f) {
+                return LuciTrueObj;
+            }
+        }
+    }
+    return LuciFalseObj;
+}
+
+/**
+ * Returns the 'next' element in the array
+ *
+ * @param a LuciArrayObj
+ * @param idx index
+ * @returns element at index idx or NULL if out of bounds
+ */
+LuciObject* LuciArray_next(LuciObject *a, LuciObject *idx)
+{
+    if (!ISTYPE(idx, obj_int_t)) {
+        LUCI_DIE("%s\n", "Argument to LuciArray_next must be LuciIntObj");
+    }
+
+    if (AS_INT(idx)->i >= AS_ARRAY(a)->count) {
+        return NULL;
+    }
+    return array_get(a, AS_INT(idx)->i);
+}
+
+/**
+ * Gets the element at index b in LuciArrayObj a
+ *
+ * @param a LuciArrayObj
+ * @param b index in a
+ * @returns element at index b
+ */
+LuciObject* LuciArray_cget(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_int_t)) {
+        long idx = AS_INT(b)->i;
+        MAKE_INDEX_POS(idx, AS_ARRAY(a)->count);
+        if (idx >= AS_ARRAY(a)->count) {
+            LUCI_DIE("%s\n", "Array index out of bounds");
+        }
+        return array_get(a, idx);
+    } else {
+        LUCI_DIE("Cannot subscript an array with an object of type %s\n",
+                b->type->type_name);
+    }
+    return LuciNilObj;
+}
+
+/**
+ * Puts the number c at index b in LuciArrayObj a
+ *
+ * @param a LuciArrayObj
+ * @param b index in a
+ * @param c LuciIntObj or LuciFloatObj (floats only into float arrays)
+ * @returns former element at index b
+ */
+LuciObject* LuciArray_cput(LuciObject *a, LuciObject *b, LuciObject *c)
+{
+    LuciArrayObj *arr = AS_ARRAY(a);
+
+    if (!ISTYPE(b, obj_int_t)) {
+        LUCI_DIE("Cannot subscript an array with an object of type %s\n",
+                b->type->type_name);
+    }
+
+    long idx = AS_INT(b)->i;
+    MAKE_INDEX_POS(idx, arr->count);
+    if (idx >= arr->count) {
+        LUCI_DIE("%s\n", "Array index out of bounds");
+    }
+    LuciObject *old = array_get(a, idx);
+
+    if (ISTYPE(c, obj_int_t)) {
+        if (arr->kind == ARRAY_INT) {
+            arr->v.i[idx] = AS_INT(c)->i;
+        } else {
+            arr->v.f[idx] = (double)AS_INT(c)->i;
+        }
+    } else if (ISTYPE(c, obj_float_t) && arr->kind == ARRAY_FLOAT) {
+        arr->v.f[idx] = AS_FLOAT(c)->f;
+    } else {
+        LUCI_DIE("Cannot put an object of type %s into an array of %ss\n",
+                c->type->type_name, arr->kind == ARRAY_INT ? "int" : "float");
+    }
+    return old;
+}
+
+/**
+ * Prints a LuciArrayObj to stdout
+ *
+ * @param in LuciArrayObj to print
+ */
+void LuciArray_print(LuciObject *in)
+{
+    char buf[NUMCONV_DOUBLE_SIZE];
+    long i;
+    printf("array[");
+    for (i = 0; i < AS_ARRAY(in)->count; i++) {
+        if (i > 0) {
+            printf(", ");
+        }
+        if (AS_ARRAY(in)->kind == ARRAY_INT) {
+            fwrite(buf, 1, numconv_format_long(buf, AS_ARRAY(in)->v.i[i]),
+                    stdout);
+        } else {
+            fwrite(buf, 1, numconv_format_double(buf, AS_ARRAY(in)->v.f[i]),
+                    stdout);
+        }
+    }
+    printf("]");
+}
+
+/**
+ * Marks a LuciArrayObj as reachable
+ *
+ * @param in LuciArrayObj
+ */
+void LuciArray_mark(LuciObject *in)
+{
+    GC_MARK(in);
+}
+
+/**
+ * Finalizes a LuciArrayObj
+ *
+ * frees its elements
+ *
+ * @param in LuciArrayObj
+ */
+void LuciArray_finalize(LuciObject *in)
+{
+    free(AS_ARRAY(in)->v.i);
+}
@@ -0,0 +1,66 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file arraytype.h
+ */
+
+#ifndef LUCI_ARRAYTYPE_H
+#define LUCI_ARRAYTYPE_H
+
+#include "lucitypes.h"
+
+extern LuciObjectType obj_array_t;
+
+#define INIT_ARRAY_SIZE 32  /**< initial allocated size of an array */
+
+/** Element type of a LuciArrayObj */
+typedef enum {
+    ARRAY_INT,          /**< 'long' elements */
+    ARRAY_FLOAT         /**< 'double' elements */
+} LuciArrayKind;
+
+/** Typed numeric array object type */
+typedef struct LuciArray_ {
+    LuciObject base;    /**< base implementation */
+    LuciArrayKind kind; /**< element type */
+    long count;         /**< current number of elements */
+    long size;          /**< current count of allocated elements */
+    union {
+        long *i;        /**< elements of an ARRAY_INT array */
+        double *f;      /**< elements of an ARRAY_FLOAT array */
+    } v;                /**< unboxed, contiguous elements */
+} LuciArrayObj;
+
+/** casts LuciObject o to a LuciArrayObj */
+#define AS_ARRAY(o)     ((LuciArrayObj *)(o))
+
+LuciObject *LuciArray_new(LuciArrayKind kind, long count);
+LuciObject *LuciArray_convert(LuciObject *, LuciArrayKind);
+LuciObject *LuciArray_from_list(LuciObject *);
+LuciObject *LuciArray_to_list(LuciObject *);
+LuciObject* LuciArray_copy(LuciObject *);
+LuciObject* LuciArray_deepcopy(LuciObject *);
+LuciObject* LuciArray_asbool(LuciObject *);
+LuciObject* LuciArray_len(LuciObject *);
+LuciObject* LuciArray_neg(LuciObject *);
+LuciObject* LuciArray_add(LuciObject *, LuciObject *);
+LuciObject* LuciArray_sub(LuciObject *, LuciObject *);
+LuciObject* LuciArray_mul(LuciObject *, LuciObject *);
+LuciObject* LuciArray_div(LuciObject *, LuciObject *);
+LuciObject* LuciArray_eq(LuciObject *, LuciObject *);
+LuciObject* LuciArray_append(LuciObject *, LuciObject *);
+LuciObject* LuciArray_sum(LuciObject *);
+LuciObject* LuciArray_min(LuciObject *);
+LuciObject* LuciArray_max(LuciObject *);
+LuciObject* LuciArray_dot(LuciObject *, LuciObject *);
+LuciObject* LuciArray_contains(LuciObject *, LuciObject *);
+LuciObject* LuciArray_next(LuciObject *, LuciObject *);
+LuciObject* LuciArray_cget(LuciObject *, LuciObject *);
+LuciObject* LuciArray_cput(LuciObject *, LuciObject *, LuciObject *);
+void LuciArray_print(LuciObject *);
+void LuciArray_mark(LuciObject *);
+void LuciArray_finalize(LuciObject *);
+
+#endif
@@ -88,6 +88,21 @@ AstNode *make_int_constant(long val)
     return result;
 }
 
+/**
+ * Creates a new AST Node representing an integer constant too large
+ * for a long.
+ *
+ * @param digits an allocated C-string of decimal digits
+ * @returns new AST Node
+ */
+AstNode *make_bigint_constant(char *digits)
+{
+    AstNode *result = create_node(ast_bigint_t);
+    result->data.s = digits;
+    LUCI_DEBUG("Made expression node from digits %s\n", digits);
+    return result;
+}
+
 /**
  * Creates a new AST Node representing a floating-point constant.
  *
@@ -271,6 +286,33 @@ AstNode *make_list_def(AstNode *result, AstNode *to_append)
     return result;
 }
 
+/**
+ * Creates a new AST Node representing a tuple definition.
+ *
+ * @param items list definition of the tuple's items
+ * @returns the same AST Node, now a tuple definition
+ */
+AstNode *make_tuple_def(AstNode *items)
+{
+    items->type = ast_tupledef_t;
+    return items;
+}
+
+/**
+ * Creates a new AST Node representing an unpacking assignment
+ *
+ * @param names list definition of string constants to assign to
+ * @param right expression to evaluate and unpack
+ * @returns new AST Node
+ */
+AstNode *make_unpack(AstNode *names, AstNode *right)
+{
+    AstNode *result = create_node(ast_unpack_t);
+    result->data.unpack.names = names;
+    result->data.unpack.right = right;
+    return result;
+}
+
 /**
  * Creates a new AST Node representing an assignment
  *
@@ -307,16 +349,21 @@ AstNode *make_while_loop(AstNode *cond, AstNode *statements)
 /**
  * Creates a new AST Node representing a for-loop.
  *
+ * If val is given, each iteration stores a key (or index) in iter
+ * and the corresponding value in val.
+ *
  * @param iter symbol name in which to store the value of each iteration
+ * @param val symbol name in which to store each value, or NULL
  * @param container container to iterate over
  * @param statements body of the for-loop
  * @returns new AST Node
  */
-AstNode *make_for_loop(char *iter,
+AstNode *make_for_loop(char *iter, char *val,
         AstNode *container, AstNode *statements)
 {
     AstNode *result = create_node(ast_for_t);
     result->data.for_loop.iter = iter;
+    result->data.for_loop.val = val;
     result->data.for_loop.container = container;
     result->data.for_loop.statements = statements;
     LUCI_DEBUG("Made for node containing %d stmts\n",
@@ -510,7 +557,9 @@ static int print_ast_graph_helper(AstNode *root, int id)
             id = print_ast_graph_helper(root->data.funcdef.statements, id);
             break;
         case ast_listdef_t:
-            printf("%d [label=\"list\"]\n", rID);
+        case ast_tupledef_t:
+            printf("%d [label=\"%s\"]\n", rID,
+                    root->type == ast_listdef_t ? "list" : "tuple");
             for (i = 0; i < root->data.listdef.count; i++)
             {
                 printf("%d -> %d\n", rID, ++id);
@@ -547,6 +596,13 @@ static int print_ast_graph_helper(AstNode *root, int id)
             printf("%d -> %d\n", rID, ++id);
             id = print_ast_graph_helper(root->data.assignment.right, id);
             break;
+        case ast_unpack_t:
+            printf("%d [label=\"unpack\"]\n", rID);
+            printf("%d -> %d\n", rID, ++id);
+            id = print_ast_graph_helper(root->data.unpack.names, id);
+            printf("%d -> %d\n", rID, ++id);
+            id = print_ast_graph_helper(root->data.unpack.right, id);
+            break;
         case ast_call_t:
             printf("%d [label=\"func call\"]\n", rID);
             printf("%d -> %d\n", rID, ++id);
@@ -601,6 +657,10 @@ static int print_ast_graph_helper(AstNode *root, int id)
             printf("%d [label=\"int: %ld\"]\n", rID,
                     root->data.i);
             break;
+        case ast_bigint_t:
+            printf("%d [label=\"int: %s\"]\n", rID,
+                    root->data.s);
+            break;
         default:
             break;
     }
@@ -636,6 +696,7 @@ void ast_destroy(AstNode *root)
             break;
 
         case ast_listdef_t:
+        case ast_tupledef_t:
             for (i = 0; i < root->data.listdef.count; i++)
             {
                 ast_destroy(root->data.listdef.items[i]);
@@ -643,6 +704,11 @@ void ast_destroy(AstNode *root)
             free(root->data.listdef.items);
             break;
 
+        case ast_unpack_t:
+            ast_destroy(root->data.unpack.names);
+            ast_destroy(root->data.unpack.right);
+            break;
+
         case ast_mapdef_t:
             for (i = 0; i < root->data.mapdef.count; i++)
             {
@@ -665,6 +731,7 @@ void ast_destroy(AstNode *root)
             ast_destroy(root->data.for_loop.container);
             ast_destroy(root->data.for_loop.statements);
             free(root->data.for_loop.iter);
+            free(root->data.for_loop.val);
             break;
 
         case ast_if_t:
@@ -708,6 +775,7 @@ void ast_destroy(AstNode *root)
             break;
 
         case ast_string_t:
+        case ast_bigint_t:
             free(root->data.s);
             break;
 
@@ -66,6 +66,9 @@ typedef enum {
     ast_continue_t,
     ast_return_t,
     ast_pass_t,
+    ast_tupledef_t,
+    ast_unpack_t,
+    ast_bigint_t,
     ast_last_t
 } AstType;
 
@@ -122,6 +125,17 @@ typedef struct
     int size;       /**< allocated # of list items */
 } AstListDef;
 
+/** AST Node representing an assignment to several names at once
+ *
+ * e.g.
+ * a, b = f();
+ */
+typedef struct
+{
+    struct AstNode *names;  /**< list definition of the names' strings */
+    struct AstNode *right;  /**< value to unpack */
+} AstUnpack;
+
 /** AST Node representing a container access
  *
  * e.g.
@@ -154,6 +168,8 @@ typedef struct
     struct AstNode *container;       /**< container to iterate over */
     struct AstNode *statements; /**< for-loop body statements */
     char *iter;                 /**< name of the step variable */
+    char *val;                  /**< name of the value variable in a
+                                     key/value loop (NULL otherwise) */
 } AstForLoop;
 
 /** AST Node representing an if-else block */
@@ -211,7 +227,8 @@ typedef struct AstNode
         AstContainerAssign contassign;  /**< container assignment node */
         AstMapDef mapdef;               /**< map definition node */
         AstMapKeyVal mapkeyval;         /**< map key-value pair node */
-        AstListDef listdef;             /**< list definition node */
+        AstListDef listdef;             /**< list or tuple definition node */
+        AstUnpack unpack;               /**< unpacking assignment node */
         AstAssignment assignment;       /**< assignment node */
         AstWhileLoop while_loop;        /**< while-loop node */
         AstForLoop for_loop;            /**< for-loop node */
@@ -231,6 +248,7 @@ void ast_destroy(AstNode *);
 
 AstNode *make_nil_expression();
 AstNode *make_int_constant(long);
+AstNode *make_bigint_constant(char *);
 AstNode *make_float_constant(double);
 AstNode *make_string_constant(char *);
 AstNode *make_id_expr(char *);
@@ -239,11 +257,13 @@ AstNode *make_binary_expr(AstNode *, AstNode *, op_type op);
 AstNode *make_container_access(AstNode *, AstNode *);
 AstNode *make_container_assignment(AstNode *, AstNode *, AstNode *);
 AstNode *make_list_def(AstNode *, AstNode *);
+AstNode *make_tuple_def(AstNode *);
+AstNode *make_unpack(AstNode *, AstNode *);
 AstNode *make_map_def(AstNode *, AstNode *);
 AstNode *make_map_keyval(AstNode *, AstNode *);
 AstNode *make_assignment(char *, AstNode *);
 AstNode *make_while_loop(AstNode *, AstNode *);
-AstNode *make_for_loop(char *, AstNode *, AstNode *);
+AstNode *make_for_loop(char *, char *, AstNode *, AstNode *);
 AstNode *make_if_else(AstNode *, AstNode *, AstNode *);
 AstNode *make_func_call(AstNode *, AstNode *);
 AstNode *make_func_def(char *, AstNode *, AstNode *);
@@ -0,0 +1,1380 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file biginttype.c
+ *
+ * Arbitrary-precision integers.
+ *
+ * LuciIntObj arithmetic checks for overflow and, when its result
+ * doesn't fit in a long, hands both operands to the functions here.
+ * Every result is demoted back to a LuciIntObj when it fits, so a
+ * LuciBigIntObj only exists while a value is too large for a long,
+ * and the common case never leaves inttype.c.
+ *
+ * Magnitudes are arrays of 32-bit digits, least significant first,
+ * so two digits multiply exactly in a uint64_t. Multiplication is
+ * schoolbook below KARATSUBA_CUTOFF digits and Karatsuba above it.
+ * Division is Knuth's algorithm D. Decimal conversion splits numbers
+ * in half by powers of 10^(9 * 2^k), converting each half recursively,
+ * and only works nine decimal digits at a time on short pieces.
+ */
+
+#include "biginttype.h"
+#include "hash.h"
+
+/** digits per operand below which multiplication is schoolbook */
+#define KARATSUBA_CUTOFF    40
+
+/** the largest power of 10 that fits in a digit */
+#define DECIMAL_BASE        1000000000U
+/** number of decimal digits in DECIMAL_BASE - 1 */
+#define DECIMAL_BASE_DIGITS 9
+/** digits below which decimal conversion works DECIMAL_BASE at a time */
+#define DECIMAL_CUTOFF      32
+/** more powers of 10 than decimal conversion of any string could use */
+#define MAX_DECIMAL_POWERS  64
+/** digits in the magnitude of the largest double */
+#define MAX_DOUBLE_DIGITS   32
+
+/**
+ * A read-only view of the value of a LuciIntObj or LuciBigIntObj
+ *
+ * Views of LuciIntObjs point into their own small array, so a view
+ * must not be copied.
+ */
+typedef struct {
+    int sign;               /**< -1, 0 or 1 */
+    size_t size;            /**< number of digits */
+    const uint32_t *digits; /**< magnitude, least significant first */
+    uint32_t small[2];      /**< storage for a LuciIntObj's magnitude */
+} BigView;
+
+/** 10^(9 * 2^k), used to split numbers during decimal conversion */
+typedef struct {
+    uint32_t *digits;       /**< magnitude, least significant first */
+    size_t size;            /**< number of digits */
+} DecimalPower;
+
+static unsigned int bigint_hash_0(LuciObject *o);
+static unsigned int bigint_hash_1(LuciObject *o);
+
+/** Type member table for LuciBigIntObj */
+LuciObjectType obj_bigint_t = {
+    "int",
+    sizeof(LuciBigIntObj),
+    TYPEID_BIGINT,
+
+    LuciBigInt_copy,
+    LuciBigInt_copy,
+    LuciBigInt_repr,
+    LuciBigInt_asbool,
+    unary_nil,
+    LuciBigInt_neg,
+    LuciObject_lgnot,
+    LuciBigInt_bwnot,
+
+    LuciBigInt_add,
+    LuciBigInt_sub,
+    LuciBigInt_mul,
+    LuciBigInt_div,
+    LuciBigInt_mod,
+    LuciBigInt_pow,
+    LuciBigInt_eq,
+    LuciBigInt_neq,
+    LuciBigInt_lt,
+    LuciBigInt_gt,
+    LuciBigInt_lte,
+    LuciBigInt_gte,
+    LuciObject_lgor,
+    LuciObject_lgand,
+    LuciBigInt_bwxor,
+    LuciBigInt_bwor,
+    LuciBigInt_bwand,
+
+    binary_nil,
+    binary_nil,
+    binary_nil,
+
+    ternary_nil,
+
+    LuciBigInt_print,
+
+    LuciBigInt_mark,
+    LuciBigInt_finalize,
+    bigint_hash_0,
+    bigint_hash_1
+};
+
+/**
+ * Returns the number of digits in a once leading zeros are dropped
+ */
+static size_t digits_trim(const uint32_t *a, size_t n)
+{
+    while (n > 0 && a[n - 1] == 0) {
+        n--;
+    }
+    return n;
+}
+
+/**
+ * Compares two trimmed magnitudes
+ *
+ * @returns -1, 0 or 1 as a is less than, equal to or greater than b
+ */
+static int digits_cmp(const uint32_t *a, size_t an,
+        const uint32_t *b, size_t bn)
+{
+    if (an != bn) {
+        return an < bn ? -1 : 1;
+    }
+    while (an-- > 0) {
+        if (a[an] != b[an]) {
+            return a[an] < b[an] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * r = a + b, where an >= bn
+ *
+ * r has room for an digits, and may be a.
+ *
+ * @returns the carry out of the top digit
+ */
+static uint32_t digits_add(uint32_t *r, const uint32_t *a, size_t an,
+        const uint32_t *b, size_t bn)
+{
+    uint64_t carry = 0;
+    size_t i;
+
+    for (i = 0; i < bn; i++) {
+        carry += (uint64_t)a[i] + b[i];
+        r[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    for (; i < an; i++) {
+        carry += a[i];
+        r[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    return (uint32_t)carry;
+}
+
+/**
+ * r = a - b, where a >= b and an >= bn
+ *
+ * r has room for an digits, and may be a.
+ */
+static void digits_sub(uint32_t *r, const uint32_t *a, size_t an,
+        const uint32_t *b, size_t bn)
+{
+    int64_t borrow = 0;
+    size_t i;
+
+    for (i = 0; i < bn; i++) {
+        borrow += (int64_t)a[i] - b[i];
+        r[i] = (uint32_t)borrow;
+        borrow = borrow < 0 ? -1 : 0;
+    }
+    for (; i < an; i++) {
+        borrow += a[i];
+        r[i] = (uint32_t)borrow;
+        borrow = borrow < 0 ? -1 : 0;
+    }
+}
+
+/**
+ * r = a * b by the schoolbook method
+ *
+ * r has room for an + bn digits and doesn't overlap a or b.
+ */
+static void digits_mul_school(uint32_t *r, const uint32_t *a, size_t an,
+        const uint32_t *b, size_t bn)
+{
+    size_t i, j;
+
+    memset(r, 0, (an + bn) * sizeof(*r));
+    for (i = 0; i < bn; i++) {
+        uint64_t carry = 0, bi = b[i];
+        if (bi == 0) {
+            continue;
+        }
+        for (j = 0; j < an; j++) {
+            carry += a[j] * bi + r[i + j];
+            r[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        r[i + an] = (uint32_t)carry;
+    }
+}
+
+/**
+ * r = a * b
+ *
+ * r has room for an + bn digits and doesn't overlap a or b.
+ *
+ * Operands of KARATSUBA_CUTOFF digits or more are split in halves,
+ * a = a1 * B^m + a0, and multiplied with three half-size products:
+ *
+ *     a * b = z2 * B^2m + (z1 - z2 - z0) * B^m + z0
+ *
+ * where z0 = a0 * b0, z2 = a1 * b1 and z1 = (a0 + a1) * (b0 + b1).
+ * When one operand is less than half as long as the other, the longer
+ * one is multiplied in pieces as long as the shorter one instead.
+ */
+static void digits_mul(uint32_t *r, const uint32_t *a, size_t an,
+        const uint32_t *b, size_t bn)
+{
+    if (an < bn) {
+        const uint32_t *t = a;
+        size_t tn = an;
+        a = b; an = bn;
+        b = t; bn = tn;
+    }
+
+    if (bn < KARATSUBA_CUTOFF) {
+        digits_mul_school(r, a, an, b, bn);
+        return;
+    }
+
+    size_t i;
+    if (2 * bn <= an) {
+        uint32_t *piece = alloc(2 * bn * sizeof(*piece));
+
+        memset(r, 0, (an + bn) * sizeof(*r));
+        for (i = 0; i < an; i += bn) {
+            size_t n = an - i < bn ? an - i : bn;
+            digits_mul(piece, a + i, n, b, bn);
+            digits_add(r + i, r + i, an + bn - i, piece, n + bn);
+        }
+        free(piece);
+        return;
+    }
+
+    /* bn > an / 2, so both high halves are non-empty */
+    size_t m = an / 2;
+    size_t a1n = an - m, b1n = bn - m;
+    size_t san = a1n + 1;
+    size_t sbn = (b1n > m ? b1n : m) + 1;
+    uint32_t *sa = alloc((san + sbn + san + sbn) * sizeof(*sa));
+    uint32_t *sb = sa + san;
+    uint32_t *z1 = sb + sbn;
+    size_t z0n, z2n, z1n;
+
+    /* z0 and z2 go straight into the low and high parts of r */
+    digits_mul(r, a, m, b, m);
+    digits_mul(r + 2 * m, a + m, a1n, b + m, b1n);
+
+    sa[san - 1] = digits_add(sa, a + m, a1n, a, m);
+    if (b1n >= m) {
+        sb[sbn - 1] = digits_add(sb, b + m, b1n, b, m);
+    } else {
+        sb[sbn - 1] = digits_add(sb, b, m, b + m, b1n);
+    }
+    digits_mul(z1, sa, san, sb, sbn);
+
+    z1n = digits_trim(z1, san + sbn);
+    z0n = digits_trim(r, 2 * m);
+    z2n = digits_trim(r + 2 * m, a1n + b1n);
+    digits_sub(z1, z1, z1n, r, z0n);
+    digits_sub(z1, z1, z1n, r + 2 * m, z2n);
+    z1n = digits_trim(z1, z1n);
+    digits_add(r + m, r + m, an + bn - m, z1, z1n);
+
+    free(sa);
+}
+
+/**
+ * q = a / d, for a single digit d
+ *
+ * q has room for n digits, and may be a.
+ *
+ * @returns a % d
+ */
+static uint32_t digits_divmod_1(uint32_t *q, const uint32_t *a, size_t n,
+        uint32_t d)
+{
+    uint64_t rem = 0;
+
+    while (n-- > 0) {
+        rem = (rem << 32) | a[n];
+        q[n] = (uint32_t)(rem / d);
+        rem %= d;
+    }
+    return (uint32_t)rem;
+}
+
+/**
+ * q = a / b and r = a % b, by Knuth's algorithm D
+ *
+ * Requires trimmed operands with an >= bn >= 2. q has room for
+ * an - bn + 1 digits and r for bn digits.
+ */
+static void digits_divmod(uint32_t *q, uint32_t *r,
+        const uint32_t *a, size_t an, const uint32_t *b, size_t bn)
+{
+    /* shift both operands so the divisor's top digit has its top bit
+     * set, which keeps each estimated quotient digit within 2 of the
+     * real one */
+    int s = __builtin_clz(b[bn - 1]);
+    uint32_t *u = alloc((an + 1 + bn) * sizeof(*u));
+    uint32_t *v = u + an + 1;
+    uint64_t carry = 0;
+    size_t i;
+    long j;
+
+    for (i = 0; i < bn; i++) {
+        uint64_t x = ((uint64_t)b[i] << s) | carry;
+        v[i] = (uint32_t)x;
+        carry = x >> 32;
+    }
+    carry = 0;
+    for (i = 0; i < an; i++) {
+        uint64_t x = ((uint64_t)a[i] << s) | carry;
+        u[i] = (uint32_t)x;
+        carry = x >> 32;
+    }
+    u[an] = (uint32_t)carry;
+
+    for (j = an - bn; j >= 0; j--) {
+        uint64_t top = ((uint64_t)u[j + bn] << 32) | u[j + bn - 1];
+        uint64_t qhat = top / v[bn - 1];
+        uint64_t rhat = top % v[bn - 1];
+
+        while (qhat > UINT32_MAX ||
+                qhat * v[bn - 2] > ((rhat << 32) | u[j + bn - 2])) {
+            qhat--;
+            rhat += v[bn - 1];
+            if (rhat > UINT32_MAX) {
+                break;
+            }
+        }
+
+        /* u[j .. j + bn] -= qhat * v */
+        int64_t borrow = 0;
+        carry = 0;
+        for (i = 0; i < bn; i++) {
+            uint64_t p = qhat * v[i] + carry;
+            carry = p >> 32;
+            borrow += (int64_t)u[i + j] - (uint32_t)p;
+            u[i + j] = (uint32_t)borrow;
+            borrow = borrow < 0 ? -1 : 0;
+        }
+        borrow += (int64_t)u[j + bn] - (int64_t)carry;
+        u[j + bn] = (uint32_t)borrow;
+
+        if (borrow < 0) {
+            /* qhat was one too large, so add v back */
+            qhat--;
+            carry = 0;
+            for (i = 0; i < bn; i++) {
+                carry += (uint64_t)u[i + j] + v[i];
+                u[i + j] = (uint32_t)carry;
+                carry >>= 32;
+            }
+            u[j + bn] += (uint32_t)carry;
+        }
+        q[j] = (uint32_t)qhat;
+    }
+
+    for (i = 0; i + 1 < bn; i++) {
+        r[i] = (uint32_t)((((uint64_t)u[i + 1] << 32) | u[i]) >> s);
+    }
+    r[bn - 1] = u[bn - 1] >> s;
+    free(u);
+}
+
+/**
+ * Fills in a view of the value of a LuciIntObj or LuciBigIntObj
+ *
+ * Dies if o is any other type.
+ */
+static void bigint_view(LuciObject *o, BigView *v, const char *what)
+{
+    if (ISTYPE(o, obj_bigint_t)) {
+        v->sign = AS_BIGINT(o)->sign;
+        v->size = AS_BIGINT(o)->size;
+        v->digits = AS_BIGINT(o)->digits;
+    } else if (ISTYPE(o, obj_int_t)) {
+        long l = AS_INT(o)->i;
+        uint64_t m = l < 0 ? -(uint64_t)l : (uint64_t)l;
+        v->sign = l < 0 ? -1 : (l > 0);
+        v->small[0] = (uint32_t)m;
+        v->small[1] = (uint32_t)(m >> 32);
+        v->size = digits_trim(v->small, 2);
+        v->digits = v->small;
+    } else {
+        LUCI_DIE("Cannot %s an int and an object of type %s\n",
+                what, o->type->type_name);
+    }
+}
+
+/**
+ * Creates an integer from a sign and an allocated magnitude
+ *
+ * Takes ownership of digits. The result is a LuciIntObj whenever the
+ * value fits in a long.
+ *
+ * @param sign -1 or 1 (ignored if the magnitude is zero)
+ * @param digits allocated magnitude, least significant first
+ * @param size number of digits, possibly including leading zeros
+ * @returns new LuciIntObj or LuciBigIntObj
+ */
+static LuciObject *bigint_result(int sign, uint32_t *digits, size_t size)
+{
+    size = digits_trim(digits, size);
+
+    if (size <= 2) {
+        uint64_t m = size == 0 ? 0 : digits[0];
+        if (size == 2) {
+            m |= (uint64_t)digits[1] << 32;
+        }
+        if ((sign > 0 || m == 0) && m <= (uint64_t)LONG_MAX) {
+            free(digits);
+            return LuciInt_new((long)m);
+        } else if (sign < 0 && m <= (uint64_t)LONG_MAX + 1) {
+            free(digits);
+            return LuciInt_new(-(long)(m - 1) - 1);
+        }
+    }
+
+    LuciBigIntObj *o = (LuciBigIntObj *)gc_malloc(&obj_bigint_t);
+    o->sign = sign < 0 ? -1 : 1;
+    o->size = size;
+    o->digits = digits;
+    return (LuciObject *)o;
+}
+
+/**
+ * Sums or subtracts two views
+ *
+ * @param a first operand
+ * @param b second operand
+ * @param bsign sign to give b, negated for subtraction
+ * @returns a + b
+ */
+static LuciObject *bigint_add_views(BigView *a, BigView *b, int bsign)
+{
+    size_t n = (a->size > b->size ? a->size : b->size) + 1;
+    uint32_t *r = alloc(n * sizeof(*r));
+
+    if (b->sign == 0) {
+        memcpy(r, a->digits, a->size * sizeof(*r));
+        return bigint_result(a->sign, r, a->size);
+    } else if (a->sign == 0) {
+        memcpy(r, b->digits, b->size * sizeof(*r));
+        return bigint_result(bsign, r, b->size);
+    } else if (a->sign == bsign) {
+        if (a->size >= b->size) {
+            r[n - 1] = digits_add(r, a->digits, a->size, b->digits, b->size);
+        } else {
+            r[n - 1] = digits_add(r, b->digits, b->size, a->digits, a->size);
+        }
+        return bigint_result(a->sign, r, n);
+    } else if (digits_cmp(a->digits, a->size, b->digits, b->size) >= 0) {
+        digits_sub(r, a->digits, a->size, b->digits, b->size);
+        return bigint_result(a->sign, r, a->size);
+    } else {
+        digits_sub(r, b->digits, b->size, a->digits, a->size);
+        return bigint_result(bsign, r, b->size);
+    }
+}
+
+/**
+ * Computes the product of two views
+ */
+static LuciObject *bigint_mul_views(BigView *a, BigView *b)
+{
+    if (a->sign == 0 || b->sign == 0) {
+        return LuciInt_new(0);
+    }
+
+    uint32_t *r = alloc((a->size + b->size) * sizeof(*r));
+    digits_mul(r, a->digits, a->size, b->digits, b->size);
+    return bigint_result(a->sign * b->sign, r, a->size + b->size);
+}
+
+/**
+ * Divides two views, truncating toward zero like C (and LuciIntObj)
+ *
+ * @param a dividend
+ * @param b divisor
+ * @param quot if not NULL, receives a / b
+ * @param rem if not NULL, receives a % b, which has the sign of a
+ */
+static void bigint_divmod_views(BigView *a, BigView *b,
+        LuciObject **quot, LuciObject **rem)
+{
+    if (b->sign == 0) {
+        LUCI_DIE("%s\n", "Divide by zero");
+    }
+
+    if (digits_cmp(a->digits, a->size, b->digits, b->size) < 0) {
+        if (quot) {
+            *quot = LuciInt_new(0);
+        }
+        if (rem) {
+            uint32_t *r = alloc((a->size + 1) * sizeof(*r));
+            memcpy(r, a->digits, a->size * sizeof(*r));
+            *rem = bigint_result(a->sign, r, a->size);
+        }
+        return;
+    }
+
+    size_t qn = a->size - b->size + 1;
+    uint32_t *q = alloc(qn * sizeof(*q));
+    uint32_t *r = alloc(b->size * sizeof(*r));
+
+    if (b->size == 1) {
+        r[0] = digits_divmod_1(q, a->digits, a->size, b->digits[0]);
+        qn = a->size;
+    } else {
+        digits_divmod(q, r, a->digits, a->size, b->digits, b->size);
+    }
+
+    if (quot) {
+        *quot = bigint_result(a->sign * b->sign, q, qn);
+    } else {
+        free(q);
+    }
+    if (rem) {
+        *rem = bigint_result(a->sign, r, b->size);
+    } else {
+        free(r);
+    }
+}
+
+/**
+ * Compares two integers
+ *
+ * @returns -1, 0 or 1 as a is less than, equal to or greater than b
+ */
+static int bigint_cmp(LuciObject *a, LuciObject *b, const char *what)
+{
+    BigView va, vb;
+    bigint_view(a, &va, what);
+    bigint_view(b, &vb, what);
+
+    if (va.sign != vb.sign) {
+        return va.sign < vb.sign ? -1 : 1;
+    }
+    return va.sign * digits_cmp(va.digits, va.size, vb.digits, vb.size);
+}
+
+/**
+ * Computes the two's complement of a view, sign-extended to n digits
+ *
+ * @returns allocated array of n digits
+ */
+static uint32_t *bigint_twos(BigView *v, size_t n)
+{
+    uint32_t *r = calloc(n, sizeof(*r));
+    size_t i;
+
+    if (!r) {
+        LUCI_DIE("%s\n", "Out of memory");
+    }
+    memcpy(r, v->digits, v->size * sizeof(*r));
+    if (v->sign < 0) {
+        uint64_t carry = 1;
+        for (i = 0; i < n; i++) {
+            carry += (uint32_t)~r[i];
+            r[i] = (uint32_t)carry;
+            carry >>= 32;
+        }
+    }
+    return r;
+}
+
+/**
+ * Computes a bitwise operation on two integers, as if both were
+ * infinitely sign-extended two's complement numbers
+ *
+ * @param op '^', '|' or '&'
+ */
+static LuciObject *bigint_bitwise(LuciObject *a, LuciObject *b, char op)
+{
+    BigView va, vb;
+    bigint_view(a, &va, "compute a bitwise operation on");
+    bigint_view(b, &vb, "compute a bitwise operation on");
+
+    size_t n = (va.size > vb.size ? va.size : vb.size) + 1;
+    uint32_t *x = bigint_twos(&va, n);
+    uint32_t *y = bigint_twos(&vb, n);
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        switch (op) {
+            case '^': x[i] ^= y[i]; break;
+            case '|': x[i] |= y[i]; break;
+            default:  x[i] &= y[i]; break;
+        }
+    }
+    free(y);
+
+    int sign = 1;
+    if (x[n - 1] >> 31) {
+        /* negative, so convert back to a magnitude */
+        uint64_t carry = 1;
+        sign = -1;
+        for (i = 0; i < n; i++) {
+            carry += (uint32_t)~x[i];
+            x[i] = (uint32_t)carry;
+            carry >>= 32;
+        }
+    }
+    return bigint_result(sign, x, n);
+}
+
+/**
+ * Computes pows[k] = 10^(9 * 2^k), by squaring pows[k - 1]
+ */
+static void decimal_power(DecimalPower *pows, int k)
+{
+    if (k == 0) {
+        pows[0].digits = alloc(sizeof(uint32_t));
+        pows[0].digits[0] = DECIMAL_BASE;
+        pows[0].size = 1;
+        return;
+    }
+
+    size_t size = 2 * pows[k - 1].size;
+    pows[k].digits = alloc(size * sizeof(uint32_t));
+    digits_mul(pows[k].digits, pows[k - 1].digits, pows[k - 1].size,
+            pows[k - 1].digits, pows[k - 1].size);
+    pows[k].size = digits_trim(pows[k].digits, size);
+}
+
+/**
+ * Frees pows[0] through pows[k]
+ */
+static void decimal_powers_free(DecimalPower *pows, int k)
+{
+    while (k >= 0) {
+        free(pows[k--].digits);
+    }
+}
+
+/**
+ * Writes a magnitude less than 10^(9 * 2^k) as exactly 9 * 2^k
+ * decimal digits, zero-padded, ending just before end
+ *
+ * Large magnitudes are split in two by dividing by pows[k - 1], and
+ * each half is written recursively, so the work is done by a few
+ * long divisions instead of one short division per nine digits.
+ * Destroys a.
+ */
+static void digits_to_decimal(uint32_t *a, size_t n, DecimalPower *pows,
+        int k, char *end)
+{
+    n = digits_trim(a, n);
+
+    if (k == 0 || n < DECIMAL_CUTOFF) {
+        char *start = end - ((size_t)DECIMAL_BASE_DIGITS << k);
+        int i;
+        while (n > 0) {
+            uint32_t chunk = digits_divmod_1(a, a, n, DECIMAL_BASE);
+            n = digits_trim(a, n);
+            for (i = 0; i < DECIMAL_BASE_DIGITS; i++) {
+                *--end = '0' + chunk % 10;
+                chunk /= 10;
+            }
+        }
+        memset(start, '0', end - start);
+        return;
+    }
+
+    DecimalPower *p = &pows[k - 1];
+    size_t half = (size_t)DECIMAL_BASE_DIGITS << (k - 1);
+
+    if (digits_cmp(a, n, p->digits, p->size) < 0) {
+        digits_to_decimal(a, n, pows, k - 1, end);
+        memset(end - 2 * half, '0', half);
+        return;
+    }
+
+    size_t qn = n - p->size + 1;
+    uint32_t *q = alloc(qn * sizeof(*q));
+    uint32_t *r = alloc(p->size * sizeof(*r));
+    if (p->size == 1) {
+        r[0] = digits_divmod_1(q, a, n, p->digits[0]);
+        qn = n;
+    } else {
+        digits_divmod(q, r, a, n, p->digits, p->size);
+    }
+    digits_to_decimal(r, p->size, pows, k - 1, end);
+    digits_to_decimal(q, qn, pows, k - 1, end - half);
+    free(q);
+    free(r);
+}
+
+/**
+ * Converts len decimal digits to a magnitude
+ *
+ * Long strings are split so that the low part is 9 * 2^k digits long,
+ * and the result is high * pows[k] + low, so the work is done by a few
+ * long (Karatsuba) multiplications.
+ *
+ * @param r room for len / 9 + 3 digits
+ * @returns number of digits in r
+ */
+static size_t decimal_to_digits(const char *s, size_t len,
+        DecimalPower *pows, uint32_t *r)
+{
+    size_t i, n = 0;
+
+    if (len <= DECIMAL_CUTOFF * DECIMAL_BASE_DIGITS) {
+        /* the first chunk takes the leftover digits, so that every
+         * other chunk is exactly DECIMAL_BASE_DIGITS long */
+        size_t chunk = len % DECIMAL_BASE_DIGITS;
+        if (chunk == 0) {
+            chunk = DECIMAL_BASE_DIGITS;
+        }
+        while (len > 0) {
+            uint64_t carry = 0, scale = 1;
+            for (i = 0; i < chunk; i++) {
+                carry = carry * 10 + (s[i] - '0');
+                scale *= 10;
+            }
+            s += chunk;
+            len -= chunk;
+            chunk = DECIMAL_BASE_DIGITS;
+
+            /* r = r * scale + carry */
+            for (i = 0; i < n; i++) {
+                carry += r[i] * scale;
+                r[i] = (uint32_t)carry;
+                carry >>= 32;
+            }
+            if (carry) {
+                r[n++] = (uint32_t)carry;
+            }
+        }
+        return n;
+    }
+
+    int k = 0;
+    while (((size_t)DECIMAL_BASE_DIGITS << (k + 1)) < len) {
+        k++;
+    }
+    size_t w = (size_t)DECIMAL_BASE_DIGITS << k;
+    uint32_t *high = alloc(((len - w) / DECIMAL_BASE_DIGITS + 3) *
+            sizeof(*high));
+    uint32_t *low = alloc((w / DECIMAL_BASE_DIGITS + 3) * sizeof(*low));
+    size_t hn = decimal_to_digits(s, len - w, pows, high);
+    size_t ln = decimal_to_digits(s + len - w, w, pows, low);
+
+    if (hn == 0) {
+        memcpy(r, low, ln * sizeof(*r));
+        n = ln;
+    } else {
+        n = hn + pows[k].size;
+        digits_mul(r, high, hn, pows[k].digits, pows[k].size);
+        digits_add(r, r, n, low, ln);
+    }
+    free(high);
+    free(low);
+    return digits_trim(r, n);
+}
+
+/**
+ * Parses a decimal integer of any size
+ *
+ * Like sscanf's "%ld", skips leading whitespace, accepts a sign and
+ * stops at the first character that isn't a decimal digit.
+ *
+ * @param s C-string
+ * @returns new LuciIntObj or LuciBigIntObj, or NULL if s has no digits
+ */
+LuciObject *LuciBigInt_parse(const char *s)
+{
+    int sign = 1;
+    size_t ndigits;
+
+    while (*s == ' ' || (*s >= '\t' && *s <= '\r')) {
+        s++;
+    }
+    if (*s == '-' || *s == '+') {
+        sign = *s == '-' ? -1 : 1;
+        s++;
+    }
+    for (ndigits = 0; s[ndigits] >= '0' && s[ndigits] <= '9'; ndigits++)
+        ;
+    if (ndigits == 0) {
+        return NULL;
+    }
+
+    /* ndigits < 9 * 2^(k + 1), so pows[0] to pows[k] are enough */
+    DecimalPower pows[MAX_DECIMAL_POWERS];
+    int k = 0;
+    decimal_power(pows, 0);
+    while (((size_t)DECIMAL_BASE_DIGITS << (k + 1)) < ndigits) {
+        decimal_power(pows, ++k);
+    }
+
+    uint32_t *r = alloc((ndigits / DECIMAL_BASE_DIGITS + 3) * sizeof(*r));
+    size_t n = decimal_to_digits(s, ndigits, pows, r);
+    decimal_powers_free(pows, k);
+    return bigint_result(sign, r, n);
+}
+
+/**
+ * Produces the hex representation of a LuciBigIntObj
+ *
+ * Negative values are written "-0x...".
+ *
+ * @param o LuciBigIntObj
+ * @returns new LuciStringObj
+ */
+LuciObject *LuciBigInt_hex(LuciObject *o)
+{
+    LuciBigIntObj *b = AS_BIGINT(o);
+    size_t len = b->size * 8 + 4;
+    char *s = alloc(len);
+    int n = 0;
+    long i;
+
+    n += sprintf(s, "%s0x%X", b->sign < 0 ? "-" : "", b->digits[b->size - 1]);
+    for (i = b->size - 2; i >= 0; i--) {
+        n += sprintf(s + n, "%08X", b->digits[i]);
+    }
+    return LuciString_new(s);
+}
+
+/**
+ * Converts a LuciBigIntObj to the nearest double
+ *
+ * @param o LuciBigIntObj
+ * @returns double value of o
+ */
+double LuciBigInt_as_double(LuciObject *o)
+{
+    LuciBigIntObj *b = AS_BIGINT(o);
+    double d = 0.0;
+    long i;
+
+    for (i = b->size - 1; i >= 0; i--) {
+        d = d * 4294967296.0 + b->digits[i];
+    }
+    return b->sign * d;
+}
+
+/**
+ * Copies a LuciBigIntObj
+ *
+ * Ints are immutable, so copies share the original.
+ *
+ * @param orig LuciBigIntObj to copy
+ * @returns orig
+ */
+LuciObject* LuciBigInt_copy(LuciObject *orig)
+{
+    return orig;
+}
+
+/**
+ * Produces the decimal LuciStringObj representation of a LuciBigIntObj
+ *
+ * @param o LuciBigIntObj to represent
+ * @returns LuciStringObj representation of o
+ */
+LuciObject* LuciBigInt_repr(LuciObject *o)
+{
+    LuciBigIntObj *b = AS_BIGINT(o);
+    DecimalPower pows[MAX_DECIMAL_POWERS];
+    int k = 0;
+
+    /* find the first power of 10 with more digits than b, so that
+     * b < 10^(9 * 2^k) */
+    decimal_power(pows, 0);
+    while (pows[k].size <= b->size) {
+        decimal_power(pows, ++k);
+    }
+
+    size_t width = (size_t)DECIMAL_BASE_DIGITS << k;
+    char *s = alloc(width + 2);
+    char *p = s + 1;
+    uint32_t *t = alloc(b->size * sizeof(*t));
+
+    memcpy(t, b->digits, b->size * sizeof(*t));
+    digits_to_decimal(t, b->size, pows, k, p + width);
+    free(t);
+    decimal_powers_free(pows, k);
+
+    while (*p == '0') {
+        p++;
+    }
+    if (b->sign < 0) {
+        *--p = '-';
+    }
+    width -= p - (s + 1);
+    memmove(s, p, width);
+    s[width] = '\0';
+    return LuciString_new(s);
+}
+
+/**
+ * Returns boolean representation of a LuciBigIntObj
+ *
+ * A LuciBigIntObj is never 0, so it is always true, like every
+ * nonzero LuciIntObj.
+ *
+ * @param o LuciBigIntObj
+ * @returns true
+ */
+LuciObject* LuciBigInt_asbool(LuciObject *o)
+{
+    return LuciTrueObj;
+}
+
+/**
+ * Sum
+ *
+ * Either operand may be a LuciIntObj, since LuciInt_add calls this
+ * when its result overflows.
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a + b
+ */
+LuciObject* LuciBigInt_add(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_float_t)) {
+        return LuciFloat_new(LuciBigInt_as_double(a) + AS_FLOAT(b)->f);
+    }
+
+    BigView va, vb;
+    bigint_view(a, &va, "add");
+    bigint_view(b, &vb, "add");
+    return bigint_add_views(&va, &vb, vb.sign);
+}
+
+/**
+ * Difference
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a - b
+ */
+LuciObject* LuciBigInt_sub(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_float_t)) {
+        return LuciFloat_new(LuciBigInt_as_double(a) - AS_FLOAT(b)->f);
+    }
+
+    BigView va, vb;
+    bigint_view(a, &va, "subtract");
+    bigint_view(b, &vb, "subtract");
+    return bigint_add_views(&va, &vb, -vb.sign);
+}
+
+/**
+ * Multiplied by
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a * b
+ */
+LuciObject* LuciBigInt_mul(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_float_t)) {
+        return LuciFloat_new(LuciBigInt_as_double(a) * AS_FLOAT(b)->f);
+    }
+
+    BigView va, vb;
+    bigint_view(a, &va, "multiply");
+    bigint_view(b, &vb, "multiply");
+    return bigint_mul_views(&va, &vb);
+}
+
+/**
+ * Divided by
+ *
+ * Truncates toward zero, like LuciIntObj division.
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a / b
+ */
+LuciObject* LuciBigInt_div(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_float_t)) {
+        if (AS_FLOAT(b)->f == 0.0) {
+            LUCI_DIE("%s\n", "Divide by zero");
+        }
+        return LuciFloat_new(LuciBigInt_as_double(a) / AS_FLOAT(b)->f);
+    }
+
+    BigView va, vb;
+    LuciObject *q;
+    bigint_view(a, &va, "divide");
+    bigint_view(b, &vb, "divide");
+    bigint_divmod_views(&va, &vb, &q, NULL);
+    return q;
+}
+
+/**
+ * Modulo
+ *
+ * The result has the sign of a, like LuciIntObj modulo.
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a % b
+ */
+LuciObject* LuciBigInt_mod(LuciObject *a, LuciObject *b)
+{
+    BigView va, vb;
+    LuciObject *r;
+    bigint_view(a, &va, "compute the modulo of");
+    bigint_view(b, &vb, "compute the modulo of");
+    if (vb.sign == 0) {
+        LUCI_DIE("%s\n", "Modulo divide by zero");
+    }
+    bigint_divmod_views(&va, &vb, NULL, &r);
+    return r;
+}
+
+/**
+ * Exponential
+ *
+ * Computed by repeated squaring. The exponent must fit in a LuciIntObj.
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a ** b
+ */
+LuciObject* LuciBigInt_pow(LuciObject *a, LuciObject *b)
+{
+    double fa = ISTYPE(a, obj_int_t) ? (double)AS_INT(a)->i :
+            LuciBigInt_as_double(a);
+
+    if (ISTYPE(b, obj_float_t)) {
+        return LuciFloat_new(pow(fa, AS_FLOAT(b)->f));
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        LUCI_DIE("%s\n", "Exponent too large");
+    } else if (!ISTYPE(b, obj_int_t)) {
+        LUCI_DIE("Cannot compute the power of an int using an object "
+                "of type %s\n", b->type->type_name);
+    }
+
+    long e = AS_INT(b)->i;
+    if (e < 0) {
+        /* truncated, like LuciInt_pow */
+        return LuciInt_new(pow(fa, e));
+    }
+
+    LuciObject *res = LuciInt_new(1);
+    LuciObject *base = a;
+    while (e > 0) {
+        BigView vr, vb;
+        if (e & 1) {
+            bigint_view(res, &vr, "multiply");
+            bigint_view(base, &vb, "multiply");
+            res = bigint_mul_views(&vr, &vb);
+        }
+        e >>= 1;
+        if (e > 0) {
+            bigint_view(base, &vb, "multiply");
+            base = bigint_mul_views(&vb, &vb);
+        }
+    }
+    return res;
+}
+
+/**
+ * Equal to
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a == b
+ */
+LuciObject* LuciBigInt_eq(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_float_t)) {
+        return LuciBool(LuciBigInt_as_double(a) == AS_FLOAT(b)->f);
+    }
+    return LuciBool(bigint_cmp(a, b, "compare") == 0);
+}
+
+/**
+ * Not equal to
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a != b
+ */
+LuciObject* LuciBigInt_neq(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_float_t)) {
+        return LuciBool(LuciBigInt_as_double(a) != AS_FLOAT(b)->f);
+    }
+    return LuciBool(bigint_cmp(a, b, "compare") != 0);
+}
+
+/**
+ * Less than
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a < b
+ */
+LuciObject* LuciBigInt_lt(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_float_t)) {
+        return LuciBool(LuciBigInt_as_double(a) < AS_FLOAT(b)->f);
+    }
+    return LuciBool(bigint_cmp(a, b, "compare") < 0);
+}
+
+/**
+ * Greater than
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a > b
+ */
+LuciObject* LuciBigInt_gt(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_float_t)) {
+        return LuciBool(LuciBigInt_as_double(a) > AS_FLOAT(b)->f);
+    }
+    return LuciBool(bigint_cmp(a, b, "compare") > 0);
+}
+
+/**
+ * Less than or equal to
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a <= b
+ */
+LuciObject* LuciBigInt_lte(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_float_t)) {
+        return LuciBool(LuciBigInt_as_double(a) <= AS_FLOAT(b)->f);
+    }
+    return LuciBool(bigint_cmp(a, b, "compare") <= 0);
+}
+
+/**
+ * Greater than or equal to
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciObject
+ * @returns a >= b
+ */
+LuciObject* LuciBigInt_gte(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_float_t)) {
+        return LuciBool(LuciBigInt_as_double(a) >= AS_FLOAT(b)->f);
+    }
+    return LuciBool(bigint_cmp(a, b, "compare") >= 0);
+}
+
+/**
+ * Bitwise-XOR
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciIntObj or LuciBigIntObj
+ * @returns a ^ b
+ */
+LuciObject* LuciBigInt_bwxor(LuciObject *a, LuciObject *b)
+{
+    return bigint_bitwise(a, b, '^');
+}
+
+/**
+ * Bitwise-OR
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciIntObj or LuciBigIntObj
+ * @returns a | b
+ */
+LuciObject* LuciBigInt_bwor(LuciObject *a, LuciObject *b)
+{
+    return bigint_bitwise(a, b, '|');
+}
+
+/**
+ * Bitwise-AND
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @param b LuciIntObj or LuciBigIntObj
+ * @returns a & b
+ */
+LuciObject* LuciBigInt_bwand(LuciObject *a, LuciObject *b)
+{
+    return bigint_bitwise(a, b, '&');
+}
+
+/**
+ * Negates a LuciBigIntObj
+ *
+ * @param a LuciIntObj or LuciBigIntObj
+ * @returns negative a
+ */
+LuciObject* LuciBigInt_neg(LuciObject *a)
+{
+    BigView va;
+    bigint_view(a, &va, "negate");
+
+    uint32_t *r = alloc((va.size + 1) * sizeof(*r));
+    memcpy(r, va.digits, va.size * sizeof(*r));
+    return bigint_result(-va.sign, r, va.size);
+}
+
+/**
+ * Returns bitwise-not of a LuciBigIntObj
+ *
+ * @param a LuciBigIntObj
+ * @returns -a - 1
+ */
+LuciObject* LuciBigInt_bwnot(LuciObject *a)
+{
+    return LuciBigInt_sub(LuciBigInt_neg(a), LuciInt_new(1));
+}
+
+/**
+ * Prints a LuciBigIntObj to stdout
+ *
+ * @param in LuciBigIntObj to print
+ */
+void LuciBigInt_print(LuciObject *in)
+{
+    LuciObject *s = LuciBigInt_repr(in);
+    fwrite(AS_STRING(s)->s, 1, AS_STRING(s)->len, stdout);
+}
+
+/**
+ * Marks a LuciBigIntObj as reachable
+ *
+ * @param in LuciBigIntObj
+ */
+void LuciBigInt_mark(LuciObject *in)
+{
+    GC_MARK(in);
+}
+
+/**
+ * Frees the digits of a LuciBigIntObj
+ *
+ * @param in LuciBigIntObj
+ */
+void LuciBigInt_finalize(LuciObject *in)
+{
+    free(AS_BIGINT(in)->digits);
+}
+
+/**
+ * Converts an integral double outside the range of a long to digits
+ *
+ * @param f finite, integral double with magnitude at least 2^63
+ * @param digits array of at least MAX_DOUBLE_DIGITS digits to fill
+ * @param sign set to the sign of f
+ * @returns number of digits in the magnitude of f
+ */
+static size_t double_to_digits(double f, uint32_t *digits, int *sign)
+{
+    unsigned __int128 mant;
+    size_t shift, size;
+    int exp;
+
+    *sign = f < 0 ? -1 : 1;
+    /* f = mant * 2^(exp - 53), with mant an integer of 53 bits */
+    mant = (uint64_t)ldexp(frexp(fabs(f), &exp), 53);
+    shift = exp - 53;
+    size = (exp + 31) / 32;
+    memset(digits, 0, size * sizeof(*digits));
+
+    mant <<= shift % 32;
+    for (shift /= 32; mant; shift++, mant >>= 32) {
+        digits[shift] = (uint32_t)mant;
+    }
+    return size;
+}
+
+/**
+ * Computes the seeded 64-bit hash of a magnitude and sign
+ *
+ * @param sign -1 or 1
+ * @param digits magnitude, least significant first
+ * @param size number of digits
+ * @returns 64-bit hash
+ */
+static uint64_t bigint_hash(int sign, const uint32_t *digits, size_t size)
+{
+    return hash_bytes_seeded(digits, size * sizeof(*digits), (uint64_t)sign);
+}
+
+/**
+ * Computes the 64-bit hash of the LuciBigIntObj equal to a double
+ *
+ * @param f finite, integral double outside the range of a long
+ * @returns 64-bit hash, matching that of the equal LuciBigIntObj
+ */
+uint64_t LuciBigInt_hash_double(double f)
+{
+    uint32_t digits[MAX_DOUBLE_DIGITS];
+    int sign;
+    size_t size = double_to_digits(f, digits, &sign);
+
+    return bigint_hash(sign, digits, size);
+}
+
+/**
+ * Determines whether a LuciBigIntObj is exactly equal to a double
+ *
+ * Unlike LuciBigInt_eq, never rounds the LuciBigIntObj to a double.
+ *
+ * @param o LuciBigIntObj
+ * @param f double
+ * @returns true if f is exactly the value of o
+ */
+bool LuciBigInt_equals_double(LuciObject *o, double f)
+{
+    LuciBigIntObj *b = AS_BIGINT(o);
+    uint32_t digits[MAX_DOUBLE_DIGITS];
+    int sign;
+    size_t size;
+
+    /* a LuciBigIntObj never holds a value that fits in a long */
+    if (!isfinite(f) || f != floor(f) ||
+            (f >= (double)LONG_MIN && f < -(double)LONG_MIN)) {
+        return false;
+    }
+    size = double_to_digits(f, digits, &sign);
+    return b->sign == sign && b->size == size &&
+        memcmp(b->digits, digits, size * sizeof(*digits)) == 0;
+}
+
+/**
+ * Computes the primary hash of a LuciBigIntObj
+ *
+ * Integral floats outside the range of a long hash like the equal
+ * LuciBigIntObj (see LuciBigInt_hash_double). A LuciBigIntObj never
+ * equals a LuciIntObj, so its hash needn't match any int's.
+ *
+ * @param o LuciBigIntObj to hash
+ * @returns unsigned integer hash
+ */
+static unsigned int bigint_hash_0(LuciObject *o)
+{
+    LuciBigIntObj *b = AS_BIGINT(o);
+    return (unsigned int)bigint_hash(b->sign, b->digits, b->size);
+}
+
+/**
+ * Computes the secondary hash of a LuciBigIntObj
+ *
+ * @param o LuciBigIntObj to hash
+ * @returns unsigned integer hash
+ */
+static unsigned int bigint_hash_1(LuciObject *o)
+{
+    LuciBigIntObj *b = AS_BIGINT(o);
+    return (unsigned int)(bigint_hash(b->sign, b->digits, b->size) >> 32);
+}
@@ -0,0 +1,68 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file biginttype.h
+ */
+
+#ifndef LUCI_BIGINTTYPE_H
+#define LUCI_BIGINTTYPE_H
+
+#include "lucitypes.h"
+
+extern LuciObjectType obj_bigint_t;
+
+/**
+ * Arbitrary-precision integer object type
+ *
+ * Only holds values that don't fit in a LuciIntObj. Every operation
+ * demotes its result back to a LuciIntObj when it fits, so zero is
+ * never a LuciBigIntObj.
+ */
+typedef struct LuciBigIntObj_
+{
+    LuciObject base;    /**< base implementation */
+    int sign;           /**< 1 or -1 */
+    unsigned int size;  /**< number of digits */
+    uint32_t *digits;   /**< magnitude in base 2^32, least significant first */
+} LuciBigIntObj;
+
+/** casts LuciObject o to a LuciBigIntObj */
+#define AS_BIGINT(o)    ((LuciBigIntObj *)(o))
+
+/** returns 1 if the object is a LuciIntObj or a LuciBigIntObj */
+#define ISINTEGER(o)    (ISTYPE(o, obj_int_t) || ISTYPE(o, obj_bigint_t))
+
+LuciObject *LuciBigInt_parse(const char *s);
+LuciObject *LuciBigInt_hex(LuciObject *o);
+double LuciBigInt_as_double(LuciObject *o);
+uint64_t LuciBigInt_hash_double(double f);
+bool LuciBigInt_equals_double(LuciObject *o, double f);
+
+LuciObject* LuciBigInt_copy(LuciObject *);
+LuciObject* LuciBigInt_repr(LuciObject *);
+LuciObject* LuciBigInt_asbool(LuciObject *);
+LuciObject* LuciBigInt_add(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_sub(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_mul(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_div(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_mod(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_pow(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_eq(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_neq(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_lt(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_gt(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_lte(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_gte(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_bwxor(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_bwor(LuciObject *, LuciObject *);
+LuciObject* LuciBigInt_bwand(LuciObject *, LuciObject *);
+
+LuciObject* LuciBigInt_neg(LuciObject *);
+LuciObject* LuciBigInt_bwnot(LuciObject *);
+void LuciBigInt_print(LuciObject *);
+void LuciBigInt_mark(LuciObject *);
+void LuciBigInt_finalize(LuciObject *);
+
+#endif
@@ -0,0 +1,281 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file buildertype.c
+ *
+ * A mutable string buffer with amortized O(1) appends.
+ *
+ * Concatenating strings with `+` allocates and copies both operands
+ * every time, so building a string piece by piece is quadratic.
+ * A builder instead grows its buffer geometrically and is converted
+ * to an ordinary string with str() once it is complete.
+ */
+
+#include "buildertype.h"
+#include "utf8.h"
+
+/** Type member table for LuciBuilderObj */
+LuciObjectType obj_builder_t = {
+    "builder",
+    sizeof(LuciBuilderObj),
+    TYPEID_BUILDER,
+
+    LuciBuilder_copy,
+    LuciBuilder_deepcopy,
+    LuciBuilder_repr,
+    LuciBuilder_asbool,
+    LuciBuilder_len,
+    unary_nil,
+    LuciObject_lgnot,
+    unary_nil,
+
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    LuciObject_lgor,
+    LuciObject_lgand,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+
+    binary_nil,
+    binary_nil,
+    binary_nil,
+
+    ternary_nil,
+
+    LuciBuilder_print,
+    LuciBuilder_mark,
+    LuciBuilder_finalize,
+    NULL,       /* hash0 */
+    NULL        /* hash1 */
+};
+
+/**
+ * Creates a new, empty LuciBuilderObj
+ *
+ * @returns new LuciBuilderObj
+ */
+LuciObject *LuciBuilder_new()
+{
+    LuciBuilderObj *o = (LuciBuilderObj*)gc_malloc(&obj_builder_t);
+    o->len = 0;
+    o->cplen = 0;
+    o->size = INIT_BUILDER_SIZE;
+    o->s = alloc(o->size);
+    o->s[0] = '\0';
+    return (LuciObject *)o;
+}
+
+/**
+ * Shallow copy of a LuciBuilderObj
+ *
+ * Like lists, builders are shared by reference, so that
+ * appends made through any variable are visible through all.
+ *
+ * @param orig LuciBuilderObj
+ * @returns orig
+ */
+LuciObject* LuciBuilder_copy(LuciObject *orig)
+{
+    return orig;
+}
+
+/**
+ * Deep copies a LuciBuilderObj
+ *
+ * @param orig LuciBuilderObj to copy
+ * @returns new LuciBuilderObj with the same contents
+ */
+LuciObject* LuciBuilder_deepcopy(LuciObject *orig)
+{
+    LuciObject *copy = LuciBuilder_new();
+    LuciBuilder_write(copy, AS_BUILDER(orig)->s, AS_BUILDER(orig)->len);
+    return copy;
+}
+
+/**
+ * Produces a LuciStringObj from the contents of a LuciBuilderObj
+ *
+ * @param o LuciBuilderObj
+ * @returns new LuciStringObj
+ */
+LuciObject* LuciBuilder_repr(LuciObject *o)
+{
+    long len = AS_BUILDER(o)->len;
+    char *s = alloc(len + 1);
+    memcpy(s, AS_BUILDER(o)->s, len + 1);
+
+    LuciObject *str = LuciString_new(s);
+    AS_STRING(str)->cplen = AS_BUILDER(o)->cplen;
+    return str;
+}
+
+/**
+ * Returns a boolean representation of a LuciBuilderObj
+ *
+ * @param o LuciBuilderObj
+ * @returns LuciIntObj (true if not empty)
+ */
+LuciObject* LuciBuilder_asbool(LuciObject *o)
+{
+    return LuciBool(AS_BUILDER(o)->len > 0);
+}
+
+/**
+ * Returns the length of the string in a LuciBuilderObj in codepoints
+ *
+ * @param o LuciBuilderObj
+ * @returns length of o
+ */
+LuciObject* LuciBuilder_len(LuciObject *o)
+{
+    return LuciInt_new(AS_BUILDER(o)->cplen);
+}
+
+/**
+ * Ensures a LuciBuilderObj can hold `extra` more bytes without
+ * reallocating
+ *
+ * @param o LuciBuilderObj
+ * @param extra number of bytes to reserve
+ */
+void LuciBuilder_reserve(LuciObject *o, long extra)
+{
+    LuciBuilderObj *b = AS_BUILDER(o);
+    long needed = b->len + extra + 1;
+
+    if (needed > b->size) {
+        long size = b->size;
+        while (size < needed) {
+            size *= 2;
+        }
+        b->s = realloc(b->s, size);
+        if (!b->s) {
+            LUCI_DIE("%s", "Failed to dynamically expand string builder\n");
+        }
+        b->size = size;
+    }
+}
+
+/**
+ * Appends raw bytes to a LuciBuilderObj
+ *
+ * @param o LuciBuilderObj
+ * @param s bytes to append
+ * @param len number of bytes
+ */
+void LuciBuilder_write(LuciObject *o, const char *s, long len)
+{
+    LuciBuilderObj *b = AS_BUILDER(o);
+
+    LuciBuilder_reserve(o, len);
+    memcpy(b->s + b->len, s, len);
+    b->len += len;
+    b->cplen += utf8_count(s, len);
+    b->s[b->len] = '\0';
+}
+
+/**
+ * Appends an object to a LuciBuilderObj
+ *
+ * Strings are appended as-is, other objects are appended
+ * using their string representation.
+ *
+ * @param b LuciBuilderObj
+ * @param o object to append
+ * @returns LuciNilObj
+ */
+LuciObject* LuciBuilder_append(LuciObject *b, LuciObject *o)
+{
+    LuciObject *str = o;
+
+    if (!ISTYPE(str, obj_string_t)) {
+        str = o->type->repr(o);
+        if (ISTYPE(str, obj_nil_t)) {
+            LUCI_DIE("Cannot append object of type %s to a builder\n",
+                    o->type->type_name);
+        }
+    }
+    LuciBuilder_write(b, AS_STRING(str)->s, AS_STRING(str)->len);
+    return LuciNilObj;
+}
+
+/**
+ * Appends every string in a LuciListObj to a LuciBuilderObj
+ *
+ * The builder is grown once to fit all strings up front.
+ *
+ * @param b LuciBuilderObj
+ * @param l LuciListObj of LuciStringObjs
+ * @returns LuciNilObj
+ */
+LuciObject* LuciBuilder_extend(LuciObject *b, LuciObject *l)
+{
+    unsigned int i;
+    long total = 0;
+
+    if (!ISTYPE(l, obj_list_t)) {
+        LUCI_DIE("Cannot extend a builder with an object of type %s\n",
+                l->type->type_name);
+    }
+
+    for (i = 0; i < AS_LIST(l)->count; i++) {
+        LuciObject *item = AS_LIST(l)->items[i];
+        if (!ISTYPE(item, obj_string_t)) {
+            LUCI_DIE("Cannot extend a builder with a list containing a %s\n",
+                    item->type->type_name);
+        }
+        total += AS_STRING(item)->len;
+    }
+
+    LuciBuilder_reserve(b, total);
+    for (i = 0; i < AS_LIST(l)->count; i++) {
+        LuciObject *item = AS_LIST(l)->items[i];
+        LuciBuilder_write(b, AS_STRING(item)->s, AS_STRING(item)->len);
+    }
+    return LuciNilObj;
+}
+
+/**
+ * Prints the contents of a LuciBuilderObj to stdout
+ *
+ * @param in LuciBuilderObj
+ */
+void LuciBuilder_print(LuciObject *in)
+{
+    printf("%s", AS_BUILDER(in)->s);
+}
+
+/**
+ * Marks a LuciBuilderObj as reachable
+ *
+ * @param in LuciBuilderObj
+ */
+void LuciBuilder_mark(LuciObject *in)
+{
+    GC_MARK(in);
+}
+
+/**
+ * Finalizes a LuciBuilderObj
+ *
+ * frees its buffer
+ *
+ * @param in LuciBuilderObj
+ */
+void LuciBuilder_finalize(LuciObject *in)
+{
+    free(AS_BUILDER(in)->s);
+}
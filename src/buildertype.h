@@ -0,0 +1,44 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file buildertype.h
+ */
+
+#ifndef LUCI_BUILDERTYPE_H
+#define LUCI_BUILDERTYPE_H
+
+#include "lucitypes.h"
+
+extern LuciObjectType obj_builder_t;
+
+#define INIT_BUILDER_SIZE 64    /**< initial allocated size of a builder */
+
+/** String builder object type */
+typedef struct LuciBuilder_ {
+    LuciObject base;    /**< base implementation */
+    char *s;            /**< pointer to (always NUL-terminated) buffer */
+    long len;           /**< current length of built string in bytes */
+    long cplen;         /**< current length of built string in codepoints */
+    long size;          /**< allocated size of buffer */
+} LuciBuilderObj;
+
+/** casts LuciObject o to a LuciBuilderObj */
+#define AS_BUILDER(o)   ((LuciBuilderObj *)(o))
+
+LuciObject *LuciBuilder_new();
+LuciObject* LuciBuilder_copy(LuciObject *);
+LuciObject* LuciBuilder_deepcopy(LuciObject *);
+LuciObject* LuciBuilder_repr(LuciObject *);
+LuciObject* LuciBuilder_asbool(LuciObject *);
+LuciObject* LuciBuilder_len(LuciObject *);
+void LuciBuilder_reserve(LuciObject *, long);
+void LuciBuilder_write(LuciObject *, const char *, long);
+LuciObject* LuciBuilder_append(LuciObject *, LuciObject *);
+LuciObject* LuciBuilder_extend(LuciObject *, LuciObject *);
+void LuciBuilder_print(LuciObject *);
+void LuciBuilder_mark(LuciObject *);
+void LuciBuilder_finalize(LuciObject *);
+
+#endif
@@ -8,6 +8,7 @@
 
 #include "luci.h"
 #include "builtin.h"
+#include "numconv.h"
 
 
 static LuciLibFuncObj builtin_print = {
@@ -73,6 +74,13 @@ static LuciLibFuncObj builtin_cast_str = {
     1
 };
 
+static LuciLibFuncObj builtin_cast_list = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_cast_list,
+    "converts a range, array, string, tuple or other container to a list",
+    1
+};
+
 static LuciLibFuncObj builtin_cast_int = {
     {&obj_libfunc_t, GC_STATIC},
     luci_cast_int,
@@ -171,6 +179,160 @@ static LuciLibFuncObj builtin_contains = {
     2
 };
 
+static LuciLibFuncObj builtin_builder = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_builder,
+    "creates a string builder for efficient concatenation",
+    0
+};
+
+static LuciLibFuncObj builtin_append = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_append,
+    "appends an object to a list or string builder",
+    2
+};
+
+static LuciLibFuncObj builtin_extend = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_extend,
+    "appends every item in a list to a list or string builder",
+    2
+};
+
+static LuciLibFuncObj builtin_slice = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_slice,
+    "returns part of a string without copying it",
+    2
+};
+
+static LuciLibFuncObj builtin_reserve = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_reserve,
+    "sets the number of items a list has room for",
+    2
+};
+
+static LuciLibFuncObj builtin_join = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_join,
+    "joins a list of strings with a separator",
+    1
+};
+
+static LuciLibFuncObj builtin_find = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_find,
+    "returns the index of the first occurrence of a substring, or -1",
+    2
+};
+
+static LuciLibFuncObj builtin_rfind = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_rfind,
+    "returns the index of the last occurrence of a substring, or -1",
+    2
+};
+
+static LuciLibFuncObj builtin_count = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_count,
+    "counts the non-overlapping occurrences of a substring",
+    2
+};
+
+static LuciLibFuncObj builtin_replace = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_replace,
+    "replaces every occurrence of a substring",
+    3
+};
+
+static LuciLibFuncObj builtin_startswith = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_startswith,
+    "determines if a string begins with a prefix",
+    2
+};
+
+static LuciLibFuncObj builtin_endswith = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_endswith,
+    "determines if a string ends with a suffix",
+    2
+};
+
+static LuciLibFuncObj builtin_strip = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_strip,
+    "removes leading and trailing whitespace (or given characters)",
+    1
+};
+
+static LuciLibFuncObj builtin_array = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_array,
+    "creates a typed numeric array from a list, or of zeros",
+    1
+};
+
+static LuciLibFuncObj builtin_tolist = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_tolist,
+    "converts an array to a list",
+    1
+};
+
+static LuciLibFuncObj builtin_dot = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_dot,
+    "computes the dot product of two arrays",
+    2
+};
+
+static LuciLibFuncObj builtin_scale = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_scale,
+    "multiplies every element of an array by a number",
+    2
+};
+
+static LuciLibFuncObj builtin_set = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_set,
+    "creates a set, optionally from the items in a container",
+    0
+};
+
+static LuciLibFuncObj builtin_add = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_add,
+    "adds an object to a set",
+    2
+};
+
+static LuciLibFuncObj builtin_remove = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_remove,
+    "removes a key from a map, or an object from a set",
+    2
+};
+
+static LuciLibFuncObj builtin_union = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_union,
+    "returns a set of the objects in either of two sets",
+    2
+};
+
+static LuciLibFuncObj builtin_intersection = {
+    {&obj_libfunc_t, GC_STATIC},
+    luci_intersection,
+    "returns a set of the objects in both of two sets",
+    2
+};
+
 static LuciFileObj builtin_stdout = {
     {&obj_file_t, GC_STATIC},
     NULL,
@@ -214,6 +376,7 @@ const LuciObjectRecord builtins_registry[] = {
     {"assert",      (LuciObject*)&builtin_assert},
     {"copy",        (LuciObject*)&builtin_copy},
     {"str",         (LuciObject*)&builtin_cast_str},
+    {"list",        (LuciObject*)&builtin_cast_list},
     {"int",         (LuciObject*)&builtin_cast_int},
     {"float",       (LuciObject*)&builtin_cast_float},
     {"hex",         (LuciObject*)&builtin_hex},
@@ -228,6 +391,28 @@ const LuciObjectRecord builtins_registry[] = {
     {"max",         (LuciObject*)&builtin_max},
     {"min",         (LuciObject*)&builtin_min},
     {"contains",    (LuciObject*)&builtin_contains},
+    {"builder",     (LuciObject*)&builtin_builder},
+    {"append",      (LuciObject*)&builtin_append},
+    {"extend",      (LuciObject*)&builtin_extend},
+    {"reserve",     (LuciObject*)&builtin_reserve},
+    {"join",        (LuciObject*)&builtin_join},
+    {"slice",       (LuciObject*)&builtin_slice},
+    {"find",        (LuciObject*)&builtin_find},
+    {"rfind",       (LuciObject*)&builtin_rfind},
+    {"count",       (LuciObject*)&builtin_count},
+    {"replace",     (LuciObject*)&builtin_replace},
+    {"startswith",  (LuciObject*)&builtin_startswith},
+    {"endswith",    (LuciObject*)&builtin_endswith},
+    {"strip",       (LuciObject*)&builtin_strip},
+    {"array",       (LuciObject*)&builtin_array},
+    {"tolist",      (LuciObject*)&builtin_tolist},
+    {"dot",         (LuciObject*)&builtin_dot},
+    {"scale",       (LuciObject*)&builtin_scale},
+    {"set",         (LuciObject*)&builtin_set},
+    {"add",         (LuciObject*)&builtin_add},
+    {"remove",      (LuciObject*)&builtin_remove},
+    {"union",       (LuciObject*)&builtin_union},
+    {"intersection", (LuciObject*)&builtin_intersection},
     {"stdout",      (LuciObject*)&builtin_stdout},
     {"stderr",      (LuciObject*)&builtin_stderr},
     {"stdin",       (LuciObject*)&builtin_stdin},
@@ -393,6 +578,9 @@ LuciObject *luci_readline(LuciObject **args, unsigned int c)
     /* overwrite the newline or EOF char with a NUL terminator */
     input[--len] = '\0';
     LuciObject *ret = LuciString_new(input);
+    if (!LuciString_validate(ret)) {
+        LUCI_DIE("%s", "Invalid UTF-8 in line read\n");
+    }
 
     LUCI_DEBUG("Read line %s\n", AS_STRING(ret)->s);
 
@@ -445,7 +633,7 @@ LuciObject *luci_assert(LuciObject **args, unsigned int c)
     } else if (ISTYPE(item, obj_float_t) && !((long)AS_FLOAT(item)->f)) {
         LUCI_DIE("%s\n", "Float assertion failed");
     } else if (ISTYPE(item, obj_string_t)) {
-        if (strcmp("", AS_STRING(item)->s) == 0) {
+        if (AS_STRING(item)->len == 0) {
             LUCI_DIE("%s\n", "String assertion failed");
         }
     } else if (ISTYPE(item, obj_list_t) && (AS_LIST(item)->count == 0)) {
@@ -471,7 +659,7 @@ LuciObject *luci_copy(LuciObject **args, unsigned int c)
         LUCI_DIE("%s\n", "Missing argument to copy()");
     }
     LuciObject *o = args[0];
-    return o->type->copy(o);
+    return o->type->deepcopy(o);
 }
 
 /**
@@ -496,15 +684,18 @@ LuciObject *luci_cast_int(LuciObject **args, unsigned int c)
 
     if (ISTYPE(item, obj_int_t)) {
         ret = LuciInt_new(AS_INT(item)->i);
+    } else if (ISTYPE(item, obj_bigint_t)) {
+        ret = item;
     } else if (ISTYPE(item, obj_float_t)) {
         ret = LuciInt_new((long)AS_FLOAT(item)->f);
     } else if (ISTYPE(item, obj_string_t)) {
-        long i;
-        int scanned = sscanf(AS_STRING(item)->s, "%ld", &i);
-        if (scanned <= 0 || scanned == EOF) {
+        /* digit strings too long for a long become LuciBigIntObjs */
+        long l;
+        if (numconv_parse_long(LuciString_cstr(item), &l)) {
+            ret = LuciInt_new(l);
+        } else if (!(ret = LuciBigInt_parse(LuciString_cstr(item)))) {
             LUCI_DIE("%s", "Could not cast to int\n");
         }
-        ret = LuciInt_new(i);
     } else {
         LUCI_DIE("Cannot cast type %s to type int\n", item->type->type_name);
     }
@@ -533,12 +724,13 @@ LuciObject *luci_cast_float(LuciObject **args, unsigned int c)
 
     if (ISTYPE(item, obj_int_t)) {
         ret = LuciFloat_new((double)AS_INT(item)->i);
+    } else if (ISTYPE(item, obj_bigint_t)) {
+        ret = LuciFloat_new(LuciBigInt_as_double(item));
     } else if (ISTYPE(item, obj_float_t)) {
         ret = LuciFloat_new(AS_FLOAT(item)->f);
     } else if (ISTYPE(item, obj_string_t)) {
         double f;
-        int scanned = sscanf(AS_STRING(item)->s, "%f", (float *)&f);
-        if (scanned <= 0 || scanned == EOF) {
+        if (!numconv_parse_double(LuciString_cstr(item), &f)) {
             LUCI_DIE("%s", "Could not cast to float\n");
         }
         ret = LuciFloat_new(f);
@@ -552,6 +744,9 @@ LuciObject *luci_cast_float(LuciObject **args, unsigned int c)
 /**
  * Returns a hex string representation of an integer
  *
+ * Negative ints are written as a sign and a magnitude, as for
+ * LuciBigIntObjs, so hex(-n) is always "-" + hex(n).
+ *
  * @param args list of args
  * @param c number of args
  * @returns LuciStringObj representation of an integer
@@ -563,13 +758,18 @@ LuciObject *luci_hex(LuciObject **args, unsigned int c)
     }
     LuciObject *hexint = args[0];
 
-    if (!ISTYPE(hexint, obj_int_t)) {
+    if (ISTYPE(hexint, obj_bigint_t)) {
+        return LuciBigInt_hex(hexint);
+    } else if (!ISTYPE(hexint, obj_int_t)) {
         LUCI_DIE("Cannot get hex representation of an object of type %s\n",
                 hexint->type->type_name);
     }
 
+    long i = AS_INT(hexint)->i;
+    /* negate as unsigned, which is exact even for LONG_MIN */
+    unsigned long mag = i < 0 ? -(unsigned long)i : (unsigned long)i;
     char *s = alloc(MAX_INT_DIGITS + 2);
-    snprintf(s, MAX_INT_DIGITS, "0x%lX", AS_INT(hexint)->i);
+    snprintf(s, MAX_INT_DIGITS + 2, "%s0x%lX", i < 0 ? "-" : "", mag);
     return LuciString_new(s);
 }
 
@@ -601,6 +801,50 @@ LuciObject *luci_cast_str(LuciObject **args, unsigned int c)
     return ret;
 }
 
+/**
+ * Converts a container to a new LuciListObj.
+ *
+ * Ranges are materialized here, and only here.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns new LuciListObj holding the items of the first arg
+ */
+LuciObject *luci_cast_list(LuciObject **args, unsigned int c)
+{
+    if (c < 1) {
+        LUCI_DIE("%s", "Missing parameter to list()\n");
+    }
+    LuciObject *item = args[0];
+
+    if (ISTYPE(item, obj_range_t)) {
+        return LuciRange_to_list(item);
+    } else if (ISTYPE(item, obj_array_t)) {
+        return LuciArray_to_list(item);
+    } else if (item->type->next == binary_nil) {
+        LUCI_DIE("Cannot convert an object of type %s to a list\n",
+                item->type->type_name);
+    }
+
+    /* anything that can be iterated over, presized if
+     * its number of items is known */
+    unsigned int size = 0;
+    if (ISTYPE(item, obj_list_t)) {
+        size = AS_LIST(item)->count;
+    } else if (ISTYPE(item, obj_tuple_t)) {
+        size = AS_TUPLE(item)->count;
+    } else if (ISTYPE(item, obj_map_t) || ISTYPE(item, obj_set_t)) {
+        size = AS_MAP(item)->count;
+    }
+    LuciObject *list = LuciList_new_sized(size);
+    LuciObject *iter = LuciIterator_new(item, 1);
+    LuciObject *next;
+    while ((next = iterator_next_object(iter)) != NULL) {
+        LuciList_append(list, next);
+    }
+    return list;
+}
+
 /**
  * Determines the file 'open' mode from a given open
  * string.
@@ -669,8 +913,8 @@ LuciObject *luci_fopen(LuciObject **args, unsigned int c)
         LUCI_DIE("%s", "Parameter 2 to open must be a string\n");
     }
 
-    filename = AS_STRING(fname_obj)->s;
-    req_mode = AS_STRING(mode_obj)->s;
+    filename = LuciString_cstr(fname_obj);
+    req_mode = LuciString_cstr(mode_obj);
 
     mode = get_file_mode(req_mode);
     if (mode < 0) {
@@ -770,6 +1014,9 @@ LuciObject *luci_fread(LuciObject **args, unsigned int c)
     /* fseek(fobj->ptr, 0, SEEK_SET); */
 
     LuciObject *ret = LuciString_new(read);
+    if (!LuciString_validate(ret)) {
+        LUCI_DIE("%s", "Invalid UTF-8 in file read\n");
+    }
 
     return ret;
 }
@@ -799,12 +1046,13 @@ LuciObject *luci_fwrite(LuciObject **args, unsigned int c)
         LUCI_DIE("%s", "Not a string\n");
     }
     char *text = AS_STRING(text_obj)->s;
+    long len = AS_STRING(text_obj)->len;
 
     if (AS_FILE(fobj)->mode == f_read_m) {
         LUCI_DIE("%s", "Can't write to  It is opened for reading.\n");
     }
 
-    fwrite(text, sizeof(char), strlen(text), AS_FILE(fobj)->ptr);
+    fwrite(text, sizeof(char), len, AS_FILE(fobj)->ptr);
 
     return LuciNilObj;
 }
@@ -827,6 +1075,8 @@ LuciObject *luci_flines(LuciObject **args, unsigned int c)
         LuciList_append(list, line);
         line = luci_readline(args, c);
     }
+    /* the number of lines isn't known until the end of the file */
+    LuciList_resize(list, AS_LIST(list)->count);
 
     return list;
 }
@@ -879,33 +1129,7 @@ LuciObject * luci_range(LuciObject **args, unsigned int c)
         incr = 1;
     }
 
-    /* Build a list of integers from start to end, incrementing by incr */
-    LuciObject *item, *list = LuciList_new();
-    long i;
-    if (incr < 0) {
-        if (start <= end) {
-            /* return empty list if idiotically requested */
-            return list;
-        }
-
-        for (i = start; i > end; i += incr) {
-            item = LuciInt_new(i);
-            LuciList_append(list, item);
-        }
-    }
-    else {
-        if (start >= end) {
-            /* return empty list if idiotically requested */
-            return list;
-        }
-
-        for (i = start; i < end; i += incr) {
-            item = LuciInt_new(i);
-            LuciList_append(list, item);
-        }
-    }
-
-    return list;
+    return LuciRange_new(start, end, incr);
 }
 
 /**
@@ -923,12 +1147,18 @@ LuciObject * luci_sum(LuciObject **args, unsigned int c)
 
     LuciObject *list = args[0];
 
-    if (!list || (!ISTYPE(list, obj_list_t))) {
+    if (list && ISTYPE(list, obj_array_t)) {
+        return LuciArray_sum(list);
+    } else if (list && ISTYPE(list, obj_range_t)) {
+        return LuciRange_sum(list);
+    } else if (!list || (!ISTYPE(list, obj_list_t))) {
         LUCI_DIE("%s", "Must specify a list to calculate sum\n");
     }
 
     LuciObject *item;
+    LuciObject *bigsum = NULL;
     double sum = 0;
+    long isum = 0, next;
     unsigned int i, found_float = 0;
     for (i = 0; i < AS_LIST(list)->count; i++) {
         item = AS_LIST(list)->items[i];
@@ -936,8 +1166,13 @@ LuciObject * luci_sum(LuciObject **args, unsigned int c)
             LUCI_DIE("%s", "Can't calulate sum of list containing NULL value\n");
         }
 
-        if (ISTYPE(item, obj_int_t)) {
-            sum += (double)AS_INT(item)->i;
+        if (ISTYPE(item, obj_int_t) &&
+                !__builtin_add_overflow(isum, AS_INT(item)->i, &next)) {
+            /* ints are summed exactly, not via a double */
+            isum = next;
+        } else if (ISINTEGER(item)) {
+            /* ints that overflow a long are summed as objects */
+            bigsum = bigsum ? bigsum->type->add(bigsum, item) : item;
         } else if (ISTYPE(item, obj_float_t)) {
             found_float = 1;
             sum += AS_FLOAT(item)->f;
@@ -948,10 +1183,13 @@ LuciObject * luci_sum(LuciObject **args, unsigned int c)
 
     LuciObject *ret;
     if (!found_float) {
-        ret = LuciInt_new((long)sum);
+        ret = LuciInt_new(isum);
     }
     else {
-        ret = LuciFloat_new(sum);
+        ret = LuciFloat_new(sum + isum);
+    }
+    if (bigsum) {
+        ret = ret->type->add(ret, bigsum);
     }
 
     return ret;
@@ -989,7 +1227,11 @@ LuciObject *luci_max(LuciObject **args, unsigned int c)
 
     LuciObject *list = args[0];
 
-    if (!list || (!ISTYPE(list, obj_list_t))) {
+    if (list && ISTYPE(list, obj_array_t)) {
+        return LuciArray_max(list);
+    } else if (list && ISTYPE(list, obj_range_t)) {
+        return LuciRange_max(list);
+    } else if (!list || (!ISTYPE(list, obj_list_t))) {
         LUCI_DIE("%s", "Must specify a list to calculate max\n");
     }
 
@@ -1042,7 +1284,11 @@ LuciObject *luci_min(LuciObject **args, unsigned int c)
 
     LuciObject *list = args[0];
 
-    if (!list || (!ISTYPE(list, obj_list_t))) {
+    if (list && ISTYPE(list, obj_array_t)) {
+        return LuciArray_min(list);
+    } else if (list && ISTYPE(list, obj_range_t)) {
+        return LuciRange_min(list);
+    } else if (!list || (!ISTYPE(list, obj_list_t))) {
         LUCI_DIE("%s", "Must specify a list to calculate min\n");
     }
 
@@ -1109,3 +1355,600 @@ LuciObject *luci_contains(LuciObject **args, unsigned int c)
 
     return cont->type->contains(cont, item);
 }
+
+/**
+ * Creates a new, empty string builder
+ *
+ * @param args unused
+ * @param c unused
+ * @returns new LuciBuilderObj
+ */
+LuciObject *luci_builder(LuciObject **args, unsigned int c)
+{
+    LuciObject *b = LuciBuilder_new();
+    unsigned int i;
+
+    /* any arguments are appended as initial contents */
+    for (i = 0; i < c; i++) {
+        LuciBuilder_append(b, args[i]);
+    }
+    return b;
+}
+
+/**
+ * Appends an object to a list or string builder
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns LuciNilObj
+ */
+LuciObject *luci_append(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to append()\n");
+    }
+
+    LuciObject *cont = args[0];
+    LuciObject *item = args[1];
+
+    if (ISTYPE(cont, obj_builder_t)) {
+        return LuciBuilder_append(cont, item);
+    } else if (ISTYPE(cont, obj_list_t)) {
+        return LuciList_append(cont, item);
+    } else if (ISTYPE(cont, obj_array_t)) {
+        return LuciArray_append(cont, item);
+    } else {
+        LUCI_DIE("Cannot append to an object of type %s\n",
+                cont->type->type_name);
+    }
+    return LuciNilObj;
+}
+
+/**
+ * Appends every item in a list to a list or string builder
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns LuciNilObj
+ */
+LuciObject *luci_extend(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to extend()\n");
+    }
+
+    LuciObject *cont = args[0];
+    LuciObject *items = args[1];
+
+    if (!ISTYPE(items, obj_list_t)) {
+        LUCI_DIE("Cannot extend a container with an object of type %s\n",
+                items->type->type_name);
+    }
+
+    if (ISTYPE(cont, obj_builder_t)) {
+        return LuciBuilder_extend(cont, items);
+    } else if (ISTYPE(cont, obj_list_t)) {
+        /* copy the count first in case a list is extended with itself */
+        unsigned int i, count = AS_LIST(items)->count;
+        LuciList_reserve(cont, AS_LIST(cont)->count + count);
+        for (i = 0; i < count; i++) {
+            LuciList_append(cont, AS_LIST(items)->items[i]);
+        }
+    } else {
+        LUCI_DIE("Cannot extend an object of type %s\n",
+                cont->type->type_name);
+    }
+    return LuciNilObj;
+}
+
+/**
+ * Sets the number of items a list has room for.
+ *
+ * Reserving room before appending many items avoids repeated
+ * reallocation. Reserving less than the list's length frees any
+ * unused space, which saves memory when holding many lists that
+ * won't grow any further.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns LuciNilObj
+ */
+LuciObject *luci_reserve(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to reserve()\n");
+    }
+
+    LuciObject *list = args[0];
+    LuciObject *size = args[1];
+
+    if (!ISTYPE(list, obj_list_t)) {
+        LUCI_DIE("Cannot reserve space in an object of type %s\n",
+                list->type->type_name);
+    } else if (!ISTYPE(size, obj_int_t)) {
+        LUCI_DIE("reserve() expects an int size, not an object of type %s\n",
+                size->type->type_name);
+    } else if (AS_INT(size)->i < 0 || AS_INT(size)->i > UINT_MAX) {
+        LUCI_DIE("%s\n", "Invalid size passed to reserve()");
+    }
+
+    LuciList_resize(list, AS_INT(size)->i);
+    return LuciNilObj;
+}
+
+/**
+ * Joins a list of strings, placing a separator between each.
+ *
+ * The length of the result is computed first so that it is
+ * allocated and filled in a single pass.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns new LuciStringObj
+ */
+LuciObject *luci_join(LuciObject **args, unsigned int c)
+{
+    if (c < 1) {
+        LUCI_DIE("%s", "Missing parameter to join()\n");
+    }
+
+    LuciObject *list = args[0];
+    if (!ISTYPE(list, obj_list_t)) {
+        LUCI_DIE("%s", "First parameter to join must be a list\n");
+    }
+
+    const char *sep = "";
+    long seplen = 0;
+    if (c > 1) {
+        if (!ISTYPE(args[1], obj_string_t)) {
+            LUCI_DIE("%s", "Second parameter to join must be a string\n");
+        }
+        sep = AS_STRING(args[1])->s;
+        seplen = AS_STRING(args[1])->len;
+    }
+
+    unsigned int i, count = AS_LIST(list)->count;
+    long total = 0;
+    for (i = 0; i < count; i++) {
+        LuciObject *item = AS_LIST(list)->items[i];
+        if (!ISTYPE(item, obj_string_t)) {
+            LUCI_DIE("Cannot join a list containing an object of type %s\n",
+                    item->type->type_name);
+        }
+        total += AS_STRING(item)->len;
+    }
+    if (count > 0) {
+        total += seplen * (count - 1);
+    }
+
+    char *s = alloc(total + 1);
+    char *p = s;
+    for (i = 0; i < count; i++) {
+        LuciObject *item = AS_LIST(list)->items[i];
+        if (i > 0) {
+            memcpy(p, sep, seplen);
+            p += seplen;
+        }
+        memcpy(p, AS_STRING(item)->s, AS_STRING(item)->len);
+        p += AS_STRING(item)->len;
+    }
+    *p = '\0';
+
+    return LuciString_new(s);
+}
+
+/**
+ * Returns a view of part of a string, from a start index up to
+ * (but not including) an optional end index.
+ *
+ * The view shares the characters of the original string.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns LuciStringObj view
+ */
+LuciObject *luci_slice(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to slice()\n");
+    }
+
+    LuciObject *str = args[0];
+    if (!ISTYPE(str, obj_string_t)) {
+        LUCI_DIE("Cannot slice an object of type %s\n",
+                str->type->type_name);
+    }
+
+    if (!ISTYPE(args[1], obj_int_t)) {
+        LUCI_DIE("%s", "Second parameter to slice must be an integer\n");
+    }
+    long start = AS_INT(args[1])->i;
+    long end = AS_STRING(str)->len;
+
+    if (c > 2) {
+        if (!ISTYPE(args[2], obj_int_t)) {
+            LUCI_DIE("%s", "Third parameter to slice must be an integer\n");
+        }
+        end = AS_INT(args[2])->i;
+    }
+
+    return LuciString_slice(str, start, end);
+}
+
+/**
+ * Fetches a string argument to a string builtin, dying if
+ * the argument is not a string
+ *
+ * @param args list of args
+ * @param i index of the argument
+ * @param func name of the builtin (for error messages)
+ * @returns LuciStringObj argument
+ */
+static LuciObject *string_arg(LuciObject **args, unsigned int i,
+        const char *func)
+{
+    LuciObject *arg = args[i];
+    if (!ISTYPE(arg, obj_string_t)) {
+        LUCI_DIE("Parameter %u to %s must be a string, not a %s\n",
+                i + 1, func, arg->type->type_name);
+    }
+    return arg;
+}
+
+/**
+ * Finds the first occurrence of a substring, optionally starting
+ * from a given index.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns index of the substring or -1
+ */
+LuciObject *luci_find(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to find()\n");
+    }
+    LuciObject *str = string_arg(args, 0, "find");
+    LuciObject *sub = string_arg(args, 1, "find");
+    long start = 0;
+
+    if (c > 2) {
+        if (!ISTYPE(args[2], obj_int_t)) {
+            LUCI_DIE("%s", "Third parameter to find must be an integer\n");
+        }
+        start = AS_INT(args[2])->i;
+    }
+    return LuciString_find(str, sub, start);
+}
+
+/**
+ * Finds the last occurrence of a substring.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns index of the substring or -1
+ */
+LuciObject *luci_rfind(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to rfind()\n");
+    }
+    return LuciString_rfind(string_arg(args, 0, "rfind"),
+            string_arg(args, 1, "rfind"));
+}
+
+/**
+ * Counts the non-overlapping occurrences of a substring.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns number of occurrences
+ */
+LuciObject *luci_count(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to count()\n");
+    }
+    return LuciString_count(string_arg(args, 0, "count"),
+            string_arg(args, 1, "count"));
+}
+
+/**
+ * Replaces every occurrence of a substring with another string.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns new string
+ */
+LuciObject *luci_replace(LuciObject **args, unsigned int c)
+{
+    if (c < 3) {
+        LUCI_DIE("%s", "Missing parameter to replace()\n");
+    }
+    return LuciString_replace(string_arg(args, 0, "replace"),
+            string_arg(args, 1, "replace"), string_arg(args, 2, "replace"));
+}
+
+/**
+ * Determines whether a string begins with a prefix.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns 1 if it does, 0 otherwise
+ */
+LuciObject *luci_startswith(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to startswith()\n");
+    }
+    return LuciString_startswith(string_arg(args, 0, "startswith"),
+            string_arg(args, 1, "startswith"));
+}
+
+/**
+ * Determines whether a string ends with a suffix.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns 1 if it does, 0 otherwise
+ */
+LuciObject *luci_endswith(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to endswith()\n");
+    }
+    return LuciString_endswith(string_arg(args, 0, "endswith"),
+            string_arg(args, 1, "endswith"));
+}
+
+/**
+ * Removes leading and trailing whitespace from a string, or
+ * any of the characters in an optional second string.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns stripped string
+ */
+LuciObject *luci_strip(LuciObject **args, unsigned int c)
+{
+    if (c < 1) {
+        LUCI_DIE("%s", "Missing parameter to strip()\n");
+    }
+    return LuciString_strip(string_arg(args, 0, "strip"),
+            (c > 1) ? string_arg(args, 1, "strip") : NULL);
+}
+
+/**
+ * Returns args[i] if it is a LuciArrayObj, otherwise dies
+ *
+ * @param args list of args
+ * @param i index of arg
+ * @param func name of calling builtin, for the error message
+ * @returns args[i]
+ */
+static LuciObject *array_arg(LuciObject **args, unsigned int i,
+        const char *func)
+{
+    if (!ISTYPE(args[i], obj_array_t)) {
+        LUCI_DIE("%s() expects an array, not an object of type %s\n",
+                func, args[i]->type->type_name);
+    }
+    return args[i];
+}
+
+/**
+ * Creates a typed numeric array.
+ *
+ * The first arg is either a list of numbers or a length. An optional
+ * second arg, "int" or "float", selects the element type. Otherwise
+ * an array made from a list holds floats if any item in the list is a
+ * float, and an array of a given length holds ints.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns new LuciArrayObj
+ */
+LuciObject *luci_array(LuciObject **args, unsigned int c)
+{
+    if (c < 1) {
+        LUCI_DIE("%s", "Missing parameter to array()\n");
+    }
+
+    LuciObject *src = args[0];
+    LuciObject *res = NULL;
+
+    if (ISTYPE(src, obj_list_t)) {
+        res = LuciArray_from_list(src);
+    } else if (ISTYPE(src, obj_int_t)) {
+        if (AS_INT(src)->i < 0) {
+            LUCI_DIE("%s", "Cannot create an array of negative length\n");
+        }
+        res = LuciArray_new(ARRAY_INT, AS_INT(src)->i);
+    } else {
+        LUCI_DIE("Cannot create an array from an object of type %s\n",
+                src->type->type_name);
+    }
+
+    if (c > 1) {
+        char *kind = LuciString_cstr(string_arg(args, 1, "array"));
+        LuciArrayKind want;
+        if (strcmp(kind, "int") == 0) {
+            want = ARRAY_INT;
+        } else if (strcmp(kind, "float") == 0) {
+            want = ARRAY_FLOAT;
+        } else {
+            LUCI_DIE("Unknown array type '%s' (expected \"int\" or \"float\")\n",
+                    kind);
+        }
+        if (AS_ARRAY(res)->kind != want) {
+            res = LuciArray_convert(res, want);
+        }
+    }
+    return res;
+}
+
+/**
+ * Converts an array to a list.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns new LuciListObj
+ */
+LuciObject *luci_tolist(LuciObject **args, unsigned int c)
+{
+    if (c < 1) {
+        LUCI_DIE("%s", "Missing parameter to tolist()\n");
+    }
+    return LuciArray_to_list(array_arg(args, 0, "tolist"));
+}
+
+/**
+ * Computes the dot product of two arrays.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns int or float dot product
+ */
+LuciObject *luci_dot(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to dot()\n");
+    }
+    return LuciArray_dot(array_arg(args, 0, "dot"), array_arg(args, 1, "dot"));
+}
+
+/**
+ * Multiplies every element of an array by a number.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns new LuciArrayObj
+ */
+LuciObject *luci_scale(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to scale()\n");
+    }
+    LuciObject *factor = args[1];
+    if (!ISTYPE(factor, obj_int_t) && !ISTYPE(factor, obj_float_t)) {
+        LUCI_DIE("Cannot scale an array by an object of type %s\n",
+                factor->type->type_name);
+    }
+    return LuciArray_mul(array_arg(args, 0, "scale"), factor);
+}
+
+/**
+ * Returns args[i] if it is a LuciSetObj, otherwise dies
+ *
+ * @param args list of args
+ * @param i index of arg
+ * @param func name of calling builtin, for the error message
+ * @returns args[i]
+ */
+static LuciObject *set_arg(LuciObject **args, unsigned int i,
+        const char *func)
+{
+    if (!ISTYPE(args[i], obj_set_t)) {
+        LUCI_DIE("%s() expects a set, not an object of type %s\n",
+                func, args[i]->type->type_name);
+    }
+    return args[i];
+}
+
+/**
+ * Creates a hashed set.
+ *
+ * If given a container, the set holds each distinct item in it.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns new LuciSetObj
+ */
+LuciObject *luci_set(LuciObject **args, unsigned int c)
+{
+    LuciObject *set = LuciSet_new();
+    if (c < 1) {
+        return set;
+    }
+
+    LuciObject *item = args[0];
+    if (item->type->next == binary_nil) {
+        LUCI_DIE("Cannot create a set from an object of type %s\n",
+                item->type->type_name);
+    }
+
+    LuciObject *iter = LuciIterator_new(item, 1);
+    LuciObject *next;
+    while ((next = iterator_next_object(iter)) != NULL) {
+        LuciSet_add(set, next);
+    }
+    return set;
+}
+
+/**
+ * Adds an object to a set.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns the set
+ */
+LuciObject *luci_add(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to add()\n");
+    }
+    LuciSet_add(set_arg(args, 0, "add"), args[1]);
+    return args[0];
+}
+
+/**
+ * Removes a key (and its value) from a map, or an object from a set.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns the removed value (or nil if the key was missing) for a map,
+ *          LuciIntObj (true if the object was in the set) for a set
+ */
+LuciObject *luci_remove(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to remove()\n");
+    }
+
+    if (ISTYPE(args[0], obj_map_t)) {
+        LuciObject *val = LuciMap_cdel(args[0], args[1]);
+        return val ? val : LuciNilObj;
+    }
+    return LuciSet_remove(set_arg(args, 0, "remove"), args[1]);
+}
+
+/**
+ * Returns the union of two sets.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns new LuciSetObj
+ */
+LuciObject *luci_union(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to union()\n");
+    }
+    return LuciSet_union(set_arg(args, 0, "union"), set_arg(args, 1, "union"));
+}
+
+/**
+ * Returns the intersection of two sets.
+ *
+ * @param args list of args
+ * @param c number of args
+ * @returns new LuciSetObj
+ */
+LuciObject *luci_intersection(LuciObject **args, unsigned int c)
+{
+    if (c < 2) {
+        LUCI_DIE("%s", "Missing parameter to intersection()\n");
+    }
+    return LuciSet_intersection(set_arg(args, 0, "intersection"),
+            set_arg(args, 1, "intersection"));
+}
@@ -38,6 +38,7 @@ LuciObject *luci_copy(LuciObject **, unsigned int);
 LuciObject *luci_cast_int(LuciObject **, unsigned int);
 LuciObject *luci_cast_float(LuciObject **, unsigned int);
 LuciObject *luci_cast_str(LuciObject **, unsigned int);
+LuciObject *luci_cast_list(LuciObject **, unsigned int);
 
 LuciObject *luci_hex(LuciObject **, unsigned int);
 
@@ -55,4 +56,28 @@ LuciObject *luci_min(LuciObject **, unsigned int);
 
 LuciObject *luci_contains(LuciObject **, unsigned int);
 
+LuciObject *luci_builder(LuciObject **, unsigned int);
+LuciObject *luci_append(LuciObject **, unsigned int);
+LuciObject *luci_extend(LuciObject **, unsigned int);
+LuciObject *luci_reserve(LuciObject **, unsigned int);
+LuciObject *luci_join(LuciObject **, unsigned int);
+LuciObject *luci_slice(LuciObject **, unsigned int);
+
+LuciObject *luci_find(LuciObject **, unsigned int);
+LuciObject *luci_rfind(LuciObject **, unsigned int);
+LuciObject *luci_count(LuciObject **, unsigned int);
+LuciObject *luci_replace(LuciObject **, unsigned int);
+LuciObject *luci_startswith(LuciObject **, unsigned int);
+LuciObject *luci_endswith(LuciObject **, unsigned int);
+LuciObject *luci_strip(LuciObject **, unsigned int);
+LuciObject *luci_array(LuciObject **, unsigned int);
+LuciObject *luci_tolist(LuciObject **, unsigned int);
+LuciObject *luci_dot(LuciObject **, unsigned int);
+LuciObject *luci_scale(LuciObject **, unsigned int);
+LuciObject *luci_set(LuciObject **, unsigned int);
+LuciObject *luci_add(LuciObject **, unsigned int);
+LuciObject *luci_remove(LuciObject **, unsigned int);
+LuciObject *luci_union(LuciObject **, unsigned int);
+LuciObject *luci_intersection(LuciObject **, unsigned int);
+
 #endif
@@ -12,11 +12,19 @@
 #include "lucitypes.h"
 #include "symbol.h"
 #include "builtin.h"
+#include "peephole.h"
+#include "ssa.h"
 
 /** global symbol table for builtin functions */
 SymbolTable *builtin_symbols;
 /** global builtins array (from final builtins symbol table) */
 LuciObject **builtins;
+/** whether to run the SSA optimizer on each function (luci -O) */
+bool compile_optimize = false;
+/** whether to inline small functions at their call sites (luci -i) */
+bool compile_inline = false;
+/** number of calls replaced by the body of the function called */
+uint32_t compile_inlined = 0;
 
 
 static void compile(AstNode *, CompileState *);
@@ -26,6 +34,98 @@ static uint32_t put_instr(CompileState *, uint32_t, Opcode, int);
 
 static void add_new_loop(CompileState *cs, int loop_type);
 static void back_patch_loop(CompileState *cs, uint32_t start, uint32_t end);
+static void push_jump(CompileState *cs, Loopjump **jumps, Opcode op);
+static void patch_jumps(CompileState *cs, Loopjump *jumps, uint32_t addr);
+
+static bool compile_inlined_call(AstNode *, CompileState *);
+
+/**
+ * A function body being compiled in place of a call to it
+ */
+typedef struct inline_site_ {
+    AstNode *def;               /**< definition of the function */
+    SymbolTable *locals;        /**< the function's own locals, created in
+                                     the order compiling it would */
+    Loopjump *returns;          /**< jumps to the end of the body */
+    struct inline_site_ *parent;    /**< enclosing inlined body, if any */
+    int depth;                  /**< number of enclosing inlined bodies */
+} InlineSite;
+
+
+/**
+ * Finds, or creates, the local variable a name refers to
+ *
+ * Inside an inlined function body, the function's own locals are
+ * stored in the caller's locals as "function.name", which can't
+ * collide with any identifier.
+ *
+ * @param cs CompileState
+ * @param name variable name
+ * @param flags SYMCREATE to create the variable if it doesn't exist
+ * @returns index of the local, or -1 if the name isn't a local
+ */
+static int local_id(CompileState *cs, const char *name, symtable_flags flags)
+{
+    InlineSite *site = cs->inlining;
+    char *renamed;
+    const char *funcname;
+    int a;
+
+    if (!site) {
+        return symtable_id(cs->ltable, name, flags);
+    }
+    if (symtable_id(site->locals, name, flags) < 0) {
+        return -1;
+    }
+    funcname = site->def->data.funcdef.funcname;
+    renamed = alloc(strlen(funcname) + strlen(name) + 2);
+    sprintf(renamed, "%s.%s", funcname, name);
+    a = symtable_id(cs->ltable, renamed, SYMCREATE);
+    free(renamed);
+    return a;
+}
+
+/**
+ * Finds the variable a name refers to in the scope being compiled
+ *
+ * @param cs CompileState
+ * @param name variable name
+ * @param op set to the instruction loading the variable
+ * @returns index of the variable, or -1 if the name is undefined
+ */
+static int resolve_id(CompileState *cs, const char *name, Opcode *op)
+{
+    int a;
+
+    *op = LOADS;
+    a = local_id(cs, name, SYMFIND);
+    if (a >= 0) {
+        return a;
+    }
+
+    /* the globals of a function inlined into the global scope are
+     * the locals it's compiled to */
+    if (cs->inlining && !cs->gtable) {
+        a = symtable_id(cs->ltable, name, SYMFIND);
+        if (a >= 0) {
+            return a;
+        }
+    }
+
+    /* didn't find symbol in the locals symbol table */
+    if (cs->gtable) {
+        /* search the globals table for the symbol */
+        *op = LOADG;
+        a = symtable_id(cs->gtable, name, SYMFIND);
+        if (a >= 0) {
+            return a;
+        }
+    }
+
+    /* didn't find symbol in the globals table either */
+    *op = LOADB;
+    return symtable_id(builtin_symbols, name, SYMFIND);
+}
 
 
 /**
@@ -48,7 +148,23 @@ static void compile_nil(AstNode *node, CompileState *cs)
 static void compile_int_constant(AstNode *node, CompileState *cs)
 {
     int a;
-    LuciObject *obj = LuciInt_new(node->data.i);
+    /* 0 and 1 are the shared false and true */
+    LuciObject *obj = (node->data.i == 0 || node->data.i == 1) ?
+            LuciBool(node->data.i) : LuciInt_new(node->data.i);
+    a = constant_id(cs->ctable, obj);
+    push_instr(cs, LOADK, a);
+}
+
+/**
+ * Compile an integer constant AST Node too large for a long
+ *
+ * @param node AST Node to compile
+ * @param cs CompileState to compile to
+ */
+static void compile_bigint_constant(AstNode *node, CompileState *cs)
+{
+    int a;
+    LuciObject *obj = LuciBigInt_parse(node->data.s);
     a = constant_id(cs->ctable, obj);
     push_instr(cs, LOADK, a);
 }
@@ -77,6 +193,9 @@ static void compile_string_constant(AstNode *node, CompileState *cs)
 {
     int a;
     LuciObject *obj = LuciString_new(strdup(node->data.s));
+    if (!LuciString_validate(obj)) {
+        LUCI_DIE("Invalid UTF-8 in string @ line %d\n", node->lineno);
+    }
     a = constant_id(cs->ctable, obj);
     push_instr(cs, LOADK, a);
 }
@@ -89,39 +208,191 @@ static void compile_string_constant(AstNode *node, CompileState *cs)
  */
 static void compile_id_expr(AstNode *node, CompileState *cs)
 {
+    Opcode op;
     int a;
 
-    a = symtable_id(cs->ltable, node->data.id.val, SYMFIND);
-    if (a >= 0) {
-        /* found the symbol immediately */
-        push_instr(cs, LOADS, a);
-        return;
+    a = resolve_id(cs, node->data.id.val, &op);
+    if (a < 0) {
+        /* symbol not found */
+        LUCI_DIE("%s undefined.\n", node->data.id.val);
     }
+    push_instr(cs, op, a);
+}
 
-    /* didn't find symbol in the locals symbol table */
-    if (cs->gtable) {
-        /* search the globals table for the symbol */
-        a = symtable_id(cs->gtable, node->data.id.val, SYMFIND);
-        if (a >= 0) {
-            /* found the symbol in the globals table */
 
-            push_instr(cs, LOADG, a);
-            return;
-        }
-    }
+/** longest string that constant folding will build */
+#define FOLD_MAX_STRING     4096
+/** largest exponent for which constant folding raises an int to a power */
+#define FOLD_MAX_EXPONENT   64
 
-    /* didn't find symbol in the globals table either */
-    a = symtable_id(builtin_symbols, node->data.id.val, SYMFIND);
-    if (a >= 0) {
-        /* the symbol is one of Luci's builtin symbols */
-        push_instr(cs, LOADB, a);
-        return;
+/** returns true if a constant is an int, a big int or a float */
+#define IS_NUMBER(o)    (ISINTEGER(o) || ISTYPE(o, obj_float_t))
+
+/** returns true if a number constant is zero */
+#define IS_ZERO(o)      ((ISTYPE(o, obj_int_t) && AS_INT(o)->i == 0) || \
+        (ISTYPE(o, obj_float_t) && AS_FLOAT(o)->f == 0.0))
+
+/**
+ * Determines whether a binary operator can be applied to two
+ * constants at compile time
+ *
+ * Only operations that are sure to succeed are folded, so that a
+ * failing one (1 / 0, "a" - 1) still fails at runtime, and only if
+ * it is reached. Strings and powers are only built up to a size.
+ *
+ * @param op binary operator
+ * @param a left constant
+ * @param b right constant
+ * @returns true if op can be folded
+ */
+static bool can_fold_binary(op_type op, LuciObject *a, LuciObject *b)
+{
+    bool numbers = IS_NUMBER(a) && IS_NUMBER(b);
+
+    switch (op) {
+        case op_add_t:
+            return numbers || (ISTYPE(a, obj_string_t) &&
+                    ISTYPE(b, obj_string_t) &&
+                    AS_STRING(a)->len + AS_STRING(b)->len <= FOLD_MAX_STRING);
+        case op_mul_t:
+            if (ISTYPE(b, obj_string_t)) {
+                LuciObject *t = a; a = b; b = t;
+            }
+            return numbers || (ISTYPE(a, obj_string_t) &&
+                    ISTYPE(b, obj_int_t) && (AS_INT(b)->i <= 0 ||
+                    AS_INT(b)->i <= FOLD_MAX_STRING / (AS_STRING(a)->len + 1)));
+        case op_sub_t:
+        case op_lt_t:
+        case op_gt_t:
+        case op_lte_t:
+        case op_gte_t:
+            return numbers;
+        case op_div_t:
+            return numbers && !IS_ZERO(b);
+        case op_mod_t:
+            /* float modulo isn't supported */
+            return ISINTEGER(a) && ISINTEGER(b) && !IS_ZERO(b);
+        case op_pow_t:
+            if (ISINTEGER(a) && ISINTEGER(b)) {
+                return ISTYPE(a, obj_int_t) && ISTYPE(b, obj_int_t) &&
+                    AS_INT(b)->i >= 0 && AS_INT(b)->i <= FOLD_MAX_EXPONENT;
+            }
+            return numbers;
+        case op_eq_t:
+        case op_neq_t:
+            return numbers ||
+                (ISTYPE(a, obj_string_t) && ISTYPE(b, obj_string_t));
+        case op_lgor_t:
+        case op_lgand_t:
+            return true;
+        case op_bwxor_t:
+        case op_bwor_t:
+        case op_bwand_t:
+            /* big ints and floats can't be mixed bitwise */
+            return (ISINTEGER(a) && ISINTEGER(b)) || (numbers &&
+                    !ISTYPE(a, obj_bigint_t) && !ISTYPE(b, obj_bigint_t));
+        default:
+            return false;
     }
+}
 
-    /* symbol not found */
-    LUCI_DIE("%s undefined.\n", node->data.id.val);
+/**
+ * Computes the value of a constant expression at compile time
+ *
+ * Literals have a value, and so do operators and calls to the builtin
+ * len() whose operands all have a value, e.g. 60 * 60 * 24,
+ * "-" * 40 or len([1, 2, 3]).
+ *
+ * @param node AST Node
+ * @param cs CompileState the node is being compiled to
+ * @returns the constant int, big int, float or string the node
+ *          evaluates to, or NULL if it isn't constant
+ */
+static LuciObject *constant_value(AstNode *node, CompileState *cs)
+{
+    LuciObject *a, *b;
+    AstNode *args, *arg;
+    Opcode op;
+
+    switch (node->type) {
+        case ast_integer_t:
+            return LuciInt_new(node->data.i);
+        case ast_bigint_t:
+            return LuciBigInt_parse(node->data.s);
+        case ast_float_t:
+            return LuciFloat_new(node->data.f);
+        case ast_string_t:
+            a = LuciString_new(strdup(node->data.s));
+            /* leave invalid UTF-8 for compile_string_constant to report */
+            return LuciString_validate(a) ? a : NULL;
+        case ast_unexpr_t:
+            a = constant_value(node->data.unexpr.right, cs);
+            if (!a) {
+                return NULL;
+            }
+            switch (node->data.unexpr.op) {
+                case op_neg_t:
+                    return IS_NUMBER(a) ? a->type->neg(a) : NULL;
+                case op_lgnot_t:
+                    b = a->type->lgnot(a);
+                    return ISTYPE(b, obj_nil_t) ? NULL : b;
+                case op_bwnot_t:
+                    return IS_NUMBER(a) ? a->type->bwnot(a) : NULL;
+                default:
+                    return NULL;
+            }
+        case ast_binexpr_t:
+            a = constant_value(node->data.binexpr.left, cs);
+            if (!a) {
+                return NULL;
+            }
+            b = constant_value(node->data.binexpr.right, cs);
+            if (!b || !can_fold_binary(node->data.binexpr.op, a, b)) {
+                return NULL;
+            }
+            return BINOP((LuciBinop)node->data.binexpr.op, a, b);
+        case ast_call_t:
+            /* len() of a literal, unless 'len' names a variable */
+            args = node->data.call.arglist;
+            if (node->data.call.funcname->type != ast_id_t ||
+                    strcmp(node->data.call.funcname->data.id.val, "len") ||
+                    args->data.listdef.count != 1 ||
+                    resolve_id(cs, "len", &op) < 0 || op != LOADB) {
+                return NULL;
+            }
+            arg = args->data.listdef.items[0];
+            if (arg->type == ast_listdef_t || arg->type == ast_tupledef_t) {
+                int i;
+                for (i = 0; i < arg->data.listdef.count; i++) {
+                    if (!constant_value(arg->data.listdef.items[i], cs)) {
+                        return NULL;
+                    }
+                }
+                return LuciInt_new(arg->data.listdef.count);
+            }
+            a = constant_value(arg, cs);
+            return (a && ISTYPE(a, obj_string_t)) ? a->type->len(a) : NULL;
+        default:
+            return NULL;
+    }
 }
 
+/**
+ * Compiles a constant expression to a single LOADK
+ *
+ * @param node AST Node to compile
+ * @param cs CompileState to compile to
+ * @returns true if node was constant and has been compiled
+ */
+static bool compile_folded(AstNode *node, CompileState *cs)
+{
+    LuciObject *obj = constant_value(node, cs);
+    if (!obj) {
+        return false;
+    }
+    push_instr(cs, LOADK, constant_id(cs->ctable, obj));
+    return true;
+}
 
 /**
  * Compile a unary expression AST Node
@@ -131,11 +402,50 @@ static void compile_id_expr(AstNode *node, CompileState *cs)
  */
 static void compile_unary_expr(AstNode *node, CompileState *cs)
 {
+    if (compile_folded(node, cs)) {
+        return;
+    }
     compile(node->data.unexpr.right, cs);
     /* offset by opcode 'NEG', which is the first binary opcode */
     push_instr(cs, NEG + (node->data.unexpr.op - op_neg_t), 0);
 }
 
+/**
+ * Compile a jump taken when an expression has the given truth value
+ *
+ * The operands of && and || become jumps themselves, so the right
+ * operand is only evaluated when the left one doesn't decide the
+ * result. Every jump is added to a list for the caller to patch.
+ *
+ * @param node AST Node of the condition
+ * @param cs CompileState to compile to
+ * @param when truth value that jumps; the other falls through
+ * @param jumps list of jumps to patch
+ */
+static void compile_condition(AstNode *node, CompileState *cs,
+        bool when, Loopjump **jumps)
+{
+    Loopjump *skip = NULL;
+    bool decides;
+
+    if (node->type != ast_binexpr_t || (node->data.binexpr.op != op_lgand_t &&
+                node->data.binexpr.op != op_lgor_t)) {
+        compile(node, cs);
+        push_jump(cs, jumps, when ? JUMPNZ : JUMPZ);
+        return;
+    }
+
+    /* a false left operand decides &&, a true one decides || */
+    decides = node->data.binexpr.op == op_lgor_t;
+    if (decides == when) {
+        compile_condition(node->data.binexpr.left, cs, when, jumps);
+    } else {
+        compile_condition(node->data.binexpr.left, cs, decides, &skip);
+    }
+    compile_condition(node->data.binexpr.right, cs, when, jumps);
+    patch_jumps(cs, skip, cs->instr_count);
+}
+
 /**
  * Compile a binary expression AST Node
  *
@@ -144,6 +454,23 @@ static void compile_unary_expr(AstNode *node, CompileState *cs)
  */
 static void compile_binary_expr(AstNode *node, CompileState *cs)
 {
+    Loopjump *falses = NULL;
+    uint32_t addr;
+
+    if (compile_folded(node, cs)) {
+        return;
+    }
+    if (node->data.binexpr.op == op_lgand_t ||
+            node->data.binexpr.op == op_lgor_t) {
+        /* short-circuit, then push true or false */
+        compile_condition(node, cs, false, &falses);
+        push_instr(cs, LOADK, constant_id(cs->ctable, LuciTrueObj));
+        addr = push_instr(cs, JUMP, -1);
+        patch_jumps(cs, falses, cs->instr_count);
+        push_instr(cs, LOADK, constant_id(cs->ctable, LuciFalseObj));
+        put_instr(cs, addr, JUMP, cs->instr_count);
+        return;
+    }
     compile(node->data.binexpr.left, cs);
     compile(node->data.binexpr.right, cs);
     /* offset by opcode 'ADD', which is the first binary opcode */
@@ -171,10 +498,24 @@ static void compile_container_access(AstNode *node, CompileState *cs)
  */
 static void compile_container_assignment(AstNode *node, CompileState *cs)
 {
+    AstNode *container = node->data.contassign.container;
+    int a = -1;
+
     compile(node->data.contassign.right, cs);
     compile(node->data.contassign.index, cs);
-    compile(node->data.contassign.container, cs);
-    push_instr(cs, CPUT, 0);
+    compile(container, cs);
+
+    if (container->type == ast_id_t) {
+        a = local_id(cs, container->data.id.val, SYMFIND);
+    }
+    if (a >= 0) {
+        /* store the container back into its local variable, since
+         * assigning into an (immutable) string creates a new string */
+        push_instr(cs, CPUT, 1);
+        push_instr(cs, STORE, a);
+    } else {
+        push_instr(cs, CPUT, 0);
+    }
 }
 
 /**
@@ -225,6 +566,45 @@ static void compile_list_def(AstNode *node, CompileState *cs)
     push_instr(cs, MKLIST, node->data.listdef.count);
 }
 
+/**
+ * Compile a tuple definition AST Node
+ *
+ * @param node AST Node to compile
+ * @param cs CompileState to compile to
+ */
+static void compile_tuple_def(AstNode *node, CompileState *cs)
+{
+    int i;
+    /* compile tuple items in reverse order */
+    for (i = node->data.listdef.count - 1; i >= 0; i--) {
+        compile(node->data.listdef.items[i], cs);
+    }
+    /* add MKTUPLE instruction for # of tuple items */
+    push_instr(cs, MKTUPLE, node->data.listdef.count);
+}
+
+/**
+ * Compile an unpacking assignment AST Node
+ *
+ * UNPACK pushes the items in reverse order, so that each of the
+ * following STOREs pops the item for its name.
+ *
+ * @param node AST Node to compile
+ * @param cs CompileState to compile to
+ */
+static void compile_unpack(AstNode *node, CompileState *cs)
+{
+    AstNode *names = node->data.unpack.names;
+    int i, a;
+
+    compile(node->data.unpack.right, cs);
+    push_instr(cs, UNPACK, names->data.listdef.count);
+    for (i = 0; i < names->data.listdef.count; i++) {
+        a = local_id(cs, names->data.listdef.items[i]->data.s, SYMCREATE);
+        push_instr(cs, STORE, a);
+    }
+}
+
 /**
  * Compile an assignment AST Node
  *
@@ -248,14 +628,14 @@ static void compile_assignment(AstNode *node, CompileState *cs)
     while (tmp->data.assignment.right->type == ast_assign_t) {
         push_instr(cs, DUP, 0);
         /* get id of left-hand symbol */
-        a = symtable_id(cs->ltable, tmp->data.assignment.name, SYMCREATE);
+        a = local_id(cs, tmp->data.assignment.name, SYMCREATE);
         /* add a STORE instruction */
         push_instr(cs, STORE, a);
 
         tmp = tmp->data.assignment.right;
     }
     /* get id of final left-hand symbol */
-    a = symtable_id(cs->ltable, tmp->data.assignment.name, SYMCREATE);
+    a = local_id(cs, tmp->data.assignment.name, SYMCREATE);
     /* add final STORE instruction */
     push_instr(cs, STORE, a);
 }
@@ -268,21 +648,20 @@ static void compile_assignment(AstNode *node, CompileState *cs)
  */
 static void compile_while_loop(AstNode *node, CompileState *cs)
 {
-    uint32_t addr1, addr2;
+    Loopjump *falses = NULL;
+    uint32_t addr1;
 
     add_new_loop(cs, LOOP_TYPE_WHILE);
     /* store addr of start of while */
     addr1 = cs->instr_count;
-    /* compile test expression */
-    compile(node->data.while_loop.cond, cs);
-    /* push a bogus jump instr */
-    addr2 = push_instr(cs, JUMP, -1);
+    /* compile test expression, jumping out of the loop when false */
+    compile_condition(node->data.while_loop.cond, cs, false, &falses);
     /* compile body of while loop */
     compile(node->data.while_loop.statements, cs);
     /* add a jump to beginning of while loop */
     push_instr(cs, JUMP, addr1);
-    /* change bogus instr to conditional jump */
-    put_instr(cs, addr2, JUMPZ, cs->instr_count);
+    /* point the conditional jumps past the loop */
+    patch_jumps(cs, falses, cs->instr_count);
 
     back_patch_loop(cs, addr1, cs->instr_count);
 }
@@ -301,15 +680,20 @@ static void compile_for_loop(AstNode *node, CompileState *cs)
     add_new_loop(cs, LOOP_TYPE_FOR);
     /* compile loop (expr) */
     compile(node->data.for_loop.container, cs);
-    /* Make Iterator */
-    push_instr(cs, MKITER, 0);
+    /* Make Iterator (over key/value pairs if there's a value symbol) */
+    push_instr(cs, MKITER, node->data.for_loop.val != NULL);
     /* store addr of start of for-loop */
     addr1 = cs->instr_count;
     /* push bogus jump for getting iterator->next */
     addr2 = push_instr(cs, JUMP, -1);
     /* store iterator output in symbol */
-    a = symtable_id(cs->ltable, node->data.for_loop.iter, SYMCREATE);
+    a = local_id(cs, node->data.for_loop.iter, SYMCREATE);
     push_instr(cs, STORE, a);
+    if (node->data.for_loop.val) {
+        /* the value was pushed below the key */
+        a = local_id(cs, node->data.for_loop.val, SYMCREATE);
+        push_instr(cs, STORE, a);
+    }
     /* compile body of for-loop */
     compile(node->data.for_loop.statements, cs);
     /* add jump to beginning of for-loop */
@@ -328,32 +712,584 @@ static void compile_for_loop(AstNode *node, CompileState *cs)
  */
 static void compile_if_else(AstNode *node, CompileState *cs)
 {
-    uint32_t addr1, addr2;
+    Loopjump *falses = NULL;
+    uint32_t addr2;
 
-    /* compile test expression */
-    compile(node->data.if_else.cond, cs);
-    /* add bogus instruction number 1 */
-    addr1 = push_instr(cs, JUMP, -1);
+    /* compile test expression, jumping to the else part when false */
+    compile_condition(node->data.if_else.cond, cs, false, &falses);
     /* compile TRUE statements */
     compile(node->data.if_else.ifstatements, cs);
 
     if (node->data.if_else.elstatements) {
         /* add bogus instruction number 2 */
         addr2 = push_instr(cs, JUMP, -1);
-        /* change bogus instr 1 to a conditional jump */
-        put_instr(cs, addr1, JUMPZ, cs->instr_count);
+        /* point the conditional jumps at the FALSE statements */
+        patch_jumps(cs, falses, cs->instr_count);
         /* compile FALSE statements */
         compile(node->data.if_else.elstatements, cs);
         /* change bogus instr 2 to a jump */
         put_instr(cs, addr2, JUMP, cs->instr_count);
     }
     else {
-        /* change bogus instr 1 to a conditional jump */
-        put_instr(cs, addr1, JUMPZ, cs->instr_count);
+        /* point the conditional jumps past the TRUE statements */
+        patch_jumps(cs, falses, cs->instr_count);
     }
 
 }
 
+/** largest function body, in AST nodes, that is inlined at call sites */
+#define INLINE_MAX_NODES    40
+/** most inlined bodies nested inside one another */
+#define INLINE_MAX_DEPTH    4
+/** most locals, including parameters, of a function that is inlined */
+#define INLINE_MAX_LOCALS   64
+
+/**
+ * A function defined at the top of the program
+ */
+typedef struct inline_func_ {
+    AstNode *def;       /**< definition of the function */
+    char *globals[INLINE_MAX_NODES];    /**< names it reads from the
+                                             global scope */
+    int nglobals;       /**< number of global names */
+    int callees[INLINE_MAX_NODES];  /**< the other functions it calls */
+    int ncallees;       /**< number of calls to other functions */
+    int nodes;          /**< size of the body in AST nodes */
+    bool ok;            /**< false if calls are never inlined */
+    bool seen;          /**< used while looking for recursion */
+} InlineFunc;
+
+/**
+ * The functions of the program being compiled that may be inlined
+ */
+typedef struct inline_table_ {
+    InlineFunc *funcs;      /**< candidate functions */
+    int count;              /**< number of candidates */
+    SymbolTable *names;     /**< candidate names, indexing funcs */
+    SymbolTable *globals;   /**< every name bound in the global scope */
+    SymbolTable *rebound;   /**< names bound more than once */
+    SymbolTable *root;      /**< locals of the global scope */
+} InlineTable;
+
+/** candidates while compile_ast runs with compile_inline set */
+static InlineTable *inliner = NULL;
+
+/**
+ * Records a name bound in the global scope by anything but a
+ * top-level function definition
+ */
+static void inline_rebind(InlineTable *t, const char *name)
+{
+    symtable_id(t->globals, name, SYMCREATE);
+    symtable_id(t->rebound, name, SYMCREATE);
+}
+
+/**
+ * Records the names bound by a block of global statements
+ *
+ * Functions defined directly in the top block become candidates.
+ *
+ * @param t table of candidates
+ * @param node statements AST Node
+ * @param top true for the outermost block of the program
+ */
+static void inline_collect(InlineTable *t, AstNode *node, bool top)
+{
+    AstNode *tmp, *names, **stmts = &node;
+    char *name;
+    int i, j, count = 1;
+
+    /* the else part of an else-if is the if-else node itself */
+    if (node->type == ast_stmnts_t) {
+        stmts = node->data.statements.statements;
+        count = node->data.statements.count;
+    }
+    for (i = 0; i < count; i++) {
+        tmp = stmts[i];
+        switch (tmp->type) {
+            case ast_func_t:
+                name = tmp->data.funcdef.funcname;
+                if (!top || symtable_id(t->globals, name, SYMFIND) >= 0) {
+                    inline_rebind(t, name);
+                    break;
+                }
+                symtable_id(t->globals, name, SYMCREATE);
+                symtable_id(t->names, name, SYMCREATE);
+                t->funcs[t->count].def = tmp;
+                t->funcs[t->count].ok = true;
+                t->count++;
+                break;
+            case ast_assign_t:
+                for (; tmp->type == ast_assign_t;
+                        tmp = tmp->data.assignment.right) {
+                    inline_rebind(t, tmp->data.assignment.name);
+                }
+                break;
+            case ast_unpack_t:
+                names = tmp->data.unpack.names;
+                for (j = 0; j < names->data.listdef.count; j++) {
+                    inline_rebind(t, names->data.listdef.items[j]->data.s);
+                }
+                break;
+            case ast_for_t:
+                inline_rebind(t, tmp->data.for_loop.iter);
+                if (tmp->data.for_loop.val) {
+                    inline_rebind(t, tmp->data.for_loop.val);
+                }
+                inline_collect(t, tmp->data.for_loop.statements, false);
+                break;
+            case ast_while_t:
+                inline_collect(t, tmp->data.while_loop.statements, false);
+                break;
+            case ast_if_t:
+                inline_collect(t, tmp->data.if_else.ifstatements, false);
+                if (tmp->data.if_else.elstatements) {
+                    inline_collect(t, tmp->data.if_else.elstatements, false);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/**
+ * Checks an expression in the body of a candidate
+ *
+ * Records the global names it reads and the candidates it calls.
+ *
+ * @param f candidate function
+ * @param node expression AST Node
+ * @param locals the function's locals so far
+ * @param assigned bit set of the locals assigned on every path here
+ */
+static void inline_scan_expr(InlineFunc *f, AstNode *node,
+        SymbolTable *locals, uint64_t assigned)
+{
+    AstNode *name;
+    int i, a;
+
+    if (++f->nodes > INLINE_MAX_NODES) {
+        f->ok = false;
+    }
+    if (!f->ok) {
+        return;
+    }
+
+    switch (node->type) {
+        case ast_nil_t:
+        case ast_integer_t:
+        case ast_bigint_t:
+        case ast_float_t:
+        case ast_string_t:
+            break;
+        case ast_id_t:
+            a = symtable_id(locals, node->data.id.val, SYMFIND);
+            if (a < 0) {
+                f->globals[f->nglobals++] = node->data.id.val;
+            } else if (!(assigned & ((uint64_t)1 << a))) {
+                /* a call would find it unset, the inlined body
+                 * could find the value of an earlier call */
+                f->ok = false;
+            }
+            break;
+        case ast_unexpr_t:
+            inline_scan_expr(f, node->data.unexpr.right, locals, assigned);
+            break;
+        case ast_binexpr_t:
+            inline_scan_expr(f, node->data.binexpr.left, locals, assigned);
+            inline_scan_expr(f, node->data.binexpr.right, locals, assigned);
+            break;
+        case ast_contaccess_t:
+            inline_scan_expr(f, node->data.contaccess.container,
+                    locals, assigned);
+            inline_scan_expr(f, node->data.contaccess.index,
+                    locals, assigned);
+            break;
+        case ast_mapdef_t:
+            for (i = 0; i < node->data.mapdef.count; i++) {
+                inline_scan_expr(f, node->data.mapdef.pairs[i],
+                        locals, assigned);
+            }
+            break;
+        case ast_mapkeyval_t:
+            inline_scan_expr(f, node->data.mapkeyval.key, locals, assigned);
+            inline_scan_expr(f, node->data.mapkeyval.val, locals, assigned);
+            break;
+        case ast_listdef_t:
+        case ast_tupledef_t:
+            for (i = 0; i < node->data.listdef.count; i++) {
+                inline_scan_expr(f, node->data.listdef.items[i],
+                        locals, assigned);
+            }
+            break;
+        case ast_call_t:
+            name = node->data.call.funcname;
+            if (name->type == ast_id_t &&
+                    symtable_id(locals, name->data.id.val, SYMFIND) < 0) {
+                a = symtable_id(inliner->names, name->data.id.val, SYMFIND);
+                if (a >= 0) {
+                    f->callees[f->ncallees++] = a;
+                }
+            }
+            inline_scan_expr(f, name, locals, assigned);
+            node = node->data.call.arglist;
+            for (i = 0; i < node->data.listdef.count; i++) {
+                inline_scan_expr(f, node->data.listdef.items[i],
+                        locals, assigned);
+            }
+            break;
+        default:
+            f->ok = false;
+            break;
+    }
+}
+
+/**
+ * Creates a local of a candidate, as compiling an assignment would
+ *
+ * @returns the bit set of assigned locals, including the new one
+ */
+static uint64_t inline_scan_store(InlineFunc *f, const char *name,
+        SymbolTable *locals, uint64_t assigned)
+{
+    int a = symtable_id(locals, name, SYMCREATE);
+    if (a >= INLINE_MAX_LOCALS) {
+        f->ok = false;
+        return assigned;
+    }
+    return assigned | ((uint64_t)1 << a);
+}
+
+/**
+ * Checks a block of statements in the body of a candidate
+ *
+ * Only blocks without loops and function definitions are inlined,
+ * and only if every local is assigned before it's read.
+ *
+ * @param f candidate function
+ * @param node statements AST Node
+ * @param locals the function's locals so far
+ * @param assigned bit set of the locals assigned on every path here
+ * @returns the locals assigned on every path out of the block, or
+ *          all of them if it always returns
+ */
+static uint64_t inline_scan_block(InlineFunc *f, AstNode *node,
+        SymbolTable *locals, uint64_t assigned)
+{
+    AstNode *tmp, *names, **stmts = &node;
+    uint64_t other;
+    int i, j, count = 1;
+
+    /* the else part of an else-if is the if-else node itself */
+    if (node->type == ast_stmnts_t) {
+        stmts = node->data.statements.statements;
+        count = node->data.statements.count;
+    }
+    for (i = 0; i < count && f->ok; i++) {
+        tmp = stmts[i];
+        f->nodes++;
+        switch (tmp->type) {
+            case ast_assign_t:
+                names = tmp;
+                while (tmp->type == ast_assign_t) {
+                    tmp = tmp->data.assignment.right;
+                }
+                inline_scan_expr(f, tmp, locals, assigned);
+                for (; names->type == ast_assign_t;
+                        names = names->data.assignment.right) {
+                    assigned = inline_scan_store(f,
+                            names->data.assignment.name, locals, assigned);
+                }
+                break;
+            case ast_unpack_t:
+                inline_scan_expr(f, tmp->data.unpack.right, locals, assigned);
+                names = tmp->data.unpack.names;
+                for (j = 0; j < names->data.listdef.count; j++) {
+                    assigned = inline_scan_store(f,
+                            names->data.listdef.items[j]->data.s,
+                            locals, assigned);
+                }
+                break;
+            case ast_contassign_t:
+                inline_scan_expr(f, tmp->data.contassign.right,
+                        locals, assigned);
+                inline_scan_expr(f, tmp->data.contassign.index,
+                        locals, assigned);
+                inline_scan_expr(f, tmp->data.contassign.container,
+                        locals, assigned);
+                break;
+            case ast_unexpr_t:
+            case ast_binexpr_t:
+            case ast_call_t:
+            case ast_id_t:
+                inline_scan_expr(f, tmp, locals, assigned);
+                break;
+            case ast_return_t:
+                if (tmp->data.return_stmt.expr) {
+                    inline_scan_expr(f, tmp->data.return_stmt.expr,
+                            locals, assigned);
+                }
+                /* nothing after a return is reached */
+                assigned = ~(uint64_t)0;
+                break;
+            case ast_pass_t:
+                break;
+            case ast_if_t:
+                inline_scan_expr(f, tmp->data.if_else.cond, locals, assigned);
+                other = assigned;
+                if (tmp->data.if_else.elstatements) {
+                    /* the else block is compiled after the if block */
+                    other = inline_scan_block(f, tmp->data.if_else.ifstatements,
+                            locals, assigned);
+                    assigned = inline_scan_block(f,
+                            tmp->data.if_else.elstatements, locals, assigned);
+                } else {
+                    assigned = inline_scan_block(f,
+                            tmp->data.if_else.ifstatements, locals, assigned);
+                }
+                assigned &= other;
+                break;
+            default:
+                f->ok = false;
+                break;
+        }
+    }
+    if (f->nodes > INLINE_MAX_NODES) {
+        f->ok = false;
+    }
+    return assigned;
+}
+
+/**
+ * Checks whether a candidate is small and simple enough to inline
+ */
+static void inline_scan(InlineFunc *f)
+{
+    AstNode *params = f->def->data.funcdef.param_list;
+    SymbolTable *locals = symtable_new(BASE_SYMTABLE_SCALE);
+    uint64_t assigned = 0;
+    int i;
+
+    for (i = 0; i < params->data.listdef.count; i++) {
+        assigned = inline_scan_store(f, params->data.listdef.items[i]->data.s,
+                locals, assigned);
+    }
+    /* a repeated parameter name shares one local */
+    if (locals->count != params->data.listdef.count) {
+        f->ok = false;
+    }
+    if (f->ok) {
+        inline_scan_block(f, f->def->data.funcdef.statements,
+                locals, assigned);
+    }
+    symtable_delete(locals);
+}
+
+/**
+ * Returns true if a candidate that may be inlined calls, directly or
+ * through other candidates that may be inlined, the given one
+ */
+static bool inline_reaches(InlineTable *t, InlineFunc *from, int target)
+{
+    int i, c;
+
+    for (i = 0; i < from->ncallees; i++) {
+        c = from->callees[i];
+        if (!t->funcs[c].ok || t->funcs[c].seen) {
+            continue;
+        }
+        if (c == target) {
+            return true;
+        }
+        t->funcs[c].seen = true;
+        if (inline_reaches(t, &t->funcs[c], target)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Fills the table of candidates for the program being compiled
+ *
+ * Candidates are defined once at the top of the program, and their
+ * names are never bound to anything else. Inlining stops where it
+ * would expand a function inside itself, so that each candidate
+ * in a cycle of calls is left with at least one real call.
+ *
+ * @param root top-level AST Node
+ * @param cs CompileState of the global scope
+ */
+static void inline_table_init(AstNode *root, CompileState *cs)
+{
+    InlineTable *t = alloc(sizeof(*t));
+    int i, j;
+
+    t->funcs = alloc((root->data.statements.count + 1) * sizeof(*t->funcs));
+    memset(t->funcs, 0, (root->data.statements.count + 1) *
+            sizeof(*t->funcs));
+    t->count = 0;
+    t->names = symtable_new(BASE_SYMTABLE_SCALE);
+    t->globals = symtable_new(BASE_SYMTABLE_SCALE);
+    t->rebound = symtable_new(BASE_SYMTABLE_SCALE);
+    t->root = cs->ltable;
+    inliner = t;
+
+    inline_collect(t, root, true);
+    for (i = 0; i < t->count; i++) {
+        if (symtable_id(t->rebound,
+                    t->funcs[i].def->data.funcdef.funcname, SYMFIND) >= 0) {
+            t->funcs[i].ok = false;
+        } else {
+            inline_scan(&t->funcs[i]);
+        }
+    }
+    for (i = 0; i < t->count; i++) {
+        if (!t->funcs[i].ok) {
+            continue;
+        }
+        for (j = 0; j < t->count; j++) {
+            t->funcs[j].seen = false;
+        }
+        if (inline_reaches(t, &t->funcs[i], i)) {
+            t->funcs[i].ok = false;
+        }
+    }
+}
+
+/**
+ * Deallocates the table of candidates
+ */
+static void inline_table_delete(void)
+{
+    InlineTable *t = inliner;
+
+    symtable_delete(t->names);
+    symtable_delete(t->globals);
+    symtable_delete(t->rebound);
+    free(t->funcs);
+    free(t);
+    inliner = NULL;
+}
+
+/**
+ * Finds the candidate a call may be replaced with
+ *
+ * The function's name must refer to the top-level definition, and
+ * each global name in its body must refer to what it does inside
+ * the function.
+ *
+ * @param node function call AST Node
+ * @param cs CompileState the call is compiled to
+ * @returns the candidate, or NULL if the call can't be inlined
+ */
+static InlineFunc *inline_candidate(AstNode *node, CompileState *cs)
+{
+    AstNode *name = node->data.call.funcname;
+    InlineFunc *f;
+    int i, a;
+
+    if (!inliner || name->type != ast_id_t ||
+            (cs->inlining && cs->inlining->depth >= INLINE_MAX_DEPTH)) {
+        return NULL;
+    }
+    if (cs->inlining) {
+        /* the enclosing body was already checked */
+        if (local_id(cs, name->data.id.val, SYMFIND) >= 0) {
+            return NULL;
+        }
+    } else if (cs->gtable ? cs->gtable != inliner->root ||
+            symtable_id(cs->ltable, name->data.id.val, SYMFIND) >= 0 :
+            cs->ltable != inliner->root) {
+        return NULL;
+    }
+
+    a = symtable_id(inliner->names, name->data.id.val, SYMFIND);
+    if (a < 0 || !inliner->funcs[a].ok) {
+        return NULL;
+    }
+    f = &inliner->funcs[a];
+    if (node->data.call.arglist->data.listdef.count !=
+            f->def->data.funcdef.param_list->data.listdef.count) {
+        /* leave the error to the call */
+        return NULL;
+    }
+
+    for (i = 0; i < f->nglobals; i++) {
+        if (symtable_id(inliner->globals, f->globals[i], SYMFIND) >= 0) {
+            /* the global isn't bound yet */
+            if (symtable_id(inliner->root, f->globals[i], SYMFIND) < 0) {
+                return NULL;
+            }
+        } else if (symtable_id(builtin_symbols, f->globals[i],
+                    SYMFIND) < 0) {
+            return NULL;
+        }
+    }
+    return f;
+}
+
+/**
+ * Compiles the body of a small function in place of a call to it
+ *
+ * The arguments are stored in the function's parameters, renamed into
+ * the caller's locals, and each return jumps past the end of the body
+ * with its value on the stack, where CALL would have left it.
+ *
+ * @param node function call AST Node
+ * @param cs CompileState to compile to
+ * @returns true if the call has been compiled
+ */
+static bool compile_inlined_call(AstNode *node, CompileState *cs)
+{
+    InlineFunc *f = inline_candidate(node, cs);
+    InlineSite site;
+    AstNode *args, *params, *statements, *last;
+    int i;
+
+    if (!f) {
+        return false;
+    }
+    args = node->data.call.arglist;
+    params = f->def->data.funcdef.param_list;
+    statements = f->def->data.funcdef.statements;
+
+    /* arguments are evaluated in the caller's scope */
+    for (i = 0; i < args->data.listdef.count; i++) {
+        compile(args->data.listdef.items[i], cs);
+    }
+
+    site.def = f->def;
+    site.locals = symtable_new(BASE_SYMTABLE_SCALE);
+    site.returns = NULL;
+    site.parent = cs->inlining;
+    site.depth = site.parent ? site.parent->depth + 1 : 0;
+    cs->inlining = &site;
+
+    for (i = 0; i < params->data.listdef.count; i++) {
+        local_id(cs, params->data.listdef.items[i]->data.s, SYMCREATE);
+    }
+    /* the last argument is on top of the stack */
+    for (i = params->data.listdef.count - 1; i >= 0; i--) {
+        push_instr(cs, STORE,
+                local_id(cs, params->data.listdef.items[i]->data.s, SYMFIND));
+    }
+
+    compile(statements, cs);
+    last = statements->data.statements.statements[
+            statements->data.statements.count - 1];
+    if (last->type != ast_return_t) {
+        push_instr(cs, PUSHNIL, 0);
+    }
+    patch_jumps(cs, site.returns, cs->instr_count);
+
+    cs->inlining = site.parent;
+    symtable_delete(site.locals);
+    compile_inlined++;
+    return true;
+}
+
 /**
  * Compile a function call AST Node
  *
@@ -363,6 +1299,10 @@ static void compile_if_else(AstNode *node, CompileState *cs)
 static void compile_func_call(AstNode *node, CompileState *cs)
 {
     int i;
+
+    if (compile_folded(node, cs) || compile_inlined_call(node, cs)) {
+        return;
+    }
     /* compile arglist, which pushes each arg onto stack */
     AstNode *tmp = node->data.call.arglist;
     for (i = 0; i < tmp->data.listdef.count; i++) {
@@ -552,7 +1492,12 @@ static void compile_return(AstNode *node, CompileState *cs)
     } else {
         compile(node->data.return_stmt.expr, cs);
     }
-    push_instr(cs, RETURN, 0);
+    if (cs->inlining) {
+        /* leave the value where the call would have */
+        push_jump(cs, &cs->inlining->returns, JUMP);
+    } else {
+        push_instr(cs, RETURN, 0);
+    }
 }
 
 /**
@@ -592,7 +1537,10 @@ static void (*compilers[])(AstNode *, CompileState *) = {
     compile_break,
     compile_continue,
     compile_return,
-    compile_pass
+    compile_pass,
+    compile_tuple_def,
+    compile_unpack,
+    compile_bigint_constant
 };
 
 
@@ -660,12 +1608,20 @@ CompileState * compile_ast(AstNode *root)
 
     CompileState *cs = compile_state_new();
 
+    if (compile_inline && root->type == ast_stmnts_t) {
+        inline_table_init(root, cs);
+    }
+
     /* compile the AST */
     compile(root, cs);
 
     /* end the CompileState with a HALT instr */
     push_instr(cs, HALT, 0);
 
+    if (inliner) {
+        inline_table_delete();
+    }
+
     return cs;
 }
 
@@ -725,6 +1681,11 @@ void convert_to_function(CompileState *cs, LuciObject *o, uint16_t nparams)
 
     f->nparams = nparams;
 
+    if (compile_optimize) {
+        ssa_optimize(cs);
+    }
+    peephole_optimize(cs);
+
     /* copy instructions array */
     f->ninstrs = cs->instr_count;
     size_t instr_bytes = f->ninstrs * sizeof(*cs->instructions);
@@ -767,6 +1728,7 @@ CompileState *compile_state_new(void)
     cs->ctable = cotable_new(BASE_COTABLE_SIZE);
 
     cs->current_loop = NULL;
+    cs->inlining = NULL;
 
     return cs;
 }
@@ -906,6 +1868,41 @@ static void back_patch_loop(CompileState *cs, uint32_t start, uint32_t end)
     cs->current_loop = parent_loop;
 }
 
+/**
+ * Add a bogus jump instruction to a list of jumps to patch later
+ *
+ * @param cs CompileState
+ * @param jumps list of jumps
+ * @param op jump opcode
+ */
+static void push_jump(CompileState *cs, Loopjump **jumps, Opcode op)
+{
+    Loopjump *jmp = alloc(sizeof(*jmp));
+    jmp->addr = push_instr(cs, op, -1);
+    jmp->next = *jumps;
+    *jumps = jmp;
+}
+
+/**
+ * Point every jump in a list at the given address and free the list
+ *
+ * @param cs CompileState
+ * @param jumps list of jumps
+ * @param addr address to jump to
+ */
+static void patch_jumps(CompileState *cs, Loopjump *jumps, uint32_t addr)
+{
+    Loopjump *old;
+
+    while (jumps) {
+        put_instr(cs, jumps->addr,
+                OPCODE(cs->instructions[jumps->addr]), addr);
+        old = jumps;
+        jumps = jumps->next;
+        free(old);
+    }
+}
+
 /**
  * Not Implemented.
  *
@@ -964,6 +1961,8 @@ static char *instruction_names[] = {
     "RETURN",
     "MKMAP",
     "MKLIST",
+    "MKTUPLE",
+    "UNPACK",
     "CGET",
     "CPUT",
     "MKITER",
@@ -971,6 +1970,7 @@ static char *instruction_names[] = {
     "JUMP",
     "POPJUMP",
     "JUMPZ",
+    "JUMPNZ",
     "ITERJUMP",
 };
 
@@ -53,6 +53,8 @@ typedef enum {
     RETURN,
     MKMAP,
     MKLIST,
+    MKTUPLE,
+    UNPACK,
     CGET,
     CPUT,
     MKITER,
@@ -60,6 +62,7 @@ typedef enum {
     JUMP,
     POPJUMP,
     JUMPZ,
+    JUMPNZ,
     ITERJUMP
 } Opcode;
 
@@ -87,10 +90,17 @@ typedef enum {
 extern SymbolTable *builtin_symbols;
 /** global builtins array (from final builtins symbol table) */
 extern LuciObject **builtins;
+/** whether to run the SSA optimizer on each function (luci -O) */
+extern bool compile_optimize;
+/** whether to inline small functions at their call sites (luci -i) */
+extern bool compile_inline;
+/** number of calls replaced by the body of the function called */
+extern uint32_t compile_inlined;
 
 
 /**
- * A linked list node used to track nested loops
+ * A linked list node holding the address of a jump to back-patch,
+ * used for breaks, continues and short-circuit conditions
  */
 typedef struct loop_jump_ {
     struct loop_jump_ *next;    /**< next loop-jump in linked list */
@@ -120,6 +130,8 @@ typedef struct compile_state_ {
     SymbolTable *gtable;        /**< symbol table for globals */
     ConstantTable *ctable;      /**< constant table */
     Looplist *current_loop;     /**< used while compiling loops */
+    struct inline_site_ *inlining;  /**< innermost function body being
+                                         inlined, or NULL */
     uint32_t instr_count;       /**< instruction count */
     uint32_t instr_alloc;       /**< size of instructions array */
 } CompileState;
@@ -22,6 +22,11 @@ ConstantTable *cotable_new(unsigned int size)
     cotable->count = 0;
     cotable->size = size;
     cotable->objects = alloc(cotable->size * sizeof(*cotable->objects));
+    cotable->nslots = 16;
+    while (cotable->nslots < 2 * size) {
+        cotable->nslots <<= 1;
+    }
+    cotable->slots = calloc(cotable->nslots, sizeof(*cotable->slots));
     return cotable;
 }
 
@@ -34,10 +39,66 @@ void cotable_delete(ConstantTable *cotable)
 {
     free(cotable->objects);
     cotable->objects = NULL;
+    free(cotable->slots);
+    cotable->slots = NULL;
     free(cotable);
     return;
 }
 
+/**
+ * Determines whether two constants are interchangeable
+ *
+ * Unlike the == operator, 1 and 1.0 are different constants, and so
+ * are 0.0 and -0.0.
+ *
+ * @param a constant
+ * @param b constant
+ * @returns true if a and b have the same type and value
+ */
+static bool constants_equal(LuciObject *a, LuciObject *b)
+{
+    if (!TYPES_MATCH(a, b)) {
+        return false;
+    }
+    if (ISTYPE(a, obj_int_t)) {
+        return AS_INT(a)->i == AS_INT(b)->i;
+    } else if (ISTYPE(a, obj_float_t)) {
+        return memcmp(&AS_FLOAT(a)->f, &AS_FLOAT(b)->f,
+                sizeof(AS_FLOAT(a)->f)) == 0;
+    } else if (ISTYPE(a, obj_string_t)) {
+        return AS_STRING(a)->len == AS_STRING(b)->len &&
+            memcmp(AS_STRING(a)->s, AS_STRING(b)->s, AS_STRING(a)->len) == 0;
+    } else if (ISTYPE(a, obj_bigint_t)) {
+        return LuciBigInt_eq(a, b) == LuciTrueObj;
+    }
+    return a == b;
+}
+
+/**
+ * Doubles the number of hash slots and reinserts every constant
+ *
+ * @param cotable the ConstantTable to grow
+ */
+static void cotable_rehash(ConstantTable *cotable)
+{
+    uint32_t i;
+
+    free(cotable->slots);
+    cotable->nslots <<= 1;
+    cotable->slots = calloc(cotable->nslots, sizeof(*cotable->slots));
+    for (i = 0; i < cotable->count; i++) {
+        LuciObject *o = cotable->objects[i];
+        if (o->type->hash0) {
+            uint32_t mask = cotable->nslots - 1;
+            uint32_t s = o->type->hash0(o) & mask;
+            while (cotable->slots[s]) {
+                s = (s + 1) & mask;
+            }
+            cotable->slots[s] = i + 1;
+        }
+    }
+}
+
 /**
  * Returns the ID of the constant value.
  * Inserts object into table if it is not already present
@@ -48,18 +109,37 @@ void cotable_delete(ConstantTable *cotable)
  */
 unsigned int constant_id(ConstantTable *cotable, LuciObject *const_obj)
 {
+    uint32_t s = 0;
+
     if (const_obj == NULL)
         LUCI_DIE("%s", "Can't index a NULL constant\n");
 
-    if (cotable->count > cotable->size) {
+    if (const_obj->type->hash0) {
+        uint32_t mask = cotable->nslots - 1;
+        s = const_obj->type->hash0(const_obj) & mask;
+        while (cotable->slots[s]) {
+            uint32_t id = cotable->slots[s] - 1;
+            if (constants_equal(cotable->objects[id], const_obj)) {
+                return id;
+            }
+            s = (s + 1) & mask;
+        }
+        cotable->slots[s] = cotable->count + 1;
+    }
+
+    if (cotable->count >= cotable->size) {
         cotable->size <<= 1;
         cotable->objects = realloc(cotable->objects,
                 cotable->size * sizeof(*cotable->objects));
     }
     /* store object */
-    cotable->objects[cotable->count] = const_obj;
-    /* return count (index a.k.a. ID ) */
-    return cotable->count++;
+    cotable->objects[cotable->count++] = const_obj;
+    /* keep the hash slots at most half full */
+    if (2 * cotable->count > cotable->nslots) {
+        cotable_rehash(cotable);
+    }
+    /* return index (a.k.a. ID) */
+    return cotable->count - 1;
 }
 
 /**
@@ -14,17 +14,19 @@
 /**
  * A table for storing all constants in a Luci program.
  *
- * A constant is either a LuciIntObj, LuciFloatObj, or LuciStringObj.
- * This implementation currently stores all constants linearly
- * in an array of LuciObjects. The plan (TODO:) is to implement
- * a hash table which is capable of hashing any of the constant types
- * in order to deduplicate entries.
+ * A constant is a LuciIntObj, LuciBigIntObj, LuciFloatObj or
+ * LuciStringObj. Constants are stored in an array of LuciObjects,
+ * indexed by an open-addressed hash table so that each distinct
+ * constant is stored only once.
  */
 typedef struct cotable
 {
     LuciObject **objects;   /**< Constant object array */
     uint32_t count;         /**< Current # of objects in array */
     uint32_t size;          /**< Total object array allocated size */
+    uint32_t *slots;        /**< hash slots holding object index + 1,
+                                 or 0 if empty */
+    uint32_t nslots;        /**< # of hash slots (a power of 2) */
 } ConstantTable;
 
 ConstantTable *cotable_new(unsigned int size);
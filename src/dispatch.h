@@ -52,6 +52,8 @@ static void* dispatch_table[] = {
     &&do_RETURN,
     &&do_MKMAP,
     &&do_MKLIST,
+    &&do_MKTUPLE,
+    &&do_UNPACK,
     &&do_CGET,
     &&do_CPUT,
     &&do_MKITER,
@@ -59,5 +61,6 @@ static void* dispatch_table[] = {
     &&do_JUMP,
     &&do_POPJUMP,
     &&do_JUMPZ,
+    &&do_JUMPNZ,
     &&do_ITERJUMP
 };
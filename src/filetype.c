@@ -12,6 +12,7 @@
 LuciObjectType obj_file_t = {
     "file",
     sizeof(LuciFileObj),
+    TYPEID_FILE,
 
     LuciFile_copy,
     LuciFile_copy,
@@ -113,9 +114,9 @@ LuciObject* LuciFile_asbool(LuciObject *o)
     LuciObject *res = LuciNilObj;
 
     if (AS_FILE(o)->ptr) {
-        res = LuciInt_new(true);
+        res = LuciTrueObj;
     } else {
-        res = LuciInt_new(false);
+        res = LuciFalseObj;
     }
     return res;
 }
@@ -7,11 +7,18 @@
  */
 
 #include "floattype.h"
+#include "hash.h"
+#include "numconv.h"
+
+static uint64_t float_hash(LuciObject *o);
+static unsigned int float_hash_0(LuciObject *o);
+static unsigned int float_hash_1(LuciObject *o);
 
 /** Type member table for LuciFloatObj */
 LuciObjectType obj_float_t = {
     "float",
     sizeof(LuciFloatObj),
+    TYPEID_FLOAT,
 
     LuciFloat_copy,
     LuciFloat_copy,
@@ -49,8 +56,8 @@ LuciObjectType obj_float_t = {
     LuciFloat_print,
     LuciFloat_mark,
     NULL,       /* finalize */
-    NULL,       /* hash0 */
-    NULL,       /* hash1 */
+    float_hash_0,
+    float_hash_1
 };
 
 /**
@@ -69,25 +76,29 @@ LuciObject *LuciFloat_new(double d)
 /**
  * Copies a LuciFloatObj
  *
+ * Floats are immutable, so copies share the original.
+ *
  * @param orig LucFloatObj to copy
- * @returns new copy of orig
+ * @returns orig
  */
 LuciObject* LuciFloat_copy(LuciObject *orig)
 {
-    return LuciFloat_new(((LuciFloatObj *)orig)->f);
+    return orig;
 }
 
 /**
  * Produces the LuciStringObj representation of a LuciFloatObj
  *
+ * Writes the shortest digits that parse back to the same double,
+ * e.g. "0.1", "2.0" or "1e+20".
+ *
  * @param o LuciFloatObj to represent
  * @returns LuciStringObj representation of o
  */
 LuciObject* LuciFloat_repr(LuciObject *o)
 {
-    char *s = alloc(MAX_FLOAT_DIGITS);
-    snprintf(s, MAX_FLOAT_DIGITS, "%f", (float)AS_FLOAT(o)->f);
-    /* AS_STRING(ret)->s[16] = '\0'; */
+    char *s = alloc(NUMCONV_DOUBLE_SIZE);
+    numconv_format_double(s, AS_FLOAT(o)->f);
     return LuciString_new(s);
 }
 
@@ -99,7 +110,7 @@ LuciObject* LuciFloat_repr(LuciObject *o)
  */
 LuciObject* LuciFloat_asbool(LuciObject *o)
 {
-    return LuciInt_new(AS_FLOAT(o)->f > 0.0L);
+    return LuciBool(AS_FLOAT(o)->f != 0.0);
 }
 
 /**
@@ -117,6 +128,8 @@ LuciObject* LuciFloat_add(LuciObject *a, LuciObject *b)
         res = LuciFloat_new(AS_FLOAT(a)->f + AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciFloat_new(AS_FLOAT(a)->f + AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_add(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot add object of type %s to a float\n", b->type->type_name);
     }
@@ -138,6 +151,8 @@ LuciObject* LuciFloat_sub(LuciObject *a, LuciObject *b)
         res = LuciFloat_new(AS_FLOAT(a)->f - AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciFloat_new(AS_FLOAT(a)->f - AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_sub(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot subtract an object of type %s from a float\n", b->type->type_name);
     }
@@ -159,6 +174,8 @@ LuciObject* LuciFloat_mul(LuciObject *a, LuciObject *b)
         res = LuciFloat_new(AS_FLOAT(a)->f * AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciFloat_new(AS_FLOAT(a)->f * AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_mul(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot multiply an object of type %s and a float\n",
                 b->type->type_name);
@@ -189,6 +206,8 @@ LuciObject* LuciFloat_div(LuciObject *a, LuciObject *b)
         } else {
             LUCI_DIE("%s\n", "Divide by zero");
         }
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_div(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot divide a float by an object of type %s\n",
                 b->type->type_name);
@@ -223,6 +242,8 @@ LuciObject* LuciFloat_pow(LuciObject *a, LuciObject *b)
         res = LuciFloat_new(pow(AS_FLOAT(a)->f, AS_INT(b)->i));
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciFloat_new(pow(AS_FLOAT(a)->f, AS_FLOAT(b)->f));
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_pow(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot compute the power of a float using an object of type %s\n",
                 b->type->type_name);
@@ -242,9 +263,11 @@ LuciObject* LuciFloat_eq(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f == AS_INT(b)->i);
+        res = LuciBool(AS_FLOAT(a)->f == AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f == AS_FLOAT(b)->f);
+        res = LuciBool(AS_FLOAT(a)->f == AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_eq(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot determine if a float is equal to an object of type %s\n",
                 b->type->type_name);
@@ -264,9 +287,11 @@ LuciObject* LuciFloat_neq(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f != AS_INT(b)->i);
+        res = LuciBool(AS_FLOAT(a)->f != AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f != AS_FLOAT(b)->f);
+        res = LuciBool(AS_FLOAT(a)->f != AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_neq(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot determine if a float is equal to an object of type %s\n",
                 b->type->type_name);
@@ -286,9 +311,11 @@ LuciObject* LuciFloat_lt(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f < AS_INT(b)->i);
+        res = LuciBool(AS_FLOAT(a)->f < AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f < AS_FLOAT(b)->f);
+        res = LuciBool(AS_FLOAT(a)->f < AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_lt(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot determine if a float is less than an object of type %s\n",
                 b->type->type_name);
@@ -308,9 +335,11 @@ LuciObject* LuciFloat_gt(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f > AS_INT(b)->i);
+        res = LuciBool(AS_FLOAT(a)->f > AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f > AS_FLOAT(b)->f);
+        res = LuciBool(AS_FLOAT(a)->f > AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_gt(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot determine if a float is greater than an object of type %s\n",
                 b->type->type_name);
@@ -330,9 +359,11 @@ LuciObject* LuciFloat_lte(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f <= AS_INT(b)->i);
+        res = LuciBool(AS_FLOAT(a)->f <= AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f <= AS_FLOAT(b)->f);
+        res = LuciBool(AS_FLOAT(a)->f <= AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_lte(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot determine if a float is less than or equal "
                 "to an object of type %s\n", b->type->type_name);
@@ -352,9 +383,11 @@ LuciObject* LuciFloat_gte(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f >= AS_INT(b)->i);
+        res = LuciBool(AS_FLOAT(a)->f >= AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_FLOAT(a)->f >= AS_FLOAT(b)->f);
+        res = LuciBool(AS_FLOAT(a)->f >= AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciFloat_gte(a, LuciFloat_new(LuciBigInt_as_double(b)));
     } else {
         LUCI_DIE("Cannot determine if a float is greater than or equal "
                 "to an object of type %s\n", b->type->type_name);
@@ -457,7 +490,8 @@ LuciObject *LuciFloat_neg(LuciObject *a)
  */
 void LuciFloat_print(LuciObject *in)
 {
-    printf("%f", AS_FLOAT(in)->f);
+    char buf[NUMCONV_DOUBLE_SIZE];
+    fwrite(buf, 1, numconv_format_double(buf, AS_FLOAT(in)->f), stdout);
 }
 
 /**
@@ -469,3 +503,52 @@ void LuciFloat_mark(LuciObject *in)
 {
     GC_MARK(in);
 }
+
+/**
+ * Computes the seeded 64-bit hash of a LuciFloatObj
+ *
+ * A float with an integral value hashes like the equal LuciIntObj
+ * or LuciBigIntObj, so that 2.0 and 2 refer to the same map key.
+ *
+ * @param o LuciFloatObj to hash
+ * @returns 64-bit hash
+ */
+static uint64_t float_hash(LuciObject *o)
+{
+    double f = AS_FLOAT(o)->f;
+    uint64_t bits;
+
+    if (f >= (double)LONG_MIN && f < -(double)LONG_MIN && f == (long)f) {
+        return hash_word((long)f);
+    } else if (isfinite(f) && f == floor(f)) {
+        return LuciBigInt_hash_double(f);
+    }
+    memcpy(&bits, &f, sizeof(bits));
+    return hash_word(bits);
+}
+
+/**
+ * Computes the primary hash of a LuciFloatObj
+ *
+ * Low 32 bits of the float's 64-bit hash
+ *
+ * @param o LuciFloatObj to hash
+ * @returns unsigned integer hash
+ */
+static unsigned int float_hash_0(LuciObject *o)
+{
+    return (unsigned int)float_hash(o);
+}
+
+/**
+ * Computes the secondary hash of a LuciFloatObj
+ *
+ * High 32 bits of the float's 64-bit hash
+ *
+ * @param o LuciFloatObj to hash
+ * @returns unsigned integer hash
+ */
+static unsigned int float_hash_1(LuciObject *o)
+{
+    return (unsigned int)(float_hash(o) >> 32);
+}
@@ -13,6 +13,7 @@
 LuciObjectType obj_func_t = {
     "function",
     sizeof(LuciFunctionObj),
+    TYPEID_FUNC,
 
     LuciFunction_copy,
     LuciFunction_copy,
@@ -123,7 +124,7 @@ LuciObject *LuciFunction_copy(LuciObject *orig)
  */
 LuciObject* LuciFunction_asbool(LuciObject *o)
 {
-    return LuciInt_new(true);
+    return LuciTrueObj;
 }
 
 /**
@@ -96,8 +96,26 @@ void gc_untrack_roots(void)
  */
 LuciObject *gc_malloc(LuciObjectType *tp)
 {
+    return gc_malloc_size(tp, tp->size);
+}
+
+/**
+ * Allocates an object whose size isn't fixed by its type
+ *
+ * Used by types that store a variable number of items inline.
+ *
+ * @param tp pointer to type object
+ * @param objsize size of the object, at most GC_MAX_OBJECT_SIZE
+ * @returns void* pointer to allocated block
+ */
+LuciObject *gc_malloc_size(LuciObjectType *tp, size_t objsize)
+{
+    if (objsize > GC_MAX_OBJECT_SIZE) {
+        LUCI_DIE("Can't allocate a %zu byte %s\n", objsize, tp->type_name);
+    }
+
     /* round size UP to next multiple of a pointer size */
-    size_t size = sizeof(void*) * ((tp->size / sizeof(void*)) + 1);
+    size_t size = sizeof(void*) * ((objsize / sizeof(void*)) + 1);
 
     unsigned int idx = size / sizeof(void*) - 1;
     GCPoolList *plist = &POOL_LISTS[idx];
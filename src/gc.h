@@ -12,10 +12,13 @@
 #include "luci.h"
 #include "lucitypes.h"
 
-#define POOL_LIST_COUNT  10     /**< number of different pool lists available */
+#define POOL_LIST_COUNT  32     /**< number of different pool lists available */
 #define INIT_POOL_LIST_SIZE 4   /**< initial size of pool list array */
 #define POOL_SIZE  6144         /**< initial pool size in bytes */
 
+/** largest object gc_malloc_size can allocate */
+#define GC_MAX_OBJECT_SIZE  (POOL_LIST_COUNT * sizeof(void*) - 1)
+
 /** marks an object as reachable via root objects */
 #define GC_MARK(obj)    (obj)->reachable = GC_REACHABLE;
 
@@ -58,6 +61,7 @@ typedef struct roots_list_ {
 
 int gc_init(void);
 LuciObject *gc_malloc(LuciObjectType *);
+LuciObject *gc_malloc_size(LuciObjectType *, size_t);
 int gc_collect(void);
 int gc_finalize(void);
 
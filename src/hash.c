@@ -0,0 +1,225 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file hash.c
+ *
+ * Seeded, word-at-a-time hashing of arbitrary byte strings.
+ *
+ * The algorithm is a port of wyhash (final version 4, public domain),
+ * which consumes 8 or 16 bytes per step and mixes them using a
+ * 64x64->128 bit multiply. Every Luci process picks a random seed
+ * at startup, so hash values (and map iteration order) differ
+ * between runs, which makes collision flooding with precomputed
+ * keys impractical.
+ */
+
+#include <time.h>
+
+#include "luci.h"
+#include "hash.h"
+
+/** default secret parameters (from the reference implementation) */
+static const uint64_t hash_secret[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+/** per-process seed, set by hash_init */
+static uint64_t HASH_SEED = 0;
+/** whether hash_init has run */
+static bool HASH_SEEDED = false;
+
+/**
+ * Multiplies two 64-bit integers, storing the low 64 bits of the
+ * 128-bit product in a and the high 64 bits in b
+ *
+ * @param a first operand, low half of product on return
+ * @param b second operand, high half of product on return
+ */
+static inline void hash_mum(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+/**
+ * Folds the 128-bit product of two 64-bit integers into 64 bits
+ *
+ * @param a first operand
+ * @param b second operand
+ * @returns low half XOR high half of a * b
+ */
+static inline uint64_t hash_mix(uint64_t a, uint64_t b)
+{
+    hash_mum(&a, &b);
+    return a ^ b;
+}
+
+/** reads 8 unaligned bytes */
+static inline uint64_t hash_read8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/** reads 4 unaligned bytes */
+static inline uint64_t hash_read4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/** reads 1 to 3 bytes */
+static inline uint64_t hash_read3(const uint8_t *p, size_t k)
+{
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+/**
+ * Initializes the per-process hash seed.
+ *
+ * The seed is read from /dev/urandom when available, otherwise it
+ * is derived from the clock and the address space layout. Setting
+ * the LUCI_HASH_SEED environment variable to an integer fixes the
+ * seed, which is useful for reproducing map ordering when debugging.
+ */
+void hash_init(void)
+{
+    char *env = getenv(HASH_SEED_ENV);
+    if (env && *env) {
+        HASH_SEED = strtoull(env, NULL, 0);
+        HASH_SEEDED = true;
+        return;
+    }
+
+    uint64_t seed = 0;
+    FILE *urandom = fopen("/dev/urandom", "rb");
+    if (urandom) {
+        if (fread(&seed, sizeof(seed), 1, urandom) != 1) {
+            seed = 0;
+        }
+        fclose(urandom);
+    }
+    if (seed == 0) {
+        seed = hash_mix((uint64_t)time(NULL) ^ hash_secret[0],
+                (uint64_t)clock() ^ (uint64_t)(uintptr_t)&seed);
+    }
+
+    HASH_SEED = seed;
+    HASH_SEEDED = true;
+}
+
+/**
+ * Returns the per-process hash seed, initializing it if necessary
+ *
+ * @returns 64-bit seed
+ */
+uint64_t hash_seed(void)
+{
+    if (!HASH_SEEDED) {
+        hash_init();
+    }
+    return HASH_SEED;
+}
+
+/**
+ * Hashes an array of bytes using the per-process seed
+ *
+ * @param data pointer to bytes
+ * @param len number of bytes
+ * @returns 64-bit hash
+ */
+uint64_t hash_bytes(const void *data, size_t len)
+{
+    return hash_bytes_seeded(data, len, hash_seed());
+}
+
+/**
+ * Hashes an array of bytes using an explicit seed
+ *
+ * @param data pointer to bytes
+ * @param len number of bytes
+ * @param seed 64-bit seed
+ * @returns 64-bit hash
+ */
+uint64_t hash_bytes_seeded(const void *data, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t a, b;
+
+    seed ^= hash_mix(seed ^ hash_secret[0], hash_secret[1]);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (hash_read4(p) << 32) | hash_read4(p + ((len >> 3) << 2));
+            b = (hash_read4(p + len - 4) << 32) |
+                    hash_read4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = hash_read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = hash_mix(hash_read8(p) ^ hash_secret[1],
+                        hash_read8(p + 8) ^ seed);
+                see1 = hash_mix(hash_read8(p + 16) ^ hash_secret[2],
+                        hash_read8(p + 24) ^ see1);
+                see2 = hash_mix(hash_read8(p + 32) ^ hash_secret[3],
+                        hash_read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = hash_mix(hash_read8(p) ^ hash_secret[1],
+                    hash_read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = hash_read8(p + i - 16);
+        b = hash_read8(p + i - 8);
+    }
+
+    a ^= hash_secret[1];
+    b ^= seed;
+    hash_mum(&a, &b);
+    return hash_mix(a ^ hash_secret[0] ^ len, b ^ hash_secret[1]);
+}
+
+/**
+ * Hashes a single 64-bit word using the per-process seed
+ *
+ * Used for numeric map keys, where calling hash_bytes on the
+ * word's 8 bytes would be needlessly slow.
+ *
+ * @param word 64-bit value
+ * @returns 64-bit hash
+ */
+uint64_t hash_word(uint64_t word)
+{
+    return hash_mix(word ^ hash_seed() ^ hash_secret[0],
+            hash_mix(word ^ hash_secret[1], hash_secret[2]));
+}
@@ -0,0 +1,23 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file hash.h
+ */
+
+#ifndef LUCI_HASH_H
+#define LUCI_HASH_H
+
+#include "luci.h"
+
+/** name of the environment variable used to fix the hash seed */
+#define HASH_SEED_ENV   "LUCI_HASH_SEED"
+
+void hash_init(void);
+uint64_t hash_seed(void);
+uint64_t hash_bytes(const void *data, size_t len);
+uint64_t hash_bytes_seeded(const void *data, size_t len, uint64_t seed);
+uint64_t hash_word(uint64_t word);
+
+#endif /* LUCI_HASH_H */
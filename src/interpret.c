@@ -110,7 +110,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "ADD");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->add(x, y);
+            z = BINOP(BINOP_ADD, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -120,7 +120,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "SUB");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->sub(x, y);
+            z = BINOP(BINOP_SUB, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -130,7 +130,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "MUL");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->mul(x, y);
+            z = BINOP(BINOP_MUL, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -140,7 +140,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "DIV");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->div(x, y);
+            z = BINOP(BINOP_DIV, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -150,7 +150,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "MOD");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->mod(x, y);
+            z = BINOP(BINOP_MOD, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -160,7 +160,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "POW");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->pow(x, y);
+            z = BINOP(BINOP_POW, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -170,7 +170,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "EQ");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->eq(x, y);
+            z = BINOP(BINOP_EQ, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -180,7 +180,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "NEQ");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->neq(x, y);
+            z = BINOP(BINOP_NEQ, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -190,7 +190,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "LT");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->lt(x, y);
+            z = BINOP(BINOP_LT, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -200,7 +200,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "GT");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->gt(x, y);
+            z = BINOP(BINOP_GT, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -210,7 +210,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "LTE");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->lte(x, y);
+            z = BINOP(BINOP_LTE, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -220,7 +220,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "GTE");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->gte(x, y);
+            z = BINOP(BINOP_GTE, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -230,7 +230,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "LGOR");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->lgor(x, y);
+            z = BINOP(BINOP_LGOR, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -240,7 +240,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "LGAND");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->lgand(x, y);
+            z = BINOP(BINOP_LGAND, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -250,7 +250,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "BWXOR");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->bwxor(x, y);
+            z = BINOP(BINOP_BWXOR, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -260,7 +260,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "BWOR");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->bwor(x, y);
+            z = BINOP(BINOP_BWOR, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -270,7 +270,7 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("%s\n", "BWAND");
             y = LuciList_pop(stack);
             x = LuciList_pop(stack);
-            z = x->type->bwand(x, y);
+            z = BINOP(BINOP_BWAND, x, y);
             LuciList_push(stack, z);
         }
         FETCH(1);
@@ -351,8 +351,7 @@ void eval(LuciObject *frame)
             /* duplicate object on top of stack
              * and push it back on */
             x = LuciList_peek(stack);
-            y = x->type->copy(x);
-            LuciList_push(stack, y);
+            LuciList_push(stack, x);
         FETCH(1);
         DISPATCH;
 
@@ -360,9 +359,9 @@ void eval(LuciObject *frame)
             LUCI_DEBUG("STORE %d\n", a);
             /* pop object off of stack */
             x = LuciList_pop(stack);
-            /* store the new object */
-            y = x->type->copy(x);
-            AS_FUNCTION(frame)->locals[a] = y;
+            /* store the object itself: primitives are immutable
+             * and containers are shared by reference */
+            AS_FUNCTION(frame)->locals[a] = x;
         FETCH(1);
         DISPATCH;
 
@@ -389,10 +388,10 @@ void eval(LuciObject *frame)
                     LUCI_DIE("%s", "Too many arguments to function.\n");
                 }
 
-                /* pop arguments and push COPIES into locals */
-                for (i = 0; i < a; i++) {
-                    y = LuciList_pop(stack);
-                    AS_FUNCTION(frame)->locals[i] = y->type->copy(y);
+                /* pop arguments into locals */
+                /* must happen in reverse, since the last arg is on top */
+                for (i = a - 1; i >= 0; i--) {
+                    AS_FUNCTION(frame)->locals[i] = LuciList_pop(stack);
                 }
 
                 /* the stack is clean, now push the previous frame */
@@ -416,8 +415,7 @@ void eval(LuciObject *frame)
                 /* pop args and push into args array */
                 /* must happen in reverse */
                 for (i = a - 1; i >= 0; i--) {
-                    y = LuciList_pop(stack);
-                    lfargs[i] = y->type->copy(y);
+                    lfargs[i] = LuciList_pop(stack);
                 }
 
                 /* call func, passing args array and arg count */
@@ -451,7 +449,7 @@ void eval(LuciObject *frame)
 
         HANDLE(MKMAP)
             LUCI_DEBUG("MKMAP %d\n", a);
-            x = LuciMap_new();
+            x = LuciMap_new_sized(a);
             for (i = 0; i < a; i ++) {
                 /* first item is the value */
                 y = LuciList_pop(stack);
@@ -466,15 +464,67 @@ void eval(LuciObject *frame)
 
         HANDLE(MKLIST)
             LUCI_DEBUG("MKLIST %d\n", a);
-            x = LuciList_new();
+            x = LuciList_new_sized(a);
+            /* the items were pushed in reverse order */
             for (i = 0; i < a; i ++) {
-                y = LuciList_pop(stack);
-                LuciList_append(x, y);
+                AS_LIST(x)->items[i] = LuciList_pop(stack);
+            }
+            AS_LIST(x)->count = a;
+            LuciList_push(stack, x);
+        FETCH(1);
+        DISPATCH;
+
+        HANDLE(MKTUPLE)
+            LUCI_DEBUG("MKTUPLE %d\n", a);
+            x = LuciTuple_new(a);
+            /* the items were pushed in reverse order */
+            for (i = 0; i < a; i ++) {
+                AS_TUPLE(x)->items[i] = LuciList_pop(stack);
             }
             LuciList_push(stack, x);
         FETCH(1);
         DISPATCH;
 
+        HANDLE(UNPACK)
+        {
+            LUCI_DEBUG("UNPACK %d\n", a);
+            x = LuciList_pop(stack);
+            LuciObject **items;
+            unsigned int count;
+            if (ISTYPE(x, obj_tuple_t)) {
+                items = AS_TUPLE(x)->items;
+                count = AS_TUPLE(x)->count;
+            } else if (ISTYPE(x, obj_list_t)) {
+                items = AS_LIST(x)->items;
+                count = AS_LIST(x)->count;
+            } else {
+                LUCI_DIE("Cannot unpack an object of type %s\n",
+                        x->type->type_name);
+            }
+            if (count != a) {
+                LUCI_DIE("Cannot unpack %u items into %d names\n", count, a);
+            }
+            /* the compiler follows UNPACK with a STORE for each name,
+             * so store each item directly into its name's slot */
+            for (i = 0; i < a; i++) {
+                if (OPCODE(ip[i + 1]) != STORE) {
+                    break;
+                }
+            }
+            if (i == a) {
+                for (i = 0; i < a; i++) {
+                    AS_FUNCTION(frame)->locals[OPARG(ip[i + 1])] = items[i];
+                }
+                FETCH(a + 1);
+            } else {
+                for (i = a - 1; i >= 0; i--) {
+                    LuciList_push(stack, items[i]);
+                }
+                FETCH(1);
+            }
+        }
+        DISPATCH;
+
         HANDLE(CGET)
         {
             LUCI_DEBUG("%s\n", "CGET");
@@ -500,15 +550,25 @@ void eval(LuciObject *frame)
             z = LuciList_pop(stack);
             /* put the right hand value into the container */
             y = x->type->cput(x, y, z);
+            /* immutable containers (strings) return an updated
+             * copy, which the next instruction stores */
+            if (a) {
+                LuciList_push(stack, ISTYPE(x, obj_string_t) ? y : x);
+            } else if (ISTYPE(x, obj_string_t)) {
+                LUCI_DIE("%s\n", "Strings are immutable, so only a character "
+                        "of a string in a local variable can be assigned to");
+            }
         }
         FETCH(1);
         DISPATCH;
 
         HANDLE(MKITER)
-            LUCI_DEBUG("%s\n", "MKITER");
+            LUCI_DEBUG("MKITER %d\n", a);
             /* x should be a container */
             x = LuciList_pop(stack);
             y = LuciIterator_new(x, 1); /* step = 1 */
+            /* a non-zero argument iterates over key/value pairs */
+            AS_ITERATOR(y)->pairs = a;
             LuciList_push(stack, y);
         FETCH(1);
         DISPATCH;
@@ -527,7 +587,29 @@ void eval(LuciObject *frame)
         HANDLE(JUMPZ)
             LUCI_DEBUG("JUMPZ %d\n", a);
             x = LuciList_pop(stack);
-            if (((LuciIntObj *)x)->i == 0) {
+            /* comparisons return one of the two canonical booleans,
+             * so most tests never look inside the object */
+            if (x == LuciFalseObj) {
+                FETCH(a);
+            } else if (x == LuciTrueObj) {
+                FETCH(1);
+            } else if (ISTYPE(x, obj_int_t) ? AS_INT(x)->i == 0 :
+                    AS_INT(x->type->asbool(x))->i == 0) {
+                FETCH(a);
+            } else {
+                FETCH(1);
+            }
+        DISPATCH;
+
+        HANDLE(JUMPNZ)
+            LUCI_DEBUG("JUMPNZ %d\n", a);
+            x = LuciList_pop(stack);
+            if (x == LuciTrueObj) {
+                FETCH(a);
+            } else if (x == LuciFalseObj) {
+                FETCH(1);
+            } else if (ISTYPE(x, obj_int_t) ? AS_INT(x)->i != 0 :
+                    AS_INT(x->type->asbool(x))->i != 0) {
                 FETCH(a);
             } else {
                 FETCH(1);
@@ -535,20 +617,54 @@ void eval(LuciObject *frame)
         DISPATCH;
 
         HANDLE(ITERJUMP)
+        {
             LUCI_DEBUG("ITERJUMP %d\n", a);
-            x = LuciList_peek(stack);
-            /* get a COPY of the next object in the iterator's list */
-            y = iterator_next_object(x);
+            LuciIteratorObj *it = AS_ITERATOR(LuciList_peek(stack));
+            LuciObject *val = NULL;
+            x = it->container;
+            /* get the next object in the iterator's container. Lists,
+             * tuples, ranges and strings are indexed directly by the iterator's
+             * unboxed index, anything else (and key/value pairs) goes
+             * through the container's next method */
+            if (it->pairs) {
+                y = iterator_next_pair((LuciObject *)it, &val);
+            } else if (ISTYPE(x, obj_list_t)) {
+                y = it->idx < AS_LIST(x)->count ?
+                    AS_LIST(x)->items[it->idx] : NULL;
+                it->idx += it->step;
+            } else if (ISTYPE(x, obj_tuple_t)) {
+                y = it->idx < AS_TUPLE(x)->count ?
+                    AS_TUPLE(x)->items[it->idx] : NULL;
+                it->idx += it->step;
+            } else if (ISTYPE(x, obj_range_t)) {
+                y = it->idx < AS_RANGE(x)->count ?
+                    LuciInt_new(RANGE_AT(x, it->idx)) : NULL;
+                it->idx += it->step;
+            } else if (ISTYPE(x, obj_string_t)) {
+                y = LuciString_char_at(x, it->idx);
+                it->idx += it->step;
+            } else {
+                y = iterator_next_object((LuciObject *)it);
+            }
             /* if the iterator returned NULL, jump to the
              * end of the for loop. Otherwise, push iterator->next */
             if (y == NULL) {
                 /* pop the iterator object */
                 x = LuciList_pop(stack);
                 FETCH(a);
+            } else if (!it->pairs && OPCODE(ip[1]) == STORE) {
+                /* store the loop variable directly, skipping the
+                 * push and the STORE that would pop it */
+                AS_FUNCTION(frame)->locals[OPARG(ip[1])] = y;
+                FETCH(2);
             } else {
+                if (it->pairs) {
+                    LuciList_push(stack, val);
+                }
                 LuciList_push(stack, y);
                 FETCH(1);
             }
+        }
         DISPATCH;
 
         HANDLE(HALT)
@@ -7,12 +7,17 @@
  */
 
 #include "inttype.h"
+#include "hash.h"
+#include "numconv.h"
 
+static unsigned int int_hash_0(LuciObject *o);
+static unsigned int int_hash_1(LuciObject *o);
 
 /** Type member table for LuciIntObj */
 LuciObjectType obj_int_t = {
     "int",
     sizeof(LuciIntObj),
+    TYPEID_INT,
 
     LuciInt_copy,
     LuciInt_copy,
@@ -51,10 +56,20 @@ LuciObjectType obj_int_t = {
 
     LuciInt_mark,
     NULL,           /* finalize */
-    NULL,           /* hash0 */
-    NULL            /* hash1 */
+    int_hash_0,
+    int_hash_1
 };
 
+/**
+ * The ints 1 and 0 returned by every comparison and truth test
+ *
+ * Booleans are ints, so these are ordinary LuciIntObjs, but they are
+ * never collected and returning them never allocates. Ints are
+ * immutable, so sharing them is safe.
+ */
+LuciIntObj LuciTrueInstance = {{&obj_int_t, GC_STATIC}, 1};
+LuciIntObj LuciFalseInstance = {{&obj_int_t, GC_STATIC}, 0};
+
 /**
  * Creates a new LuciIntObj
  *
@@ -71,12 +86,14 @@ LuciObject *LuciInt_new(long l)
 /**
  * Copies a LuciIntObj
  *
+ * Ints are immutable, so copies share the original.
+ *
  * @param orig LucIntObj to copy
- * @returns new copy of orig
+ * @returns orig
  */
 LuciObject* LuciInt_copy(LuciObject *orig)
 {
-    return LuciInt_new(((LuciIntObj *)orig)->i);
+    return orig;
 }
 
 /**
@@ -87,9 +104,8 @@ LuciObject* LuciInt_copy(LuciObject *orig)
  */
 LuciObject* LuciInt_repr(LuciObject *o)
 {
-    char *s = alloc(MAX_INT_DIGITS);
-    snprintf(s, MAX_INT_DIGITS, "%ld", AS_INT(o)->i);
-    /* ret->s[16] = '\0'; */
+    char *s = alloc(NUMCONV_LONG_SIZE);
+    numconv_format_long(s, AS_INT(o)->i);
     return LuciString_new(s);
 }
 
@@ -101,7 +117,7 @@ LuciObject* LuciInt_repr(LuciObject *o)
  */
 LuciObject* LuciInt_asbool(LuciObject *o)
 {
-    return LuciInt_new(AS_INT(o)->i > 0L);
+    return LuciBool(AS_INT(o)->i != 0L);
 }
 
 /**
@@ -116,9 +132,16 @@ LuciObject* LuciInt_add(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_INT(a)->i + AS_INT(b)->i);
+        long r;
+        if (__builtin_add_overflow(AS_INT(a)->i, AS_INT(b)->i, &r)) {
+            res = LuciBigInt_add(a, b);
+        } else {
+            res = LuciInt_new(r);
+        }
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciFloat_new(AS_INT(a)->i + AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_add(a, b);
     } else {
         LUCI_DIE("Cannot add object of type %s to an int\n", b->type->type_name);
     }
@@ -137,9 +160,16 @@ LuciObject* LuciInt_sub(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_INT(a)->i - AS_INT(b)->i);
+        long r;
+        if (__builtin_sub_overflow(AS_INT(a)->i, AS_INT(b)->i, &r)) {
+            res = LuciBigInt_sub(a, b);
+        } else {
+            res = LuciInt_new(r);
+        }
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciFloat_new(AS_INT(a)->i - AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_sub(a, b);
     } else {
         LUCI_DIE("Cannot subtract an object of type %s from an int\n", b->type->type_name);
     }
@@ -158,11 +188,16 @@ LuciObject* LuciInt_mul(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_INT(a)->i * AS_INT(b)->i);
+        long r;
+        if (__builtin_mul_overflow(AS_INT(a)->i, AS_INT(b)->i, &r)) {
+            res = LuciBigInt_mul(a, b);
+        } else {
+            res = LuciInt_new(r);
+        }
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciFloat_new(AS_INT(a)->i * AS_FLOAT(b)->f);
-    } else if (ISTYPE(b, obj_string_t)) {
-        res = b->type->mul(b, a);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_mul(a, b);
     } else {
         LUCI_DIE("Cannot multiply an object of type %s and an int\n", b->type->type_name);
     }
@@ -181,7 +216,10 @@ LuciObject* LuciInt_div(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        if (AS_INT(b)->i != 0) {
+        if (AS_INT(b)->i == -1) {
+            /* LONG_MIN / -1 overflows */
+            res = LuciInt_neg(a);
+        } else if (AS_INT(b)->i != 0) {
             res = LuciInt_new(AS_INT(a)->i / AS_INT(b)->i);
         } else {
             LUCI_DIE("%s\n", "Divide by zero");
@@ -192,6 +230,8 @@ LuciObject* LuciInt_div(LuciObject *a, LuciObject *b)
         } else {
             LUCI_DIE("%s\n", "Divide by zero");
         }
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_div(a, b);
     } else {
         LUCI_DIE("Cannot divide an int by an object of type %s\n",
                 b->type->type_name);
@@ -216,8 +256,11 @@ LuciObject* LuciInt_mod(LuciObject *a, LuciObject *b)
         if (AS_INT(b)->i == 0) {
             LUCI_DIE("%s\n", "Modulo divide by zero");
         }
-        long m = AS_INT(a)->i % AS_INT(b)->i;
+        /* LONG_MIN % -1 traps on some machines */
+        long m = AS_INT(b)->i == -1 ? 0 : AS_INT(a)->i % AS_INT(b)->i;
         res = LuciInt_new(m);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_mod(a, b);
     } else {
         LUCI_DIE("Cannot compute int modulo using an object of type %s\n",
                 b->type->type_name);
@@ -229,6 +272,9 @@ LuciObject* LuciInt_mod(LuciObject *a, LuciObject *b)
 /**
  * Exponential
  *
+ * Non-negative int exponents are computed exactly by repeated
+ * squaring, continuing as a LuciBigIntObj if the result overflows.
+ *
  * @param a LuciIntObj
  * @param b LuciObject
  * @returns a ** b
@@ -237,10 +283,24 @@ LuciObject* LuciInt_pow(LuciObject *a, LuciObject *b)
 {
     LuciObject *res = LuciNilObj;
 
-    if (ISTYPE(b, obj_int_t)) {
+    if (ISTYPE(b, obj_int_t) && AS_INT(b)->i >= 0) {
+        long base = AS_INT(a)->i, e = AS_INT(b)->i, r = 1;
+        while (e > 0) {
+            if ((e & 1) && __builtin_mul_overflow(r, base, &r)) {
+                return LuciBigInt_pow(a, b);
+            }
+            e >>= 1;
+            if (e > 0 && __builtin_mul_overflow(base, base, &base)) {
+                return LuciBigInt_pow(a, b);
+            }
+        }
+        res = LuciInt_new(r);
+    } else if (ISTYPE(b, obj_int_t)) {
         res = LuciInt_new(pow(AS_INT(a)->i, AS_INT(b)->i));
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciFloat_new(pow(AS_INT(a)->i, AS_FLOAT(b)->f));
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_pow(a, b);
     } else {
         LUCI_DIE("Cannot compute the power of an int using an object of type %s\n",
                 b->type->type_name);
@@ -260,9 +320,11 @@ LuciObject* LuciInt_eq(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_INT(a)->i == AS_INT(b)->i);
+        res = LuciBool(AS_INT(a)->i == AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_INT(a)->i == AS_FLOAT(b)->f);
+        res = LuciBool(AS_INT(a)->i == AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_eq(a, b);
     } else {
         LUCI_DIE("Cannot determine if an int is equal to an object of type %s\n",
                 b->type->type_name);
@@ -282,9 +344,11 @@ LuciObject* LuciInt_neq(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_INT(a)->i != AS_INT(b)->i);
+        res = LuciBool(AS_INT(a)->i != AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_INT(a)->i != AS_FLOAT(b)->f);
+        res = LuciBool(AS_INT(a)->i != AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_neq(a, b);
     } else {
         LUCI_DIE("Cannot determine if an int is equal to an object of type %s\n",
                 b->type->type_name);
@@ -304,9 +368,11 @@ LuciObject* LuciInt_lt(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_INT(a)->i < AS_INT(b)->i);
+        res = LuciBool(AS_INT(a)->i < AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_INT(a)->i < AS_FLOAT(b)->f);
+        res = LuciBool(AS_INT(a)->i < AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_lt(a, b);
     } else {
         LUCI_DIE("Cannot determine if an int is less than an object of type %s\n",
                 b->type->type_name);
@@ -326,9 +392,11 @@ LuciObject* LuciInt_gt(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_INT(a)->i > AS_INT(b)->i);
+        res = LuciBool(AS_INT(a)->i > AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_INT(a)->i > AS_FLOAT(b)->f);
+        res = LuciBool(AS_INT(a)->i > AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_gt(a, b);
     } else {
         LUCI_DIE("Cannot determine if an int is greater than an object of type %s\n",
                 b->type->type_name);
@@ -348,9 +416,11 @@ LuciObject* LuciInt_lte(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_INT(a)->i <= AS_INT(b)->i);
+        res = LuciBool(AS_INT(a)->i <= AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_INT(a)->i <= AS_FLOAT(b)->f);
+        res = LuciBool(AS_INT(a)->i <= AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_lte(a, b);
     } else {
         LUCI_DIE("Cannot determine if an int is less than or equal to an "
                 "object of type %s\n", b->type->type_name);
@@ -370,9 +440,11 @@ LuciObject* LuciInt_gte(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_int_t)) {
-        res = LuciInt_new(AS_INT(a)->i >= AS_INT(b)->i);
+        res = LuciBool(AS_INT(a)->i >= AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
-        res = LuciInt_new(AS_INT(a)->i >= AS_FLOAT(b)->f);
+        res = LuciBool(AS_INT(a)->i >= AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_gte(a, b);
     } else {
         LUCI_DIE("Cannot determine if an int is greater than or equal to an "
                 "object of type %s\n", b->type->type_name);
@@ -395,6 +467,8 @@ LuciObject* LuciInt_bwxor(LuciObject *a, LuciObject *b)
         res = LuciInt_new(AS_INT(a)->i ^ AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciInt_new(AS_INT(a)->i ^ (long)AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_bwxor(a, b);
     } else {
         LUCI_DIE("Can't compute bitwise XOR of an int and object of type %s\n",
                 b->type->type_name);
@@ -417,6 +491,8 @@ LuciObject* LuciInt_bwor(LuciObject *a, LuciObject *b)
         res = LuciInt_new(AS_INT(a)->i | AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciInt_new(AS_INT(a)->i | (long)AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_bwor(a, b);
     } else {
         LUCI_DIE("Can't compute bitwise OR of an int and object of type %s\n",
                 b->type->type_name);
@@ -439,6 +515,8 @@ LuciObject* LuciInt_bwand(LuciObject *a, LuciObject *b)
         res = LuciInt_new(AS_INT(a)->i & AS_INT(b)->i);
     } else if (ISTYPE(b, obj_float_t)) {
         res = LuciInt_new(AS_INT(a)->i & (long)AS_FLOAT(b)->f);
+    } else if (ISTYPE(b, obj_bigint_t)) {
+        res = LuciBigInt_bwand(a, b);
     } else {
         LUCI_DIE("Can't compute bitwise AND of an int and object of type %s\n",
                 b->type->type_name);
@@ -465,6 +543,9 @@ LuciObject* LuciInt_bwnot(LuciObject *a)
  */
 LuciObject *LuciInt_neg(LuciObject *a)
 {
+    if (AS_INT(a)->i == LONG_MIN) {
+        return LuciBigInt_neg(a);
+    }
     return LuciInt_new(-(AS_INT(a)->i));
 }
 
@@ -475,7 +556,8 @@ LuciObject *LuciInt_neg(LuciObject *a)
  */
 void LuciInt_print(LuciObject *in)
 {
-    printf("%ld", AS_INT(in)->i);
+    char buf[NUMCONV_LONG_SIZE];
+    fwrite(buf, 1, numconv_format_long(buf, AS_INT(in)->i), stdout);
 }
 
 /**
@@ -487,3 +569,29 @@ void LuciInt_mark(LuciObject *in)
 {
     GC_MARK(in);
 }
+
+/**
+ * Computes the primary hash of a LuciIntObj
+ *
+ * Low 32 bits of the integer's seeded 64-bit hash
+ *
+ * @param o LuciIntObj to hash
+ * @returns unsigned integer hash
+ */
+static unsigned int int_hash_0(LuciObject *o)
+{
+    return (unsigned int)hash_word(AS_INT(o)->i);
+}
+
+/**
+ * Computes the secondary hash of a LuciIntObj
+ *
+ * High 32 bits of the integer's seeded 64-bit hash
+ *
+ * @param o LuciIntObj to hash
+ * @returns unsigned integer hash
+ */
+static unsigned int int_hash_1(LuciObject *o)
+{
+    return (unsigned int)(hash_word(AS_INT(o)->i) >> 32);
+}
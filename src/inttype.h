@@ -23,6 +23,16 @@ typedef struct LuciIntObj_
 /** casts LuciObject o to a LuciIntObj */
 #define AS_INT(o)       ((LuciIntObj *)(o))
 
+extern LuciIntObj LuciTrueInstance;
+extern LuciIntObj LuciFalseInstance;
+
+/** allows "LuciTrueObj" to be used as a LuciObject* */
+#define LuciTrueObj     ((LuciObject *)&LuciTrueInstance)
+/** allows "LuciFalseObj" to be used as a LuciObject* */
+#define LuciFalseObj    ((LuciObject *)&LuciFalseInstance)
+/** returns LuciTrueObj if C expression b is true, else LuciFalseObj */
+#define LuciBool(b)     ((b) ? LuciTrueObj : LuciFalseObj)
+
 LuciObject *LuciInt_new(long l);
 LuciObject* LuciInt_copy(LuciObject *);
 LuciObject* LuciInt_repr(LuciObject *);
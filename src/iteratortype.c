@@ -13,6 +13,7 @@
 LuciObjectType obj_iterator_t = {
     "iterator",
     sizeof(LuciIteratorObj),
+    TYPEID_ITERATOR,
 
     LuciIterator_copy,
     LuciIterator_copy,
@@ -65,8 +66,10 @@ LuciObjectType obj_iterator_t = {
 LuciObject *LuciIterator_new(LuciObject *container, int step)
 {
     LuciIteratorObj *o = (LuciIteratorObj*)gc_malloc(&obj_iterator_t);
-    o->idx = LuciInt_new(0);
+    o->idx = 0;
     o->step = step;
+    o->pairs = false;
+    o->cursor = NULL;
     o->container = container;
     return (LuciObject *)o;
 }
@@ -80,7 +83,9 @@ LuciObject *LuciIterator_new(LuciObject *container, int step)
 LuciObject *LuciIterator_copy(LuciObject *orig)
 {
     LuciIteratorObj *iterobj = (LuciIteratorObj *)orig;
-    return LuciIterator_new(iterobj->container, iterobj->step);
+    LuciObject *copy = LuciIterator_new(iterobj->container, iterobj->step);
+    AS_ITERATOR(copy)->pairs = iterobj->pairs;
+    return copy;
 }
 
 /**
@@ -97,18 +102,44 @@ LuciObject* LuciIterator_asbool(LuciObject *o)
     unsigned int len = 0;
     if (ISTYPE(container, obj_list_t)) {
         len = AS_LIST(container)->count;
-    } else if (ISTYPE(container, obj_map_t)) {
-        len = AS_LIST(container)->size;
+    } else if (ISTYPE(container, obj_tuple_t)) {
+        len = AS_TUPLE(container)->count;
+    } else if (ISTYPE(container, obj_map_t) || ISTYPE(container, obj_set_t)) {
+        /* the iterator's index is a cursor into the map's entries */
+        len = AS_MAP(container)->used;
+    } else if (ISTYPE(container, obj_array_t)) {
+        len = AS_ARRAY(container)->count;
+    } else if (ISTYPE(container, obj_range_t)) {
+        len = AS_RANGE(container)->count;
     }
 
-    if (AS_INT(AS_ITERATOR(o)->idx)->i < len) {
-        res = LuciInt_new(true);
+    if (AS_ITERATOR(o)->idx < len) {
+        res = LuciTrueObj;
     } else {
-        res = LuciInt_new(false);
+        res = LuciFalseObj;
     }
     return res;
 }
 
+/**
+ * Returns the iterator's index boxed for a container's next method
+ *
+ * The box is allocated the first time it is needed and reused
+ * afterwards, so generic iteration allocates once per loop rather
+ * than once per step.
+ *
+ * @param iter LuciIteratorObj
+ * @returns LuciIntObj holding iter's index
+ */
+static LuciObject *iterator_cursor(LuciIteratorObj *iter)
+{
+    if (!iter->cursor) {
+        iter->cursor = LuciInt_new(iter->idx);
+    }
+    AS_INT(iter->cursor)->i = iter->idx;
+    return iter->cursor;
+}
+
 /**
  * Returns the next LuciObject in a container.
  *
@@ -124,8 +155,43 @@ LuciObject *iterator_next_object(LuciObject *iterator)
     LuciIteratorObj *iter = (LuciIteratorObj *)iterator;
     LuciObject *container = iter->container;
 
-    LuciObject *next = container->type->next(container, iter->idx);
-    AS_INT(iter->idx)->i += iter->step;
+    LuciObject *cursor = iterator_cursor(iter);
+    LuciObject *next = container->type->next(container, cursor);
+    /* a map advances the cursor past any removed pairs */
+    iter->idx = AS_INT(cursor)->i + iter->step;
+    return next;
+}
+
+/**
+ * Returns the next key/value pair in a container.
+ *
+ * For a map, the pair is a key and its value. For any other
+ * container, it is an index and the object at that index.
+ *
+ * @param iterator from which to compute next pair
+ * @param val set to the next value
+ * @returns next key or index, or NULL if finished iterating
+ */
+LuciObject *iterator_next_pair(LuciObject *iterator, LuciObject **val)
+{
+    if (!iterator || (!ISTYPE(iterator, obj_iterator_t))) {
+        LUCI_DIE("%s", "Can't get next from non-iterator object\n");
+    }
+
+    LuciIteratorObj *iter = (LuciIteratorObj *)iterator;
+    LuciObject *container = iter->container;
+    LuciObject *next = NULL;
+
+    LuciObject *cursor = iterator_cursor(iter);
+    if (ISTYPE(container, obj_map_t)) {
+        next = LuciMap_next_pair(container, cursor, val);
+    } else {
+        *val = container->type->next(container, cursor);
+        if (*val) {
+            next = LuciInt_new(iter->idx);
+        }
+    }
+    iter->idx = AS_INT(cursor)->i + iter->step;
     return next;
 }
 
@@ -148,10 +214,12 @@ void LuciIterator_print(LuciObject *in)
  */
 void LuciIterator_mark(LuciObject *in)
 {
-    LuciObject *idx = AS_ITERATOR(in)->idx;
+    LuciObject *cursor = AS_ITERATOR(in)->cursor;
     LuciObject *container = AS_ITERATOR(in)->container;
 
-    idx->type->mark(idx);
+    if (cursor) {
+        cursor->type->mark(cursor);
+    }
     container->type->mark(container);
 
     GC_MARK(in);
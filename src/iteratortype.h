@@ -16,8 +16,11 @@ extern LuciObjectType obj_iterator_t;
 /** Iterator object type (internal) */
 typedef struct LuciIterator_ {
     LuciObject base;        /**< base implemenatation */
-    LuciObject *idx;        /**< current index */
+    long idx;               /**< index of the next object */
     int step;               /**< amount to increment by */
+    bool pairs;             /**< whether to iterate over key/value pairs */
+    LuciObject *cursor;     /**< idx boxed as a LuciIntObj for the
+                                 container's next method (NULL until used) */
     LuciObject *container;  /**< the container this iterator applies to */
 } LuciIteratorObj;
 
@@ -31,5 +34,6 @@ void LuciIterator_print(LuciObject *);
 void LuciIterator_mark(LuciObject *);
 
 LuciObject *iterator_next_object(LuciObject *iterator);
+LuciObject *iterator_next_pair(LuciObject *iterator, LuciObject **val);
 
 #endif
@@ -16,6 +16,7 @@ static LuciObject *list_set_object(LuciObject *list, LuciObject *item, long inde
 LuciObjectType obj_list_t = {
     "list",
     sizeof(LuciListObj),
+    TYPEID_LIST,
 
     LuciList_copy,
     LuciList_deepcopy,
@@ -63,20 +64,104 @@ LuciObjectType obj_list_t = {
  * @returns new empty LuciListObj
  */
 LuciObject *LuciList_new()
+{
+    return LuciList_new_sized(0);
+}
+
+/**
+ * Creates a new, empty LuciListObj with room for size items
+ *
+ * Lists of up to LIST_INLINE_SIZE items are stored in the list
+ * object itself, so building a small list never calls malloc.
+ *
+ * @param size number of items to allocate space for
+ * @returns new empty LuciListObj
+ */
+LuciObject *LuciList_new_sized(unsigned int size)
 {
     LuciListObj *o = (LuciListObj*)gc_malloc(&obj_list_t);
     o->count = 0;
-    o->size = INIT_LIST_SIZE;
-    o->items = alloc(o->size * sizeof(*o->items));
+    if (size <= LIST_INLINE_SIZE) {
+        o->size = LIST_INLINE_SIZE;
+        o->items = o->small_items;
+    } else {
+        o->size = size;
+        o->items = alloc(o->size * sizeof(*o->items));
+    }
     return (LuciObject *)o;
 }
 
 /**
- * Returns a COPY of the object in the list at the index
+ * Moves a LuciListObj's items into an array of exactly size items
+ *
+ * @param list LuciListObj
+ * @param size new capacity, at least the list's count
+ */
+static void list_resize(LuciListObj *list, unsigned int size)
+{
+    if (size <= LIST_INLINE_SIZE) {
+        if (list->items != list->small_items) {
+            memcpy(list->small_items, list->items,
+                    list->count * sizeof(*list->items));
+            free(list->items);
+            list->items = list->small_items;
+        }
+        list->size = LIST_INLINE_SIZE;
+        return;
+    }
+
+    if (list->items == list->small_items) {
+        list->items = alloc(size * sizeof(*list->items));
+        memcpy(list->items, list->small_items,
+                list->count * sizeof(*list->items));
+    } else {
+        list->items = realloc(list->items, size * sizeof(*list->items));
+        if (!list->items) {
+            LUCI_DIE("%s", "Failed to resize list\n");
+        }
+    }
+    list->size = size;
+    LUCI_DEBUG("%s\n", "Reallocated space for list");
+}
+
+/**
+ * Ensures a LuciListObj has room for at least size items
+ *
+ * @param l LuciListObj
+ * @param size number of items
+ */
+void LuciList_reserve(LuciObject *l, unsigned int size)
+{
+    if (size > AS_LIST(l)->size) {
+        list_resize(AS_LIST(l), size);
+    }
+}
+
+/**
+ * Sets the capacity of a LuciListObj, growing or shrinking it
+ *
+ * The capacity never drops below the list's count, so resizing
+ * to 0 frees any space allocated beyond its items.
+ *
+ * @param l LuciListObj
+ * @param size number of items
+ */
+void LuciList_resize(LuciObject *l, unsigned int size)
+{
+    if (size < AS_LIST(l)->count) {
+        size = AS_LIST(l)->count;
+    }
+    if (size != AS_LIST(l)->size) {
+        list_resize(AS_LIST(l), size);
+    }
+}
+
+/**
+ * Returns the object in the list at the index
  *
  * @param list LuciListObj to grab from
  * @param index index from which to grab object
- * @returns copy of LuciObject at index
+ * @returns LuciObject at index
  */
 static LuciObject *list_get_object(LuciObject *list, long index)
 {
@@ -94,8 +179,7 @@ static LuciObject *list_get_object(LuciObject *list, long index)
     if (index >= listobj->count) {
 	LUCI_DIE("%s", "List index out of bounds\n");
     }
-    LuciObject *item = listobj->items[index];
-    return item->type->copy(item);
+    return listobj->items[index];
 }
 
 /**
@@ -149,7 +233,7 @@ LuciObject* LuciList_deepcopy(LuciObject *orig)
     LuciListObj *listobj = (LuciListObj *)orig;
     int i;
 
-    LuciObject *copy = LuciList_new();
+    LuciObject *copy = LuciList_new_sized(listobj->count);
 
     for (i = 0; i < listobj->count; i++) {
         LuciList_append(copy, list_get_object(orig, i));
@@ -166,7 +250,7 @@ LuciObject* LuciList_deepcopy(LuciObject *orig)
  */
 LuciObject* LuciList_asbool(LuciObject *o)
 {
-    return LuciInt_new(AS_LIST(o)->count > 0);
+    return LuciBool(AS_LIST(o)->count > 0);
 }
 
 /**
@@ -193,7 +277,7 @@ LuciObject* LuciList_add(LuciObject *a, LuciObject *b)
     LuciObject *res = LuciNilObj;
 
     if (ISTYPE(b, obj_list_t)) {
-        res = LuciList_new();
+        res = LuciList_new_sized(AS_LIST(a)->count + AS_LIST(b)->count);
         int i;
         for (i = 0; i < AS_LIST(a)->count; i++) {
             LuciList_append(res, AS_LIST(a)->items[i]);
@@ -221,14 +305,7 @@ LuciObject* LuciList_append(LuciObject *l, LuciObject *b)
     LuciListObj *list = AS_LIST(l);
 
     if (list->count >= list->size) {
-	list->size *= 2;
-	/* realloc the list array */
-	list->items = realloc(list->items,
-		list->size * sizeof(*list->items));
-        if (!list->items) {
-            LUCI_DIE("%s", "Failed to dynamically expand list while appending\n");
-        }
-	LUCI_DEBUG("%s\n", "Reallocated space for list");
+        list_resize(list, list->size * 2);
     }
     /* increment count after appending object */
     list->items[list->count++] = b;
@@ -291,7 +368,7 @@ LuciObject* LuciList_eq(LuciObject *a, LuciObject *b)
 {
     if(ISTYPE(b, obj_list_t)) {
         if (AS_LIST(a)->count != AS_LIST(b)->count) {
-            return LuciInt_new(false);
+            return LuciFalseObj;
         }
         int i;
         for (i = 0; i < AS_LIST(a)->count; i++) {
@@ -301,11 +378,11 @@ LuciObject* LuciList_eq(LuciObject *a, LuciObject *b)
             /* if the objects in the lists at index i aren't equal,
              * return false */
             if (!AS_INT(eq)->i) {
-                return LuciInt_new(false);
+                return LuciFalseObj;
             }
         }
         /* all objects match */
-        return LuciInt_new(true);
+        return LuciTrueObj;
     } else {
         LUCI_DIE("Cannot compare a list to an object of type %s\n",
                 b->type->type_name);
@@ -328,10 +405,10 @@ LuciObject *LuciList_contains(LuciObject *l, LuciObject *o)
         LuciObject *x = AS_LIST(l)->items[i];
         LuciObject *eq = o->type->eq(o, x);
         if (AS_INT(eq)->i) {
-            return LuciInt_new(true);
+            return LuciTrueObj;
         }
     }
-    return LuciInt_new(false);
+    return LuciFalseObj;
 }
 
 /**
@@ -339,7 +416,7 @@ LuciObject *LuciList_contains(LuciObject *l, LuciObject *o)
  *
  * @param l LuciListObj
  * @param idx index
- * @returns copy of object at index idx or NULL if out of bounds
+ * @returns object at index idx or NULL if out of bounds
  */
 LuciObject *LuciList_next(LuciObject *l, LuciObject *idx)
 {
@@ -351,8 +428,7 @@ LuciObject *LuciList_next(LuciObject *l, LuciObject *idx)
         return NULL;
     }
 
-    LuciObject *item = AS_LIST(l)->items[AS_INT(idx)->i];
-    return item->type->copy(item);
+    return AS_LIST(l)->items[AS_INT(idx)->i];
 }
 
 /**
@@ -432,11 +508,13 @@ void LuciList_mark(LuciObject *list)
 /**
  * Finalizes a LuciListObj
  *
- * frees objects array
+ * frees objects array, unless it is stored inline
  *
  * @param list LuciListObj
  */
 void LuciList_finalize(LuciObject *list)
 {
-    free(AS_LIST(list)->items);
+    if (AS_LIST(list)->items != AS_LIST(list)->small_items) {
+        free(AS_LIST(list)->items);
+    }
 }
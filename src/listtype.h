@@ -13,20 +13,25 @@
 
 extern LuciObjectType obj_list_t;
 
-#define INIT_LIST_SIZE 32   /**< initial allocated size of a list */
+#define LIST_INLINE_SIZE 4  /**< number of items stored in the list object */
 
 /** List object type */
 typedef struct LuciList_ {
     LuciObject base;    /**< base implementation */
-    LuciObject **items; /**< pointer to items array */
+    LuciObject **items; /**< pointer to items array (small_items if the
+                             list fits in it) */
     unsigned int count;	/**< current number of items in list */
     unsigned int size;	/**< current count of allocated items */
+    LuciObject *small_items[LIST_INLINE_SIZE];  /**< inline items array */
 } LuciListObj;
 
 /** casts LuciObject o to a LuciListObj */
 #define AS_LIST(o)      ((LuciListObj *)(o))
 
 LuciObject *LuciList_new();
+LuciObject *LuciList_new_sized(unsigned int size);
+void LuciList_reserve(LuciObject *l, unsigned int size);
+void LuciList_resize(LuciObject *l, unsigned int size);
 LuciObject* LuciList_copy(LuciObject *);
 LuciObject* LuciList_deepcopy(LuciObject *);
 LuciObject* LuciList_len(LuciObject *);
@@ -41,7 +41,7 @@
 /** maximum allowed size of a raw string in a source file */
 #define MAX_STR_CONST       8192
 /** maximum # of digits needed to convert a long to a char* */
-#define MAX_INT_DIGITS      (CHAR_BIT * (sizeof(long) / 3) + 3)
+#define MAX_INT_DIGITS      (CHAR_BIT * sizeof(long) / 3 + 3)
 /** maximum # of digits needed to convert a double to a char* */
 #define MAX_FLOAT_DIGITS    (CHAR_BIT * (sizeof(double) / 3) + 3)
 
@@ -6,6 +6,8 @@
  * @file lucitypes.c
  */
 
+#include <stddef.h>
+
 #include "luci.h"
 #include "lucitypes.h"
 
@@ -18,6 +20,7 @@ static void LuciNil_print(LuciObject *);
 LuciObjectType obj_nil_t = {
     "nil",
     sizeof(LuciNilObj),
+    TYPEID_NIL,
 
     LuciNil_copy,
     LuciNil_copy,
@@ -52,7 +55,11 @@ LuciObjectType obj_nil_t = {
 
     ternary_nil,
 
-    LuciNil_print
+    LuciNil_print,
+    unary_void,     /* mark (the nil instance is static) */
+    NULL,           /* finalize */
+    NULL,           /* hash0 */
+    NULL            /* hash1 */
 };
 
 
@@ -80,7 +87,7 @@ static LuciObject* LuciNil_copy(LuciObject *orig)
  */
 static LuciObject* LuciNil_asbool(LuciObject *o)
 {
-    return LuciInt_new(false);
+    return LuciFalseObj;
 }
 
 /**
@@ -93,6 +100,147 @@ static void LuciNil_print(LuciObject *in)
     printf("%s", "nil");
 }
 
+/** every type, indexed by its id */
+static LuciObjectType *all_types[TYPEID_COUNT] = {
+    &obj_nil_t,
+    &obj_int_t,
+    &obj_bigint_t,
+    &obj_float_t,
+    &obj_string_t,
+    &obj_builder_t,
+    &obj_array_t,
+    &obj_range_t,
+    &obj_list_t,
+    &obj_tuple_t,
+    &obj_map_t,
+    &obj_set_t,
+    &obj_func_t,
+    &obj_libfunc_t,
+    &obj_iterator_t,
+    &obj_file_t
+};
+
+/** offset of each binary method in LuciObjectType, in LuciBinop order */
+static const size_t binop_methods[BINOP_COUNT] = {
+    offsetof(LuciObjectType, add),
+    offsetof(LuciObjectType, sub),
+    offsetof(LuciObjectType, mul),
+    offsetof(LuciObjectType, div),
+    offsetof(LuciObjectType, mod),
+    offsetof(LuciObjectType, pow),
+    offsetof(LuciObjectType, eq),
+    offsetof(LuciObjectType, neq),
+    offsetof(LuciObjectType, lt),
+    offsetof(LuciObjectType, gt),
+    offsetof(LuciObjectType, lte),
+    offsetof(LuciObjectType, gte),
+    offsetof(LuciObjectType, lgor),
+    offsetof(LuciObjectType, lgand),
+    offsetof(LuciObjectType, bwxor),
+    offsetof(LuciObjectType, bwor),
+    offsetof(LuciObjectType, bwand)
+};
+
+/**
+ * Binary operators by operator, left operand type and right operand type
+ *
+ * Filled in by types_init.
+ */
+LuciBinaryFunc binop_table[BINOP_COUNT][TYPEID_COUNT][TYPEID_COUNT];
+
+/**
+ * Defines an arithmetic or comparison operator on an int and a float,
+ * a float and an int, and two floats, skipping the type checks that
+ * LuciInt's and LuciFloat's methods make on their right operand
+ */
+#define MIXED_NUMERIC_BINOP(name, make, op) \
+static LuciObject *int_float_##name(LuciObject *a, LuciObject *b) \
+{ \
+    return make(AS_INT(a)->i op AS_FLOAT(b)->f); \
+} \
+static LuciObject *float_int_##name(LuciObject *a, LuciObject *b) \
+{ \
+    return make(AS_FLOAT(a)->f op AS_INT(b)->i); \
+} \
+static LuciObject *float_float_##name(LuciObject *a, LuciObject *b) \
+{ \
+    return make(AS_FLOAT(a)->f op AS_FLOAT(b)->f); \
+}
+
+MIXED_NUMERIC_BINOP(add, LuciFloat_new, +)
+MIXED_NUMERIC_BINOP(sub, LuciFloat_new, -)
+MIXED_NUMERIC_BINOP(mul, LuciFloat_new, *)
+MIXED_NUMERIC_BINOP(eq, LuciBool, ==)
+MIXED_NUMERIC_BINOP(neq, LuciBool, !=)
+MIXED_NUMERIC_BINOP(lt, LuciBool, <)
+MIXED_NUMERIC_BINOP(gt, LuciBool, >)
+MIXED_NUMERIC_BINOP(lte, LuciBool, <=)
+MIXED_NUMERIC_BINOP(gte, LuciBool, >=)
+
+/** number * string repeats the string, like string * number */
+static LuciObject *int_string_mul(LuciObject *a, LuciObject *b)
+{
+    return LuciString_mul(b, a);
+}
+
+/** number + array adds elementwise, like array + number */
+static LuciObject *number_array_add(LuciObject *a, LuciObject *b)
+{
+    return LuciArray_add(b, a);
+}
+
+/** number * array multiplies elementwise, like array * number */
+static LuciObject *number_array_mul(LuciObject *a, LuciObject *b)
+{
+    return LuciArray_mul(b, a);
+}
+
+/**
+ * Builds binop_table
+ *
+ * Each operator defaults to the left operand's method, which checks
+ * the type of the right operand itself. Commutative operators whose
+ * method belongs to the right operand's type (3 * "ab", 2 + array)
+ * are swapped to it, and operators on ints and floats call
+ * specialized functions directly.
+ */
+void types_init(void)
+{
+    int op, l, r;
+
+    for (op = 0; op < BINOP_COUNT; op++) {
+        for (l = 0; l < TYPEID_COUNT; l++) {
+            LuciBinaryFunc method = *(LuciBinaryFunc *)
+                ((char *)all_types[l] + binop_methods[op]);
+            for (r = 0; r < TYPEID_COUNT; r++) {
+                binop_table[op][l][r] = method;
+            }
+        }
+    }
+
+#define SET_NUMERIC(op, name) \
+    binop_table[op][TYPEID_INT][TYPEID_FLOAT] = int_float_##name; \
+    binop_table[op][TYPEID_FLOAT][TYPEID_INT] = float_int_##name; \
+    binop_table[op][TYPEID_FLOAT][TYPEID_FLOAT] = float_float_##name;
+
+    SET_NUMERIC(BINOP_ADD, add)
+    SET_NUMERIC(BINOP_SUB, sub)
+    SET_NUMERIC(BINOP_MUL, mul)
+    SET_NUMERIC(BINOP_EQ, eq)
+    SET_NUMERIC(BINOP_NEQ, neq)
+    SET_NUMERIC(BINOP_LT, lt)
+    SET_NUMERIC(BINOP_GT, gt)
+    SET_NUMERIC(BINOP_LTE, lte)
+    SET_NUMERIC(BINOP_GTE, gte)
+#undef SET_NUMERIC
+
+    binop_table[BINOP_MUL][TYPEID_INT][TYPEID_STRING] = int_string_mul;
+    binop_table[BINOP_ADD][TYPEID_INT][TYPEID_ARRAY] = number_array_add;
+    binop_table[BINOP_ADD][TYPEID_FLOAT][TYPEID_ARRAY] = number_array_add;
+    binop_table[BINOP_MUL][TYPEID_INT][TYPEID_ARRAY] = number_array_mul;
+    binop_table[BINOP_MUL][TYPEID_FLOAT][TYPEID_ARRAY] = number_array_mul;
+}
+
 /**
  * Returns logical not of any LuciObject
  *
@@ -102,7 +250,7 @@ static void LuciNil_print(LuciObject *in)
 LuciObject *LuciObject_lgnot(LuciObject *o)
 {
     LuciObject *b = o->type->asbool(o);
-    return LuciInt_new(!(AS_INT(b)->i));
+    return LuciBool(!(AS_INT(b)->i));
 }
 
 /**
@@ -116,7 +264,7 @@ LuciObject *LuciObject_lgand(LuciObject *a, LuciObject *b)
 {
     LuciObject *a0 = a->type->asbool(a);
     LuciObject *b0 = b->type->asbool(b);
-    return LuciInt_new(AS_INT(a0)->i && AS_INT(b0)->i);
+    return LuciBool(AS_INT(a0)->i && AS_INT(b0)->i);
 }
 
 /**
@@ -130,7 +278,7 @@ LuciObject *LuciObject_lgor(LuciObject *a, LuciObject *b)
 {
     LuciObject *a0 = a->type->asbool(a);
     LuciObject *b0 = b->type->asbool(b);
-    return LuciInt_new(AS_INT(a0)->i || AS_INT(b0)->i);
+    return LuciBool(AS_INT(a0)->i || AS_INT(b0)->i);
 }
 
 /**
@@ -25,6 +25,27 @@
  */
 #define MAKE_INDEX_POS(idx, len) while ((idx) < 0) { (idx) = (len) + (idx); }
 
+/** Small integer identifying each type, indexing binop_table */
+typedef enum {
+    TYPEID_NIL,
+    TYPEID_INT,
+    TYPEID_BIGINT,
+    TYPEID_FLOAT,
+    TYPEID_STRING,
+    TYPEID_BUILDER,
+    TYPEID_ARRAY,
+    TYPEID_RANGE,
+    TYPEID_LIST,
+    TYPEID_TUPLE,
+    TYPEID_MAP,
+    TYPEID_SET,
+    TYPEID_FUNC,
+    TYPEID_LIBFUNC,
+    TYPEID_ITERATOR,
+    TYPEID_FILE,
+    TYPEID_COUNT
+} LuciTypeId;
+
 /** Generic Object which allows for dynamic typing */
 typedef struct LuciObject_ {
     struct LuciObjectType *type;    /**< pointer to type implementation */
@@ -36,6 +57,7 @@ typedef struct LuciObjectType
 {
     char *type_name;    /**< name of the type */
     uint32_t size;      /**< size of an instance */
+    LuciTypeId id;      /**< index into binop_table */
 
     /* unary methods */
     LuciObject* (*copy)(LuciObject *);  /**< copy method */
@@ -86,6 +108,47 @@ typedef struct LuciObjectType
 /** returns 1 if two objects have the same type, 0 otherwise */
 #define TYPES_MATCH(left, right) ((left)->type == (right)->type)
 
+/**
+ * Binary operators, in the order of their methods in LuciObjectType
+ * and of their opcodes, starting from ADD
+ */
+typedef enum {
+    BINOP_ADD,
+    BINOP_SUB,
+    BINOP_MUL,
+    BINOP_DIV,
+    BINOP_MOD,
+    BINOP_POW,
+    BINOP_EQ,
+    BINOP_NEQ,
+    BINOP_LT,
+    BINOP_GT,
+    BINOP_LTE,
+    BINOP_GTE,
+    BINOP_LGOR,
+    BINOP_LGAND,
+    BINOP_BWXOR,
+    BINOP_BWOR,
+    BINOP_BWAND,
+    BINOP_COUNT
+} LuciBinop;
+
+/** binary method, e.g. LuciObjectType's add */
+typedef LuciObject* (*LuciBinaryFunc)(LuciObject *, LuciObject *);
+
+extern LuciBinaryFunc binop_table[BINOP_COUNT][TYPEID_COUNT][TYPEID_COUNT];
+
+/**
+ * Applies a binary operator by looking up both operands' types
+ *
+ * @param op LuciBinop
+ * @param a left operand
+ * @param b right operand
+ */
+#define BINOP(op, a, b) \
+    (binop_table[(op)][(a)->type->id][(b)->type->id]((a), (b)))
+
+void types_init(void);
 
 LuciObject *LuciObject_lgand(LuciObject *, LuciObject *);
 LuciObject *LuciObject_lgor(LuciObject *, LuciObject *);
@@ -100,10 +163,16 @@ LuciObject* ternary_nil(LuciObject *, LuciObject *, LuciObject *);
 
 #include "gc.h"     /* for gc_malloc */
 #include "inttype.h"
+#include "biginttype.h"
 #include "floattype.h"
 #include "stringtype.h"
+#include "buildertype.h"
+#include "arraytype.h"
+#include "rangetype.h"
 #include "listtype.h"
+#include "tupletype.h"
 #include "maptype.h"
+#include "settype.h"
 #include "functiontype.h"
 #include "iteratortype.h"
 #include "filetype.h"
@@ -9,8 +9,11 @@
 #include "luci.h"
 #include "lucitypes.h"
 #include "gc.h"
+#include "hash.h"
 #include "ast.h"
 #include "compile.h"
+#include "peephole.h"
+#include "ssa.h"
 #include "interpret.h"
 
 /** defined in scanner */
@@ -56,14 +59,18 @@ static void help()
     puts("    -g\t\tPrint a Graphviz dot spec for the parsed AST");
     puts("    -p\t\tShow the compiled bytecode source");
     puts("    -c\t\tCompile the source to a .lxc file (i.e. do nothing)");
+    puts("    -O\t\tOptimize the bytecode in SSA form before running it");
+    puts("    -i\t\tInline calls to small functions");
     printf("\n%s\n", version_string);
 
     puts("\nSizes:");
     printf("%ld (%s)\n", sizeof(LuciIntObj), "int");
+    printf("%ld (%s)\n", sizeof(LuciBigIntObj), "bigint");
     printf("%ld (%s)\n", sizeof(LuciFloatObj), "float");
     printf("%ld (%s)\n", sizeof(LuciStringObj), "string");
     printf("%ld (%s)\n", sizeof(LuciFileObj), "file");
     printf("%ld (%s)\n", sizeof(LuciListObj), "list");
+    printf("%ld (%s)\n", sizeof(LuciTupleObj), "tuple");
     printf("%ld (%s)\n", sizeof(LuciMapObj), "map");
     printf("%ld (%s)\n", sizeof(LuciIteratorObj), "iterator");
     printf("%ld (%s)\n", sizeof(LuciFunctionObj), "func");
@@ -112,6 +119,10 @@ int luci_main(int argc, char *argv[])
             return EXIT_SUCCESS;
         } else if (strcmp(arg, "-n") == 0) {
             mode = MODE_SYNTAX;
+        } else if (strcmp(arg, "-O") == 0) {
+            compile_optimize = true;
+        } else if (strcmp(arg, "-i") == 0) {
+            compile_inline = true;
         } else if (i == (argc - 1)) {
             infilename = arg;
         } else {
@@ -146,7 +157,9 @@ int luci_main(int argc, char *argv[])
     }
 
     /* initialize systems */
+    hash_init();
     gc_init();
+    types_init();
     compiler_init();
 
     /* Compile the AST */
@@ -168,6 +181,18 @@ int luci_main(int argc, char *argv[])
             case MODE_PRINT:
                 /* Print the bytecode */
                 print_instructions(gf);
+                printf("; %u instructions, %u removed by the peephole optimizer\n",
+                        peephole_stats.after,
+                        peephole_stats.before - peephole_stats.after);
+                if (compile_optimize) {
+                    printf("; SSA: %u loads forwarded, %u expressions hoisted, "
+                            "%u reused, %u dead stores\n",
+                            ssa_stats.forwarded, ssa_stats.hoisted,
+                            ssa_stats.reused, ssa_stats.stores);
+                }
+                if (compile_inline) {
+                    printf("; %u calls inlined\n", compile_inlined);
+                }
                 break;
             case MODE_SERIAL:
                 /* Serialize program */
@@ -201,7 +226,9 @@ int luci_interactive(void)
     printf("\nWelcome to Interactive %s\n\n", version_string);
 
     /* initialize systems */
+    hash_init();
     gc_init();
+    types_init();
     compiler_init();
 
     CompileState *cs = NULL;
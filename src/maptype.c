@@ -4,45 +4,63 @@
 
 /**
  * @file maptype.c
+ *
+ * Open-addressing hash table in the style of Google's "Swiss tables".
+ *
+ * Key/value pairs live in a dense entries array, in insertion order.
+ * The table itself is an array of 4-byte indices into the entries,
+ * plus one control byte per slot holding MAP_CTRL_EMPTY,
+ * MAP_CTRL_DELETED or the low 7 bits of the hash of the slot's key. Slots are probed in
+ * groups of MAP_GROUP_SIZE, comparing a whole group of control bytes
+ * at once (with SSE2 when available), so a lookup rarely touches an
+ * entry whose key doesn't match.
+ *
+ * The number of slots is always a power of two, and groups are
+ * probed in triangular order, which visits every group.
+ *
+ * Removing a pair leaves a hole in the entries array and, unless its
+ * group still has an empty slot, a tombstone in the table, so removal
+ * is O(1). Once the entries array fills up, the table is rebuilt from
+ * the remaining pairs at whatever size suits them, which compacts the
+ * entries and clears every tombstone, and shrinks a map most of whose
+ * pairs were removed. Removal itself never moves an entry, so a loop
+ * over a map's keys may remove them as it goes.
  */
 
 #include "maptype.h"
+#include "hash.h"
 
-/** Returns the next computed index for the two given hashes
- * @param H0 hash 0
- * @param H1 hash 1
- * @param I  iteration number
- * @param N  table size
- * @returns  index into hash table
- */
-#define GET_INDEX(H0, H1, I, N)   ( ( (H0) + ((I) * (I)) * (H1) ) % (N) )
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && \
+        defined(__GNUC__)
+#define MAP_SSE2 1
+#include <emmintrin.h>
+#endif
 
+/** control byte of a slot that has never held a key */
+#define MAP_CTRL_EMPTY  0x80
 
+/** control byte of a slot whose key was removed (a tombstone) */
+#define MAP_CTRL_DELETED    0xFE
 
-static LuciMapObj *map_grow(LuciMapObj *map);
-static LuciMapObj *map_shrink(LuciMapObj *map);
-static LuciMapObj *map_resize(LuciMapObj *map, unsigned int new_size);
+/** control byte of a slot holding a key with the given hash */
+#define MAP_CTRL_HASH(H)    ((uint8_t)((H) & 0x7F))
 
-/** total number of possible hash table sizes */
-#define MAX_TABLE_SIZE_OPTIONS  28
-/**
- * Array of prime number hash table sizes.
- *
- * Numbers courtesy of:
- * http://planetmath.org/GoodHashTablePrimes.html
- */
-unsigned int table_sizes[] = {
-    7, 17, 43, 97, 193, 389, 769, 1543, 3079, 6151,
-    12289, 24593, 49157, 98317, 196613, 393241, 786433,
-    1572869, 3145739, 6291469, 12582917, 25165843,
-    50331653, 100663319, 201326611, 402653189,
-    805306457, 1610612741, 0
-};
+/** maximum number of pairs held by a table of N slots (7/8 load) */
+#define MAP_MAX_LOAD(N)     ((N) - (N) / 8)
+
+static uint64_t map_hash(LuciObject *key);
+static bool map_keys_equal(LuciObject *a, LuciObject *b);
+static long map_find(LuciMapObj *map, LuciObject *key, uint64_t hash);
+static unsigned int map_find_free(LuciMapObj *map, uint64_t hash);
+static unsigned int map_ideal_size(unsigned int count);
+static void map_resize(LuciMapObj *map, unsigned int new_size);
+static void map_missing_key(LuciObject *key);
 
 /** Type member table for LuciMapObj */
 LuciObjectType obj_map_t = {
     "map",
     sizeof(LuciMapObj),
+    TYPEID_MAP,
 
     LuciMap_copy,
     LuciMap_deepcopy,
@@ -91,28 +109,35 @@ LuciObjectType obj_map_t = {
  * @returns new LuciMapObj
  */
 LuciObject *LuciMap_new()
+{
+    return LuciMap_new_sized(0);
+}
+
+/**
+ * Creates a new, empty LuciMapObj that can hold count pairs
+ * without being resized
+ *
+ * @param count number of pairs to allocate space for
+ * @returns new empty LuciMapObj
+ */
+LuciObject *LuciMap_new_sized(unsigned int count)
 {
     LuciMapObj *map = (LuciMapObj*)gc_malloc(&obj_map_t);
-    map->size_idx = 0;
-    map->size = table_sizes[map->size_idx];
+    map->count = 0;
+    map->used = 0;
+    map->size = INIT_MAP_SIZE;
+    while (MAP_MAX_LOAD(map->size) < count) {
+        map->size *= 2;
+    }
 
-    map->keys = alloc(map->size * sizeof(*(map->keys)));
-    map->vals = alloc(map->size * sizeof(*(map->vals)));
+    map->ctrl = alloc(map->size * sizeof(*(map->ctrl)));
+    memset(map->ctrl, MAP_CTRL_EMPTY, map->size * sizeof(*(map->ctrl)));
+    map->slots = alloc(map->size * sizeof(*(map->slots)));
+    map->entries = alloc(MAP_MAX_LOAD(map->size) * sizeof(*(map->entries)));
 
     return (LuciObject *)map;
 }
 
-/*
-void map_delete(LuciObject *o)
-{
-    LuciMapObj *map = AS_MAP(o);
-    free(map->keys);
-    free(map->vals);
-    free(map);
-    return;
-}
-*/
-
 /**
  * Copies a LuciMapObj
  *
@@ -135,14 +160,14 @@ LuciObject *LuciMap_copy(LuciObject *orig)
 LuciObject* LuciMap_deepcopy(LuciObject *orig)
 {
     LuciMapObj *mapobj = (LuciMapObj *)orig;
-    int i;
+    unsigned int i;
 
-    LuciObject *copy = LuciMap_new();
+    LuciObject *copy = LuciMap_new_sized(mapobj->count);
 
-    for (i = 0; i < mapobj->size; i++) {
-        if (mapobj->keys[i]) {
-            LuciObject *key = mapobj->keys[i];
-            LuciObject *val = mapobj->vals[i];
+    for (i = 0; i < mapobj->used; i++) {
+        LuciObject *key = mapobj->entries[i].key;
+        LuciObject *val = mapobj->entries[i].val;
+        if (key) {
             LuciMap_cput(copy, key->type->copy(key), val->type->copy(val));
         }
     }
@@ -157,7 +182,7 @@ LuciObject* LuciMap_deepcopy(LuciObject *orig)
  */
 LuciObject* LuciMap_asbool(LuciObject *o)
 {
-    return LuciInt_new(AS_MAP(o)->count > 0);
+    return LuciBool(AS_MAP(o)->count > 0);
 }
 
 /**
@@ -173,18 +198,17 @@ LuciObject* LuciMap_add(LuciObject *a, LuciObject *b)
 
     if (ISTYPE(b, obj_map_t)) {
         res = LuciMap_new();
-        int i;
-        LuciObject *key = NULL;
-        for (i = 0; i < AS_MAP(a)->size; i++) {
-            key = AS_MAP(a)->keys[i];
-            if (key) {
-                LuciMap_cput(res, key, AS_MAP(a)->vals[i]);
+        unsigned int i;
+        for (i = 0; i < AS_MAP(a)->used; i++) {
+            if (AS_MAP(a)->entries[i].key) {
+                LuciMap_cput(res, AS_MAP(a)->entries[i].key,
+                        AS_MAP(a)->entries[i].val);
             }
         }
-        for (i = 0; i < AS_MAP(b)->size; i++) {
-            key = AS_MAP(b)->keys[i];
-            if (key) {
-                LuciMap_cput(res, key, AS_MAP(b)->vals[i]);
+        for (i = 0; i < AS_MAP(b)->used; i++) {
+            if (AS_MAP(b)->entries[i].key) {
+                LuciMap_cput(res, AS_MAP(b)->entries[i].key,
+                        AS_MAP(b)->entries[i].val);
             }
         }
     } else {
@@ -206,26 +230,26 @@ LuciObject* LuciMap_eq(LuciObject *a, LuciObject *b)
 {
     if(ISTYPE(b, obj_map_t)) {
         if (AS_MAP(a)->count != AS_MAP(b)->count) {
-            return LuciInt_new(false);
+            return LuciFalseObj;
         }
-        int i;
-        for (i = 0; i < AS_MAP(a)->size; i++) {
-            LuciObject *key = AS_MAP(a)->keys[i];
-            if (key) {
-                LuciObject *val1 = AS_MAP(b)->vals[i];
-                /* TODO: if the key isn't in the second map,
-                 * this will DIE and kill luci */
-                LuciObject *val2 = LuciMap_cget(b, key);
-                LuciObject *eq = val1->type->eq(val1, val2);
-                /* if the objects in the lists at index i aren't equal,
-                 * return false */
-                if (!AS_INT(eq)->i) {
-                    return LuciInt_new(false);
-                }
+        unsigned int i;
+        for (i = 0; i < AS_MAP(a)->used; i++) {
+            if (!AS_MAP(a)->entries[i].key) {
+                continue;
+            }
+            LuciObject *val1 = AS_MAP(a)->entries[i].val;
+            LuciObject *val2 = LuciMap_get(b, AS_MAP(a)->entries[i].key);
+            if (!val2) {
+                return LuciFalseObj;
+            }
+            LuciObject *eq = val1->type->eq(val1, val2);
+            /* if the values for the key aren't equal, return false */
+            if (!AS_INT(eq)->i) {
+                return LuciFalseObj;
             }
         }
         /* all key-value pairs are in both maps */
-        return LuciInt_new(true);
+        return LuciTrueObj;
     } else {
         LUCI_DIE("Cannot compare a map to an object of type %s\n",
                 b->type->type_name);
@@ -247,121 +271,326 @@ LuciObject* LuciMap_len(LuciObject *o)
 /**
  * Determines whether a LuciMapObj contains a key
  *
+ * Objects that can't be map keys are never contained.
+ *
  * @param m LuciMapObj
  * @param o object
- * @returns 1 if str contains k, 0 otherwise
+ * @returns 1 if m contains key o, 0 otherwise
  */
 LuciObject *LuciMap_contains(LuciObject *m, LuciObject *o)
 {
-    int i;
-    for (i = 0; i < AS_MAP(m)->size; i++) {
-        LuciObject *key = AS_MAP(m)->keys[i];
-        if (key) {
-            LuciObject *eq = o->type->eq(o, key);
-            if (AS_INT(eq)->i) {
-                return LuciInt_new(true);
-            }
-        }
+    if (!o->type->hash0) {
+        return LuciFalseObj;
     }
-    return LuciInt_new(false);
+    return LuciBool(map_find(AS_MAP(m), o, map_hash(o)) >= 0);
 }
 
 /**
  * Returns the 'next' object in the map
  *
+ * Keys are returned in insertion order.
+ *
  * @param m LuciMapObj
  * @param idx index
- * @returns copy of object at index idx or NULL if out of bounds
+ * @returns key at index idx or NULL if out of bounds
  */
 LuciObject *LuciMap_next(LuciObject *m, LuciObject *idx)
+{
+    LuciObject *val;
+    return LuciMap_next_pair(m, idx, &val);
+}
+
+/**
+ * Returns the 'next' key in the map, along with its value
+ *
+ * Keys are returned in insertion order. idx is a cursor into the
+ * entries array, which the map advances past the holes left by
+ * removed pairs, so each step is amortized O(1).
+ *
+ * @param m LuciMapObj
+ * @param idx iterator's cursor
+ * @param val set to the value of the returned key
+ * @returns next key at or after idx, or NULL if there are none
+ */
+LuciObject *LuciMap_next_pair(LuciObject *m, LuciObject *idx, LuciObject **val)
 {
     if (!ISTYPE(idx, obj_int_t)) {
         LUCI_DIE("Argument to LuciMap_next must be LuciIntObj, not %s\n",
                 idx->type->type_name);
     }
 
-    if (AS_INT(idx)->i >= AS_MAP(m)->count) {
+    LuciMapObj *map = AS_MAP(m);
+    long i = AS_INT(idx)->i;
+    if (i < 0) {
         return NULL;
     }
+    while (i < map->used && !map->entries[i].key) {
+        i++;
+    }
+    if (i >= map->used) {
+        return NULL;
+    }
+    AS_INT(idx)->i = i;
+    *val = map->entries[i].val;
+    return map->entries[i].key;
+}
+
+/**
+ * Computes the 64-bit hash of a map key
+ *
+ * Any object whose type provides hash functions can be a key.
+ *
+ * @param key LuciObject key
+ * @returns 64-bit hash
+ */
+static uint64_t map_hash(LuciObject *key)
+{
+    if (ISTYPE(key, obj_string_t) && AS_STRING(key)->hash) {
+        /* a string caches its hash, so skip calling through its type */
+        return AS_STRING(key)->hash;
+    } else if (ISTYPE(key, obj_int_t)) {
+        /* the same 64 bits as the int type's hash0 and hash1 */
+        return hash_word(AS_INT(key)->i);
+    } else if (!key->type->hash0) {
+        LUCI_DIE("Map key must be an int, float or string, not %s\n",
+                key->type->type_name);
+    }
+    return ((uint64_t)key->type->hash1(key) << 32) | key->type->hash0(key);
+}
+
+/**
+ * Determines whether two keys with equal hashes are equal
+ *
+ * An int (of any size) and a float are equal keys only if the float
+ * is exactly the integer's value. Never allocates, unlike the type's
+ * eq method.
+ *
+ * @param a LuciObject key
+ * @param b LuciObject key
+ * @returns true if the keys are equal
+ */
+static bool map_keys_equal(LuciObject *a, LuciObject *b)
+{
+    if (a == b) {
+        return true;
+    }
 
-    /* loop through the map keys, counting keys until we reach idx */
-    int i = 0, count = -1;
-    for (i = 0; i < AS_MAP(m)->size; i++) {
-        if (AS_MAP(m)->keys[i]) {
-            count++;
+    if (ISTYPE(a, obj_string_t)) {
+        LuciStringObj *sa = AS_STRING(a), *sb = AS_STRING(b);
+        return ISTYPE(b, obj_string_t) && sa->len == sb->len &&
+            memcmp(sa->s, sb->s, sa->len) == 0;
+    } else if (ISTYPE(a, obj_int_t)) {
+        if (ISTYPE(b, obj_int_t)) {
+            return AS_INT(a)->i == AS_INT(b)->i;
+        } else if (ISTYPE(b, obj_float_t)) {
+            double f = AS_FLOAT(b)->f;
+            return f >= (double)LONG_MIN && f < -(double)LONG_MIN &&
+                f == (long)f && (long)f == AS_INT(a)->i;
         }
-        if (count == AS_INT(idx)->i) {
-            return AS_MAP(m)->keys[i];
+    } else if (ISTYPE(a, obj_bigint_t)) {
+        LuciBigIntObj *ba = AS_BIGINT(a), *bb = AS_BIGINT(b);
+        if (ISTYPE(b, obj_bigint_t)) {
+            return ba->sign == bb->sign && ba->size == bb->size &&
+                memcmp(ba->digits, bb->digits,
+                        ba->size * sizeof(*ba->digits)) == 0;
+        } else if (ISTYPE(b, obj_float_t)) {
+            return LuciBigInt_equals_double(a, AS_FLOAT(b)->f);
+        }
+    } else if (ISTYPE(a, obj_float_t)) {
+        if (ISTYPE(b, obj_float_t)) {
+            return AS_FLOAT(a)->f == AS_FLOAT(b)->f;
+        } else if (ISTYPE(b, obj_int_t) || ISTYPE(b, obj_bigint_t)) {
+            return map_keys_equal(b, a);
         }
     }
-    return NULL;
+    return false;
 }
 
 /**
- * Calls map_resize with a larger size index
+ * Returns a bit mask of the control bytes in a group equal to c
  *
- * @param o LuciMapObj to enlarge
- * @returns enlarged LuciMapObj
+ * @param group first of MAP_GROUP_SIZE control bytes
+ * @param c control byte to match
+ * @returns mask with bit i set if group[i] == c
  */
-static LuciMapObj *map_grow(LuciMapObj *o)
+static inline unsigned int map_group_match(const uint8_t *group, uint8_t c)
 {
-    return map_resize(o, o->size_idx + 1);
+#ifdef MAP_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)c)));
+#else
+    unsigned int mask = 0, i;
+    for (i = 0; i < MAP_GROUP_SIZE; i++) {
+        if (group[i] == c) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
 }
 
 /**
- * Calls map_resize with a smaller size index
+ * Returns a bit mask of the free (empty or deleted) slots in a group
+ *
+ * Only free slots' control bytes have the high bit set.
  *
- * @param o LuciMapObj to shrink
- * @returns shrunk LuciMapObj
+ * @param group first of MAP_GROUP_SIZE control bytes
+ * @returns mask with bit i set if slot i is free
  */
-static LuciMapObj *map_shrink(LuciMapObj *o)
+static inline unsigned int map_group_match_free(const uint8_t *group)
 {
-    return map_resize(o, o->size_idx + 1);
+#ifdef MAP_SSE2
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    unsigned int mask = 0, i;
+    for (i = 0; i < MAP_GROUP_SIZE; i++) {
+        if (group[i] & 0x80) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
 }
 
 /**
- * Resizes the map's hash table and re-hashes all of its contents.
+ * Finds the slot holding a key
  *
- * @param map a LuciMapObj
- * @param new_size_idx the new size index used to determine the new size
- * @returns Same LuciMapObj with a new hash table
+ * @param map LuciMapObj
+ * @param key key to find
+ * @param hash 64-bit hash of key
+ * @returns index of key's slot, or -1 if map doesn't contain key
  */
-static LuciMapObj *map_resize(LuciMapObj *map, unsigned int new_size_idx)
+static long map_find(LuciMapObj *map, LuciObject *key, uint64_t hash)
 {
-    int i;
-    unsigned int old_size = 0;
-    LuciObject **old_keys = NULL;
-    LuciObject **old_vals = NULL;
-
-    if (new_size_idx <= 0) {
-        return map;
-    } else if (new_size_idx > MAX_TABLE_SIZE_OPTIONS) {
-        return map;
+    unsigned int gmask = map->size / MAP_GROUP_SIZE - 1;
+    unsigned int group = (hash >> 7) & gmask;
+    unsigned int step = 0;
+
+    while (true) {
+        const uint8_t *ctrl = map->ctrl + group * MAP_GROUP_SIZE;
+        unsigned int match = map_group_match(ctrl, MAP_CTRL_HASH(hash));
+
+        while (match) {
+            unsigned int slot = group * MAP_GROUP_SIZE + __builtin_ctz(match);
+            LuciMapEntry *entry = &map->entries[map->slots[slot]];
+            if (entry->hash == hash && map_keys_equal(entry->key, key)) {
+                return slot;
+            }
+            match &= match - 1;
+        }
+        /* an empty slot ends the probe sequence */
+        if (map_group_match(ctrl, MAP_CTRL_EMPTY)) {
+            return -1;
+        }
+        group = (group + ++step) & gmask;
     }
+}
 
-    old_size = map->size;
-    old_keys = map->keys;
-    old_vals = map->vals;
+/**
+ * Finds the first empty or deleted slot in a hash's probe sequence
+ *
+ * The table is never full, so there is always one.
+ *
+ * @param map LuciMapObj
+ * @param hash 64-bit hash
+ * @returns index of a free slot
+ */
+static unsigned int map_find_free(LuciMapObj *map, uint64_t hash)
+{
+    unsigned int gmask = map->size / MAP_GROUP_SIZE - 1;
+    unsigned int group = (hash >> 7) & gmask;
+    unsigned int step = 0;
+
+    while (true) {
+        unsigned int avail = map_group_match_free(map->ctrl + group * MAP_GROUP_SIZE);
+        if (avail) {
+            return group * MAP_GROUP_SIZE + __builtin_ctz(avail);
+        }
+        group = (group + ++step) & gmask;
+    }
+}
 
-    map->size_idx = new_size_idx;
-    map->size = table_sizes[new_size_idx];
-    map->count = 0;
-    map->collisions = 0;
+/**
+ * Returns the number of slots a table holding count pairs should have
+ *
+ * At most half of the table's capacity is used right after a resize,
+ * so that growing or shrinking again takes many insertions or
+ * removals.
+ *
+ * @param count number of pairs
+ * @returns number of slots (a power of 2)
+ */
+static unsigned int map_ideal_size(unsigned int count)
+{
+    unsigned int size = INIT_MAP_SIZE;
+    while (MAP_MAX_LOAD(size) < 2 * count) {
+        size *= 2;
+    }
+    return size;
+}
 
-    map->keys = alloc(map->size * sizeof(*(map->keys)));
-    map->vals = alloc(map->size * sizeof(*(map->vals)));
+/**
+ * Resizes the map's hash table and re-hashes all of its entries.
+ *
+ * The entries are compacted first, dropping the holes left by removed
+ * pairs, and the rebuilt table has no tombstones. If the size doesn't
+ * change, the table is rebuilt in place. Entries cache their hashes,
+ * so no key is hashed again.
+ *
+ * @param map a LuciMapObj
+ * @param new_size the new number of slots (a power of 2)
+ */
+static void map_resize(LuciMapObj *map, unsigned int new_size)
+{
+    unsigned int i, n = 0;
 
-    /* re-hash every existing entry into the new, smaller array */
-    for (i = 0; i < old_size; i++) {
-        if (old_keys[i]) {
-            LuciMap_cput((LuciObject *)map, old_keys[i], old_vals[i]);
+    for (i = 0; i < map->used; i++) {
+        if (map->entries[i].key) {
+            map->entries[n++] = map->entries[i];
+        }
+    }
+    map->used = n;
+
+    if (new_size != map->size) {
+        free(map->ctrl);
+        free(map->slots);
+
+        map->size = new_size;
+        map->ctrl = alloc(map->size * sizeof(*(map->ctrl)));
+        map->slots = alloc(map->size * sizeof(*(map->slots)));
+        map->entries = realloc(map->entries,
+                MAP_MAX_LOAD(map->size) * sizeof(*(map->entries)));
+        if (!map->entries) {
+            LUCI_DIE("%s\n", "Failed to resize map");
         }
     }
+    memset(map->ctrl, MAP_CTRL_EMPTY, map->size * sizeof(*(map->ctrl)));
 
-    free(old_keys);
-    free(old_vals);
+    for (i = 0; i < map->used; i++) {
+        unsigned int slot = map_find_free(map, map->entries[i].hash);
+        map->ctrl[slot] = MAP_CTRL_HASH(map->entries[i].hash);
+        map->slots[slot] = i;
+    }
+}
 
-    return map;
+/**
+ * Dies, reporting a key missing from a map
+ *
+ * @param key the missing key
+ */
+static void map_missing_key(LuciObject *key)
+{
+    if (ISTYPE(key, obj_string_t)) {
+        LUCI_DIE("Missing key \"%.*s\" in map\n",
+                (int)AS_STRING(key)->len, AS_STRING(key)->s);
+    } else if (ISTYPE(key, obj_int_t)) {
+        LUCI_DIE("Missing key %ld in map\n", AS_INT(key)->i);
+    } else if (ISTYPE(key, obj_bigint_t)) {
+        LUCI_DIE("Missing key %s in map\n",
+                AS_STRING(LuciBigInt_repr(key))->s);
+    } else {
+        LUCI_DIE("Missing key %f in map\n", AS_FLOAT(key)->f);
+    }
 }
 
 /**
@@ -370,7 +599,7 @@ static LuciMapObj *map_resize(LuciMapObj *map, unsigned int new_size_idx)
  * @param o     LuciObject (should be a LuciMapObj)
  * @param key   Key to be hashed
  * @param val   Value corresponding to key
- * @returns     original LuciObject with updated hash table
+ * @returns     the key
  */
 LuciObject *LuciMap_cput(LuciObject *o, LuciObject *key, LuciObject *val)
 {
@@ -378,101 +607,84 @@ LuciObject *LuciMap_cput(LuciObject *o, LuciObject *key, LuciObject *val)
         LUCI_DIE("%s\n", "Map table not allocated");
     } else if (!key) {
         LUCI_DIE("%s\n", "Null key in map insertion");
-    } else if (!ISTYPE(key, obj_string_t)) {
-        printf("Map key must be of type string, not %s\n",
-                key->type->type_name);
-        longjmp(LUCI_EXCEPTION_BUF, 42);
-        LUCI_DIE("Map key must be of type string, not %s\n",
-                key->type->type_name);
     }
 
     LuciMapObj *map = AS_MAP(o);
+    uint64_t hash = map_hash(key);
 
-    if (map->count > (map->size * 0.60)) {
-        map_grow(map);
+    long found = map_find(map, key, hash);
+    if (found >= 0) {
+        /* update the corresponding val */
+        map->entries[map->slots[found]].val = val;
+        return key;
     }
 
-    uint32_t hash0 = key->type->hash0(key);
-    uint32_t hash1 = key->type->hash1(key);
-
-    /* otherwise, it's time to search for an empty slot */
-    unsigned int i = 0, idx = 0;
-    for (i = 0; i < map->size; i++) {
-        idx = GET_INDEX(hash0, hash1, i, map->size);
-        LuciObject *curkey = map->keys[idx];
-
-        if (!curkey) {
-            /* if an empty slot is found, use it and break */
-            map->keys[idx] = key;
-            map->vals[idx] = val;
-            map->count++;
-            break;
-        } else if (strcmp(AS_STRING(curkey)->s, AS_STRING(key)->s) == 0) {
-            /* TODO: use proper LuciStringObj comparison */
-            /* compare objects and return if equal */
-
-            /* update the corresponding val */
-            map->vals[idx] = val;
-            return key;
-        } else {
-            /* just count the collision and continue trying indices */
-            map->collisions++;
-        }
+    /* once the entries array is full, either grow the table or,
+     * if enough pairs have been removed, rebuild it to reclaim
+     * their holes and tombstones */
+    if (map->used >= MAP_MAX_LOAD(map->size)) {
+        map_resize(map, map_ideal_size(map->count + 1));
     }
 
-    /* return the object inserted */
+    unsigned int slot = map_find_free(map, hash);
+    map->ctrl[slot] = MAP_CTRL_HASH(hash);
+    map->slots[slot] = map->used;
+    map->count++;
+
+    LuciMapEntry *entry = &map->entries[map->used++];
+    entry->hash = hash;
+    entry->key = key;
+    entry->val = val;
+
     return key;
 }
 
 /**
  * Performs a search for the value corresponding to the given key
- * in the map's hash table
  *
  * @param o     LuciObject (should be a LuciMapObj)
  * @param key   Key to be hashed and searched for
  * @returns     LuciObject value corresponding to key or NULL if not found
  */
+LuciObject *LuciMap_get(LuciObject *o, LuciObject *key)
+{
+    LuciMapObj *map = AS_MAP(o);
+    long slot = map_find(map, key, map_hash(key));
+    return (slot >= 0) ? map->entries[map->slots[slot]].val : NULL;
+}
+
+/**
+ * Performs a search for the value corresponding to the given key
+ * in the map's hash table, dying if the key is missing
+ *
+ * @param o     LuciObject (should be a LuciMapObj)
+ * @param key   Key to be hashed and searched for
+ * @returns     LuciObject value corresponding to key
+ */
 LuciObject *LuciMap_cget(LuciObject *o, LuciObject *key)
 {
     if (!o) {
         LUCI_DIE("%s\n", "Map table not allocated");
     } else if (!key) {
         LUCI_DIE("%s\n", "Null key in map lookup");
-    } else if (!ISTYPE(key, obj_string_t)) {
-        LUCI_DIE("Map key must be of type string, not %s\n",
-                key->type->type_name);
     }
 
-    LuciMapObj *map = AS_MAP(o);
-
-    uint32_t hash0 = key->type->hash0(key);
-    uint32_t hash1 = key->type->hash1(key);
-
-    unsigned int i, idx;
-    for (i = 0; i < map->size; i++) {
-        idx = GET_INDEX(hash0, hash1, i, map->size);
-
-        if (!map->keys[idx]) {
-            /* if we find a NULL slot, it's not in the hash table */
-            break;
-        } else if (strcmp(
-                    AS_STRING(map->keys[idx])->s,
-                    AS_STRING(key)->s) == 0) {
-            /* TODO: use proper LuciStringObj comparison */
-            return map->vals[idx];
-        }
+    LuciObject *val = LuciMap_get(o, key);
+    if (!val) {
+        map_missing_key(key);
     }
-    LUCI_DIE("Missing key \"%s\" in map\n", AS_STRING(key)->s);
-    return NULL;
+    return val;
 }
 
 /**
  * Performs a search for the value corresponding to the given key
  * in the map's hash table then removes the key,value pair.
  *
- * Once a key is removed, any keys that potentially conflicted with the
- * newly deleted key in the past must be re-hashed in order to preserve
- * the table's integrity for future key insertions.
+ * The pair's entry becomes a hole, and its slot becomes empty if
+ * no probe sequence can have passed through its group (i.e. the group
+ * still has an empty slot), or a tombstone otherwise. No entry moves,
+ * so iterators over the map stay valid; the next insertion that finds
+ * the entries array full reclaims the space.
  *
  * @param o     LuciObject (should be a LuciMapObj)
  * @param key   Key to be hashed and searched for
@@ -484,67 +696,25 @@ LuciObject *LuciMap_cdel(LuciObject *o, LuciObject *key)
         LUCI_DIE("%s\n", "Map table not allocated");
     } else if (!key) {
         LUCI_DIE("%s\n", "Null key in map remove");
-    } else if (!ISTYPE(key, obj_string_t)) {
-        LUCI_DIE("Map key must be of type string, not %s\n",
-                key->type->type_name);
     }
 
     LuciMapObj *map = AS_MAP(o);
-    LuciObject *val = NULL;
-
-    if (map->count < (map->size * 0.2)) {
-        map_shrink(map);
-    }
-
-    uint32_t hash0 = key->type->hash0(key);
-    uint32_t hash1 = key->type->hash1(key);
-
-    /* First, find the object to remove */
-    unsigned int i, idx;
-    for (i = 0; i < map->size; i++) {
-        idx = GET_INDEX(hash0, hash1, i, map->size);
-
-        if (!map->keys[idx]) {
-            /* if we ever find a null slot, it's not in the table */
-            return NULL;
-        } else if (strcmp(
-                    AS_STRING(map->keys[idx])->s,
-                    AS_STRING(key)->s) == 0) {
-            /* TODO: use proper LuciStringObj comparison */
-            val = map->vals[idx];
-            map->count--;
-            map->keys[idx] = NULL;
-            map->vals[idx] = NULL;
-            break;
-        } else {
-            /* the object at this index possibly needs to be re-inserted */
-            ;
-        }
+    long slot = map_find(map, key, map_hash(key));
+    if (slot < 0) {
+        return NULL;
     }
 
-    /* now clean up the table */
-    LuciObject *key_to_move, *val_to_move;
-    for (i = 0; i < map->size; i++) {
-        idx = GET_INDEX(hash0, hash1, i, map->size);
+    LuciMapEntry *entry = &map->entries[map->slots[slot]];
+    LuciObject *val = entry->val;
+    entry->key = NULL;
+    entry->val = NULL;
+    map->count--;
 
-        if (!map->keys[idx]) {
-            break;
-        }
-        /* else, delete and reinsert all objects following the
-         * newly deleted one. This ensures that all objects are
-         * as close as possible to their hash-index on each call
-         * to LuciMap_cput.
-         *
-         * The alternative method would be to keep track of them
-         * in the first loop when searching for the original
-         * object to remove */
-        else {
-            key_to_move = map->keys[idx];
-            val_to_move = map->vals[idx];
-            map->keys[idx] = NULL;
-            map->vals[idx] = NULL;
-            LuciMap_cput((LuciObject *)map, key_to_move, val_to_move);
-        }
+    const uint8_t *group = map->ctrl + (slot & ~(MAP_GROUP_SIZE - 1));
+    if (map_group_match(group, MAP_CTRL_EMPTY)) {
+        map->ctrl[slot] = MAP_CTRL_EMPTY;
+    } else {
+        map->ctrl[slot] = MAP_CTRL_DELETED;
     }
 
     return val;
@@ -557,18 +727,24 @@ LuciObject *LuciMap_cdel(LuciObject *o, LuciObject *key)
  */
 void LuciMap_print(LuciObject *in)
 {
-    int i;
+    unsigned int i;
     printf("{");
-    for (i = 0; i < AS_MAP(in)->size; i++) {
-        if (AS_MAP(in)->keys[i]) {
-            LuciObject *key = AS_MAP(in)->keys[i];
-            LuciObject *val = AS_MAP(in)->vals[i];
+    for (i = 0; i < AS_MAP(in)->used; i++) {
+        LuciObject *key = AS_MAP(in)->entries[i].key;
+        LuciObject *val = AS_MAP(in)->entries[i].val;
+        if (!key) {
+            continue;
+        }
+        if (ISTYPE(key, obj_string_t)) {
+            printf("\"");
+            key->type->print(key);
             printf("\"");
+        } else {
             key->type->print(key);
-            printf("\":");
-            val->type->print(val);
-            printf(", ");
         }
+        printf(":");
+        val->type->print(val);
+        printf(", ");
     }
     printf("}");
 }
@@ -583,10 +759,10 @@ void LuciMap_print(LuciObject *in)
 void LuciMap_mark(LuciObject *in)
 {
     LuciMapObj *map = AS_MAP(in);
-    int i;
-    for (i = 0; i < map->size; i++) {
-        LuciObject *key = map->keys[i];
-        LuciObject *val = map->vals[i];
+    unsigned int i;
+    for (i = 0; i < map->used; i++) {
+        LuciObject *key = map->entries[i].key;
+        LuciObject *val = map->entries[i].val;
         if (key) {
             key->type->mark(key);
             val->type->mark(val);
@@ -598,12 +774,13 @@ void LuciMap_mark(LuciObject *in)
 /**
  * Finalizes a LuciMapObj
  *
- * frees keys and values arrays
+ * frees the control bytes, slots and entries arrays
  *
  * @param in LuciMapObj
  */
 void LuciMap_finalize(LuciObject *in)
 {
-    free(AS_MAP(in)->keys);
-    free(AS_MAP(in)->vals);
+    free(AS_MAP(in)->ctrl);
+    free(AS_MAP(in)->slots);
+    free(AS_MAP(in)->entries);
 }
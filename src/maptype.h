@@ -11,25 +11,37 @@
 
 #include "lucitypes.h"
 
-#define INIT_MAP_SIZE 8     /**< initial allocated size of a map */
+#define MAP_GROUP_SIZE 16   /**< number of control bytes probed at once */
+#define INIT_MAP_SIZE 16    /**< initial number of slots in a map (one group) */
 
 extern LuciObjectType obj_map_t;
 
+/** A key/value pair and the key's cached hash */
+typedef struct LuciMapEntry_ {
+    uint64_t hash;      /**< 64-bit hash of key */
+    LuciObject *key;    /**< pointer to key */
+    LuciObject *val;    /**< pointer to value */
+} LuciMapEntry;
+
 /** Map object type */
 typedef struct LuciMap_ {
     LuciObject base;    /**< base implementation */
-    LuciObject **keys;  /**< array of pointers to keys */
-    LuciObject **vals;  /**< array of pointers to values */
-    unsigned int size_idx;  /**< identifier for current size of table */
-    unsigned int collisions;    /**< number of hash collisions */
-    unsigned int count;	/**< current number of key/value pairs */
-    unsigned int size;	/**< current count of allocated pairs*/
+    uint8_t *ctrl;      /**< one control byte per slot: empty, or the low
+                             7 bits of the hash of the slot's key */
+    uint32_t *slots;    /**< index into entries of each slot's pair */
+    LuciMapEntry *entries;  /**< key/value pairs, in insertion order
+                                 (removed pairs have a NULL key) */
+    unsigned int count; /**< current number of key/value pairs */
+    unsigned int used;  /**< number of entries used, including the holes
+                             left by removed pairs */
+    unsigned int size;  /**< current number of slots (a power of 2) */
 } LuciMapObj;
 
 /** casts LuciObject o to a LuciMapObj */
 #define AS_MAP(o)       ((LuciMapObj *)(o))
 
 LuciObject* LuciMap_new();
+LuciObject *LuciMap_new_sized(unsigned int count);
 LuciObject* LuciMap_copy(LuciObject *);
 LuciObject* LuciMap_deepcopy(LuciObject *);
 LuciObject* LuciMap_asbool(LuciObject *);
@@ -38,6 +50,8 @@ LuciObject* LuciMap_add(LuciObject *, LuciObject *);
 LuciObject* LuciMap_eq(LuciObject *, LuciObject *);
 LuciObject* LuciMap_contains(LuciObject *m, LuciObject *o);
 LuciObject* LuciMap_next(LuciObject *, LuciObject *);
+LuciObject *LuciMap_next_pair(LuciObject *, LuciObject *, LuciObject **);
+LuciObject *LuciMap_get(LuciObject *map, LuciObject *key);
 LuciObject *LuciMap_cput(LuciObject *map, LuciObject *key, LuciObject *val);
 LuciObject *LuciMap_cget(LuciObject *map, LuciObject *key);
 LuciObject *LuciMap_cdel(LuciObject *map, LuciObject *key);
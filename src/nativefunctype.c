@@ -13,6 +13,7 @@
 LuciObjectType obj_libfunc_t = {
     "libfunction",
     sizeof(LuciLibFuncObj),
+    TYPEID_LIBFUNC,
 
     LuciLibFunc_copy,
     LuciLibFunc_copy,
@@ -91,7 +92,7 @@ LuciObject *LuciLibFunc_copy(LuciObject *orig)
  */
 LuciObject* LuciLibFunc_asbool(LuciObject *o)
 {
-    return LuciInt_new(true);
+    return LuciTrueObj;
 }
 
 /**
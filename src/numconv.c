@@ -0,0 +1,676 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file numconv.c
+ *
+ * Conversion of numbers to and from decimal strings.
+ *
+ * Longs are written two digits at a time from a table of digit
+ * pairs, after counting their digits with a leading-zero count
+ * instead of a division per digit.
+ *
+ * Doubles are written with the fewest digits that read back as the
+ * same double, using Florian Loitsch's Grisu3 ("Printing
+ * Floating-Point Numbers Quickly and Accurately with Integers",
+ * PLDI 2010). Grisu3 gives up on about 0.5% of doubles, where its
+ * 64-bit arithmetic can't tell which digits are shortest; those are
+ * shortened a digit at a time with snprintf and strtod instead.
+ * Output matches Python's repr: "2.5", "3.0", "1e+16", "1.5e-05".
+ *
+ * Parsing handles the common case without libc: a long of up to 18
+ * digits is accumulated directly, and a double whose significand fits
+ * in 53 bits and whose decimal exponent is at most 22 is computed
+ * exactly with a single multiplication or division by a power of 10
+ * (Clinger's fast path). Anything else falls back to strtod, which
+ * rounds correctly.
+ */
+
+#include "numconv.h"
+
+/** "00" through "99", indexed by twice a two-digit number */
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/** powers of 10 that fit in a uint64_t */
+static const uint64_t pow10_u64[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL
+};
+
+/** powers of 10 that are exact in a double */
+static const double pow10_exact[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * Returns the number of decimal digits in v
+ */
+static int count_digits(uint64_t v)
+{
+    /* 1233 / 4096 approximates log10(2) */
+    int n;
+
+    v |= 1;     /* 0 has one digit, like 1 */
+    n = ((64 - __builtin_clzll(v)) * 1233) >> 12;
+    return n + (n < 20 && v >= pow10_u64[n]);
+}
+
+/**
+ * Writes the n decimal digits of v ending just before end
+ */
+static void write_digits(char *end, uint64_t v)
+{
+    while (v >= 100) {
+        const char *pair = digit_pairs + (v % 100) * 2;
+        v /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    if (v >= 10) {
+        *--end = digit_pairs[v * 2 + 1];
+        *--end = digit_pairs[v * 2];
+    } else {
+        *--end = '0' + v;
+    }
+}
+
+/**
+ * Writes a long in decimal
+ *
+ * @param buf room for NUMCONV_LONG_SIZE chars
+ * @param v value
+ * @returns length of the nul-terminated string in buf
+ */
+int numconv_format_long(char *buf, long v)
+{
+    uint64_t m = v < 0 ? -(uint64_t)v : (uint64_t)v;
+    int neg = v < 0;
+    int len = neg + count_digits(m);
+
+    buf[0] = '-';
+    write_digits(buf + len, m);
+    buf[len] = '\0';
+    return len;
+}
+
+/** A floating-point number f * 2^e with a 64-bit significand */
+typedef struct {
+    uint64_t f;
+    int e;
+} DiyFp;
+
+#define DP_SIGNIFICAND_BITS 52
+#define DP_HIDDEN_BIT       ((uint64_t)1 << DP_SIGNIFICAND_BITS)
+#define DP_SIGNIFICAND_MASK (DP_HIDDEN_BIT - 1)
+#define DP_EXPONENT_BIAS    (0x3FF + DP_SIGNIFICAND_BITS)
+
+/**
+ * Normalized 64-bit significands and binary exponents of
+ * 10^-348, 10^-340, ..., 10^340
+ */
+static const DiyFp cached_powers[87] = {
+    {0xfa8fd5a0081c0288ULL, -1220}, {0xbaaee17fa23ebf76ULL, -1193},
+    {0x8b16fb203055ac76ULL, -1166}, {0xcf42894a5dce35eaULL, -1140},
+    {0x9a6bb0aa55653b2dULL, -1113}, {0xe61acf033d1a45dfULL, -1087},
+    {0xab70fe17c79ac6caULL, -1060}, {0xff77b1fcbebcdc4fULL, -1034},
+    {0xbe5691ef416bd60cULL, -1007}, {0x8dd01fad907ffc3cULL, -980},
+    {0xd3515c2831559a83ULL, -954}, {0x9d71ac8fada6c9b5ULL, -927},
+    {0xea9c227723ee8bcbULL, -901}, {0xaecc49914078536dULL, -874},
+    {0x823c12795db6ce57ULL, -847}, {0xc21094364dfb5637ULL, -821},
+    {0x9096ea6f3848984fULL, -794}, {0xd77485cb25823ac7ULL, -768},
+    {0xa086cfcd97bf97f4ULL, -741}, {0xef340a98172aace5ULL, -715},
+    {0xb23867fb2a35b28eULL, -688}, {0x84c8d4dfd2c63f3bULL, -661},
+    {0xc5dd44271ad3cdbaULL, -635}, {0x936b9fcebb25c996ULL, -608},
+    {0xdbac6c247d62a584ULL, -582}, {0xa3ab66580d5fdaf6ULL, -555},
+    {0xf3e2f893dec3f126ULL, -529}, {0xb5b5ada8aaff80b8ULL, -502},
+    {0x87625f056c7c4a8bULL, -475}, {0xc9bcff6034c13053ULL, -449},
+    {0x964e858c91ba2655ULL, -422}, {0xdff9772470297ebdULL, -396},
+    {0xa6dfbd9fb8e5b88fULL, -369}, {0xf8a95fcf88747d94ULL, -343},
+    {0xb94470938fa89bcfULL, -316}, {0x8a08f0f8bf0f156bULL, -289},
+    {0xcdb02555653131b6ULL, -263}, {0x993fe2c6d07b7facULL, -236},
+    {0xe45c10c42a2b3b06ULL, -210}, {0xaa242499697392d3ULL, -183},
+    {0xfd87b5f28300ca0eULL, -157}, {0xbce5086492111aebULL, -130},
+    {0x8cbccc096f5088ccULL, -103}, {0xd1b71758e219652cULL, -77},
+    {0x9c40000000000000ULL, -50}, {0xe8d4a51000000000ULL, -24},
+    {0xad78ebc5ac620000ULL, 3}, {0x813f3978f8940984ULL, 30},
+    {0xc097ce7bc90715b3ULL, 56}, {0x8f7e32ce7bea5c70ULL, 83},
+    {0xd5d238a4abe98068ULL, 109}, {0x9f4f2726179a2245ULL, 136},
+    {0xed63a231d4c4fb27ULL, 162}, {0xb0de65388cc8ada8ULL, 189},
+    {0x83c7088e1aab65dbULL, 216}, {0xc45d1df942711d9aULL, 242},
+    {0x924d692ca61be758ULL, 269}, {0xda01ee641a708deaULL, 295},
+    {0xa26da3999aef774aULL, 322}, {0xf209787bb47d6b85ULL, 348},
+    {0xb454e4a179dd1877ULL, 375}, {0x865b86925b9bc5c2ULL, 402},
+    {0xc83553c5c8965d3dULL, 428}, {0x952ab45cfa97a0b3ULL, 455},
+    {0xde469fbd99a05fe3ULL, 481}, {0xa59bc234db398c25ULL, 508},
+    {0xf6c69a72a3989f5cULL, 534}, {0xb7dcbf5354e9beceULL, 561},
+    {0x88fcf317f22241e2ULL, 588}, {0xcc20ce9bd35c78a5ULL, 614},
+    {0x98165af37b2153dfULL, 641}, {0xe2a0b5dc971f303aULL, 667},
+    {0xa8d9d1535ce3b396ULL, 694}, {0xfb9b7cd9a4a7443cULL, 720},
+    {0xbb764c4ca7a44410ULL, 747}, {0x8bab8eefb6409c1aULL, 774},
+    {0xd01fef10a657842cULL, 800}, {0x9b10a4e5e9913129ULL, 827},
+    {0xe7109bfba19c0c9dULL, 853}, {0xac2820d9623bf429ULL, 880},
+    {0x80444b5e7aa7cf85ULL, 907}, {0xbf21e44003acdd2dULL, 933},
+    {0x8e679c2f5e44ff8fULL, 960}, {0xd433179d9c8cb841ULL, 986},
+    {0x9e19db92b4e31ba9ULL, 1013}, {0xeb96bf6ebadf77d9ULL, 1039},
+    {0xaf87023b9bf0ee6bULL, 1066}
+};
+
+/**
+ * Multiplies two DiyFps, keeping the rounded high 64 bits
+ */
+static DiyFp diyfp_mul(DiyFp x, DiyFp y)
+{
+    const uint64_t M32 = 0xFFFFFFFFU;
+    uint64_t a = x.f >> 32, b = x.f & M32;
+    uint64_t c = y.f >> 32, d = y.f & M32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t mid = (bd >> 32) + (ad & M32) + (bc & M32) + (1U << 31);
+    DiyFp r;
+
+    r.f = ac + (ad >> 32) + (bc >> 32) + (mid >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+/**
+ * Shifts a DiyFp left until the top bit of its significand is set
+ */
+static DiyFp diyfp_normalize(DiyFp x)
+{
+    int s = __builtin_clzll(x.f);
+    x.f <<= s;
+    x.e -= s;
+    return x;
+}
+
+/**
+ * Splits a finite, positive double into a DiyFp
+ */
+static DiyFp diyfp_from_double(double d)
+{
+    uint64_t bits;
+    DiyFp r;
+
+    memcpy(&bits, &d, sizeof(bits));
+    int biased = (int)((bits >> DP_SIGNIFICAND_BITS) & 0x7FF);
+    r.f = bits & DP_SIGNIFICAND_MASK;
+    if (biased) {
+        r.f += DP_HIDDEN_BIT;
+        r.e = biased - DP_EXPONENT_BIAS;
+    } else {
+        r.e = 1 - DP_EXPONENT_BIAS;
+    }
+    return r;
+}
+
+/**
+ * Computes the boundaries halfway between v and its neighbouring
+ * doubles, with the same exponent and the upper one normalized
+ */
+static void diyfp_boundaries(DiyFp v, DiyFp *minus, DiyFp *plus)
+{
+    DiyFp pl, mi;
+
+    pl.f = (v.f << 1) + 1;
+    pl.e = v.e - 1;
+    pl = diyfp_normalize(pl);
+    if (v.f == DP_HIDDEN_BIT && v.e > 1 - DP_EXPONENT_BIAS) {
+        /* the gap below a power of 2 is half the gap above it */
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    } else {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *minus = mi;
+    *plus = pl;
+}
+
+/**
+ * Finds a cached power of 10, c = 10^-k, that brings a DiyFp with
+ * binary exponent e into the range Grisu works in
+ *
+ * @param k receives the negated decimal exponent of c
+ */
+static DiyFp cached_power(int e, int *k)
+{
+    /* 0.30102999566398114 = log10(2) */
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    if (dk - ik > 0.0) {
+        ik++;
+    }
+    unsigned int index = (unsigned int)((ik >> 3) + 1);
+    *k = -(-348 + (int)index * 8);
+    return cached_powers[index];
+}
+
+/**
+ * Nudges the last digit down while that brings the result closer to
+ * w, then checks that the digits are certainly the closest shortest
+ * ones
+ *
+ * Every value is scaled so that unit bounds the error in w and in the
+ * boundaries: high is the distance from w to the upper boundary,
+ * interval the width of the rounding interval, rest the distance from
+ * the digits to the upper boundary and ten_kappa the weight of the
+ * last digit.
+ *
+ * @returns false if the error could have changed the digits
+ */
+static bool grisu_round_weed(char *buf, int len, uint64_t high,
+        uint64_t interval, uint64_t rest, uint64_t ten_kappa, uint64_t unit)
+{
+    uint64_t small = high - unit, big = high + unit;
+
+    while (rest < small && interval - rest >= ten_kappa &&
+            (rest + ten_kappa < small ||
+             small - rest >= rest + ten_kappa - small)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+    /* if w is really as high as it could be, one more step is closer */
+    if (rest < big && interval - rest >= ten_kappa &&
+            (rest + ten_kappa < big ||
+             big - rest > rest + ten_kappa - big)) {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= interval - 4 * unit;
+}
+
+/**
+ * Generates the shortest digits within the boundaries mm and mp that
+ * are closest to w
+ *
+ * The boundaries are widened by their possible error, so that no
+ * shorter digits are missed, and grisu_round_weed rejects digits that
+ * might lie outside the real interval.
+ *
+ * @returns false if the digits can't be trusted
+ */
+static bool grisu_digits(DiyFp mm, DiyFp w, DiyFp mp, char *buf,
+        int *len, int *k)
+{
+    DiyFp one;
+    one.f = (uint64_t)1 << -w.e;
+    one.e = w.e;
+
+    uint64_t unit = 1;
+    uint64_t too_high = mp.f + unit;
+    uint64_t interval = too_high - (mm.f - unit);
+    uint32_t p1 = (uint32_t)(too_high >> -one.e);
+    uint64_t p2 = too_high & (one.f - 1);
+    int kappa = count_digits(p1);
+
+    *len = 0;
+    while (kappa > 0) {
+        uint32_t d = (uint32_t)(p1 / pow10_u64[kappa - 1]);
+        p1 %= (uint32_t)pow10_u64[kappa - 1];
+        if (d || *len) {
+            buf[(*len)++] = '0' + d;
+        }
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest < interval) {
+            *k += kappa;
+            return grisu_round_weed(buf, *len, too_high - w.f, interval,
+                    rest, pow10_u64[kappa] << -one.e, unit);
+        }
+    }
+
+    for (;;) {
+        p2 *= 10;
+        unit *= 10;
+        interval *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d || *len) {
+            buf[(*len)++] = '0' + d;
+        }
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < interval) {
+            *k += kappa;
+            return grisu_round_weed(buf, *len, (too_high - w.f) * unit,
+                    interval, p2, one.f, unit);
+        }
+    }
+}
+
+/**
+ * Writes the shortest digits of a finite, positive double, closest to
+ * it among the shortest
+ *
+ * @param buf room for 18 digits
+ * @param len receives the number of digits
+ * @param k receives the decimal exponent: d = digits * 10^k
+ * @returns false if Grisu3 couldn't be sure of the digits
+ */
+static bool grisu3(double d, char *buf, int *len, int *k)
+{
+    DiyFp v = diyfp_from_double(d);
+    DiyFp w_m, w_p;
+
+    diyfp_boundaries(v, &w_m, &w_p);
+    DiyFp c_mk = cached_power(w_p.e, k);
+    DiyFp w = diyfp_mul(diyfp_normalize(v), c_mk);
+    DiyFp wp = diyfp_mul(w_p, c_mk);
+    DiyFp wm = diyfp_mul(w_m, c_mk);
+
+    return grisu_digits(wm, w, wp, buf, len, k);
+}
+
+/**
+ * Determines whether digits * 10^k reads back as d
+ */
+static bool digits_read_back(double d, const char *digits, int len, int k)
+{
+    char s[NUMCONV_DOUBLE_SIZE];
+
+    snprintf(s, sizeof(s), "%.*se%d", len, digits, k);
+    return strtod(s, NULL) == d;
+}
+
+/**
+ * Writes the decimal of len digits nearest to d, or the next one up,
+ * if either reads back as d
+ *
+ * Below a power of 2 the rounding interval is narrower, so the
+ * nearest decimal may miss it while the one above doesn't. Some
+ * decimal of len digits reads back exactly when one of these does.
+ *
+ * @param buf room for len digits
+ * @param k receives the decimal exponent: d = digits * 10^k
+ * @returns true if the digits read back as d
+ */
+static bool digits_of_length(double d, int len, char *buf, int *k)
+{
+    char s[NUMCONV_DOUBLE_SIZE];
+    int i;
+
+    /* "D.DDDe+XX", or "De+XX" for one digit */
+    snprintf(s, sizeof(s), "%.*e", len - 1, d);
+    buf[0] = s[0];
+    memcpy(buf + 1, s + 2, len - 1);
+    *k = atoi(strchr(s, 'e') + 1) - (len - 1);
+    if (digits_read_back(d, buf, len, *k)) {
+        return true;
+    }
+
+    for (i = len - 1; i >= 0 && buf[i] == '9'; i--) {
+        buf[i] = '0';
+    }
+    if (i < 0) {
+        buf[0] = '1';
+        (*k)++;
+    } else {
+        buf[i]++;
+    }
+    return digits_read_back(d, buf, len, *k);
+}
+
+/**
+ * Writes the shortest digits of a finite, positive double with libc,
+ * for the few doubles Grisu3 can't be sure of
+ *
+ * Starts from 17 digits, which always read back, and drops a digit
+ * at a time until the shorter decimal no longer reads back as d.
+ *
+ * @param buf room for 18 digits
+ * @param k receives the decimal exponent: d = digits * 10^k
+ * @returns number of digits
+ */
+static int shortest_digits(double d, char *buf, int *k)
+{
+    char shorter[17];
+    int len = 17, shorter_k;
+
+    digits_of_length(d, len, buf, k);
+    while (len > 1 && digits_of_length(d, len - 1, shorter, &shorter_k)) {
+        len--;
+        memcpy(buf, shorter, len);
+        *k = shorter_k;
+    }
+    while (buf[len - 1] == '0') {
+        len--;
+        (*k)++;
+    }
+    return len;
+}
+
+/**
+ * Writes a double with the fewest digits that read back as the same
+ * double
+ *
+ * Uses positional notation for decimal exponents from -4 through 15,
+ * and scientific notation otherwise. Integral values keep a ".0".
+ *
+ * @param buf room for NUMCONV_DOUBLE_SIZE chars
+ * @param d value
+ * @returns length of the nul-terminated string in buf
+ */
+int numconv_format_double(char *buf, double d)
+{
+    char digits[20];
+    char *p = buf;
+    int len, k, exp10, i;
+
+    if (isnan(d)) {
+        memcpy(buf, "nan", 4);
+        return 3;
+    }
+    if (signbit(d)) {
+        *p++ = '-';
+        d = -d;
+    }
+    if (isinf(d)) {
+        memcpy(p, "inf", 4);
+        return p - buf + 3;
+    }
+    if (d == 0.0) {
+        memcpy(p, "0.0", 4);
+        return p - buf + 3;
+    }
+
+    if (!grisu3(d, digits, &len, &k)) {
+        len = shortest_digits(d, digits, &k);
+    }
+    /* exponent of the first digit */
+    exp10 = len + k - 1;
+
+    if (exp10 >= -4 && exp10 < 16) {
+        if (k >= 0) {
+            /* integral */
+            memcpy(p, digits, len);
+            p += len;
+            memset(p, '0', k);
+            p += k;
+            memcpy(p, ".0", 2);
+            p += 2;
+        } else if (exp10 >= 0) {
+            memcpy(p, digits, exp10 + 1);
+            p += exp10 + 1;
+            *p++ = '.';
+            memcpy(p, digits + exp10 + 1, len - exp10 - 1);
+            p += len - exp10 - 1;
+        } else {
+            *p++ = '0';
+            *p++ = '.';
+            for (i = exp10 + 1; i < 0; i++) {
+                *p++ = '0';
+            }
+            memcpy(p, digits, len);
+            p += len;
+        }
+    } else {
+        *p++ = digits[0];
+        if (len > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, len - 1);
+            p += len - 1;
+        }
+        *p++ = 'e';
+        *p++ = exp10 < 0 ? '-' : '+';
+        if (exp10 < 0) {
+            exp10 = -exp10;
+        }
+        if (exp10 >= 100) {
+            *p++ = '0' + exp10 / 100;
+            exp10 %= 100;
+        }
+        *p++ = digit_pairs[exp10 * 2];
+        *p++ = digit_pairs[exp10 * 2 + 1];
+    }
+    *p = '\0';
+    return p - buf;
+}
+
+/**
+ * Skips leading whitespace, as the scanf family does
+ */
+static const char *skip_space(const char *s)
+{
+    while (*s == ' ' || (*s >= '\t' && *s <= '\r')) {
+        s++;
+    }
+    return s;
+}
+
+/**
+ * Parses a decimal long of up to 18 digits
+ *
+ * Like sscanf's "%ld", skips leading whitespace, accepts a sign and
+ * stops at the first character that isn't a decimal digit.
+ *
+ * @param s C-string
+ * @param out receives the value
+ * @returns false if s has no digits or more than 18, in which case
+ *          the caller should parse it as a LuciBigIntObj instead
+ */
+bool numconv_parse_long(const char *s, long *out)
+{
+    uint64_t v = 0;
+    int neg = 0, n;
+
+    s = skip_space(s);
+    if (*s == '-' || *s == '+') {
+        neg = *s == '-';
+        s++;
+    }
+    for (n = 0; (unsigned char)(s[n] - '0') < 10; n++) {
+        if (n == 18) {
+            return false;
+        }
+        v = v * 10 + (s[n] - '0');
+    }
+    if (n == 0) {
+        return false;
+    }
+    *out = neg ? -(long)v : (long)v;
+    return true;
+}
+
+/**
+ * Parses a decimal double
+ *
+ * Like strtod, skips leading whitespace and stops at the first
+ * character that can't continue the number.
+ *
+ * @param s C-string
+ * @param out receives the value
+ * @returns false if s doesn't start with a number
+ */
+bool numconv_parse_double(const char *s, double *out)
+{
+    const char *start = s;
+    uint64_t mant = 0;
+    int neg = 0, seen = 0, ndigits = 0, exp10 = 0;
+
+    s = skip_space(s);
+    if (*s == '-' || *s == '+') {
+        neg = *s == '-';
+        s++;
+    }
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        goto slow;  /* hex float */
+    }
+
+    /* up to 19 significant digits fit in the uint64_t */
+    for (; (unsigned char)(*s - '0') < 10; s++) {
+        seen = 1;
+        if (mant == 0 && *s == '0') {
+            continue;   /* leading zeros aren't significant */
+        } else if (ndigits == 19) {
+            goto slow;
+        }
+        mant = mant * 10 + (*s - '0');
+        ndigits++;
+    }
+    if (*s == '.') {
+        for (s++; (unsigned char)(*s - '0') < 10; s++) {
+            seen = 1;
+            exp10--;
+            if (mant == 0 && *s == '0') {
+                continue;
+            } else if (ndigits == 19) {
+                goto slow;
+            }
+            mant = mant * 10 + (*s - '0');
+            ndigits++;
+        }
+    }
+    if (!seen) {
+        /* no digits at all, or inf, nan... */
+        goto slow;
+    }
+    if (*s == 'e' || *s == 'E') {
+        const char *e = s + 1;
+        int eneg = 0, ev = 0;
+        if (*e == '-' || *e == '+') {
+            eneg = *e == '-';
+            e++;
+        }
+        if ((unsigned char)(*e - '0') < 10) {
+            for (; (unsigned char)(*e - '0') < 10; e++) {
+                if (ev > 10000) {
+                    goto slow;
+                }
+                ev = ev * 10 + (*e - '0');
+            }
+            exp10 += eneg ? -ev : ev;
+        }
+    }
+
+    if (mant <= ((uint64_t)1 << 53) && exp10 >= -22 && exp10 <= 22) {
+        /* both the significand and the power of 10 are exact, so a
+         * single correctly-rounded operation gives the right answer */
+        double d = (double)mant;
+        d = exp10 < 0 ? d / pow10_exact[-exp10] : d * pow10_exact[exp10];
+        *out = neg ? -d : d;
+        return true;
+    }
+
+slow:
+    {
+        char *end;
+        *out = strtod(start, &end);
+        return end != start;
+    }
+}
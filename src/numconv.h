@@ -0,0 +1,24 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file numconv.h
+ */
+
+#ifndef LUCI_NUMCONV_H
+#define LUCI_NUMCONV_H
+
+#include "luci.h"
+
+/** buffer size that holds any long formatted by numconv_format_long */
+#define NUMCONV_LONG_SIZE       24
+/** buffer size that holds any double formatted by numconv_format_double */
+#define NUMCONV_DOUBLE_SIZE     32
+
+int numconv_format_long(char *buf, long v);
+int numconv_format_double(char *buf, double d);
+bool numconv_parse_long(const char *s, long *out);
+bool numconv_parse_double(const char *s, double *out);
+
+#endif /* LUCI_NUMCONV_H */
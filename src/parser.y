@@ -44,12 +44,13 @@ AstNode *g_root_node = NULL;
 %type <node> func_def params return
 %type <node> map_items map_keyval map
 %type <node> list_items list
+%type <node> tuple_items tuple unpack_names
 %type <node> container_index container_access container_assign
 %type <node> program
 
 %token <int_v> INT
 %token <float_v> FLOAT
-%token <string_v> STRING ID
+%token <string_v> STRING ID BIGINT
 
 %token NEWLINE COLON SEMICOLON COMMA
 %token WHILE FOR IN
@@ -96,6 +97,8 @@ statement:
     |   expr SEMICOLON              { $$ = $1; }
     |   container_assign SEMICOLON  { $$ = $1; }
     |   assignment SEMICOLON        { $$ = $1; }
+    |   unpack_names ASSIGN expr SEMICOLON
+                { $$ = make_unpack($1, $3); }
     |   return SEMICOLON            { $$ = $1; }
     |   BREAK SEMICOLON             { $$ = make_break(); }
     |   CONTINUE SEMICOLON          { $$ = make_continue(); }
@@ -110,7 +113,9 @@ while_loop:
 
 for_loop:
         FOR ID IN expr LBRACK statements RBRACK
-                { $$ = make_for_loop($2, $4, $6); }
+                { $$ = make_for_loop($2, NULL, $4, $6); }
+    |   FOR ID COMMA ID IN expr LBRACK statements RBRACK
+                { $$ = make_for_loop($2, $4, $6, $8); }
     ;
 
 if_else:
@@ -170,6 +175,25 @@ list_items:
     |   list_items COMMA expr   { $$ = make_list_def($1, $3); }
     ;
 
+tuple:
+        LPAREN RPAREN                   { $$ = make_tuple_def(make_list_def(NULL, NULL)); }
+    |   LPAREN expr COMMA RPAREN        { $$ = make_tuple_def(make_list_def(NULL, $2)); }
+    |   LPAREN tuple_items RPAREN       { $$ = make_tuple_def($2); }
+    ;
+
+tuple_items:
+        expr COMMA expr         { $$ = make_list_def(make_list_def(NULL, $1), $3); }
+    |   tuple_items COMMA expr  { $$ = make_list_def($1, $3); }
+    ;
+
+unpack_names:
+        ID COMMA ID
+                { $$ = make_list_def(make_list_def(NULL,
+                            make_string_constant($1)), make_string_constant($3)); }
+    |   unpack_names COMMA ID
+                { $$ = make_list_def($1, make_string_constant($3)); }
+    ;
+
 assignment:
         ID ASSIGN expr
                 { $$ = make_assignment($1, $3); }
@@ -196,6 +220,7 @@ id:     ID                      { $$ = make_id_expr($1); }
 expr:
         NIL                     { $$ = make_nil_expression(); }
     |   INT                     { $$ = make_int_constant($1); }
+    |   BIGINT                  { $$ = make_bigint_constant($1); }
     |   FLOAT                   { $$ = make_float_constant($1); }
     |   STRING                  { $$ = make_string_constant($1); }
     |   id                      { $$ = $1; }
@@ -243,6 +268,7 @@ expr:
     |   container_access        { $$ = $1; }
     |   map                     { $$ = $1; }
     |   list                    { $$ = $1; }
+    |   tuple                   { $$ = $1; }
     |   call                    { $$ = $1; }
     ;
 
@@ -0,0 +1,401 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file peephole.c
+ *
+ * Bytecode cleanup, run on a CompileState before it becomes a function.
+ *
+ * The compiler emits code one AST node at a time, so nested blocks
+ * leave jumps to jumps, statements after a return, values stored then
+ * immediately reloaded and values pushed only to be popped. The pass
+ * decodes the instructions, with jump offsets made absolute, and
+ * repeats these rules until none applies:
+ *
+ * - a jump to an unconditional JUMP goes straight to its final target,
+ *   and a JUMP to a RETURN or HALT becomes that instruction
+ * - a constant condition (LOADK, then JUMPZ or JUMPNZ) becomes a JUMP
+ *   or nothing
+ * - instructions that can't be reached from the first are removed
+ * - a JUMP to the next instruction and NOPs are removed, and a
+ *   conditional jump to the next instruction becomes a POP
+ * - a push with no side effects followed by a POP is removed
+ * - STORE x, LOADS x becomes DUP, STORE x
+ *
+ * The second instruction of a pair is only rewritten when no jump
+ * lands on it. After each round the live instructions are packed
+ * together and every jump target renumbered, and the result is
+ * encoded with relative offsets again.
+ */
+
+#include "luci.h"
+#include "peephole.h"
+#include "lucitypes.h"
+#include "inttype.h"
+
+/** totals reported by `luci -p` */
+PeepholeStats peephole_stats;
+
+/**
+ * A decoded instruction
+ */
+typedef struct peep_instr_ {
+    Opcode op;      /**< opcode */
+    int arg;        /**< argument, or absolute address for jumps */
+    bool live;      /**< false once the instruction is removed */
+    bool target;    /**< true if a live jump lands here */
+    bool reached;   /**< used while finding unreachable code */
+} PeepInstr;
+
+/** returns 1 if the opcode takes a jump target as its argument */
+#define IS_JUMP(op)     ((op) >= JUMP)
+
+
+/**
+ * Returns the address of the first live instruction at or after addr
+ *
+ * @returns n if there is none
+ */
+static uint32_t next_live(PeepInstr *code, uint32_t n, uint32_t addr)
+{
+    while (addr < n && !code[addr].live) {
+        addr++;
+    }
+    return addr;
+}
+
+/**
+ * Flags every instruction that a live jump lands on
+ */
+static void mark_targets(PeepInstr *code, uint32_t n)
+{
+    uint32_t i, t;
+
+    for (i = 0; i < n; i++) {
+        code[i].target = false;
+    }
+    for (i = 0; i < n; i++) {
+        if (code[i].live && IS_JUMP(code[i].op)) {
+            t = next_live(code, n, code[i].arg);
+            if (t < n) {
+                code[t].target = true;
+            }
+        }
+    }
+}
+
+/**
+ * Points each jump past any unconditional JUMPs it would land on
+ *
+ * A JUMP that lands on a RETURN or HALT is replaced by a copy of it.
+ *
+ * @returns true if any instruction changed
+ */
+static bool thread_jumps(PeepInstr *code, uint32_t n)
+{
+    uint32_t i, t, hops;
+    bool changed = false;
+
+    for (i = 0; i < n; i++) {
+        if (!code[i].live || !IS_JUMP(code[i].op)) {
+            continue;
+        }
+        t = next_live(code, n, code[i].arg);
+        /* bounded, since a loop of JUMPs never leads anywhere */
+        for (hops = 0; t < n && code[t].op == JUMP && hops < n; hops++) {
+            t = next_live(code, n, code[t].arg);
+        }
+        if (t < n && code[i].op == JUMP &&
+                (code[t].op == RETURN || code[t].op == HALT)) {
+            code[i].op = code[t].op;
+            code[i].arg = 0;
+            changed = true;
+        } else if (t != next_live(code, n, code[i].arg)) {
+            code[i].arg = t;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Returns the truth value of constant o as the conditional jumps test
+ * it: 1, 0, or -1 if it can't be tested at compile time
+ */
+static int constant_truth(LuciObject *o)
+{
+    if (!ISTYPE(o, obj_int_t)) {
+        if (!o->type->asbool) {
+            return -1;
+        }
+        o = o->type->asbool(o);
+        if (!ISTYPE(o, obj_int_t)) {
+            return -1;
+        }
+    }
+    return AS_INT(o)->i != 0;
+}
+
+/**
+ * Resolves each conditional jump testing a constant pushed just before it
+ *
+ * Expects mark_targets to be current.
+ *
+ * @returns true if any instruction changed
+ */
+static bool fold_conditions(PeepInstr *code, uint32_t n,
+        ConstantTable *ctable)
+{
+    uint32_t i, j;
+    bool changed = false;
+    int truth;
+
+    for (i = 0; i < n; i++) {
+        if (!code[i].live || code[i].op != LOADK) {
+            continue;
+        }
+        j = next_live(code, n, i + 1);
+        if (j >= n || (code[j].op != JUMPZ && code[j].op != JUMPNZ) ||
+                code[j].target) {
+            continue;
+        }
+        truth = constant_truth(ctable->objects[code[i].arg]);
+        if (truth < 0) {
+            continue;
+        }
+        code[i].live = false;
+        if (truth == (code[j].op == JUMPNZ)) {
+            code[j].op = JUMP;
+        } else {
+            code[j].live = false;
+        }
+        changed = true;
+    }
+    return changed;
+}
+
+/**
+ * Removes every instruction that no path from the first one reaches
+ *
+ * @param work scratch space for n addresses
+ * @returns true if any instruction was removed
+ */
+static bool remove_unreachable(PeepInstr *code, uint32_t n, uint32_t *work)
+{
+    uint32_t i, t, nwork = 0;
+    bool changed = false;
+
+    for (i = 0; i < n; i++) {
+        code[i].reached = false;
+    }
+
+    t = next_live(code, n, 0);
+    if (t < n) {
+        code[t].reached = true;
+        work[nwork++] = t;
+    }
+    while (nwork > 0) {
+        i = work[--nwork];
+        t = n;
+        if (IS_JUMP(code[i].op)) {
+            t = next_live(code, n, code[i].arg);
+            if (t < n && !code[t].reached) {
+                code[t].reached = true;
+                work[nwork++] = t;
+            }
+        }
+        switch (code[i].op) {
+            case JUMP:
+            case POPJUMP:
+            case RETURN:
+            case HALT:
+                /* never falls through */
+                continue;
+            default:
+                break;
+        }
+        t = next_live(code, n, i + 1);
+        if (t < n && !code[t].reached) {
+            code[t].reached = true;
+            work[nwork++] = t;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        if (code[i].live && !code[i].reached) {
+            code[i].live = false;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Applies the rules that look at one instruction and the next
+ *
+ * Expects mark_targets to be current.
+ *
+ * @returns true if any instruction changed
+ */
+static bool simplify(PeepInstr *code, uint32_t n)
+{
+    uint32_t i, j, prev = n;
+    bool changed = false;
+
+    for (i = 0; i < n; i++) {
+        if (!code[i].live) {
+            continue;
+        }
+        j = next_live(code, n, i + 1);
+
+        switch (code[i].op) {
+            case NOP:
+                code[i].live = false;
+                changed = true;
+                break;
+            case JUMP:
+                if (next_live(code, n, code[i].arg) == j) {
+                    code[i].live = false;
+                    changed = true;
+                }
+                break;
+            case POPJUMP:
+            case JUMPZ:
+            case JUMPNZ:
+                /* both paths continue at the same place, leaving
+                 * just the pop of the tested value */
+                if (next_live(code, n, code[i].arg) == j) {
+                    code[i].op = POP;
+                    code[i].arg = 0;
+                    changed = true;
+                }
+                break;
+            case PUSHNIL:
+            case LOADK:
+            case LOADS:
+            case LOADG:
+            case LOADB:
+            case DUP:
+                if (j < n && code[j].op == POP && !code[j].target) {
+                    code[i].live = false;
+                    code[j].live = false;
+                    changed = true;
+                }
+                break;
+            case STORE:
+                /* the STORE after an ITERJUMP is folded into it
+                 * by the interpreter, so it stays where it is */
+                if (j < n && code[j].op == LOADS &&
+                        code[j].arg == code[i].arg && !code[j].target &&
+                        !(prev < n && code[prev].op == ITERJUMP)) {
+                    code[j].op = STORE;
+                    code[i].op = DUP;
+                    code[i].arg = 0;
+                    changed = true;
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (code[i].live) {
+            prev = i;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Packs the live instructions together and renumbers jump targets
+ *
+ * @param map scratch space for n + 1 addresses
+ * @returns the new instruction count
+ */
+static uint32_t compact(PeepInstr *code, uint32_t n, uint32_t *map)
+{
+    uint32_t i, count = 0;
+
+    /* a removed instruction maps to the next live one */
+    for (i = 0; i < n; i++) {
+        map[i] = count;
+        if (code[i].live) {
+            count++;
+        }
+    }
+    map[n] = count;
+
+    for (i = 0; i < n; i++) {
+        if (code[i].live) {
+            if (IS_JUMP(code[i].op)) {
+                code[i].arg = map[code[i].arg];
+            }
+            code[map[i]] = code[i];
+        }
+    }
+    return count;
+}
+
+/**
+ * Optimizes the instructions of the given CompileState in place
+ *
+ * @param cs CompileState whose instructions are complete
+ * @returns the number of instructions removed
+ */
+uint32_t peephole_optimize(CompileState *cs)
+{
+    uint32_t i, n = cs->instr_count, removed;
+    PeepInstr *code;
+    uint32_t *work;
+    bool changed;
+
+    peephole_stats.before += n;
+    if (n == 0) {
+        return 0;
+    }
+
+    code = alloc(n * sizeof(*code));
+    work = alloc((n + 1) * sizeof(*work));
+
+    for (i = 0; i < n; i++) {
+        Instruction instr = cs->instructions[i];
+        code[i].op = OPCODE(instr);
+        code[i].arg = OPARG(instr);
+        if (IS_JUMP(code[i].op)) {
+            code[i].arg += i;
+        }
+        code[i].live = true;
+    }
+
+    do {
+        changed = thread_jumps(code, n);
+        mark_targets(code, n);
+        changed |= fold_conditions(code, n, cs->ctable);
+        changed |= remove_unreachable(code, n, work);
+        mark_targets(code, n);
+        changed |= simplify(code, n);
+        n = compact(code, n, work);
+    } while (changed);
+
+    for (i = 0; i < n; i++) {
+        int arg = code[i].arg;
+        Instruction instr = code[i].op << OPCODE_SHIFT;
+        /* jumps are relative, as written by the compiler */
+        if (IS_JUMP(code[i].op)) {
+            arg -= i;
+        }
+        if (arg < 0) {
+            arg = -arg;
+            instr |= OPARG_NEG_BIT;
+        }
+        cs->instructions[i] = instr | (OPARG_MASK & arg);
+    }
+
+    free(work);
+    free(code);
+
+    removed = cs->instr_count - n;
+    cs->instr_count = n;
+    peephole_stats.after += n;
+    return removed;
+}
@@ -0,0 +1,26 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file peephole.h
+ */
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "compile.h"
+
+/**
+ * Running totals over every CompileState given to peephole_optimize
+ */
+typedef struct peephole_stats_ {
+    uint32_t before;    /**< instructions emitted by the compiler */
+    uint32_t after;     /**< instructions left after optimizing */
+} PeepholeStats;
+
+extern PeepholeStats peephole_stats;
+
+uint32_t peephole_optimize(CompileState *);
+
+#endif
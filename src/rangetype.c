@@ -0,0 +1,368 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file rangetype.c
+ *
+ * The lazy integer sequence returned by range().
+ *
+ * A range stores only its start, step and length, so iterating over
+ * range(n) takes O(1) memory. Each integer is computed when it is
+ * requested. A range is immutable; list() converts it to a list.
+ */
+
+#include "rangetype.h"
+
+/** Type member table for LuciRangeObj */
+LuciObjectType obj_range_t = {
+    "range",
+    sizeof(LuciRangeObj),
+    TYPEID_RANGE,
+
+    LuciRange_copy,
+    LuciRange_copy,
+    unary_nil,
+    LuciRange_asbool,
+    LuciRange_len,
+    unary_nil,
+    LuciObject_lgnot,
+    unary_nil,
+
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    LuciRange_eq,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    LuciObject_lgor,
+    LuciObject_lgand,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+
+    LuciRange_contains,
+    LuciRange_next,
+    LuciRange_cget,
+
+    LuciRange_cput,
+
+    LuciRange_print,
+    LuciRange_mark,
+    NULL,       /* finalize */
+    NULL,       /* hash0 */
+    NULL        /* hash1 */
+};
+
+/**
+ * Creates a new LuciRangeObj
+ *
+ * The range holds start, start + step, start + 2 * step, ...
+ * up to but not including end.
+ *
+ * @param start first integer
+ * @param end integer at which to stop
+ * @param step non-zero increment
+ * @returns new LuciRangeObj
+ */
+LuciObject *LuciRange_new(long start, long end, long step)
+{
+    if (step == 0) {
+        LUCI_DIE("%s\n", "range() step must not be zero");
+    }
+
+    unsigned long count;
+
+    /* computed in unsigned arithmetic, since end - start may overflow */
+    if (step > 0 && start < end) {
+        count = ((unsigned long)end - start - 1) / step + 1;
+    } else if (step < 0 && start > end) {
+        count = ((unsigned long)start - end - 1) / (0 - (unsigned long)step) + 1;
+    } else {
+        count = 0;
+    }
+    if (count > LONG_MAX) {
+        LUCI_DIE("range() can't hold more than %ld integers\n", LONG_MAX);
+    }
+
+    LuciRangeObj *o = (LuciRangeObj*)gc_malloc(&obj_range_t);
+    o->start = start;
+    o->step = step;
+    o->count = count;
+    return (LuciObject *)o;
+}
+
+/**
+ * Returns the integer at an index in a LuciRangeObj
+ *
+ * @param r LuciRangeObj
+ * @param idx index in bounds
+ * @returns integer at idx
+ */
+static long range_at(LuciObject *r, long idx)
+{
+    return RANGE_AT(r, idx);
+}
+
+/**
+ * Materializes a LuciRangeObj as a LuciListObj
+ *
+ * @param r LuciRangeObj
+ * @returns new LuciListObj holding every integer in r
+ */
+LuciObject *LuciRange_to_list(LuciObject *r)
+{
+    LuciObject *list = LuciList_new_sized(AS_RANGE(r)->count);
+    long i;
+
+    for (i = 0; i < AS_RANGE(r)->count; i++) {
+        LuciList_append(list, LuciInt_new(range_at(r, i)));
+    }
+    return list;
+}
+
+/**
+ * Copies a LuciRangeObj
+ *
+ * Ranges are immutable, so they can always be shared.
+ *
+ * @param orig LuciRangeObj
+ * @returns orig
+ */
+LuciObject* LuciRange_copy(LuciObject *orig)
+{
+    return orig;
+}
+
+/**
+ * Returns a boolean representation of a LuciRangeObj
+ *
+ * @param o LuciRangeObj
+ * @returns LuciIntObj (true if not empty)
+ */
+LuciObject* LuciRange_asbool(LuciObject *o)
+{
+    return LuciBool(AS_RANGE(o)->count > 0);
+}
+
+/**
+ * Returns the length of a LuciRangeObj
+ *
+ * @param o LuciRangeObj
+ * @returns number of integers in o
+ */
+LuciObject* LuciRange_len(LuciObject *o)
+{
+    return LuciInt_new(AS_RANGE(o)->count);
+}
+
+/**
+ * Determines if two LuciRangeObjs hold the same integers
+ *
+ * @param a LuciRangeObj
+ * @param b LuciRangeObj
+ * @returns 1 if equal, 0 otherwise
+ */
+LuciObject* LuciRange_eq(LuciObject *a, LuciObject *b)
+{
+    if (!ISTYPE(b, obj_range_t)) {
+        LUCI_DIE("Cannot compare a range to an object of type %s\n",
+                b->type->type_name);
+    }
+
+    LuciRangeObj *x = AS_RANGE(a), *y = AS_RANGE(b);
+    if (x->count != y->count) {
+        return LuciFalseObj;
+    } else if (x->count == 0) {
+        return LuciTrueObj;
+    } else if (x->start != y->start) {
+        return LuciFalseObj;
+    }
+    /* the step is irrelevant if there is only one integer */
+    return LuciBool(x->count == 1 || x->step == y->step);
+}
+
+/**
+ * Sums the integers in a LuciRangeObj in O(1)
+ *
+ * @param r LuciRangeObj
+ * @returns LuciIntObj sum
+ */
+LuciObject* LuciRange_sum(LuciObject *r)
+{
+    long n = AS_RANGE(r)->count;
+    long start = AS_RANGE(r)->start, step = AS_RANGE(r)->step;
+    /* n * (n - 1) / 2, halving the even factor first */
+    long a = (n % 2 == 0) ? n / 2 : n;
+    long b = (n % 2 == 0) ? n - 1 : (n - 1) / 2;
+    long tri, first, rest, sum;
+
+    /* n * start + tri * step, continuing as objects if it overflows */
+    if (__builtin_mul_overflow(a, b, &tri) ||
+            __builtin_mul_overflow(n, start, &first) ||
+            __builtin_mul_overflow(tri, step, &rest) ||
+            __builtin_add_overflow(first, rest, &sum)) {
+        LuciObject *x = LuciInt_new(a), *y = LuciInt_new(n);
+        x = x->type->mul(x, LuciInt_new(b));
+        x = x->type->mul(x, LuciInt_new(step));
+        y = y->type->mul(y, LuciInt_new(start));
+        return y->type->add(y, x);
+    }
+    return LuciInt_new(sum);
+}
+
+/**
+ * Finds the smallest integer in a non-empty LuciRangeObj
+ *
+ * @param r LuciRangeObj
+ * @returns LuciIntObj minimum
+ */
+LuciObject* LuciRange_min(LuciObject *r)
+{
+    if (AS_RANGE(r)->count == 0) {
+        LUCI_DIE("%s\n", "Can't find min of an empty range");
+    }
+    return LuciInt_new(range_at(r, AS_RANGE(r)->step > 0 ?
+                0 : AS_RANGE(r)->count - 1));
+}
+
+/**
+ * Finds the largest integer in a non-empty LuciRangeObj
+ *
+ * @param r LuciRangeObj
+ * @returns LuciIntObj maximum
+ */
+LuciObject* LuciRange_max(LuciObject *r)
+{
+    if (AS_RANGE(r)->count == 0) {
+        LUCI_DIE("%s\n", "Can't find max of an empty range");
+    }
+    return LuciInt_new(range_at(r, AS_RANGE(r)->step > 0 ?
+                AS_RANGE(r)->count - 1 : 0));
+}
+
+/**
+ * Determines whether a LuciRangeObj contains an integer in O(1)
+ *
+ * @param r LuciRangeObj
+ * @param o object
+ * @returns 1 if r contains o, 0 otherwise
+ */
+LuciObject* LuciRange_contains(LuciObject *r, LuciObject *o)
+{
+    LuciRangeObj *range = AS_RANGE(r);
+
+    if (!ISTYPE(o, obj_int_t) || range->count == 0) {
+        return LuciFalseObj;
+    }
+
+    long x = AS_INT(o)->i;
+    unsigned long offset, step;
+    if (range->step > 0) {
+        if (x < range->start) {
+            return LuciFalseObj;
+        }
+        offset = (unsigned long)x - range->start;
+        step = range->step;
+    } else {
+        if (x > range->start) {
+            return LuciFalseObj;
+        }
+        offset = (unsigned long)range->start - x;
+        step = 0 - (unsigned long)range->step;
+    }
+    return LuciBool(offset % step == 0 &&
+            offset / step < (unsigned long)range->count);
+}
+
+/**
+ * Returns the 'next' integer in the range
+ *
+ * @param r LuciRangeObj
+ * @param idx index
+ * @returns integer at index idx or NULL if out of bounds
+ */
+LuciObject* LuciRange_next(LuciObject *r, LuciObject *idx)
+{
+    if (!ISTYPE(idx, obj_int_t)) {
+        LUCI_DIE("%s\n", "Argument to LuciRange_next must be LuciIntObj");
+    }
+
+    if (AS_INT(idx)->i >= AS_RANGE(r)->count) {
+        return NULL;
+    }
+    return LuciInt_new(range_at(r, AS_INT(idx)->i));
+}
+
+/**
+ * Gets the integer at index b in LuciRangeObj a
+ *
+ * @param a LuciRangeObj
+ * @param b index in a
+ * @returns integer at index b
+ */
+LuciObject* LuciRange_cget(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_int_t)) {
+        long idx = AS_INT(b)->i;
+        if (idx < 0 && AS_RANGE(a)->count > 0) {
+            MAKE_INDEX_POS(idx, AS_RANGE(a)->count);
+        }
+        if (idx < 0 || idx >= AS_RANGE(a)->count) {
+            LUCI_DIE("%s\n", "Range index out of bounds");
+        }
+        return LuciInt_new(range_at(a, idx));
+    } else {
+        LUCI_DIE("Cannot subscript a range with an object of type %s\n",
+                b->type->type_name);
+    }
+    return LuciNilObj;
+}
+
+/**
+ * Ranges are immutable, so this always fails
+ *
+ * @param a LuciRangeObj
+ * @param b index in a
+ * @param c object to insert
+ * @returns LuciNilObj
+ */
+LuciObject* LuciRange_cput(LuciObject *a, LuciObject *b, LuciObject *c)
+{
+    LUCI_DIE("%s\n", "Cannot modify a range (convert it with list() first)");
+    return LuciNilObj;
+}
+
+/**
+ * Prints a LuciRangeObj to stdout
+ *
+ * @param in LuciRangeObj to print
+ */
+void LuciRange_print(LuciObject *in)
+{
+    LuciRangeObj *r = AS_RANGE(in);
+    long end = range_at(in, r->count);
+
+    if (r->step == 1) {
+        printf("range(%ld, %ld)", r->start, r->count ? end : r->start);
+    } else {
+        printf("range(%ld, %ld, %ld)", r->start, r->count ? end : r->start,
+                r->step);
+    }
+}
+
+/**
+ * Marks a LuciRangeObj as reachable
+ *
+ * @param in LuciRangeObj
+ */
+void LuciRange_mark(LuciObject *in)
+{
+    GC_MARK(in);
+}
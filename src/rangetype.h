@@ -0,0 +1,47 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file rangetype.h
+ */
+
+#ifndef LUCI_RANGETYPE_H
+#define LUCI_RANGETYPE_H
+
+#include "lucitypes.h"
+
+extern LuciObjectType obj_range_t;
+
+/** Lazy, immutable range of integers */
+typedef struct LuciRange_ {
+    LuciObject base;    /**< base implementation */
+    long start;         /**< first integer in the range */
+    long step;          /**< difference between consecutive integers */
+    long count;         /**< number of integers in the range */
+} LuciRangeObj;
+
+/** casts LuciObject o to a LuciRangeObj */
+#define AS_RANGE(o)     ((LuciRangeObj *)(o))
+
+/** integer at index i of LuciRangeObj r (wraps instead of overflowing) */
+#define RANGE_AT(r, i)  ((long)((unsigned long)AS_RANGE(r)->start + \
+            (unsigned long)(i) * AS_RANGE(r)->step))
+
+LuciObject *LuciRange_new(long start, long end, long step);
+LuciObject *LuciRange_to_list(LuciObject *);
+LuciObject* LuciRange_copy(LuciObject *);
+LuciObject* LuciRange_asbool(LuciObject *);
+LuciObject* LuciRange_len(LuciObject *);
+LuciObject* LuciRange_eq(LuciObject *, LuciObject *);
+LuciObject* LuciRange_sum(LuciObject *);
+LuciObject* LuciRange_min(LuciObject *);
+LuciObject* LuciRange_max(LuciObject *);
+LuciObject* LuciRange_contains(LuciObject *, LuciObject *);
+LuciObject* LuciRange_next(LuciObject *, LuciObject *);
+LuciObject* LuciRange_cget(LuciObject *, LuciObject *);
+LuciObject* LuciRange_cput(LuciObject *, LuciObject *, LuciObject *);
+void LuciRange_print(LuciObject *);
+void LuciRange_mark(LuciObject *);
+
+#endif
@@ -0,0 +1,249 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file settype.c
+ *
+ * Hashed sets of ints, floats and strings.
+ *
+ * Members are stored as the keys of a map's hash table, so adding,
+ * removing and finding a member take expected O(1) time, and members
+ * are iterated in insertion order. Wherever a set behaves just like
+ * a map (length, membership, iteration, garbage collection), its type
+ * uses the map's methods directly.
+ */
+
+#include "settype.h"
+
+/** Type member table for LuciSetObj */
+LuciObjectType obj_set_t = {
+    "set",
+    sizeof(LuciSetObj),
+    TYPEID_SET,
+
+    LuciSet_copy,
+    LuciSet_deepcopy,
+    unary_nil,
+    LuciMap_asbool,
+    LuciMap_len,
+    unary_nil,
+    LuciObject_lgnot,
+    unary_nil,
+
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    LuciSet_eq,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    LuciObject_lgor,
+    LuciObject_lgand,
+    binary_nil,
+    LuciSet_union,
+    LuciSet_intersection,
+
+    LuciMap_contains,
+    LuciMap_next,
+    binary_nil,
+
+    ternary_nil,
+
+    LuciSet_print,
+    LuciMap_mark,
+    LuciMap_finalize,
+    NULL,       /* hash0 */
+    NULL        /* hash1 */
+};
+
+/**
+ * Creates a new, empty LuciSetObj
+ *
+ * @returns new LuciSetObj
+ */
+LuciObject *LuciSet_new()
+{
+    /* a set is allocated and initialized just like a map */
+    LuciObject *o = LuciMap_new();
+    o->type = &obj_set_t;
+    return o;
+}
+
+/**
+ * Copies a LuciSetObj
+ *
+ * returns itself
+ *
+ * @param orig LuciSetObj
+ * @returns orig
+ */
+LuciObject* LuciSet_copy(LuciObject *orig)
+{
+    return orig;
+}
+
+/**
+ * Deep copies a LuciSetObj
+ *
+ * Members are immutable, so only the table is copied.
+ *
+ * @param orig LuciSetObj to copy
+ * @returns new copy of orig
+ */
+LuciObject* LuciSet_deepcopy(LuciObject *orig)
+{
+    LuciObject *copy = LuciSet_new();
+    unsigned int i;
+
+    for (i = 0; i < AS_SET(orig)->used; i++) {
+        if (AS_SET(orig)->entries[i].key) {
+            LuciSet_add(copy, AS_SET(orig)->entries[i].key);
+        }
+    }
+    return copy;
+}
+
+/**
+ * Determines if two LuciSetObjs have the same members
+ *
+ * @param a LuciSetObj
+ * @param b LuciSetObj
+ * @returns 1 if equal, 0 otherwise
+ */
+LuciObject* LuciSet_eq(LuciObject *a, LuciObject *b)
+{
+    if (!ISTYPE(b, obj_set_t)) {
+        LUCI_DIE("Cannot compare a set to an object of type %s\n",
+                b->type->type_name);
+    }
+
+    if (AS_SET(a)->count != AS_SET(b)->count) {
+        return LuciFalseObj;
+    }
+    unsigned int i;
+    for (i = 0; i < AS_SET(a)->used; i++) {
+        LuciObject *member = AS_SET(a)->entries[i].key;
+        if (member && !LuciMap_get(b, member)) {
+            return LuciFalseObj;
+        }
+    }
+    return LuciTrueObj;
+}
+
+/**
+ * Returns the union of two LuciSetObjs
+ *
+ * Also implements `a | b`.
+ *
+ * @param a LuciSetObj
+ * @param b LuciSetObj
+ * @returns new LuciSetObj holding the members of both a and b
+ */
+LuciObject* LuciSet_union(LuciObject *a, LuciObject *b)
+{
+    if (!ISTYPE(b, obj_set_t)) {
+        LUCI_DIE("Cannot find the union of a set and an object of type %s\n",
+                b->type->type_name);
+    }
+
+    LuciObject *res = LuciSet_deepcopy(a);
+    unsigned int i;
+    for (i = 0; i < AS_SET(b)->used; i++) {
+        if (AS_SET(b)->entries[i].key) {
+            LuciSet_add(res, AS_SET(b)->entries[i].key);
+        }
+    }
+    return res;
+}
+
+/**
+ * Returns the intersection of two LuciSetObjs
+ *
+ * Also implements `a & b`. Only the smaller set is iterated over.
+ *
+ * @param a LuciSetObj
+ * @param b LuciSetObj
+ * @returns new LuciSetObj holding the members in both a and b
+ */
+LuciObject* LuciSet_intersection(LuciObject *a, LuciObject *b)
+{
+    if (!ISTYPE(b, obj_set_t)) {
+        LUCI_DIE("Cannot find the intersection of a set and an object of type %s\n",
+                b->type->type_name);
+    }
+
+    LuciObject *res = LuciSet_new();
+    LuciObject *small = a, *large = b;
+    if (AS_SET(a)->count > AS_SET(b)->count) {
+        small = b;
+        large = a;
+    }
+
+    unsigned int i;
+    for (i = 0; i < AS_SET(small)->used; i++) {
+        LuciObject *member = AS_SET(small)->entries[i].key;
+        if (member && LuciMap_get(large, member)) {
+            LuciSet_add(res, member);
+        }
+    }
+    return res;
+}
+
+/**
+ * Adds a member to a LuciSetObj
+ *
+ * @param s LuciSetObj
+ * @param o int, float or string to add
+ * @returns o
+ */
+LuciObject *LuciSet_add(LuciObject *s, LuciObject *o)
+{
+    return LuciMap_cput(s, o, o);
+}
+
+/**
+ * Removes a member from a LuciSetObj
+ *
+ * @param s LuciSetObj
+ * @param o object to remove
+ * @returns LuciIntObj (true if o was a member)
+ */
+LuciObject *LuciSet_remove(LuciObject *s, LuciObject *o)
+{
+    if (!o->type->hash0) {
+        return LuciFalseObj;
+    }
+    return LuciBool(LuciMap_cdel(s, o) != NULL);
+}
+
+/**
+ * Prints a LuciSetObj to stdout
+ *
+ * @param in LuciSetObj to print
+ */
+void LuciSet_print(LuciObject *in)
+{
+    unsigned int i;
+    printf("set{");
+    for (i = 0; i < AS_SET(in)->used; i++) {
+        LuciObject *member = AS_SET(in)->entries[i].key;
+        if (!member) {
+            continue;
+        }
+        if (ISTYPE(member, obj_string_t)) {
+            printf("\"");
+            member->type->print(member);
+            printf("\"");
+        } else {
+            member->type->print(member);
+        }
+        printf(", ");
+    }
+    printf("}");
+}
@@ -0,0 +1,37 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file settype.h
+ */
+
+#ifndef LUCI_SETTYPE_H
+#define LUCI_SETTYPE_H
+
+#include "lucitypes.h"
+
+extern LuciObjectType obj_set_t;
+
+/**
+ * Set object type
+ *
+ * A set is laid out exactly like a map whose keys are the set's
+ * members (each mapped to itself), so it shares the map's hash table.
+ */
+typedef struct LuciMap_ LuciSetObj;
+
+/** casts LuciObject o to a LuciSetObj */
+#define AS_SET(o)       ((LuciSetObj *)(o))
+
+LuciObject *LuciSet_new();
+LuciObject* LuciSet_copy(LuciObject *);
+LuciObject* LuciSet_deepcopy(LuciObject *);
+LuciObject* LuciSet_eq(LuciObject *, LuciObject *);
+LuciObject* LuciSet_union(LuciObject *, LuciObject *);
+LuciObject* LuciSet_intersection(LuciObject *, LuciObject *);
+LuciObject *LuciSet_add(LuciObject *, LuciObject *);
+LuciObject *LuciSet_remove(LuciObject *, LuciObject *);
+void LuciSet_print(LuciObject *);
+
+#endif
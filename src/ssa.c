@@ -0,0 +1,2038 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file ssa.c
+ *
+ * SSA optimizer, run on a CompileState before the peephole pass when
+ * Luci is started with -O.
+ *
+ * The compiler has already resolved every name to a slot and lowered
+ * conditions to jumps, so the IR is built from the bytecode rather
+ * than from the AST. The instructions are split into basic blocks and
+ * each one is simulated on a stack of SSA values. Every STORE defines
+ * a new version of its local, and versions meeting at a join get a
+ * phi, using the construction of Braun et al., "Simple and Efficient
+ * Construction of Static Single Assignment Form". Stack entries that
+ * are still there at the end of a block are treated like locals.
+ *
+ * The IR then drives these rewrites of the bytecode:
+ *
+ * - copy propagation: a load of a local holding a constant becomes a
+ *   LOADK, and in functions a load of a copy reads the original
+ * - loop-invariant code motion: an expression without side effects
+ *   whose inputs don't change inside a loop is computed once, before
+ *   the loop, into a hidden local
+ * - common subexpression elimination: an expression whose value is
+ *   already known on every path to it loads a saved copy instead
+ * - dead code elimination: in functions, stores that are never read,
+ *   and anywhere, expressions that can't fail whose value is dropped
+ *
+ * Whether an expression can be moved or shared depends on the types
+ * of its operands, which are inferred from constants, builtins and
+ * operators. Arithmetic on numbers and strings always creates an
+ * equal, immutable value, while the same operators on lists create a
+ * new mutable one. len(l) on a list only moves out of a loop that
+ * can't modify a container, i.e. one with no CPUT and no calls other
+ * than to builtins that leave their arguments alone.
+ *
+ * Lowering keeps the original instructions in order and only deletes,
+ * rewrites or inserts around them, so the ITERJUMP and UNPACK fast
+ * paths still find the STOREs they expect. Functions the optimizer
+ * can't model (inconsistent stack depths) are left as they are.
+ */
+
+#include "luci.h"
+#include "ssa.h"
+#include "lucitypes.h"
+#include "symbol.h"
+#include "functiontype.h"
+
+/** totals reported by `luci -O -p` */
+SsaStats ssa_stats;
+
+/** no value, block or address */
+#define NONE            UINT32_MAX
+
+/** returns 1 if the opcode takes a jump target as its argument */
+#define IS_JUMP(op)     ((op) >= JUMP)
+
+/** largest number of phi slots (blocks * variables) worth building */
+#define MAX_DEFS        (1 << 22)
+
+/** kinds of value that aren't pushed by an opcode of the same name */
+enum {
+    SSA_PHI = ITERJUMP + 1, /**< one of a variable's versions at a join */
+    SSA_ENTRY,              /**< a variable's value on entry */
+    SSA_COPY,               /**< version created by a STORE */
+    SSA_ITER,               /**< pushed by ITERJUMP, arg 1 for a pair's value */
+    SSA_ITEM                /**< pushed by UNPACK, arg is the item's index */
+};
+
+/** what lowering emits for an instruction */
+enum {
+    EMIT_KEEP,      /**< emit_op and emit_arg */
+    EMIT_DELETE,    /**< only the pops of its remaining operands */
+    EMIT_REPLACE    /**< the pops, then a load of the saved value */
+};
+
+/** how freely an expression can be shared or moved */
+enum {
+    MOVE_NEVER,     /**< side effects, or a new mutable object */
+    MOVE_MEMORY,    /**< reads a container that could be modified */
+    MOVE_FREE       /**< depends only on its operands' values */
+};
+
+/** builtins the optimizer knows about */
+enum {
+    BUILTIN_OTHER,      /**< could modify its arguments */
+    BUILTIN_READER,     /**< leaves its arguments alone */
+    BUILTIN_LEN,
+    BUILTIN_TYPE,
+    BUILTIN_STR,
+    BUILTIN_HEX,
+    BUILTIN_INT,
+    BUILTIN_FLOAT,
+    BUILTIN_LIST,
+    BUILTIN_RANGE
+};
+
+static const struct {
+    const char *name;
+    int kind;
+} known_builtins[] = {
+    {"len", BUILTIN_LEN},
+    {"type", BUILTIN_TYPE},
+    {"str", BUILTIN_STR},
+    {"hex", BUILTIN_HEX},
+    {"int", BUILTIN_INT},
+    {"float", BUILTIN_FLOAT},
+    {"list", BUILTIN_LIST},
+    {"range", BUILTIN_RANGE},
+    {"print", BUILTIN_READER},
+    {"help", BUILTIN_READER},
+    {"assert", BUILTIN_READER},
+    {"copy", BUILTIN_READER},
+    {"array", BUILTIN_READER},
+    {"tolist", BUILTIN_READER},
+    {"set", BUILTIN_READER},
+    {"sum", BUILTIN_READER},
+    {"max", BUILTIN_READER},
+    {"min", BUILTIN_READER},
+    {"contains", BUILTIN_READER},
+    {"join", BUILTIN_READER},
+    {"slice", BUILTIN_READER},
+    {"find", BUILTIN_READER},
+    {"rfind", BUILTIN_READER},
+    {"count", BUILTIN_READER},
+    {"replace", BUILTIN_READER},
+    {"startswith", BUILTIN_READER},
+    {"endswith", BUILTIN_READER},
+    {"strip", BUILTIN_READER},
+    {"dot", BUILTIN_READER},
+    {"union", BUILTIN_READER},
+    {"intersection", BUILTIN_READER},
+    {NULL, 0}
+};
+
+/* sets of types, as bit masks of LuciTypeId */
+#define T(id)           (1u << (id))
+#define T_ANY           ((1u << TYPEID_COUNT) - 1)
+#define T_INTS          (T(TYPEID_INT) | T(TYPEID_BIGINT))
+#define T_NUMBER        (T_INTS | T(TYPEID_FLOAT))
+#define T_SCALAR        (T_NUMBER | T(TYPEID_STRING))
+#define T_SIZED         (T(TYPEID_STRING) | T(TYPEID_LIST) | \
+        T(TYPEID_TUPLE) | T(TYPEID_MAP) | T(TYPEID_SET) | T(TYPEID_RANGE))
+#define SUBSET(a, b)    (((a) & ~(b)) == 0)
+
+/**
+ * A value in SSA form
+ */
+typedef struct ssa_value_ {
+    int kind;           /**< Opcode, or one of the SSA_ kinds */
+    int arg;            /**< argument of the instruction */
+    uint32_t block;     /**< defining block, or NONE */
+    uint32_t addr;      /**< defining instruction, or NONE */
+    uint32_t var;       /**< variable of a phi, entry or copy */
+    uint32_t *ops;      /**< operands, bottom of the stack first */
+    uint32_t nops;      /**< number of operands */
+    uint32_t aops;      /**< size of ops */
+    uint32_t *users;    /**< phis with this value as an operand */
+    uint32_t nusers;    /**< number of users */
+    uint32_t ausers;    /**< size of users */
+    uint32_t same;      /**< value this one turned out to equal, or itself */
+    uint32_t types;     /**< set of types the value can have */
+    uint32_t home;      /**< first local holding the value, or NONE */
+    uint32_t rep;       /**< first equal expression */
+    bool live;          /**< version still read by a load */
+} SsaValue;
+
+/**
+ * A basic block
+ */
+typedef struct ssa_block_ {
+    uint32_t start;     /**< first instruction */
+    uint32_t end;       /**< one past the last instruction */
+    uint32_t *preds;    /**< reachable predecessors */
+    uint32_t npreds;    /**< number of predecessors */
+    uint32_t apreds;    /**< size of preds */
+    uint32_t succs[2];  /**< successors, fall through first */
+    uint32_t nsuccs;    /**< number of successors */
+    int depth;          /**< stack depth on entry, -1 if unreachable */
+    uint32_t rpo;       /**< position in reverse postorder */
+    uint32_t idom;      /**< immediate dominator */
+    uint32_t *phis;     /**< phis waiting for the block to be sealed */
+    uint32_t nphis;     /**< number of waiting phis */
+    uint32_t aphis;     /**< size of phis */
+    bool filled;        /**< all instructions have been simulated */
+    bool sealed;        /**< all predecessors have been filled */
+} SsaBlock;
+
+/**
+ * A decoded instruction and what to emit for it
+ */
+typedef struct ssa_instr_ {
+    Opcode op;          /**< opcode */
+    int arg;            /**< argument, or absolute address for jumps */
+    uint32_t block;     /**< enclosing block */
+    uint32_t value;     /**< value pushed, or NONE */
+    uint32_t version;   /**< LOADS: version loaded, STORE: version created */
+    uint32_t in;        /**< index of its operands' producers */
+    uint32_t nin;       /**< number of operands popped */
+    uint32_t home;      /**< LOADS: another local with the same value */
+    uint32_t home_version; /**< LOADS: version of home at this point */
+    uint32_t reads;     /**< LOADS: version read by emit_op */
+    int emit;           /**< EMIT_ action */
+    Opcode emit_op;     /**< opcode to emit when kept */
+    int emit_arg;       /**< argument to emit when kept */
+    uint32_t pops;      /**< POPs emitted in place of deleted producers */
+    int slot;           /**< EMIT_REPLACE: local holding the value */
+    int save;           /**< local to also store the value in, or -1 */
+} SsaInstr;
+
+/**
+ * A natural loop
+ */
+typedef struct ssa_loop_ {
+    uint32_t header;    /**< block every iteration starts at */
+    bool *body;         /**< membership of each block */
+    uint32_t size;      /**< number of blocks in the body */
+    bool clobbers;      /**< could modify a container */
+    uint32_t *hoisted;  /**< expressions to compute before the loop */
+    uint32_t nhoisted;  /**< number of hoisted expressions */
+    uint32_t ahoisted;  /**< size of hoisted */
+} SsaLoop;
+
+/**
+ * A function in SSA form
+ */
+typedef struct ssa_func_ {
+    CompileState *cs;   /**< state being optimized */
+    bool global;        /**< the program's top level */
+    uint32_t n;         /**< number of instructions */
+    SsaInstr *instrs;   /**< decoded instructions */
+    uint32_t *producers;    /**< producer of each operand, or NONE */
+    uint32_t nproducers;    /**< number of producers */
+    uint32_t aproducers;    /**< size of producers */
+    SsaBlock *blocks;   /**< basic blocks in address order */
+    uint32_t nblocks;   /**< number of blocks */
+    uint32_t *block_of; /**< block of each instruction */
+    uint32_t *order;    /**< reachable blocks in reverse postorder */
+    uint32_t norder;    /**< number of reachable blocks */
+    uint32_t nlocals;   /**< locals before any temporaries */
+    uint32_t maxdepth;  /**< deepest stack */
+    uint32_t nvars;     /**< locals, then stack slots */
+    uint32_t *defs;     /**< current version of each variable per block */
+    uint32_t *entries;  /**< entry value of each variable */
+    SsaValue *values;   /**< all values */
+    uint32_t nvalues;   /**< number of values */
+    uint32_t avalues;   /**< size of values */
+    uint32_t nil;       /**< value of PUSHNIL */
+    uint32_t *constants;    /**< value of each LOADK */
+    uint32_t *globals;  /**< value of each LOADG */
+    uint32_t nglobals;  /**< size of globals */
+    uint32_t *builtins; /**< value of each LOADB */
+    uint8_t *builtin_kind;  /**< BUILTIN_ kind of each builtin */
+    SsaLoop *loops;     /**< loops, outermost first */
+    uint32_t nloops;    /**< number of loops */
+    uint32_t ntemps;    /**< hidden locals created */
+} SsaFunc;
+
+/** an entry on the simulated stack */
+typedef struct ssa_entry_ {
+    uint32_t value;     /**< value pushed */
+    uint32_t producer;  /**< instruction that pushed it, or NONE */
+} SsaEntry;
+
+
+/**
+ * Appends x to a growable array
+ */
+static void append(uint32_t **array, uint32_t *count, uint32_t *size,
+        uint32_t x)
+{
+    if (*count >= *size) {
+        *size = *size ? *size * 2 : 4;
+        *array = realloc(*array, *size * sizeof(**array));
+        if (!*array) {
+            LUCI_DIE("%s", "Could not grow SSA array\n");
+        }
+    }
+    (*array)[(*count)++] = x;
+}
+
+/**
+ * Creates a value
+ *
+ * Pointers into f->values are invalid after this returns.
+ */
+static uint32_t new_value(SsaFunc *f, int kind, int arg, uint32_t block,
+        uint32_t addr)
+{
+    SsaValue *v;
+
+    if (f->nvalues >= f->avalues) {
+        f->avalues = f->avalues ? f->avalues * 2 : 64;
+        f->values = realloc(f->values, f->avalues * sizeof(*f->values));
+        if (!f->values) {
+            LUCI_DIE("%s", "Could not grow SSA values\n");
+        }
+    }
+    v = &f->values[f->nvalues];
+    memset(v, 0, sizeof(*v));
+    v->kind = kind;
+    v->arg = arg;
+    v->block = block;
+    v->addr = addr;
+    v->var = NONE;
+    v->same = f->nvalues;
+    v->home = NONE;
+    v->rep = f->nvalues;
+    return f->nvalues++;
+}
+
+static void add_operand(SsaFunc *f, uint32_t v, uint32_t op)
+{
+    SsaValue *val = &f->values[v];
+    append(&val->ops, &val->nops, &val->aops, op);
+}
+
+/**
+ * Returns the value v was found to be equal to
+ */
+static uint32_t find(SsaFunc *f, uint32_t v)
+{
+    uint32_t root = v, next;
+
+    while (f->values[root].same != root) {
+        root = f->values[root].same;
+    }
+    while (v != root) {
+        next = f->values[v].same;
+        f->values[v].same = root;
+        v = next;
+    }
+    return root;
+}
+
+/**
+ * Returns the value v stands for once copies are looked through
+ */
+static uint32_t resolve(SsaFunc *f, uint32_t v)
+{
+    v = find(f, v);
+    while (f->values[v].kind == SSA_COPY) {
+        v = find(f, f->values[v].ops[0]);
+    }
+    return v;
+}
+
+/** set of types of operand i of value v */
+#define OP_TYPES(f, v, i) \
+    ((f)->values[find((f), (f)->values[(v)].ops[(i)])].types)
+
+/**
+ * Returns the BUILTIN_ kind of the function a CALL value calls
+ *
+ * @returns -1 if it isn't a builtin
+ */
+static int called_builtin(SsaFunc *f, uint32_t v)
+{
+    SsaValue *val = &f->values[v];
+    uint32_t func = resolve(f, val->ops[val->nops - 1]);
+
+    if (f->values[func].kind != LOADB) {
+        return -1;
+    }
+    return f->builtin_kind[f->values[func].arg];
+}
+
+
+/* ---------------------------------------------------------------- */
+/* Control flow                                                     */
+/* ---------------------------------------------------------------- */
+
+/**
+ * Returns how many entries an instruction pops and pushes
+ *
+ * ITERJUMP is left to the caller, since it pushes on one path only.
+ *
+ * @returns false for an opcode the optimizer doesn't model
+ */
+static bool stack_effect(SsaInstr *in, int *pops, int *pushes)
+{
+    *pops = 0;
+    *pushes = 0;
+    switch (in->op) {
+        case NOP: case HALT: case JUMP: case ITERJUMP:
+            break;
+        case ADD: case SUB: case MUL: case DIV: case MOD: case POW:
+        case EQ: case NEQ: case LT: case GT: case LTE: case GTE:
+        case LGOR: case LGAND: case BWXOR: case BWOR: case BWAND:
+        case CGET:
+            *pops = 2;
+            *pushes = 1;
+            break;
+        case NEG: case LGNOT: case BWNOT: case MKITER:
+            *pops = 1;
+            *pushes = 1;
+            break;
+        case POP: case STORE: case RETURN:
+        case POPJUMP: case JUMPZ: case JUMPNZ:
+            *pops = 1;
+            break;
+        case PUSHNIL: case LOADK: case LOADS: case LOADG: case LOADB:
+            *pushes = 1;
+            break;
+        case DUP:
+            *pops = 1;
+            *pushes = 2;
+            break;
+        case CALL:
+            *pops = in->arg + 1;
+            *pushes = 1;
+            break;
+        case MKMAP:
+            *pops = 2 * in->arg;
+            *pushes = 1;
+            break;
+        case MKLIST: case MKTUPLE:
+            *pops = in->arg;
+            *pushes = 1;
+            break;
+        case UNPACK:
+            *pops = 1;
+            *pushes = in->arg;
+            break;
+        case CPUT:
+            *pops = 3;
+            *pushes = in->arg ? 1 : 0;
+            break;
+        default:
+            return false;
+    }
+    return *pops >= 0 && *pushes >= 0;
+}
+
+/**
+ * Splits the instructions into basic blocks and links them
+ */
+static bool build_blocks(SsaFunc *f)
+{
+    uint32_t i, b, n = f->n;
+    bool *leader = alloc((n + 1) * sizeof(*leader));
+    bool ok = true;
+
+    leader[0] = true;
+    for (i = 0; i < n && ok; i++) {
+        SsaInstr *in = &f->instrs[i];
+        if (IS_JUMP(in->op)) {
+            if (in->arg < 0 || (uint32_t)in->arg >= n) {
+                ok = false;
+                break;
+            }
+            leader[in->arg] = true;
+        }
+        if (IS_JUMP(in->op) || in->op == RETURN || in->op == HALT) {
+            leader[i + 1] = true;
+        }
+        if (in->op == ITERJUMP && (i == 0 || f->instrs[i - 1].op != MKITER)) {
+            /* the pairs flag is read from the MKITER */
+            ok = false;
+        }
+    }
+    if (!ok) {
+        free(leader);
+        return false;
+    }
+
+    for (i = 0; i < n; i++) {
+        f->nblocks += leader[i];
+    }
+    f->blocks = alloc(f->nblocks * sizeof(*f->blocks));
+    f->block_of = alloc(n * sizeof(*f->block_of));
+    for (i = 0, b = 0; i < n; i++) {
+        if (leader[i]) {
+            if (i > 0) {
+                f->blocks[b++].end = i;
+            }
+            f->blocks[b].start = i;
+        }
+        f->block_of[i] = b;
+        f->instrs[i].block = b;
+    }
+    f->blocks[b].end = n;
+    free(leader);
+
+    for (b = 0; b < f->nblocks; b++) {
+        SsaBlock *blk = &f->blocks[b];
+        SsaInstr *last = &f->instrs[blk->end - 1];
+        bool falls = true;
+
+        blk->depth = -1;
+        switch (last->op) {
+            case JUMP:
+            case POPJUMP:
+            case RETURN:
+            case HALT:
+                falls = false;
+                break;
+            default:
+                break;
+        }
+        if (falls) {
+            if (blk->end >= n) {
+                /* falls off the end */
+                return false;
+            }
+            blk->succs[blk->nsuccs++] = b + 1;
+        }
+        if (IS_JUMP(last->op)) {
+            blk->succs[blk->nsuccs++] = f->block_of[last->arg];
+        }
+    }
+    return true;
+}
+
+/**
+ * Finds the stack depth at the start of every reachable block
+ *
+ * @returns false if two paths reach a block with different depths
+ */
+static bool find_depths(SsaFunc *f)
+{
+    uint32_t *work = alloc(f->nblocks * sizeof(*work));
+    uint32_t nwork = 0, b, i, s;
+    int pops, pushes, d, out[2];
+    bool ok = true;
+
+    f->blocks[0].depth = 0;
+    work[nwork++] = 0;
+    while (nwork > 0 && ok) {
+        SsaBlock *blk = &f->blocks[work[--nwork]];
+        d = blk->depth;
+        for (i = blk->start; i < blk->end && ok; i++) {
+            if (!stack_effect(&f->instrs[i], &pops, &pushes) || d < pops) {
+                ok = false;
+                break;
+            }
+            d += pushes - pops;
+            if ((uint32_t)d > f->maxdepth) {
+                f->maxdepth = d;
+            }
+        }
+        if (!ok) {
+            break;
+        }
+        out[0] = out[1] = d;
+        if (f->instrs[blk->end - 1].op == ITERJUMP) {
+            if (d < 1) {
+                ok = false;
+                break;
+            }
+            /* pushes the next item, or pops the iterator and jumps */
+            out[0] = d + (f->instrs[blk->end - 2].arg ? 2 : 1);
+            out[1] = d - 1;
+            if ((uint32_t)out[0] > f->maxdepth) {
+                f->maxdepth = out[0];
+            }
+        }
+        for (i = 0; i < blk->nsuccs; i++) {
+            SsaBlock *succ = &f->blocks[blk->succs[i]];
+            s = blk->nsuccs == 2 ? i : 0;
+            if (succ->depth < 0) {
+                succ->depth = out[s];
+                work[nwork++] = blk->succs[i];
+            } else if (succ->depth != out[s]) {
+                ok = false;
+            }
+        }
+    }
+    free(work);
+
+    for (b = 0; b < f->nblocks && ok; b++) {
+        SsaBlock *blk = &f->blocks[b];
+        if (blk->depth < 0) {
+            continue;
+        }
+        for (i = 0; i < blk->nsuccs; i++) {
+            SsaBlock *succ = &f->blocks[blk->succs[i]];
+            append(&succ->preds, &succ->npreds, &succ->apreds, b);
+        }
+    }
+    return ok;
+}
+
+/**
+ * Orders the reachable blocks in reverse postorder
+ */
+static void order_blocks(SsaFunc *f)
+{
+    uint32_t *stack = alloc(f->nblocks * sizeof(*stack));
+    uint32_t *next = alloc(f->nblocks * sizeof(*next));
+    bool *seen = alloc(f->nblocks * sizeof(*seen));
+    uint32_t sp = 0, post = 0, b, i;
+
+    f->order = alloc(f->nblocks * sizeof(*f->order));
+    stack[sp++] = 0;
+    seen[0] = true;
+    while (sp > 0) {
+        b = stack[sp - 1];
+        if (next[b] < f->blocks[b].nsuccs) {
+            uint32_t s = f->blocks[b].succs[next[b]++];
+            if (!seen[s]) {
+                seen[s] = true;
+                stack[sp++] = s;
+            }
+        } else {
+            f->order[post++] = b;
+            sp--;
+        }
+    }
+    f->norder = post;
+    for (i = 0; i < post / 2; i++) {
+        b = f->order[i];
+        f->order[i] = f->order[post - 1 - i];
+        f->order[post - 1 - i] = b;
+    }
+    for (i = 0; i < post; i++) {
+        f->blocks[f->order[i]].rpo = i;
+    }
+
+    free(seen);
+    free(next);
+    free(stack);
+}
+
+static uint32_t intersect(SsaFunc *f, uint32_t a, uint32_t b)
+{
+    while (a != b) {
+        while (f->blocks[a].rpo > f->blocks[b].rpo) {
+            a = f->blocks[a].idom;
+        }
+        while (f->blocks[b].rpo > f->blocks[a].rpo) {
+            b = f->blocks[b].idom;
+        }
+    }
+    return a;
+}
+
+/**
+ * Finds immediate dominators (Cooper, Harvey and Kennedy, "A Simple,
+ * Fast Dominance Algorithm")
+ */
+static void find_dominators(SsaFunc *f)
+{
+    uint32_t i, j, b, idom;
+    bool changed = true;
+
+    for (i = 0; i < f->nblocks; i++) {
+        f->blocks[i].idom = NONE;
+    }
+    f->blocks[0].idom = 0;
+    while (changed) {
+        changed = false;
+        for (i = 1; i < f->norder; i++) {
+            b = f->order[i];
+            idom = NONE;
+            for (j = 0; j < f->blocks[b].npreds; j++) {
+                uint32_t p = f->blocks[b].preds[j];
+                if (f->blocks[p].idom == NONE) {
+                    continue;
+                }
+                idom = idom == NONE ? p : intersect(f, p, idom);
+            }
+            if (f->blocks[b].idom != idom) {
+                f->blocks[b].idom = idom;
+                changed = true;
+            }
+        }
+    }
+}
+
+/** returns true if every path to block b goes through block a */
+static bool dominates(SsaFunc *f, uint32_t a, uint32_t b)
+{
+    while (b != a && b != 0) {
+        b = f->blocks[b].idom;
+    }
+    return b == a;
+}
+
+
+/* ---------------------------------------------------------------- */
+/* SSA construction                                                 */
+/* ---------------------------------------------------------------- */
+
+static uint32_t read_variable(SsaFunc *f, uint32_t var, uint32_t b);
+
+static void write_variable(SsaFunc *f, uint32_t var, uint32_t b, uint32_t v)
+{
+    f->defs[b * f->nvars + var] = v;
+}
+
+static uint32_t entry_value(SsaFunc *f, uint32_t var)
+{
+    if (f->entries[var] == NONE) {
+        uint32_t v = new_value(f, SSA_ENTRY, 0, NONE, NONE);
+        f->values[v].var = var;
+        f->values[v].types = T_ANY;
+        if (var < f->nlocals) {
+            f->values[v].home = var;
+        }
+        f->entries[var] = v;
+    }
+    return f->entries[var];
+}
+
+static uint32_t new_phi(SsaFunc *f, uint32_t var, uint32_t b)
+{
+    uint32_t v = new_value(f, SSA_PHI, 0, b, NONE);
+    f->values[v].var = var;
+    if (var < f->nlocals) {
+        f->values[v].home = var;
+    }
+    return v;
+}
+
+/**
+ * Replaces a phi whose operands are all one value (or itself) by that
+ * value, then rechecks the phis that used it
+ */
+static uint32_t remove_trivial_phi(SsaFunc *f, uint32_t phi)
+{
+    uint32_t same = NONE, op, i;
+
+    for (i = 0; i < f->values[phi].nops; i++) {
+        op = find(f, f->values[phi].ops[i]);
+        if (op == same || op == phi) {
+            continue;
+        }
+        if (same != NONE) {
+            return phi;
+        }
+        same = op;
+    }
+    if (same == NONE) {
+        /* only reachable from itself */
+        same = entry_value(f, f->values[phi].var);
+    }
+    f->values[phi].same = same;
+
+    for (i = 0; i < f->values[phi].nusers; i++) {
+        uint32_t user = f->values[phi].users[i];
+        if (f->values[same].kind == SSA_PHI) {
+            SsaValue *s = &f->values[same];
+            append(&s->users, &s->nusers, &s->ausers, user);
+        }
+        if (find(f, user) == user && user != phi) {
+            remove_trivial_phi(f, user);
+        }
+    }
+    return find(f, same);
+}
+
+static uint32_t add_phi_operands(SsaFunc *f, uint32_t var, uint32_t phi)
+{
+    uint32_t b = f->values[phi].block, i, op;
+
+    if (b == 0) {
+        /* entering the function is another way in */
+        add_operand(f, phi, entry_value(f, var));
+    }
+    for (i = 0; i < f->blocks[b].npreds; i++) {
+        op = read_variable(f, var, f->blocks[b].preds[i]);
+        add_operand(f, phi, op);
+        if (f->values[op].kind == SSA_PHI) {
+            SsaValue *o = &f->values[op];
+            append(&o->users, &o->nusers, &o->ausers, phi);
+        }
+    }
+    return remove_trivial_phi(f, phi);
+}
+
+static uint32_t read_variable_recursive(SsaFunc *f, uint32_t var, uint32_t b)
+{
+    SsaBlock *blk = &f->blocks[b];
+    uint32_t v;
+
+    if (!blk->sealed) {
+        v = new_phi(f, var, b);
+        blk = &f->blocks[b];
+        append(&blk->phis, &blk->nphis, &blk->aphis, v);
+    } else if (b == 0 && blk->npreds == 0) {
+        v = entry_value(f, var);
+    } else if (b != 0 && blk->npreds == 1) {
+        v = read_variable(f, var, blk->preds[0]);
+    } else {
+        v = new_phi(f, var, b);
+        write_variable(f, var, b, v);
+        v = add_phi_operands(f, var, v);
+    }
+    write_variable(f, var, b, v);
+    return v;
+}
+
+/**
+ * Returns the current version of a variable at the end of block b
+ */
+static uint32_t read_variable(SsaFunc *f, uint32_t var, uint32_t b)
+{
+    uint32_t v = f->defs[b * f->nvars + var];
+    if (v != NONE) {
+        return find(f, v);
+    }
+    return read_variable_recursive(f, var, b);
+}
+
+static void seal_block(SsaFunc *f, uint32_t b)
+{
+    uint32_t i;
+
+    for (i = 0; i < f->blocks[b].nphis; i++) {
+        uint32_t phi = f->blocks[b].phis[i];
+        add_phi_operands(f, f->values[phi].var, phi);
+    }
+    f->blocks[b].nphis = 0;
+    f->blocks[b].sealed = true;
+}
+
+/** seals block b if all of its predecessors have been filled */
+static void try_seal(SsaFunc *f, uint32_t b)
+{
+    uint32_t i;
+
+    if (f->blocks[b].sealed) {
+        return;
+    }
+    for (i = 0; i < f->blocks[b].npreds; i++) {
+        if (!f->blocks[f->blocks[b].preds[i]].filled) {
+            return;
+        }
+    }
+    seal_block(f, b);
+}
+
+/**
+ * Returns the shared value of a constant, global or builtin
+ */
+static uint32_t shared_value(SsaFunc *f, uint32_t *cache, int kind, int arg)
+{
+    if (cache[arg] == NONE) {
+        cache[arg] = new_value(f, kind, arg, NONE, NONE);
+    }
+    return cache[arg];
+}
+
+/**
+ * Simulates the instructions of block b on a stack of values
+ */
+static void fill_block(SsaFunc *f, uint32_t b, SsaEntry *stack)
+{
+    SsaBlock *blk = &f->blocks[b];
+    uint32_t start = blk->start, end = blk->end, addr, v, i;
+    int sp = 0, k, depth = blk->depth;
+
+    for (k = 0; k < depth; k++) {
+        stack[sp].value = read_variable(f, f->nlocals + k, b);
+        stack[sp++].producer = NONE;
+    }
+
+    for (addr = start; addr < end; addr++) {
+        SsaInstr *in = &f->instrs[addr];
+        int pops, pushes;
+
+        stack_effect(in, &pops, &pushes);
+        if (in->op == DUP) {
+            pops = 0;
+        }
+        in->block = b;
+        in->in = f->nproducers;
+        in->nin = pops;
+        for (k = sp - pops; k < sp; k++) {
+            append(&f->producers, &f->nproducers, &f->aproducers,
+                    stack[k].producer);
+        }
+        sp -= pops;
+
+        switch (in->op) {
+            case PUSHNIL:
+                if (f->nil == NONE) {
+                    f->nil = new_value(f, PUSHNIL, 0, NONE, NONE);
+                }
+                v = f->nil;
+                break;
+            case LOADK:
+                v = shared_value(f, f->constants, LOADK, in->arg);
+                break;
+            case LOADG:
+                if ((uint32_t)in->arg >= f->nglobals) {
+                    v = new_value(f, LOADG, in->arg, NONE, NONE);
+                } else {
+                    v = shared_value(f, f->globals, LOADG, in->arg);
+                }
+                break;
+            case LOADB:
+                v = shared_value(f, f->builtins, LOADB, in->arg);
+                break;
+            case LOADS:
+                v = read_variable(f, in->arg, b);
+                in->version = v;
+                if (!f->global) {
+                    uint32_t home = f->values[resolve(f, v)].home;
+                    if (home != NONE && home != (uint32_t)in->arg) {
+                        in->home = home;
+                        in->home_version = read_variable(f, home, b);
+                    }
+                }
+                break;
+            case DUP:
+                v = stack[sp - 1].value;
+                break;
+            case STORE:
+                v = new_value(f, SSA_COPY, 0, b, addr);
+                f->values[v].var = in->arg;
+                add_operand(f, v, stack[sp].value);
+                write_variable(f, in->arg, b, v);
+                in->version = v;
+                i = resolve(f, v);
+                if (f->values[i].home == NONE) {
+                    f->values[i].home = in->arg;
+                }
+                v = NONE;
+                break;
+            case UNPACK:
+                i = stack[sp].value;
+                for (k = in->arg - 1; k >= 0; k--) {
+                    v = new_value(f, SSA_ITEM, k, b, addr);
+                    add_operand(f, v, i);
+                    stack[sp].value = v;
+                    stack[sp++].producer = addr;
+                }
+                v = NONE;
+                break;
+            case ITERJUMP:
+                if (f->instrs[addr - 1].arg) {
+                    v = new_value(f, SSA_ITER, 1, b, addr);
+                    stack[sp].value = v;
+                    stack[sp++].producer = NONE;
+                }
+                v = new_value(f, SSA_ITER, 0, b, addr);
+                stack[sp].value = v;
+                stack[sp++].producer = NONE;
+                v = NONE;
+                break;
+            default:
+                v = NONE;
+                if (pushes > 0) {
+                    v = new_value(f, in->op, in->arg, b, addr);
+                    for (k = 0; k < pops; k++) {
+                        add_operand(f, v, stack[sp + k].value);
+                    }
+                    in->value = v;
+                }
+                break;
+        }
+        if (v != NONE) {
+            stack[sp].value = v;
+            stack[sp++].producer = addr;
+        }
+    }
+
+    for (k = 0; k < sp; k++) {
+        write_variable(f, f->nlocals + k, b, stack[k].value);
+    }
+    f->blocks[b].filled = true;
+}
+
+/**
+ * Builds the SSA values of every reachable block
+ */
+static void build_ssa(SsaFunc *f)
+{
+    SsaEntry *stack = alloc((f->maxdepth + 2) * sizeof(*stack));
+    uint32_t i, j, b;
+
+    f->nvars = f->nlocals + f->maxdepth + 2;
+    f->defs = alloc(f->nblocks * f->nvars * sizeof(*f->defs));
+    memset(f->defs, 0xFF, f->nblocks * f->nvars * sizeof(*f->defs));
+    f->entries = alloc(f->nvars * sizeof(*f->entries));
+    memset(f->entries, 0xFF, f->nvars * sizeof(*f->entries));
+
+    for (i = 0; i < f->norder; i++) {
+        b = f->order[i];
+        try_seal(f, b);
+        fill_block(f, b, stack);
+        for (j = 0; j < f->blocks[b].nsuccs; j++) {
+            try_seal(f, f->blocks[b].succs[j]);
+        }
+    }
+    for (i = 0; i < f->norder; i++) {
+        try_seal(f, f->order[i]);
+    }
+    free(stack);
+}
+
+
+/* ---------------------------------------------------------------- */
+/* Types                                                            */
+/* ---------------------------------------------------------------- */
+
+/** returns true if a mix of a and b could pair a float with a bigint */
+static bool float_bigint(uint32_t a, uint32_t b)
+{
+    return ((a & T(TYPEID_FLOAT)) && (b & T(TYPEID_BIGINT))) ||
+        ((a & T(TYPEID_BIGINT)) && (b & T(TYPEID_FLOAT)));
+}
+
+static uint32_t binary_types(int op, uint32_t a, uint32_t b)
+{
+    uint32_t r = 0;
+
+    switch (op) {
+        case EQ: case NEQ: case LT: case GT: case LTE: case GTE:
+        case LGOR: case LGAND:
+            /* comparisons involving nil give nil */
+            if (SUBSET(a, T_SCALAR) && SUBSET(b, T_SCALAR)) {
+                return T(TYPEID_INT);
+            }
+            return T_ANY;
+        case BWXOR: case BWOR: case BWAND:
+            return SUBSET(a, T_INTS) && SUBSET(b, T_INTS) ? T_INTS : T_ANY;
+        case ADD:
+            if (a == T(TYPEID_STRING) && b == T(TYPEID_STRING)) {
+                return T(TYPEID_STRING);
+            }
+            break;
+        case MUL:
+            if ((a == T(TYPEID_STRING) && b == T(TYPEID_INT)) ||
+                    (a == T(TYPEID_INT) && b == T(TYPEID_STRING))) {
+                return T(TYPEID_STRING);
+            }
+            break;
+        default:
+            break;
+    }
+    if (!SUBSET(a, T_NUMBER) || !SUBSET(b, T_NUMBER)) {
+        return T_ANY;
+    }
+    if ((a | b) & T(TYPEID_FLOAT)) {
+        r |= T(TYPEID_FLOAT);
+    }
+    if ((a & T_INTS) && (b & T_INTS)) {
+        r |= T_INTS;
+    }
+    return r;
+}
+
+/**
+ * Returns the types value v can have, given its operands' types so far
+ */
+static uint32_t value_types(SsaFunc *f, uint32_t v)
+{
+    SsaValue *val = &f->values[v];
+    uint32_t t = 0, a, i;
+
+    switch (val->kind) {
+        case LOADK:
+            return T(f->cs->ctable->objects[val->arg]->type->id);
+        case LOADB:
+            return T(builtins[val->arg]->type->id);
+        case PUSHNIL:
+            return T(TYPEID_NIL);
+        case SSA_COPY:
+            return OP_TYPES(f, v, 0);
+        case SSA_PHI:
+            for (i = 0; i < val->nops; i++) {
+                t |= OP_TYPES(f, v, i);
+            }
+            return t;
+        case MKLIST:
+            return T(TYPEID_LIST);
+        case MKTUPLE:
+            return T(TYPEID_TUPLE);
+        case MKMAP:
+            return T(TYPEID_MAP);
+        case MKITER:
+            return T(TYPEID_ITERATOR);
+        case NEG:
+            a = OP_TYPES(f, v, 0);
+            return SUBSET(a, T_NUMBER) ? a : T_ANY;
+        case BWNOT:
+            return SUBSET(OP_TYPES(f, v, 0), T_INTS) ? T_INTS : T_ANY;
+        case LGNOT:
+            return SUBSET(OP_TYPES(f, v, 0), T_SCALAR) ?
+                T(TYPEID_INT) : T_ANY;
+        case CGET:
+            return OP_TYPES(f, v, 1) == T(TYPEID_STRING) ?
+                T(TYPEID_STRING) : T_ANY;
+        case CALL:
+            switch (called_builtin(f, v)) {
+                case BUILTIN_LEN:
+                    return T(TYPEID_INT);
+                case BUILTIN_TYPE: case BUILTIN_STR: case BUILTIN_HEX:
+                    return T(TYPEID_STRING);
+                case BUILTIN_INT:
+                    return T_INTS;
+                case BUILTIN_FLOAT:
+                    return T(TYPEID_FLOAT);
+                case BUILTIN_LIST:
+                    return T(TYPEID_LIST);
+                case BUILTIN_RANGE:
+                    return T(TYPEID_RANGE);
+                default:
+                    return T_ANY;
+            }
+        default:
+            if (val->kind >= ADD && val->kind <= BWAND) {
+                a = OP_TYPES(f, v, 0);
+                t = OP_TYPES(f, v, 1);
+                if (a == 0 || t == 0) {
+                    /* not known yet */
+                    return 0;
+                }
+                return binary_types(val->kind, a, t);
+            }
+            return T_ANY;
+    }
+}
+
+/**
+ * Infers the types of every value, iterating until phis settle
+ */
+static void infer_types(SsaFunc *f)
+{
+    uint32_t v, t;
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+        for (v = 0; v < f->nvalues; v++) {
+            if (find(f, v) != v) {
+                continue;
+            }
+            t = f->values[v].types | value_types(f, v);
+            if (t != f->values[v].types) {
+                f->values[v].types = t;
+                changed = true;
+            }
+        }
+    }
+    for (v = 0; v < f->nvalues; v++) {
+        if (f->values[v].types == 0) {
+            f->values[v].types = T_ANY;
+        }
+    }
+}
+
+/**
+ * Returns how freely the expression computing value v can be moved
+ */
+static int movability(SsaFunc *f, uint32_t v)
+{
+    SsaValue *val = &f->values[v];
+    uint32_t a;
+
+    if (val->kind >= ADD && val->kind <= BWNOT) {
+        if (!SUBSET(OP_TYPES(f, v, 0), T_SCALAR)) {
+            return MOVE_NEVER;
+        }
+        if (val->nops > 1 && !SUBSET(OP_TYPES(f, v, 1), T_SCALAR)) {
+            return MOVE_NEVER;
+        }
+        return MOVE_FREE;
+    }
+    switch (val->kind) {
+        case CGET:
+            /* strings and tuples never change */
+            if (SUBSET(OP_TYPES(f, v, 1),
+                        T(TYPEID_STRING) | T(TYPEID_TUPLE)) &&
+                    SUBSET(OP_TYPES(f, v, 0), T_INTS)) {
+                return MOVE_FREE;
+            }
+            return MOVE_MEMORY;
+        case CALL:
+            if (val->nops != 2) {
+                return MOVE_NEVER;
+            }
+            a = OP_TYPES(f, v, 0);
+            switch (called_builtin(f, v)) {
+                case BUILTIN_LEN:
+                    return SUBSET(a, T(TYPEID_STRING) | T(TYPEID_TUPLE) |
+                            T(TYPEID_RANGE)) ? MOVE_FREE : MOVE_MEMORY;
+                case BUILTIN_TYPE:
+                    return MOVE_FREE;
+                case BUILTIN_STR: case BUILTIN_HEX:
+                case BUILTIN_INT: case BUILTIN_FLOAT:
+                    return SUBSET(a, T_SCALAR) ? MOVE_FREE : MOVE_NEVER;
+                default:
+                    return MOVE_NEVER;
+            }
+        default:
+            return MOVE_NEVER;
+    }
+}
+
+/**
+ * Returns false if the expression computing value v can't fail
+ */
+static bool can_fail(SsaFunc *f, uint32_t v)
+{
+    SsaValue *val = &f->values[v];
+    uint32_t a = 0, b = 0;
+
+    if (val->nops > 0) {
+        a = OP_TYPES(f, v, 0);
+    }
+    if (val->nops > 1) {
+        b = OP_TYPES(f, v, 1);
+    }
+    switch (val->kind) {
+        case ADD:
+            if (a == T(TYPEID_STRING) && b == T(TYPEID_STRING)) {
+                return false;
+            }
+            /* fall through */
+        case SUB: case MUL:
+        case LT: case GT: case LTE: case GTE:
+            return !SUBSET(a, T_NUMBER) || !SUBSET(b, T_NUMBER) ||
+                float_bigint(a, b);
+        case EQ: case NEQ:
+            if (a == T(TYPEID_STRING) && b == T(TYPEID_STRING)) {
+                return false;
+            }
+            return !SUBSET(a, T_NUMBER) || !SUBSET(b, T_NUMBER) ||
+                float_bigint(a, b);
+        case BWXOR: case BWOR: case BWAND:
+            return !SUBSET(a, T_INTS) || !SUBSET(b, T_INTS);
+        case NEG:
+            return !SUBSET(a, T_NUMBER);
+        case BWNOT:
+            return !SUBSET(a, T_INTS);
+        case LGNOT:
+            return !SUBSET(a, T_SCALAR);
+        case MKLIST: case MKTUPLE:
+            return false;
+        case CALL:
+            if (val->nops != 2) {
+                return true;
+            }
+            switch (called_builtin(f, v)) {
+                case BUILTIN_LEN:
+                    return !SUBSET(a, T_SIZED);
+                case BUILTIN_TYPE:
+                    return false;
+                case BUILTIN_STR:
+                    return !SUBSET(a, T_SCALAR);
+                default:
+                    return true;
+            }
+        default:
+            return true;
+    }
+}
+
+
+/* ---------------------------------------------------------------- */
+/* Optimizations                                                    */
+/* ---------------------------------------------------------------- */
+
+/** returns true for an instruction that only pushes a value */
+static bool is_load(Opcode op)
+{
+    return op == LOADK || op == LOADS || op == LOADG || op == LOADB ||
+        op == PUSHNIL;
+}
+
+/**
+ * Returns true if the instruction at addr can go away along with the
+ * instruction consuming its value
+ *
+ * @param dead the value is unused, rather than available elsewhere
+ */
+static bool removable(SsaFunc *f, uint32_t addr, bool dead)
+{
+    SsaInstr *in = &f->instrs[addr];
+
+    if (in->save >= 0 || in->emit == EMIT_DELETE) {
+        return false;
+    }
+    if (is_load(in->op) || in->op == DUP || in->emit == EMIT_REPLACE) {
+        return true;
+    }
+    if (in->value == NONE) {
+        return false;
+    }
+    if (!dead) {
+        return movability(f, in->value) != MOVE_NEVER;
+    }
+    if (can_fail(f, in->value)) {
+        return false;
+    }
+    return in->op == MKLIST || in->op == MKTUPLE ||
+        movability(f, in->value) != MOVE_NEVER;
+}
+
+static void remove_instr(SsaFunc *f, uint32_t addr, bool dead);
+
+/**
+ * Deletes the producers of the operands of the instruction at addr
+ * where possible, and pops the rest
+ */
+static void remove_operands(SsaFunc *f, uint32_t addr, bool dead)
+{
+    uint32_t i;
+
+    for (i = 0; i < f->instrs[addr].nin; i++) {
+        uint32_t p = f->producers[f->instrs[addr].in + i];
+        if (p != NONE && removable(f, p, dead)) {
+            remove_instr(f, p, dead);
+        } else {
+            f->instrs[addr].pops++;
+        }
+    }
+}
+
+/**
+ * Deletes the instruction at addr and what only it used
+ */
+static void remove_instr(SsaFunc *f, uint32_t addr, bool dead)
+{
+    SsaInstr *in = &f->instrs[addr];
+
+    /* a replaced instruction has already dealt with its operands */
+    if (in->emit == EMIT_REPLACE) {
+        in->emit = EMIT_DELETE;
+        return;
+    }
+    in->emit = EMIT_DELETE;
+    remove_operands(f, addr, dead);
+}
+
+/**
+ * Creates a hidden local
+ */
+static int new_temp(SsaFunc *f)
+{
+    SymbolTable *ltable = f->cs->ltable;
+    uintptr_t old = (uintptr_t)ltable->objects;
+    char name[16];
+    uint32_t i;
+    int id;
+
+    /* '%' can't appear in an identifier, so these never clash */
+    do {
+        sprintf(name, "%%%u", f->ntemps++);
+    } while (symtable_id(ltable, name, SYMFIND) >= 0);
+    id = symtable_id(ltable, name, SYMCREATE);
+
+    if ((uintptr_t)ltable->objects != old) {
+        /* functions defined in this scope read its locals as globals */
+        for (i = 0; i < ltable->count; i++) {
+            LuciObject *o = ltable->objects[i];
+            if (o && ISTYPE(o, obj_func_t) &&
+                    (uintptr_t)AS_FUNCTION(o)->globals == old) {
+                AS_FUNCTION(o)->globals = ltable->objects;
+            }
+        }
+    }
+    return id;
+}
+
+/**
+ * Chooses what each LOADS reads: a constant, the first local that
+ * held its value (in functions), or what it read before
+ */
+static void forward_loads(SsaFunc *f)
+{
+    uint32_t i, u;
+
+    for (i = 0; i < f->n; i++) {
+        SsaInstr *in = &f->instrs[i];
+        if (in->op != LOADS || f->blocks[in->block].depth < 0) {
+            continue;
+        }
+        in->reads = in->version;
+        u = resolve(f, in->version);
+        if (f->values[u].kind == LOADK) {
+            in->emit_op = LOADK;
+            in->emit_arg = f->values[u].arg;
+            in->reads = NONE;
+            ssa_stats.forwarded++;
+        } else if (in->home != NONE &&
+                resolve(f, in->home_version) == u) {
+            in->emit_arg = in->home;
+            in->reads = in->home_version;
+            ssa_stats.forwarded++;
+        }
+    }
+}
+
+/**
+ * Finds natural loops, outermost first, and whether they could modify
+ * a container
+ */
+static void find_loops(SsaFunc *f)
+{
+    uint32_t *work = alloc(f->nblocks * sizeof(*work));
+    uint32_t i, j, k, b, h, nwork;
+
+    for (i = 0; i < f->norder; i++) {
+        b = f->order[i];
+        for (j = 0; j < f->blocks[b].nsuccs; j++) {
+            SsaLoop *loop = NULL;
+            h = f->blocks[b].succs[j];
+            if (!dominates(f, h, b)) {
+                continue;
+            }
+            for (k = 0; k < f->nloops; k++) {
+                if (f->loops[k].header == h) {
+                    loop = &f->loops[k];
+                }
+            }
+            if (!loop) {
+                f->loops = realloc(f->loops,
+                        (f->nloops + 1) * sizeof(*f->loops));
+                loop = &f->loops[f->nloops++];
+                memset(loop, 0, sizeof(*loop));
+                loop->header = h;
+                loop->body = alloc(f->nblocks * sizeof(*loop->body));
+                loop->body[h] = true;
+                loop->size = 1;
+            }
+            /* everything that reaches the back edge without the header */
+            nwork = 0;
+            if (!loop->body[b]) {
+                loop->body[b] = true;
+                loop->size++;
+                work[nwork++] = b;
+            }
+            while (nwork > 0) {
+                uint32_t w = work[--nwork];
+                for (k = 0; k < f->blocks[w].npreds; k++) {
+                    uint32_t p = f->blocks[w].preds[k];
+                    if (!loop->body[p]) {
+                        loop->body[p] = true;
+                        loop->size++;
+                        work[nwork++] = p;
+                    }
+                }
+            }
+        }
+    }
+    free(work);
+
+    for (i = 0; i < f->nloops; i++) {
+        SsaLoop *loop = &f->loops[i];
+        for (b = 0; b < f->nblocks && !loop->clobbers; b++) {
+            if (!loop->body[b]) {
+                continue;
+            }
+            for (k = f->blocks[b].start; k < f->blocks[b].end; k++) {
+                SsaInstr *in = &f->instrs[k];
+                if (in->op == CPUT || (in->op == CALL &&
+                            called_builtin(f, in->value) <= BUILTIN_OTHER)) {
+                    loop->clobbers = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    /* outer loops are larger than the loops inside them */
+    for (i = 1; i < f->nloops; i++) {
+        SsaLoop tmp = f->loops[i];
+        for (j = i; j > 0 && f->loops[j - 1].size < tmp.size; j--) {
+            f->loops[j] = f->loops[j - 1];
+        }
+        f->loops[j] = tmp;
+    }
+}
+
+/** returns true if version v of a variable was assigned inside loop */
+static bool defined_in(SsaFunc *f, SsaLoop *loop, uint32_t v)
+{
+    uint32_t b = f->values[find(f, v)].block;
+    return b != NONE && loop->body[b];
+}
+
+/**
+ * Collects the expression tree computing the value of the instruction
+ * at addr, if it can be computed before loop
+ *
+ * @param fails set if any part of it could fail
+ * @returns the tree's first address, or NONE
+ */
+static uint32_t invariant_tree(SsaFunc *f, SsaLoop *loop, uint32_t addr,
+        bool *fails)
+{
+    SsaInstr *in = &f->instrs[addr];
+    uint32_t first = addr, i, start;
+
+    if (in->emit != EMIT_KEEP || in->save >= 0) {
+        return NONE;
+    }
+    if (is_load(in->op)) {
+        if (in->op == LOADS && in->emit_op == LOADS &&
+                defined_in(f, loop, in->reads)) {
+            return NONE;
+        }
+        return addr;
+    }
+    if (in->value == NONE) {
+        return NONE;
+    }
+    switch (movability(f, in->value)) {
+        case MOVE_FREE:
+            break;
+        case MOVE_MEMORY:
+            if (loop->clobbers) {
+                return NONE;
+            }
+            break;
+        default:
+            return NONE;
+    }
+    *fails |= can_fail(f, in->value);
+
+    /* operands were pushed in order just before the instruction */
+    for (i = in->nin; i > 0; i--) {
+        uint32_t p = f->producers[in->in + i - 1];
+        if (p != first - 1) {
+            return NONE;
+        }
+        start = invariant_tree(f, loop, p, fails);
+        if (start == NONE) {
+            return NONE;
+        }
+        first = start;
+    }
+    return first;
+}
+
+/** a value number table entry */
+typedef struct ssa_vn_ {
+    uint32_t value;     /**< first value with this number */
+    uint32_t hash;      /**< hash of its opcode and operands */
+    uint32_t next;      /**< next entry in the bucket, or NONE */
+} SsaVn;
+
+#define VN_BUCKETS      1024
+
+static uint32_t vn_hash(SsaFunc *f, uint32_t v)
+{
+    SsaValue *val = &f->values[v];
+    uint32_t h = val->kind * 31 + val->arg, i;
+
+    for (i = 0; i < val->nops; i++) {
+        h = h * 31 + f->values[resolve(f, val->ops[i])].rep;
+    }
+    return h * 2654435761u;
+}
+
+static bool vn_equal(SsaFunc *f, uint32_t a, uint32_t b)
+{
+    SsaValue *va = &f->values[a], *vb = &f->values[b];
+    uint32_t i;
+
+    if (va->kind != vb->kind || va->arg != vb->arg || va->nops != vb->nops) {
+        return false;
+    }
+    for (i = 0; i < va->nops; i++) {
+        if (f->values[resolve(f, va->ops[i])].rep !=
+                f->values[resolve(f, vb->ops[i])].rep) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Moves expressions that don't change in a loop to just before it
+ */
+static void hoist_invariants(SsaFunc *f)
+{
+    uint32_t i, j, k, b, addr, first;
+
+    for (i = 0; i < f->norder; i++) {
+        b = f->order[i];
+        /* from the end of the block, so the largest tree moves */
+        for (addr = f->blocks[b].end; addr-- > f->blocks[b].start; ) {
+            SsaInstr *in = &f->instrs[addr];
+            if (in->emit != EMIT_KEEP || in->value == NONE ||
+                    movability(f, in->value) == MOVE_NEVER) {
+                continue;
+            }
+            for (j = 0; j < f->nloops; j++) {
+                SsaLoop *loop = &f->loops[j];
+                bool fails = false;
+                if (!loop->body[b]) {
+                    continue;
+                }
+                first = invariant_tree(f, loop, addr, &fails);
+                if (first == NONE) {
+                    continue;
+                }
+                if (fails) {
+                    /* only where the loop would have run it first */
+                    if (b != loop->header) {
+                        continue;
+                    }
+                    for (k = f->blocks[b].start; k < first; k++) {
+                        Opcode op = f->instrs[k].op;
+                        if (!is_load(op) && op != DUP && op != STORE &&
+                                op != NOP) {
+                            break;
+                        }
+                    }
+                    if (k < first) {
+                        continue;
+                    }
+                }
+                in->emit = EMIT_REPLACE;
+                remove_operands(f, addr, false);
+                /* the same expression may already be computed there */
+                for (k = 1; k < loop->nhoisted; k += 2) {
+                    SsaInstr *prev = &f->instrs[loop->hoisted[k]];
+                    if (vn_equal(f, prev->value, in->value)) {
+                        in->slot = prev->slot;
+                        ssa_stats.reused++;
+                        break;
+                    }
+                }
+                if (k < loop->nhoisted) {
+                    break;
+                }
+                append(&loop->hoisted, &loop->nhoisted, &loop->ahoisted,
+                        first);
+                append(&loop->hoisted, &loop->nhoisted, &loop->ahoisted,
+                        addr);
+                in->slot = new_temp(f);
+                ssa_stats.hoisted++;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Replaces expressions computed again where their value is already
+ * known by a load of a saved copy
+ *
+ * Walks the dominator tree, so an expression is only matched against
+ * ones on every path to it.
+ */
+static void reuse_expressions(SsaFunc *f)
+{
+    uint32_t buckets[VN_BUCKETS];
+    SsaVn *table = alloc((f->nvalues + 1) * sizeof(*table));
+    uint32_t *children = alloc(f->nblocks * sizeof(*children));
+    uint32_t *sibling = alloc(f->nblocks * sizeof(*sibling));
+    uint32_t *stack = alloc(2 * f->nblocks * sizeof(*stack));
+    uint32_t *marks = alloc(f->nblocks * sizeof(*marks));
+    uint32_t ntable = 0, sp = 0, i, b, addr;
+
+    memset(buckets, 0xFF, sizeof(buckets));
+    memset(children, 0xFF, f->nblocks * sizeof(*children));
+    for (i = f->norder; i-- > 1; ) {
+        b = f->order[i];
+        sibling[b] = children[f->blocks[b].idom];
+        children[f->blocks[b].idom] = b;
+    }
+
+    stack[sp++] = 0;
+    while (sp > 0) {
+        b = stack[--sp];
+        if (b & 0x80000000u) {
+            /* leaving the block: forget its expressions */
+            b &= ~0x80000000u;
+            while (ntable > marks[b]) {
+                SsaVn *e = &table[--ntable];
+                buckets[e->hash % VN_BUCKETS] = e->next;
+            }
+            continue;
+        }
+        marks[b] = ntable;
+        stack[sp++] = b | 0x80000000u;
+        for (i = children[b]; i != NONE; i = sibling[i]) {
+            stack[sp++] = i;
+        }
+
+        for (addr = f->blocks[b].start; addr < f->blocks[b].end; addr++) {
+            SsaInstr *in = &f->instrs[addr];
+            uint32_t h, e, v = in->value;
+            if (v == NONE || in->emit == EMIT_DELETE ||
+                    movability(f, v) != MOVE_FREE) {
+                continue;
+            }
+            h = vn_hash(f, v);
+            for (e = buckets[h % VN_BUCKETS]; e != NONE; e = table[e].next) {
+                if (table[e].hash == h && vn_equal(f, table[e].value, v)) {
+                    break;
+                }
+            }
+            if (e == NONE) {
+                table[ntable].value = v;
+                table[ntable].hash = h;
+                table[ntable].next = buckets[h % VN_BUCKETS];
+                buckets[h % VN_BUCKETS] = ntable++;
+                continue;
+            }
+
+            SsaInstr *src = &f->instrs[f->values[table[e].value].addr];
+            if (src->emit == EMIT_DELETE || in->emit != EMIT_KEEP) {
+                continue;
+            }
+            if (src->emit != EMIT_REPLACE && src->save < 0) {
+                src->save = new_temp(f);
+            }
+            in->slot = src->emit == EMIT_REPLACE ? src->slot : src->save;
+            in->emit = EMIT_REPLACE;
+            f->values[v].rep = table[e].value;
+            remove_operands(f, addr, false);
+            ssa_stats.reused++;
+        }
+    }
+
+    free(marks);
+    free(stack);
+    free(sibling);
+    free(children);
+    free(table);
+}
+
+/** marks version v, and the versions that can reach it, as read */
+static void mark_live(SsaFunc *f, uint32_t v)
+{
+    uint32_t i;
+
+    v = find(f, v);
+    if (f->values[v].live) {
+        return;
+    }
+    f->values[v].live = true;
+    if (f->values[v].kind == SSA_PHI) {
+        for (i = 0; i < f->values[v].nops; i++) {
+            mark_live(f, f->values[v].ops[i]);
+        }
+    }
+}
+
+/**
+ * Removes stores of versions that are never read (in functions) and
+ * expressions whose value is popped, until no more can go
+ */
+static void remove_dead(SsaFunc *f)
+{
+    uint32_t i, j, p;
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        if (!f->global) {
+            for (i = 0; i < f->nvalues; i++) {
+                f->values[i].live = false;
+            }
+            for (i = 0; i < f->n; i++) {
+                SsaInstr *in = &f->instrs[i];
+                if (in->op == LOADS && in->emit == EMIT_KEEP &&
+                        in->emit_op == LOADS &&
+                        f->blocks[in->block].depth >= 0) {
+                    mark_live(f, in->reads);
+                }
+            }
+            for (i = 0; i < f->nloops; i++) {
+                SsaLoop *loop = &f->loops[i];
+                for (j = 0; j < loop->nhoisted; j += 2) {
+                    for (p = loop->hoisted[j]; p <= loop->hoisted[j + 1]; p++) {
+                        SsaInstr *in = &f->instrs[p];
+                        if (in->op == LOADS && in->emit_op == LOADS) {
+                            mark_live(f, in->reads);
+                        }
+                    }
+                }
+            }
+            for (i = 0; i < f->n; i++) {
+                SsaInstr *in = &f->instrs[i];
+                if (in->op != STORE || in->emit != EMIT_KEEP ||
+                        in->emit_op != STORE ||
+                        f->blocks[in->block].depth < 0 ||
+                        f->values[in->version].live) {
+                    continue;
+                }
+                p = f->producers[in->in];
+                /* keep the stores ITERJUMP and UNPACK make themselves */
+                if (p == NONE || f->instrs[p].op == UNPACK) {
+                    continue;
+                }
+                in->emit_op = POP;
+                in->emit_arg = 0;
+                ssa_stats.stores++;
+                changed = true;
+            }
+        }
+
+        for (i = 0; i < f->n; i++) {
+            SsaInstr *in = &f->instrs[i];
+            if (in->emit != EMIT_KEEP || in->emit_op != POP ||
+                    f->blocks[in->block].depth < 0) {
+                continue;
+            }
+            p = f->producers[in->in];
+            if (p != NONE && removable(f, p, true)) {
+                remove_instr(f, p, true);
+                in->emit = EMIT_DELETE;
+                changed = true;
+            }
+        }
+    }
+}
+
+
+/* ---------------------------------------------------------------- */
+/* Lowering                                                         */
+/* ---------------------------------------------------------------- */
+
+/** an emitted instruction */
+typedef struct ssa_out_ {
+    Opcode op;          /**< opcode */
+    int arg;            /**< argument, or original jump target */
+    uint32_t from;      /**< original address, for jumps */
+} SsaOut;
+
+static void emit(SsaOut **out, uint32_t *count, uint32_t *size, Opcode op,
+        int arg, uint32_t from)
+{
+    if (*count >= *size) {
+        *size = *size * 2 + 16;
+        *out = realloc(*out, *size * sizeof(**out));
+        if (!*out) {
+            LUCI_DIE("%s", "Could not grow SSA output\n");
+        }
+    }
+    (*out)[*count].op = op;
+    (*out)[*count].arg = arg;
+    (*out)[*count].from = from;
+    (*count)++;
+}
+
+/**
+ * Writes the optimized instructions back to the CompileState
+ */
+static void lower(SsaFunc *f)
+{
+    CompileState *cs = f->cs;
+    uint32_t n = f->n, count = 0, size = n + 16, i, j, k, p;
+    uint32_t *outer = alloc((n + 1) * sizeof(*outer));
+    uint32_t *inner = alloc((n + 1) * sizeof(*inner));
+    uint32_t *loop_at = alloc((n + 1) * sizeof(*loop_at));
+    SsaOut *out = alloc(size * sizeof(*out));
+
+    memset(loop_at, 0xFF, (n + 1) * sizeof(*loop_at));
+    for (i = 0; i < f->nloops; i++) {
+        if (f->loops[i].nhoisted > 0) {
+            loop_at[f->blocks[f->loops[i].header].start] = i;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        SsaInstr *in = &f->instrs[i];
+
+        /* jumps from outside the loop run the hoisted code */
+        outer[i] = count;
+        if (loop_at[i] != NONE) {
+            SsaLoop *loop = &f->loops[loop_at[i]];
+            for (j = 0; j < loop->nhoisted; j += 2) {
+                uint32_t root = loop->hoisted[j + 1];
+                for (p = loop->hoisted[j]; p <= root; p++) {
+                    emit(&out, &count, &size, f->instrs[p].emit_op,
+                            f->instrs[p].emit_arg, p);
+                }
+                emit(&out, &count, &size, STORE, f->instrs[root].slot, root);
+            }
+        }
+        inner[i] = count;
+
+        for (k = 0; k < in->pops; k++) {
+            emit(&out, &count, &size, POP, 0, i);
+        }
+        switch (in->emit) {
+            case EMIT_KEEP:
+                emit(&out, &count, &size, in->emit_op, in->emit_arg, i);
+                break;
+            case EMIT_REPLACE:
+                emit(&out, &count, &size, LOADS, in->slot, i);
+                break;
+            default:
+                break;
+        }
+        if (in->save >= 0 && in->emit != EMIT_DELETE) {
+            emit(&out, &count, &size, DUP, 0, i);
+            emit(&out, &count, &size, STORE, in->save, i);
+        }
+    }
+    outer[n] = inner[n] = count;
+
+    if (count > cs->instr_alloc) {
+        cs->instr_alloc = count;
+        cs->instructions = realloc(cs->instructions,
+                cs->instr_alloc * sizeof(*cs->instructions));
+        if (!cs->instructions) {
+            LUCI_DIE("%s", "Could not grow instructions\n");
+        }
+    }
+    for (i = 0; i < count; i++) {
+        int arg = out[i].arg;
+        Instruction instr = out[i].op << OPCODE_SHIFT;
+        if (IS_JUMP(out[i].op)) {
+            uint32_t t = arg, l = loop_at[t];
+            if (l != NONE &&
+                    f->loops[l].body[f->block_of[out[i].from]]) {
+                arg = inner[t];
+            } else {
+                arg = outer[t];
+            }
+            /* jumps are relative, as written by the compiler */
+            arg -= i;
+        }
+        if (arg < 0) {
+            arg = -arg;
+            instr |= OPARG_NEG_BIT;
+        }
+        cs->instructions[i] = instr | (OPARG_MASK & arg);
+    }
+    cs->instr_count = count;
+
+    free(out);
+    free(loop_at);
+    free(inner);
+    free(outer);
+}
+
+static void ssa_func_delete(SsaFunc *f)
+{
+    uint32_t i;
+
+    for (i = 0; i < f->nvalues; i++) {
+        free(f->values[i].ops);
+        free(f->values[i].users);
+    }
+    for (i = 0; i < f->nblocks; i++) {
+        free(f->blocks[i].preds);
+        free(f->blocks[i].phis);
+    }
+    for (i = 0; i < f->nloops; i++) {
+        free(f->loops[i].body);
+        free(f->loops[i].hoisted);
+    }
+    free(f->loops);
+    free(f->builtin_kind);
+    free(f->builtins);
+    free(f->globals);
+    free(f->constants);
+    free(f->values);
+    free(f->entries);
+    free(f->defs);
+    free(f->order);
+    free(f->block_of);
+    free(f->blocks);
+    free(f->producers);
+    free(f->instrs);
+}
+
+/**
+ * Optimizes the instructions of the given CompileState in place
+ *
+ * @param cs CompileState whose instructions are complete
+ */
+void ssa_optimize(CompileState *cs)
+{
+    SsaFunc func, *f = &func;
+    uint32_t i;
+    int id;
+
+    if (cs->instr_count == 0) {
+        return;
+    }
+
+    memset(f, 0, sizeof(*f));
+    f->cs = cs;
+    f->global = cs->gtable == NULL;
+    f->n = cs->instr_count;
+    f->nlocals = cs->ltable->count;
+    f->nil = NONE;
+
+    f->instrs = alloc(f->n * sizeof(*f->instrs));
+    for (i = 0; i < f->n; i++) {
+        SsaInstr *in = &f->instrs[i];
+        in->op = OPCODE(cs->instructions[i]);
+        in->arg = OPARG(cs->instructions[i]);
+        if (IS_JUMP(in->op)) {
+            in->arg += i;
+        }
+        in->value = NONE;
+        in->version = NONE;
+        in->home = NONE;
+        in->reads = NONE;
+        in->emit_op = in->op;
+        in->emit_arg = in->arg;
+        in->slot = -1;
+        in->save = -1;
+    }
+
+    if (!build_blocks(f) || !find_depths(f) ||
+            (uint64_t)f->nblocks * (f->nlocals + f->maxdepth + 2) > MAX_DEFS) {
+        ssa_func_delete(f);
+        return;
+    }
+    order_blocks(f);
+    find_dominators(f);
+
+    f->constants = alloc(cs->ctable->count * sizeof(*f->constants));
+    memset(f->constants, 0xFF, cs->ctable->count * sizeof(*f->constants));
+    f->nglobals = cs->gtable ? cs->gtable->count : 0;
+    f->globals = alloc((f->nglobals + 1) * sizeof(*f->globals));
+    memset(f->globals, 0xFF, (f->nglobals + 1) * sizeof(*f->globals));
+    f->builtins = alloc(builtin_symbols->count * sizeof(*f->builtins));
+    memset(f->builtins, 0xFF, builtin_symbols->count * sizeof(*f->builtins));
+    f->builtin_kind = alloc(builtin_symbols->count);
+    for (i = 0; known_builtins[i].name; i++) {
+        id = symtable_id(builtin_symbols, known_builtins[i].name, SYMFIND);
+        if (id >= 0) {
+            f->builtin_kind[id] = known_builtins[i].kind;
+        }
+    }
+
+    build_ssa(f);
+    infer_types(f);
+    forward_loads(f);
+    find_loops(f);
+    hoist_invariants(f);
+    reuse_expressions(f);
+    remove_dead(f);
+    lower(f);
+
+    ssa_func_delete(f);
+}
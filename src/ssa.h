@@ -0,0 +1,28 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file ssa.h
+ */
+
+#ifndef SSA_H
+#define SSA_H
+
+#include "compile.h"
+
+/**
+ * Running totals over every CompileState given to ssa_optimize
+ */
+typedef struct ssa_stats_ {
+    uint32_t forwarded; /**< loads replaced by a constant or another local */
+    uint32_t hoisted;   /**< expressions moved out of loops */
+    uint32_t reused;    /**< expressions replaced by an earlier result */
+    uint32_t stores;    /**< stores of values that are never read */
+} SsaStats;
+
+extern SsaStats ssa_stats;
+
+void ssa_optimize(CompileState *);
+
+#endif
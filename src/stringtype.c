@@ -4,19 +4,47 @@
 
 /**
  * @file stringtype.c
+ *
+ * Strings are immutable, so assigning or passing a string shares the
+ * same object. Slicing a string creates a new object pointing into
+ * the same reference-counted buffer, so no characters are copied.
+ * A slice (view) is not NUL-terminated unless it ends where its
+ * buffer ends; use LuciString_cstr when a C-string is needed.
+ *
+ * Strings hold UTF-8, and lengths and indices count codepoints.
+ * Strings that turn out to be pure ASCII (the common case) are
+ * indexed by byte in O(1). Other strings lazily build a sparse index
+ * holding the byte offset of every STRING_INDEX_STRIDE'th codepoint,
+ * so that finding any codepoint decodes at most that many.
  */
 
 #include "stringtype.h"
+#include "hash.h"
+#include "strsearch.h"
+#include "utf8.h"
 
+static uint64_t string_hash(LuciObject *s);
 static unsigned int string_hash_0(LuciObject *s);
 static unsigned int string_hash_1(LuciObject *s);
-static unsigned int string_hash_2(LuciObject *s);
+
+/** immortal single-character strings, indexed by character */
+static LuciStringObj string_chars[256];
+/** NUL-terminated contents of each single-character string */
+static char string_char_bufs[256][2];
+/** whether string_chars has been populated */
+static bool string_chars_ready = false;
+
+/** true if o is one of the cached single-character strings */
+#define IS_CACHED_CHAR(o) \
+    ((LuciStringObj *)(o) >= string_chars && \
+     (LuciStringObj *)(o) < string_chars + 256)
 
 
 /** Type member table for LuciStringObj */
 LuciObjectType obj_string_t = {
     "string",
     sizeof(LuciStringObj),
+    TYPEID_STRING,
 
     LuciString_copy,
     LuciString_copy,
@@ -71,35 +99,348 @@ LuciObject *LuciString_new(char *s)
     LuciStringObj *o = (LuciStringObj*)gc_malloc(&obj_string_t);
     o->s = s;   /* not a copy! */
     o->len = strlen(o->s);
+    o->hash = 0;
+    o->buf = NULL;
+    o->cplen = -1;
+    o->cpindex = NULL;
     return (LuciObject *)o;
 }
 
+/**
+ * Verifies that a LuciStringObj holds valid UTF-8
+ *
+ * Called on strings from outside the interpreter (source code and
+ * files). Also records the string's codepoint count.
+ *
+ * @param o LuciStringObj
+ * @returns true if o is valid UTF-8
+ */
+bool LuciString_validate(LuciObject *o)
+{
+    return utf8_validate(AS_STRING(o)->s, AS_STRING(o)->len,
+            &AS_STRING(o)->cplen);
+}
+
+/**
+ * Returns the number of codepoints in a LuciStringObj
+ *
+ * @param o LuciStringObj
+ * @returns codepoint count
+ */
+static long string_cplen(LuciObject *o)
+{
+    LuciStringObj *str = AS_STRING(o);
+
+    if (str->cplen < 0) {
+        str->cplen = utf8_count(str->s, str->len);
+    }
+    return str->cplen;
+}
+
+/** true if every codepoint in LuciStringObj o is a single byte */
+#define STRING_IS_ASCII(o)  (string_cplen(o) == AS_STRING(o)->len)
+
+/**
+ * Builds the sparse codepoint index of a non-ASCII LuciStringObj
+ *
+ * @param o LuciStringObj
+ */
+static void string_build_index(LuciObject *o)
+{
+    LuciStringObj *str = AS_STRING(o);
+    long entries = string_cplen(o) / STRING_INDEX_STRIDE + 1;
+    long i, cp = 0;
+
+    str->cpindex = alloc(entries * sizeof(*str->cpindex));
+    for (i = 0; i < str->len; i++) {
+        if (!UTF8_IS_CONT(str->s[i])) {
+            if (cp % STRING_INDEX_STRIDE == 0) {
+                str->cpindex[cp / STRING_INDEX_STRIDE] = i;
+            }
+            cp++;
+        }
+    }
+    /* an entry for the end, when the count is a multiple of the
+     * stride, keeps string_cp_offset's search inside the index */
+    if (cp % STRING_INDEX_STRIDE == 0) {
+        str->cpindex[cp / STRING_INDEX_STRIDE] = str->len;
+    }
+}
+
+/**
+ * Converts a codepoint index into a byte offset
+ *
+ * @param o LuciStringObj
+ * @param cp codepoint index, from 0 to the codepoint count
+ * @returns byte offset of codepoint cp
+ */
+static long string_byte_offset(LuciObject *o, long cp)
+{
+    LuciStringObj *str = AS_STRING(o);
+
+    if (STRING_IS_ASCII(o)) {
+        return cp;
+    } else if (cp >= str->cplen) {
+        return str->len;
+    }
+
+    if (!str->cpindex) {
+        string_build_index(o);
+    }
+    long b = str->cpindex[cp / STRING_INDEX_STRIDE];
+    long k = cp % STRING_INDEX_STRIDE;
+    while (k-- > 0) {
+        b++;
+        while (b < str->len && UTF8_IS_CONT(str->s[b])) {
+            b++;
+        }
+    }
+    return b;
+}
+
+/**
+ * Converts a byte offset into a codepoint index
+ *
+ * @param o LuciStringObj
+ * @param b byte offset at a codepoint boundary
+ * @returns index of the codepoint starting at b
+ */
+static long string_cp_offset(LuciObject *o, long b)
+{
+    LuciStringObj *str = AS_STRING(o);
+
+    if (STRING_IS_ASCII(o)) {
+        return b;
+    }
+
+    if (!str->cpindex) {
+        string_build_index(o);
+    }
+
+    /* find the last index entry at or before b */
+    long lo = 0, hi = str->cplen / STRING_INDEX_STRIDE;
+    while (lo < hi) {
+        long mid = (lo + hi + 1) / 2;
+        if (str->cpindex[mid] <= b) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    long from = str->cpindex[lo];
+    return lo * STRING_INDEX_STRIDE + utf8_count(str->s + from, b - from);
+}
+
+/**
+ * Returns the single-character LuciStringObj for a character
+ *
+ * These strings are statically allocated (GC_STATIC), so indexing
+ * or iterating over a string never allocates. They are immutable:
+ * copying one returns the same object.
+ *
+ * @param c character
+ * @returns cached LuciStringObj
+ */
+LuciObject *LuciString_char(unsigned char c)
+{
+    if (!string_chars_ready) {
+        unsigned int i;
+        for (i = 0; i < 256; i++) {
+            string_char_bufs[i][0] = (char)i;
+            string_char_bufs[i][1] = '\0';
+            string_chars[i].base.type = &obj_string_t;
+            string_chars[i].base.reachable = GC_STATIC;
+            string_chars[i].s = string_char_bufs[i];
+            string_chars[i].len = 1;
+            string_chars[i].hash = 0;
+            string_chars[i].buf = NULL;
+            string_chars[i].cplen = 1;
+            string_chars[i].cpindex = NULL;
+        }
+        string_chars_ready = true;
+    }
+    return (LuciObject *)&string_chars[c];
+}
+
+/**
+ * Returns the shared buffer of a LuciStringObj, creating
+ * it if the string currently owns its characters privately
+ *
+ * @param o LuciStringObj
+ * @returns shared buffer
+ */
+static LuciStringBuf *string_share(LuciObject *o)
+{
+    LuciStringObj *str = AS_STRING(o);
+
+    if (!str->buf) {
+        str->buf = alloc(sizeof(*str->buf));
+        str->buf->base = str->s;
+        str->buf->size = str->len;
+        str->buf->refs = 1;
+    }
+    return str->buf;
+}
+
+/**
+ * Drops a LuciStringObj's reference to its shared buffer,
+ * freeing the buffer if it was the last reference
+ *
+ * @param o LuciStringObj
+ */
+static void string_release(LuciObject *o)
+{
+    LuciStringBuf *buf = AS_STRING(o)->buf;
+
+    if (--buf->refs == 0) {
+        free(buf->base);
+        free(buf);
+    }
+    AS_STRING(o)->buf = NULL;
+}
+
+/**
+ * Gives a LuciStringObj its own private, NUL-terminated copy of
+ * its characters, so that it may outlive its buffer or be used as
+ * a C-string
+ *
+ * @param o LuciStringObj
+ */
+static void string_detach(LuciObject *o)
+{
+    LuciStringObj *str = AS_STRING(o);
+
+    if (!str->buf) {
+        return;
+    }
+
+    if (str->buf->refs == 1 && str->s == str->buf->base &&
+            str->len == str->buf->size) {
+        /* sole owner of the entire buffer, so just take it back */
+        free(str->buf);
+        str->buf = NULL;
+        return;
+    }
+
+    char *s = alloc(str->len + 1);
+    memcpy(s, str->s, str->len);
+    s[str->len] = '\0';
+    string_release(o);
+    str->s = s;
+}
+
+/**
+ * Creates a view of a byte range of a LuciStringObj without copying
+ *
+ * @param o LuciStringObj
+ * @param start byte offset of the first character
+ * @param end byte offset one past the last character
+ * @returns new LuciStringObj sharing o's characters
+ */
+static LuciObject *string_view(LuciObject *o, long start, long end)
+{
+    if (IS_CACHED_CHAR(o)) {
+        /* never share a static buffer */
+        return (end > start) ? o : LuciString_new(alloc(1));
+    }
+
+    LuciStringBuf *buf = string_share(o);
+    LuciStringObj *view = (LuciStringObj*)gc_malloc(&obj_string_t);
+    view->s = AS_STRING(o)->s + start;
+    view->len = end - start;
+    view->buf = buf;
+    buf->refs++;
+    if (view->len == AS_STRING(o)->len) {
+        view->hash = AS_STRING(o)->hash;
+        view->cplen = AS_STRING(o)->cplen;
+    } else {
+        view->hash = 0;
+        view->cplen = -1;
+    }
+    view->cpindex = NULL;
+    return (LuciObject *)view;
+}
+
+/**
+ * Creates a view of part of a LuciStringObj without copying
+ *
+ * Indices count codepoints. Negative indices count from the end of
+ * the string and out-of-range indices are clamped, e.g.
+ * slice("hello", 1, -1) is "ell".
+ *
+ * @param o LuciStringObj to slice
+ * @param start index of first character
+ * @param end index one past the last character
+ * @returns new LuciStringObj sharing o's characters
+ */
+LuciObject *LuciString_slice(LuciObject *o, long start, long end)
+{
+    long len = string_cplen(o);
+
+    if (start < 0) {
+        start += len;
+    }
+    if (end < 0) {
+        end += len;
+    }
+    if (start < 0) {
+        start = 0;
+    }
+    if (end > len) {
+        end = len;
+    }
+    if (end < start) {
+        end = start;
+    }
+
+    LuciObject *view = string_view(o, string_byte_offset(o, start),
+            string_byte_offset(o, end));
+    AS_STRING(view)->cplen = end - start;
+    return view;
+}
+
+/**
+ * Returns a NUL-terminated C-string of a LuciStringObj's contents
+ *
+ * Views that do not extend to the end of their buffer are first
+ * given a private copy of their characters.
+ *
+ * @param o LuciStringObj
+ * @returns C-string owned by o
+ */
+char *LuciString_cstr(LuciObject *o)
+{
+    LuciStringObj *str = AS_STRING(o);
+
+    /* s[len] is always within the buffer, which is NUL-terminated */
+    if (str->s[str->len] != '\0') {
+        string_detach(o);
+    }
+    return str->s;
+}
+
 /**
  * Copies a LuciStringObj
  *
+ * Strings are immutable, so copies share the original.
+ *
  * @param orig LucStringObj to copy
- * @returns new copy of orig
+ * @returns orig
  */
 LuciObject* LuciString_copy(LuciObject *orig)
 {
-    return LuciString_new(strdup(((LuciStringObj *)orig)->s));
+    return orig;
 }
 
 /**
  * Produces the LuciStringObj representation of a LuciStringObj
  *
- * While this may seem redundant, cast a string to a string
- * must return a *new* string.
- *
  * @param o LuciStringObj to represent
  * @returns LuciStringObj representation of o
  */
 LuciObject* LuciString_repr(LuciObject *o)
 {
-    int len = AS_STRING(o)->len + 1;
-    char *s = alloc(len);
-    strncpy(s, AS_STRING(o)->s, len);
-    return LuciString_new(s);
+    return LuciString_copy(o);
 }
 
 /**
@@ -110,18 +451,18 @@ LuciObject* LuciString_repr(LuciObject *o)
  */
 LuciObject* LuciString_asbool(LuciObject *o)
 {
-    return LuciInt_new(AS_STRING(o)->len > 0);
+    return LuciBool(AS_STRING(o)->len > 0);
 }
 
 /**
- * Returns the length of a LuciStringObj
+ * Returns the length of a LuciStringObj in codepoints
  *
  * @param o LuciStringObj
  * @returns length of o
  */
 LuciObject* LuciString_len(LuciObject *o)
 {
-    return LuciInt_new(AS_STRING(o)->len);
+    return LuciInt_new(string_cplen(o));
 }
 
 
@@ -135,10 +476,17 @@ LuciObject* LuciString_len(LuciObject *o)
 LuciObject* LuciString_add(LuciObject *a, LuciObject *b)
 {
     if (ISTYPE(b, obj_string_t)) {
-        char *s = alloc(AS_STRING(a)->len + AS_STRING(b)-> len + 1);
-        strncpy(s, AS_STRING(a)->s, AS_STRING(a)->len);
-        strncat(s, AS_STRING(b)->s, AS_STRING(b)->len);
-        return LuciString_new(s);
+        long alen = AS_STRING(a)->len, blen = AS_STRING(b)->len;
+        char *s = alloc(alen + blen + 1);
+        memcpy(s, AS_STRING(a)->s, alen);
+        memcpy(s + alen, AS_STRING(b)->s, blen);
+        s[alen + blen] = '\0';
+
+        LuciObject *ret = LuciString_new(s);
+        if (AS_STRING(a)->cplen >= 0 && AS_STRING(b)->cplen >= 0) {
+            AS_STRING(ret)->cplen = AS_STRING(a)->cplen + AS_STRING(b)->cplen;
+        }
+        return ret;
     } else {
         LUCI_DIE("Cannot append object of type %s to a string\n",
                 b->type->type_name);
@@ -157,14 +505,31 @@ LuciObject* LuciString_add(LuciObject *a, LuciObject *b)
 LuciObject* LuciString_mul(LuciObject *a, LuciObject *b)
 {
     if (ISTYPE(b, obj_int_t)) {
-        char *s = alloc(AS_STRING(a)->len * AS_INT(b)->i + 1);
-        *s = '\0';
+        long len = AS_STRING(a)->len;
+        long times = AS_INT(b)->i;
+        if (times < 0) {
+            times = 0;
+        }
+        long total = len * times;
+        char *s = alloc(total + 1);
+
+        /* copy once, then keep doubling the filled prefix */
+        if (total > 0) {
+            long filled = len;
+            memcpy(s, AS_STRING(a)->s, len);
+            while (filled < total) {
+                long n = (filled <= total - filled) ? filled : total - filled;
+                memcpy(s + filled, s, n);
+                filled += n;
+            }
+        }
+        s[total] = '\0';
 
-        int i;
-        for (i = 0; i < AS_INT(b)->i; i++) {
-            strncat(s, AS_STRING(a)->s, AS_STRING(a)->len);
+        LuciObject *ret = LuciString_new(s);
+        if (AS_STRING(a)->cplen >= 0) {
+            AS_STRING(ret)->cplen = AS_STRING(a)->cplen * times;
         }
-        return LuciString_new(s);
+        return ret;
     } else {
         LUCI_DIE("Cannot multiply a string by an object of type %s\n",
                 b->type->type_name);
@@ -184,12 +549,12 @@ LuciObject* LuciString_eq(LuciObject *a, LuciObject *b)
 {
     if(ISTYPE(b, obj_string_t)) {
         if (AS_STRING(a)->len != AS_STRING(b)->len) {
-            return LuciInt_new(false);
+            return LuciFalseObj;
         }
-        if ((strncmp(AS_STRING(a)->s, AS_STRING(b)->s, AS_STRING(a)->len)) == 0) {
-            return LuciInt_new(true);
+        if (memcmp(AS_STRING(a)->s, AS_STRING(b)->s, AS_STRING(a)->len) == 0) {
+            return LuciTrueObj;
         } else {
-            return LuciInt_new(false);
+            return LuciFalseObj;
         }
     } else {
         LUCI_DIE("Cannot compare a string to an object of type %s\n",
@@ -211,11 +576,235 @@ LuciObject *LuciString_contains(LuciObject *str, LuciObject *o)
         LUCI_DIE("A string can only contain a string, not a %s\n",
                 o->type->type_name);
     }
-    if ((strstr(AS_STRING(str)->s, AS_STRING(o)->s)) != NULL) {
-        return LuciInt_new(true);
+    if (strsearch_find(AS_STRING(str)->s, AS_STRING(str)->len,
+                AS_STRING(o)->s, AS_STRING(o)->len) != NULL) {
+        return LuciTrueObj;
+    } else {
+        return LuciFalseObj;
+    }
+}
+
+/**
+ * Finds the index of the first occurrence of a substring
+ *
+ * @param str LuciStringObj to search
+ * @param sub LuciStringObj to search for
+ * @param start index at which to begin searching
+ * @returns LuciIntObj index of sub in str, or -1
+ */
+LuciObject *LuciString_find(LuciObject *str, LuciObject *sub, long start)
+{
+    long len = string_cplen(str);
+
+    if (start < 0) {
+        start += len;
+        if (start < 0) {
+            start = 0;
+        }
+    }
+    if (start > len) {
+        return LuciInt_new(-1);
+    }
+
+    long b = string_byte_offset(str, start);
+    const char *found = strsearch_find(AS_STRING(str)->s + b,
+            AS_STRING(str)->len - b, AS_STRING(sub)->s, AS_STRING(sub)->len);
+    if (!found) {
+        return LuciInt_new(-1);
+    }
+    return LuciInt_new(string_cp_offset(str, found - AS_STRING(str)->s));
+}
+
+/**
+ * Finds the index of the last occurrence of a substring
+ *
+ * @param str LuciStringObj to search
+ * @param sub LuciStringObj to search for
+ * @returns LuciIntObj index of sub in str, or -1
+ */
+LuciObject *LuciString_rfind(LuciObject *str, LuciObject *sub)
+{
+    const char *found = strsearch_rfind(AS_STRING(str)->s, AS_STRING(str)->len,
+            AS_STRING(sub)->s, AS_STRING(sub)->len);
+    if (!found) {
+        return LuciInt_new(-1);
+    }
+    return LuciInt_new(string_cp_offset(str, found - AS_STRING(str)->s));
+}
+
+/**
+ * Counts the non-overlapping occurrences of a substring
+ *
+ * @param str LuciStringObj to search
+ * @param sub LuciStringObj to count
+ * @returns LuciIntObj count
+ */
+LuciObject *LuciString_count(LuciObject *str, LuciObject *sub)
+{
+    return LuciInt_new(strsearch_count(AS_STRING(str)->s, AS_STRING(str)->len,
+            AS_STRING(sub)->s, AS_STRING(sub)->len));
+}
+
+/**
+ * Replaces every occurrence of a substring with another string
+ *
+ * The matches are counted first so that the result is
+ * allocated once.
+ *
+ * @param str LuciStringObj
+ * @param old LuciStringObj to replace (must not be empty)
+ * @param new LuciStringObj replacement
+ * @returns new LuciStringObj
+ */
+LuciObject *LuciString_replace(LuciObject *str, LuciObject *old,
+        LuciObject *new)
+{
+    const char *s = AS_STRING(str)->s;
+    long len = AS_STRING(str)->len;
+    const char *o = AS_STRING(old)->s;
+    long olen = AS_STRING(old)->len;
+    long nlen = AS_STRING(new)->len;
+
+    if (olen == 0) {
+        LUCI_DIE("%s\n", "Cannot replace an empty string");
+    }
+
+    long n = strsearch_count(s, len, o, olen);
+    if (n == 0) {
+        return LuciString_copy(str);
+    }
+
+    long total = len + n * (nlen - olen);
+    char *result = alloc(total + 1);
+    char *dst = result;
+    const char *end = s + len;
+    const char *p = s, *found;
+
+    while ((found = strsearch_find(p, end - p, o, olen)) != NULL) {
+        memcpy(dst, p, found - p);
+        dst += found - p;
+        memcpy(dst, AS_STRING(new)->s, nlen);
+        dst += nlen;
+        p = found + olen;
+    }
+    memcpy(dst, p, end - p);
+    result[total] = '\0';
+
+    return LuciString_new(result);
+}
+
+/**
+ * Determines whether a LuciStringObj begins with a prefix
+ *
+ * @param str LuciStringObj
+ * @param prefix LuciStringObj
+ * @returns 1 if str starts with prefix, 0 otherwise
+ */
+LuciObject *LuciString_startswith(LuciObject *str, LuciObject *prefix)
+{
+    long plen = AS_STRING(prefix)->len;
+    return LuciBool(plen <= AS_STRING(str)->len &&
+            memcmp(AS_STRING(str)->s, AS_STRING(prefix)->s, plen) == 0);
+}
+
+/**
+ * Determines whether a LuciStringObj ends with a suffix
+ *
+ * @param str LuciStringObj
+ * @param suffix LuciStringObj
+ * @returns 1 if str ends with suffix, 0 otherwise
+ */
+LuciObject *LuciString_endswith(LuciObject *str, LuciObject *suffix)
+{
+    long len = AS_STRING(str)->len, slen = AS_STRING(suffix)->len;
+    return LuciBool(slen <= len &&
+            memcmp(AS_STRING(str)->s + len - slen,
+                AS_STRING(suffix)->s, slen) == 0);
+}
+
+/**
+ * Removes leading and trailing characters from a LuciStringObj
+ *
+ * The result is a view of the original string, so nothing is copied.
+ *
+ * @param str LuciStringObj
+ * @param chars LuciStringObj of characters to remove,
+ *        or NULL to remove whitespace
+ * @returns stripped LuciStringObj
+ */
+LuciObject *LuciString_strip(LuciObject *str, LuciObject *chars)
+{
+    static const char *whitespace = " \t\n\r\f\v";
+    const char *set = whitespace;
+    long setlen = 6;
+    bool strip[256] = { false };
+    long i;
+
+    if (chars) {
+        set = AS_STRING(chars)->s;
+        setlen = AS_STRING(chars)->len;
+    }
+
+    const char *s = AS_STRING(str)->s;
+    long start = 0, end = AS_STRING(str)->len;
+
+    if (!chars || STRING_IS_ASCII(chars)) {
+        /* ASCII bytes never occur inside a multi-byte sequence,
+         * so the string can be stripped byte by byte */
+        for (i = 0; i < setlen; i++) {
+            strip[(unsigned char)set[i]] = true;
+        }
+        while (start < end && strip[(unsigned char)s[start]]) {
+            start++;
+        }
+        while (end > start && strip[(unsigned char)s[end - 1]]) {
+            end--;
+        }
     } else {
-        return LuciInt_new(false);
+        while (start < end) {
+            long n = utf8_seqlen(s[start]);
+            if (!strsearch_find(set, setlen, s + start, n)) {
+                break;
+            }
+            start += n;
+        }
+        while (end > start) {
+            long b = end - 1;
+            while (b > start && UTF8_IS_CONT(s[b])) {
+                b--;
+            }
+            if (!strsearch_find(set, setlen, s + b, end - b)) {
+                break;
+            }
+            end = b;
+        }
+    }
+
+    return string_view(str, start, end);
+}
+
+/**
+ * Returns the codepoint at index idx of a LuciStringObj
+ *
+ * ASCII characters come from the static character cache, others
+ * are views of the string.
+ *
+ * @param o LuciStringObj
+ * @param idx codepoint index, in bounds
+ * @returns single-character LuciStringObj
+ */
+static LuciObject *string_char_at(LuciObject *o, long idx)
+{
+    long b = string_byte_offset(o, idx);
+    unsigned char lead = AS_STRING(o)->s[b];
+
+    if (lead < 0x80) {
+        return LuciString_char(lead);
     }
+
+    LuciObject *c = string_view(o, b, b + utf8_seqlen(lead));
+    AS_STRING(c)->cplen = 1;
+    return c;
 }
 
 /**
@@ -231,14 +820,28 @@ LuciObject *LuciString_next(LuciObject *str, LuciObject *idx)
         LUCI_DIE("%s\n", "Argument to LuciString_next must be LuciIntObj");
     }
 
-    if (AS_INT(idx)->i >= AS_STRING(str)->len) {
+    return LuciString_char_at(str, AS_INT(idx)->i);
+}
+
+/**
+ * Returns the character at a codepoint index of a LuciStringObj
+ *
+ * Used by for-loops, which keep their index unboxed. An ASCII
+ * string is indexed by byte, and its characters come from the
+ * static character cache, so iterating over it never allocates.
+ *
+ * @param str LuciStringObj
+ * @param idx non-negative codepoint index
+ * @returns character at idx or NULL if out of bounds
+ */
+LuciObject *LuciString_char_at(LuciObject *str, long idx)
+{
+    if (idx >= string_cplen(str)) {
         return NULL;
+    } else if (STRING_IS_ASCII(str)) {
+        return LuciString_char(AS_STRING(str)->s[idx]);
     }
-
-    char *s = alloc(2 * sizeof(char));
-    s[0] = AS_STRING(str)->s[AS_INT(idx)->i];
-    s[1] = '\0';
-    return LuciString_new(s);
+    return string_char_at(str, idx);
 }
 
 /**
@@ -252,17 +855,15 @@ LuciObject* LuciString_cget(LuciObject *a, LuciObject *b)
 {
     if (ISTYPE(b, obj_int_t)) {
         long idx = AS_INT(b)->i;
+        long len = string_cplen(a);
 
-        MAKE_INDEX_POS(idx, AS_STRING(a)->len);
+        MAKE_INDEX_POS(idx, len);
 
-        if (idx >= AS_STRING(a)->len) {
+        if (idx >= len) {
             LUCI_DIE("%s\n", "String subscript out of bounds");
         }
 
-        char *s = alloc(2 * sizeof(char));
-        s[0] = AS_STRING(a)->s[idx];
-        s[1] = '\0';
-        return LuciString_new(s);
+        return string_char_at(a, idx);
     } else {
         LUCI_DIE("Cannot subscript a string with an object of type %s\n",
                 b->type->type_name);
@@ -271,31 +872,46 @@ LuciObject* LuciString_cget(LuciObject *a, LuciObject *b)
 }
 
 /**
- * Sets the character at index b in LuciStringObj a
+ * Replaces the character at index b in LuciStringObj a
+ *
+ * Strings are immutable, so a is left unchanged. The interpreter
+ * stores the result back into the variable that held a.
+ * Only the first character of c is inserted.
  *
  * @param a LuciStringObj
  * @param b index in a
  * @param c substring to insert into a
- * @returns former character at index b
+ * @returns new LuciStringObj
  */
 LuciObject* LuciString_cput(LuciObject *a, LuciObject *b, LuciObject *c)
 {
     if (ISTYPE(b, obj_int_t)) {
         if (ISTYPE(c, obj_string_t)) {
             long idx = AS_INT(b)->i;
-            MAKE_INDEX_POS(idx, AS_STRING(a)->len);
-            if (idx >= AS_STRING(a)->len) {
+            long len = string_cplen(a);
+            MAKE_INDEX_POS(idx, len);
+            if (idx >= len) {
                 LUCI_DIE("%s\n", "String subscript out of bounds");
             }
-            char *s = alloc(2 * sizeof(char));
-            s[0] = AS_STRING(a)->s[idx];
-            s[1] = '\0';
-
-            /* just put one char for now */
-            AS_STRING(a)->s[idx] = AS_STRING(c)->s[0];
+            if (AS_STRING(c)->len == 0) {
+                LUCI_DIE("%s\n", "Cannot put an empty string into a string");
+            }
 
-            /* return the former char */
-            return LuciString_new(s);
+            long at = string_byte_offset(a, idx);
+            long oldlen = utf8_seqlen(AS_STRING(a)->s[at]);
+            long newlen = utf8_seqlen(AS_STRING(c)->s[0]);
+            long total = AS_STRING(a)->len - oldlen + newlen;
+
+            char *s = alloc(total + 1);
+            memcpy(s, AS_STRING(a)->s, at);
+            memcpy(s + at, AS_STRING(c)->s, newlen);
+            memcpy(s + at + newlen, AS_STRING(a)->s + at + oldlen,
+                    AS_STRING(a)->len - at - oldlen);
+            s[total] = '\0';
+
+            LuciObject *ret = LuciString_new(s);
+            AS_STRING(ret)->cplen = len;
+            return ret;
         } else {
             LUCI_DIE("Cannot put an object of type %s into a string\n",
                     c->type->type_name);
@@ -314,92 +930,87 @@ LuciObject* LuciString_cput(LuciObject *a, LuciObject *b, LuciObject *c)
  */
 void LuciString_print(LuciObject *in)
 {
-    printf("%s", AS_STRING(in)->s);
+    fwrite(AS_STRING(in)->s, 1, AS_STRING(in)->len, stdout);
 }
 
 
 /**
- * Computes a hash of a LuciStringObj
+ * Computes the seeded 64-bit hash of a LuciStringObj
  *
- * djb2 (hash(i) = hash(i - 1) * 33 + str[i])
+ * The hash is computed a word at a time (see hash.c) and cached
+ * in the string object.
  *
  * @param s LuciStringObj to hash
- * @returns unsigned integer hash
+ * @returns 64-bit hash
  */
-static unsigned int string_hash_0(LuciObject *s)
+static uint64_t string_hash(LuciObject *s)
 {
-    char *str = AS_STRING(s)->s;
-
-    unsigned int h = 5381;
-    int c;
+    LuciStringObj *str = AS_STRING(s);
 
-    while ((c = *str++))
-        h = ((h << 5) + h) + c;
-    return h;
+    if (str->hash == 0) {
+        str->hash = hash_bytes(str->s, str->len);
+    }
+    return str->hash;
 }
 
 /**
- * Computes a hash of a LuciStringObj
+ * Computes the primary hash of a LuciStringObj
  *
- * sdbm (hash(i) = hash(i - 1) * 65599 + str[i])
+ * Low 32 bits of the string's 64-bit hash
  *
  * @param s LuciStringObj to hash
  * @returns unsigned integer hash
  */
-static unsigned int string_hash_1(LuciObject *s)
+static unsigned int string_hash_0(LuciObject *s)
 {
-    char *str = AS_STRING(s)->s;
-
-    unsigned int h = 0;
-    int c;
-    while ((c = *str++))
-        h = c + (h << 6) + (h << 16) - h;
-    return h;
+    return (unsigned int)string_hash(s);
 }
 
 /**
- * Computes a hash of a LuciStringObj
+ * Computes the secondary hash of a LuciStringObj
  *
- * One-at-a-time (Bob Jenkins)
+ * High 32 bits of the string's 64-bit hash
  *
  * @param s LuciStringObj to hash
  * @returns unsigned integer hash
  */
-static unsigned int string_hash_2(LuciObject *s)
+static unsigned int string_hash_1(LuciObject *s)
 {
-    char *str = AS_STRING(s)->s;
-
-    unsigned int h = 0;
-    int c;
-    while ((c = *str++)) {
-        h += c;
-        h += h << 10;
-        h ^= h >> 6;
-    }
-    h += h << 3;
-    h ^= h >> 11;
-    h += h << 15;
-    return h;
+    return (unsigned int)(string_hash(s) >> 32);
 }
 
 /**
  * Marks a LuciStringObj as reachable
  *
+ * A small view of a much larger buffer is compacted into its own
+ * copy here, so it no longer pins the larger buffer in memory.
+ *
  * @param in LuciStringObj
  */
 void LuciString_mark(LuciObject *in)
 {
+    LuciStringObj *str = AS_STRING(in);
+
+    if (str->buf && str->buf->size >= STRING_COMPACT_MIN &&
+            str->len < str->buf->size / STRING_COMPACT_RATIO) {
+        string_detach(in);
+    }
     GC_MARK(in);
 }
 
 /**
  * Finalizes a LuciStringObj
  *
- * frees its char*
+ * frees its char*, or releases its shared buffer
  *
  * @param in LuciStringObj
  */
 void LuciString_finalize(LuciObject *in)
 {
-    free(AS_STRING(in)->s);
+    if (AS_STRING(in)->buf) {
+        string_release(in);
+    } else {
+        free(AS_STRING(in)->s);
+    }
+    free(AS_STRING(in)->cpindex);
 }
@@ -13,17 +13,44 @@
 
 extern LuciObjectType obj_string_t;
 
+/** parent buffers at least this long may have their small views compacted */
+#define STRING_COMPACT_MIN      1024
+/** views shorter than (parent length / this) are compacted by the GC */
+#define STRING_COMPACT_RATIO    8
+/** a non-ASCII string's codepoint index records every Nth codepoint */
+#define STRING_INDEX_STRIDE     32
+
+/**
+ * Reference-counted character buffer shared between strings.
+ *
+ * Allocated lazily, the first time a string is copied or sliced.
+ */
+typedef struct LuciStringBuf_ {
+    char *base;         /**< start of the NUL-terminated buffer */
+    long size;          /**< length of the buffer (excluding NUL) */
+    unsigned int refs;  /**< number of strings referencing the buffer */
+} LuciStringBuf;
+
 /** String object type */
 typedef struct LuciString_ {
     LuciObject base;    /**< base implementation */
-    char * s;           /**< pointer to C-string */
+    char * s;           /**< pointer to first char (NUL-terminated unless a view) */
     long len;           /**< string length */
+    uint64_t hash;      /**< cached seeded hash (0 if not yet computed) */
+    LuciStringBuf *buf; /**< shared buffer s points into, NULL if s is private */
+    long cplen;         /**< number of codepoints (-1 if not yet counted) */
+    long *cpindex;      /**< byte offsets of every STRING_INDEX_STRIDE'th
+                             codepoint (built lazily, non-ASCII only) */
 } LuciStringObj;
 
 /** casts LuciObject o to a LuciStringObj */
 #define AS_STRING(o)    ((LuciStringObj *)(o))
 
 LuciObject *LuciString_new(char *s);
+bool LuciString_validate(LuciObject *);
+LuciObject *LuciString_char(unsigned char);
+LuciObject *LuciString_slice(LuciObject *, long, long);
+char *LuciString_cstr(LuciObject *);
 LuciObject* LuciString_copy(LuciObject *);
 LuciObject* LuciString_repr(LuciObject *);
 LuciObject* LuciString_asbool(LuciObject *);
@@ -32,9 +59,17 @@ LuciObject* LuciString_add(LuciObject *, LuciObject *);
 LuciObject* LuciString_mul(LuciObject *, LuciObject *);
 LuciObject* LuciString_eq(LuciObject *, LuciObject *);
 LuciObject* LuciString_contains(LuciObject *m, LuciObject *o);
+LuciObject *LuciString_find(LuciObject *, LuciObject *, long);
+LuciObject *LuciString_rfind(LuciObject *, LuciObject *);
+LuciObject *LuciString_count(LuciObject *, LuciObject *);
+LuciObject *LuciString_replace(LuciObject *, LuciObject *, LuciObject *);
+LuciObject *LuciString_startswith(LuciObject *, LuciObject *);
+LuciObject *LuciString_endswith(LuciObject *, LuciObject *);
+LuciObject *LuciString_strip(LuciObject *, LuciObject *);
 LuciObject* LuciString_cget(LuciObject *, LuciObject *);
 LuciObject* LuciString_cput(LuciObject *, LuciObject *, LuciObject *);
 LuciObject* LuciString_next(LuciObject *, LuciObject *);
+LuciObject *LuciString_char_at(LuciObject *, long);
 void LuciString_print(LuciObject *);
 void LuciString_mark(LuciObject *);
 void LuciString_finalize(LuciObject *);
@@ -0,0 +1,330 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file strsearch.c
+ *
+ * Substring search and counting kernels.
+ *
+ * On x86 the searches compare the first and last byte of the needle
+ * against 16 (SSE2) or 32 (AVX2) candidate positions at once and only
+ * call memcmp for positions where both match. The AVX2 kernels are
+ * compiled with a function-level target attribute and selected at
+ * runtime if the CPU supports them. Other platforms use the scalar
+ * kernels, which are built on memchr/memcmp.
+ */
+
+#include "strsearch.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && \
+        defined(__GNUC__)
+#define STRSEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+/** signature shared by all find kernels */
+typedef const char *(*find_kernel)(const char *, long, const char *, long);
+/** signature shared by all single-byte count kernels */
+typedef long (*count_kernel)(const char *, long, char);
+
+/**
+ * Scalar forward search
+ *
+ * @param hay bytes to search
+ * @param hlen number of bytes in hay
+ * @param needle bytes to search for (at least 1)
+ * @param nlen length of needle
+ * @returns pointer to first match or NULL
+ */
+static const char *find_scalar(const char *hay, long hlen,
+        const char *needle, long nlen)
+{
+    const char *end = hay + hlen - nlen;
+    const char *p = hay;
+
+    while (p <= end) {
+        p = memchr(p, needle[0], end - p + 1);
+        if (!p) {
+            break;
+        }
+        if (memcmp(p + 1, needle + 1, nlen - 1) == 0) {
+            return p;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+/**
+ * Scalar count of a single byte
+ *
+ * @param hay bytes to search
+ * @param hlen number of bytes in hay
+ * @param c byte to count
+ * @returns number of occurrences of c
+ */
+static long count_byte_scalar(const char *hay, long hlen, char c)
+{
+    long i, n = 0;
+    for (i = 0; i < hlen; i++) {
+        n += (hay[i] == c);
+    }
+    return n;
+}
+
+#ifdef STRSEARCH_X86
+
+/**
+ * SSE2 forward search
+ *
+ * @param hay bytes to search
+ * @param hlen number of bytes in hay
+ * @param needle bytes to search for (at least 2)
+ * @param nlen length of needle
+ * @returns pointer to first match or NULL
+ */
+static const char *find_sse2(const char *hay, long hlen,
+        const char *needle, long nlen)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[nlen - 1]);
+    long i;
+
+    for (i = 0; i + nlen - 1 + 16 <= hlen; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i bl = _mm_loadu_si128((const __m128i *)(hay + i + nlen - 1));
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi8(first, bf), _mm_cmpeq_epi8(last, bl)));
+
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, nlen - 2) == 0) {
+                return hay + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(hay + i, hlen - i, needle, nlen);
+}
+
+/**
+ * SSE2 count of a single byte
+ *
+ * @param hay bytes to search
+ * @param hlen number of bytes in hay
+ * @param c byte to count
+ * @returns number of occurrences of c
+ */
+static long count_byte_sse2(const char *hay, long hlen, char c)
+{
+    const __m128i needle = _mm_set1_epi8(c);
+    long i, n = 0;
+
+    for (i = 0; i + 16 <= hlen; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(hay + i));
+        n += __builtin_popcount(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+    }
+    return n + count_byte_scalar(hay + i, hlen - i, c);
+}
+
+/**
+ * AVX2 forward search
+ *
+ * @param hay bytes to search
+ * @param hlen number of bytes in hay
+ * @param needle bytes to search for (at least 2)
+ * @param nlen length of needle
+ * @returns pointer to first match or NULL
+ */
+__attribute__((target("avx2")))
+static const char *find_avx2(const char *hay, long hlen,
+        const char *needle, long nlen)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[nlen - 1]);
+    long i;
+
+    for (i = 0; i + nlen - 1 + 32 <= hlen; i += 32) {
+        __m256i bf = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i *)(hay + i + nlen - 1));
+        unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(first, bf), _mm256_cmpeq_epi8(last, bl)));
+
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, nlen - 2) == 0) {
+                return hay + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return find_sse2(hay + i, hlen - i, needle, nlen);
+}
+
+/**
+ * AVX2 count of a single byte
+ *
+ * @param hay bytes to search
+ * @param hlen number of bytes in hay
+ * @param c byte to count
+ * @returns number of occurrences of c
+ */
+__attribute__((target("avx2,popcnt")))
+static long count_byte_avx2(const char *hay, long hlen, char c)
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+    long i, n = 0;
+
+    for (i = 0; i + 32 <= hlen; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(hay + i));
+        n += __builtin_popcount(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+    }
+    return n + count_byte_sse2(hay + i, hlen - i, c);
+}
+
+#endif /* STRSEARCH_X86 */
+
+static const char *find_dispatch(const char *, long, const char *, long);
+static long count_byte_dispatch(const char *, long, char);
+
+/** selected multi-byte find kernel (resolved on first use) */
+static find_kernel find_impl = find_dispatch;
+/** selected single-byte count kernel (resolved on first use) */
+static count_kernel count_byte_impl = count_byte_dispatch;
+
+/**
+ * Chooses the fastest kernels supported by the running CPU
+ */
+static void strsearch_select(void)
+{
+    find_impl = find_scalar;
+    count_byte_impl = count_byte_scalar;
+#ifdef STRSEARCH_X86
+    find_impl = find_sse2;
+    count_byte_impl = count_byte_sse2;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        find_impl = find_avx2;
+        count_byte_impl = count_byte_avx2;
+    }
+#endif
+}
+
+/** selects kernels then forwards to the chosen find kernel */
+static const char *find_dispatch(const char *hay, long hlen,
+        const char *needle, long nlen)
+{
+    strsearch_select();
+    return find_impl(hay, hlen, needle, nlen);
+}
+
+/** selects kernels then forwards to the chosen count kernel */
+static long count_byte_dispatch(const char *hay, long hlen, char c)
+{
+    strsearch_select();
+    return count_byte_impl(hay, hlen, c);
+}
+
+/**
+ * Finds the first occurrence of a byte string within another
+ *
+ * @param hay bytes to search
+ * @param hlen number of bytes in hay
+ * @param needle bytes to search for
+ * @param nlen length of needle
+ * @returns pointer to first match in hay or NULL
+ */
+const char *strsearch_find(const char *hay, long hlen,
+        const char *needle, long nlen)
+{
+    if (nlen == 0) {
+        return hay;
+    } else if (nlen > hlen) {
+        return NULL;
+    } else if (nlen == 1) {
+        return memchr(hay, needle[0], hlen);
+    }
+    return find_impl(hay, hlen, needle, nlen);
+}
+
+/**
+ * Finds the last occurrence of a byte string within another
+ *
+ * @param hay bytes to search
+ * @param hlen number of bytes in hay
+ * @param needle bytes to search for
+ * @param nlen length of needle
+ * @returns pointer to last match in hay or NULL
+ */
+const char *strsearch_rfind(const char *hay, long hlen,
+        const char *needle, long nlen)
+{
+    if (nlen == 0) {
+        return hay + hlen;
+    } else if (nlen > hlen) {
+        return NULL;
+    }
+
+    const char *p = hay + hlen - nlen;
+#ifdef STRSEARCH_X86
+    if (nlen > 1) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[nlen - 1]);
+
+        /* test the 16 candidate positions ending at p, last to first */
+        while (p - 15 >= hay) {
+            const char *block = p - 15;
+            __m128i bf = _mm_loadu_si128((const __m128i *)block);
+            __m128i bl = _mm_loadu_si128((const __m128i *)(block + nlen - 1));
+            unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+                        _mm_cmpeq_epi8(first, bf), _mm_cmpeq_epi8(last, bl)));
+
+            while (mask) {
+                int bit = 31 - __builtin_clz(mask);
+                if (memcmp(block + bit + 1, needle + 1, nlen - 2) == 0) {
+                    return block + bit;
+                }
+                mask &= ~(1u << bit);
+            }
+            p -= 16;
+        }
+    }
+#endif
+    for (; p >= hay; p--) {
+        if (*p == needle[0] && memcmp(p + 1, needle + 1, nlen - 1) == 0) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Counts the non-overlapping occurrences of a byte string within another
+ *
+ * @param hay bytes to search
+ * @param hlen number of bytes in hay
+ * @param needle bytes to search for
+ * @param nlen length of needle
+ * @returns number of matches (hlen + 1 for an empty needle)
+ */
+long strsearch_count(const char *hay, long hlen,
+        const char *needle, long nlen)
+{
+    if (nlen == 0) {
+        return hlen + 1;
+    } else if (nlen == 1) {
+        return count_byte_impl(hay, hlen, needle[0]);
+    }
+
+    long n = 0;
+    const char *end = hay + hlen;
+    const char *p = hay;
+    while ((p = strsearch_find(p, end - p, needle, nlen)) != NULL) {
+        n++;
+        p += nlen;
+    }
+    return n;
+}
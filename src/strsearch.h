@@ -0,0 +1,21 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file strsearch.h
+ */
+
+#ifndef LUCI_STRSEARCH_H
+#define LUCI_STRSEARCH_H
+
+#include "luci.h"
+
+const char *strsearch_find(const char *hay, long hlen,
+        const char *needle, long nlen);
+const char *strsearch_rfind(const char *hay, long hlen,
+        const char *needle, long nlen);
+long strsearch_count(const char *hay, long hlen,
+        const char *needle, long nlen);
+
+#endif /* LUCI_STRSEARCH_H */
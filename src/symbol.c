@@ -101,7 +101,7 @@ static SymbolTable *symtable_insert(SymbolTable *symtable, Symbol *new_symbol)
 
     /* resize symbol table if if is over half full */
     if (symtable->count > (NBUCKETS[symtable->bscale] >> 1)) {
-        symtable = symtable_resize(symtable, symtable->bscale++);
+        symtable = symtable_resize(symtable, symtable->bscale + 1);
     }
 
     /* calculate hash of the symbol's name */
@@ -152,15 +152,16 @@ static SymbolTable *symtable_resize(SymbolTable *symtable, unsigned int bucketsc
         LUCI_DIE("%s", "Error allocating new, larger symtable entry array\n");
     symtable->bscale = bucketscale;
 
-    Symbol *cur = NULL;
+    Symbol *cur = NULL, *next = NULL;
     int i = 0;
     for (i = 0; i < NBUCKETS[old_bscale]; i ++) {
         cur = old_symbols[i];
         while (cur) {
-            /* re-insert symbol into new hash table */
+            /* unlink the symbol, then re-insert it into new hash table */
+            next = cur->next;
+            cur->next = NULL;
             symtable_insert(symtable, cur);
-            /* TODO: copy symbol payload to new symbol location */
-            cur = cur->next;
+            cur = next;
         }
     }
     /* delete old symbol array */
@@ -0,0 +1,325 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file tupletype.c
+ *
+ * Immutable, fixed-length tuples.
+ *
+ * The items of a tuple of up to TUPLE_INLINE_MAX items are stored in
+ * the tuple object itself, so building one is a single GC allocation,
+ * with no separate items array to malloc and free. Larger tuples keep
+ * their items in a malloc'd array, like lists. Functions return
+ * several values as a tuple, and assigning a tuple to several names
+ * unpacks it.
+ */
+
+#include "tupletype.h"
+
+/** Type member table for LuciTupleObj */
+LuciObjectType obj_tuple_t = {
+    "tuple",
+    sizeof(LuciTupleObj),
+    TYPEID_TUPLE,
+
+    LuciTuple_copy,
+    LuciTuple_deepcopy,
+    unary_nil,
+    LuciTuple_asbool,
+    LuciTuple_len,
+    unary_nil,
+    LuciObject_lgnot,
+    unary_nil,
+
+    LuciTuple_add,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    LuciTuple_eq,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+    LuciObject_lgor,
+    LuciObject_lgand,
+    binary_nil,
+    binary_nil,
+    binary_nil,
+
+    LuciTuple_contains,
+    LuciTuple_next,
+    LuciTuple_cget,
+
+    LuciTuple_cput,
+
+    LuciTuple_print,
+    LuciTuple_mark,
+    LuciTuple_finalize,
+    NULL,       /* hash0 */
+    NULL        /* hash1 */
+};
+
+/**
+ * Creates a new LuciTupleObj
+ *
+ * Every item is nil until the caller fills it in.
+ *
+ * @param count number of items
+ * @returns new LuciTupleObj
+ */
+LuciObject *LuciTuple_new(unsigned int count)
+{
+    LuciTupleObj *o;
+    unsigned int i;
+
+    if (count <= TUPLE_INLINE_MAX) {
+        o = (LuciTupleObj *)gc_malloc_size(&obj_tuple_t,
+                sizeof(LuciTupleObj) + count * sizeof(LuciObject *));
+        o->items = o->small_items;
+    } else {
+        o = (LuciTupleObj *)gc_malloc(&obj_tuple_t);
+        o->items = alloc(count * sizeof(LuciObject *));
+    }
+
+    o->count = count;
+    for (i = 0; i < count; i++) {
+        o->items[i] = LuciNilObj;
+    }
+    return (LuciObject *)o;
+}
+
+/**
+ * Copies a LuciTupleObj
+ *
+ * Tuples are immutable, so they can always be shared.
+ *
+ * @param orig LuciTupleObj
+ * @returns orig
+ */
+LuciObject* LuciTuple_copy(LuciObject *orig)
+{
+    return orig;
+}
+
+/**
+ * Deep copies a LuciTupleObj
+ *
+ * @param orig LuciTupleObj
+ * @returns new LuciTupleObj holding deep copies of orig's items
+ */
+LuciObject* LuciTuple_deepcopy(LuciObject *orig)
+{
+    unsigned int i, count = AS_TUPLE(orig)->count;
+    LuciObject *copy = LuciTuple_new(count);
+
+    for (i = 0; i < count; i++) {
+        LuciObject *item = AS_TUPLE(orig)->items[i];
+        AS_TUPLE(copy)->items[i] = item->type->deepcopy(item);
+    }
+    return copy;
+}
+
+/**
+ * Returns a boolean representation of a LuciTupleObj
+ *
+ * @param o LuciTupleObj
+ * @returns LuciIntObj (true if not empty)
+ */
+LuciObject* LuciTuple_asbool(LuciObject *o)
+{
+    return LuciBool(AS_TUPLE(o)->count > 0);
+}
+
+/**
+ * Returns the length of a LuciTupleObj
+ *
+ * @param o LuciTupleObj
+ * @returns number of items in o
+ */
+LuciObject* LuciTuple_len(LuciObject *o)
+{
+    return LuciInt_new(AS_TUPLE(o)->count);
+}
+
+/**
+ * Concatenates two LuciTupleObjs
+ *
+ * @param a first LuciTupleObj
+ * @param b second LuciTupleObj
+ * @returns new LuciTupleObj
+ */
+LuciObject* LuciTuple_add(LuciObject *a, LuciObject *b)
+{
+    if (!ISTYPE(b, obj_tuple_t)) {
+        LUCI_DIE("Cannot add an object of type %s to a tuple\n",
+                b->type->type_name);
+    }
+
+    unsigned int acount = AS_TUPLE(a)->count, bcount = AS_TUPLE(b)->count;
+    LuciObject *res = LuciTuple_new(acount + bcount);
+
+    memcpy(AS_TUPLE(res)->items, AS_TUPLE(a)->items,
+            acount * sizeof(LuciObject *));
+    memcpy(AS_TUPLE(res)->items + acount, AS_TUPLE(b)->items,
+            bcount * sizeof(LuciObject *));
+    return res;
+}
+
+/**
+ * Determines if two LuciTupleObjs are equal
+ *
+ * @param a LuciTupleObj
+ * @param b LuciTupleObj
+ * @returns 1 if equal, 0 otherwise
+ */
+LuciObject* LuciTuple_eq(LuciObject *a, LuciObject *b)
+{
+    if (!ISTYPE(b, obj_tuple_t)) {
+        LUCI_DIE("Cannot compare a tuple to an object of type %s\n",
+                b->type->type_name);
+    }
+
+    if (AS_TUPLE(a)->count != AS_TUPLE(b)->count) {
+        return LuciFalseObj;
+    }
+    unsigned int i;
+    for (i = 0; i < AS_TUPLE(a)->count; i++) {
+        LuciObject *item1 = AS_TUPLE(a)->items[i];
+        LuciObject *item2 = AS_TUPLE(b)->items[i];
+        LuciObject *eq = item1->type->eq(item1, item2);
+        if (!AS_INT(eq)->i) {
+            return LuciFalseObj;
+        }
+    }
+    return LuciTrueObj;
+}
+
+/**
+ * Determines whether a LuciTupleObj contains an object
+ *
+ * @param t LuciTupleObj
+ * @param o object
+ * @returns 1 if t contains o, 0 otherwise
+ */
+LuciObject* LuciTuple_contains(LuciObject *t, LuciObject *o)
+{
+    unsigned int i;
+    for (i = 0; i < AS_TUPLE(t)->count; i++) {
+        LuciObject *x = AS_TUPLE(t)->items[i];
+        LuciObject *eq = o->type->eq(o, x);
+        if (AS_INT(eq)->i) {
+            return LuciTrueObj;
+        }
+    }
+    return LuciFalseObj;
+}
+
+/**
+ * Returns the 'next' item in the tuple
+ *
+ * @param t LuciTupleObj
+ * @param idx index
+ * @returns item at index idx or NULL if out of bounds
+ */
+LuciObject* LuciTuple_next(LuciObject *t, LuciObject *idx)
+{
+    if (!ISTYPE(idx, obj_int_t)) {
+        LUCI_DIE("%s\n", "Argument to LuciTuple_next must be LuciIntObj");
+    }
+
+    if (AS_INT(idx)->i >= AS_TUPLE(t)->count) {
+        return NULL;
+    }
+    return AS_TUPLE(t)->items[AS_INT(idx)->i];
+}
+
+/**
+ * Gets the item at index b in LuciTupleObj a
+ *
+ * @param a LuciTupleObj
+ * @param b index in a
+ * @returns item at index b
+ */
+LuciObject* LuciTuple_cget(LuciObject *a, LuciObject *b)
+{
+    if (ISTYPE(b, obj_int_t)) {
+        long idx = AS_INT(b)->i;
+        if (idx < 0 && AS_TUPLE(a)->count > 0) {
+            MAKE_INDEX_POS(idx, (long)AS_TUPLE(a)->count);
+        }
+        if (idx < 0 || idx >= AS_TUPLE(a)->count) {
+            LUCI_DIE("%s\n", "Tuple index out of bounds");
+        }
+        return AS_TUPLE(a)->items[idx];
+    } else {
+        LUCI_DIE("Cannot subscript a tuple with an object of type %s\n",
+                b->type->type_name);
+    }
+    return LuciNilObj;
+}
+
+/**
+ * Tuples are immutable, so this always fails
+ *
+ * @param a LuciTupleObj
+ * @param b index in a
+ * @param c object to insert
+ * @returns LuciNilObj
+ */
+LuciObject* LuciTuple_cput(LuciObject *a, LuciObject *b, LuciObject *c)
+{
+    LUCI_DIE("%s\n", "Cannot modify a tuple (convert it with list() first)");
+    return LuciNilObj;
+}
+
+/**
+ * Prints a LuciTupleObj to stdout
+ *
+ * @param in LuciTupleObj to print
+ */
+void LuciTuple_print(LuciObject *in)
+{
+    unsigned int i;
+    printf("(");
+    for (i = 0; i < AS_TUPLE(in)->count; i++) {
+        LuciObject *item = AS_TUPLE(in)->items[i];
+        item->type->print(item);
+        printf(", ");
+    }
+    printf(")");
+}
+
+/**
+ * Marks a LuciTupleObj as reachable
+ *
+ * marks each item
+ *
+ * @param in LuciTupleObj
+ */
+void LuciTuple_mark(LuciObject *in)
+{
+    unsigned int i;
+    for (i = 0; i < AS_TUPLE(in)->count; i++) {
+        LuciObject *item = AS_TUPLE(in)->items[i];
+        item->type->mark(item);
+    }
+    GC_MARK(in);
+}
+
+/**
+ * Finalizes a LuciTupleObj
+ *
+ * frees items array, unless it is stored inline
+ *
+ * @param in LuciTupleObj
+ */
+void LuciTuple_finalize(LuciObject *in)
+{
+    if (AS_TUPLE(in)->items != AS_TUPLE(in)->small_items) {
+        free(AS_TUPLE(in)->items);
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file tupletype.h
+ */
+
+#ifndef LUCI_TUPLETYPE_H
+#define LUCI_TUPLETYPE_H
+
+#include "lucitypes.h"
+
+extern LuciObjectType obj_tuple_t;
+
+/** Immutable, fixed-length tuple object type */
+typedef struct LuciTuple_ {
+    LuciObject base;        /**< base implementation */
+    LuciObject **items;     /**< pointer to items array (small_items if the
+                                 tuple fits in its object) */
+    unsigned int count;     /**< number of items */
+    LuciObject *small_items[];  /**< inline items array */
+} LuciTupleObj;
+
+/** casts LuciObject o to a LuciTupleObj */
+#define AS_TUPLE(o)     ((LuciTupleObj *)(o))
+
+/** largest number of items stored in the tuple object itself */
+#define TUPLE_INLINE_MAX ((GC_MAX_OBJECT_SIZE - sizeof(LuciTupleObj)) / \
+            sizeof(LuciObject *))
+
+LuciObject *LuciTuple_new(unsigned int count);
+LuciObject* LuciTuple_copy(LuciObject *);
+LuciObject* LuciTuple_deepcopy(LuciObject *);
+LuciObject* LuciTuple_asbool(LuciObject *);
+LuciObject* LuciTuple_len(LuciObject *);
+LuciObject* LuciTuple_add(LuciObject *, LuciObject *);
+LuciObject* LuciTuple_eq(LuciObject *, LuciObject *);
+LuciObject* LuciTuple_contains(LuciObject *, LuciObject *);
+LuciObject* LuciTuple_next(LuciObject *, LuciObject *);
+LuciObject* LuciTuple_cget(LuciObject *, LuciObject *);
+LuciObject* LuciTuple_cput(LuciObject *, LuciObject *, LuciObject *);
+void LuciTuple_print(LuciObject *);
+void LuciTuple_mark(LuciObject *);
+void LuciTuple_finalize(LuciObject *);
+
+#endif
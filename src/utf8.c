@@ -0,0 +1,164 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file utf8.c
+ *
+ * UTF-8 validation and codepoint counting.
+ *
+ * Both routines skip over runs of ASCII 16 bytes at a time using
+ * SSE2 (when available), since most text is mostly ASCII, and fall
+ * back to decoding byte by byte only around non-ASCII sequences.
+ */
+
+#include "utf8.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && \
+        defined(__GNUC__)
+#define UTF8_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/**
+ * Returns the length of the run of ASCII bytes at the start of s
+ *
+ * @param s bytes
+ * @param len number of bytes
+ * @returns number of leading bytes below 0x80
+ */
+static long utf8_ascii_prefix(const char *s, long len)
+{
+    long i = 0;
+
+#ifdef UTF8_SSE2
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(s + i));
+        int mask = _mm_movemask_epi8(block);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#else
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, s + i, sizeof(word));
+        if (word & 0x8080808080808080ULL) {
+            break;
+        }
+    }
+#endif
+    while (i < len && !((unsigned char)s[i] & 0x80)) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Returns the length of a UTF-8 sequence given its lead byte
+ *
+ * @param lead first byte of the sequence
+ * @returns 1 to 4, or 0 if lead is not a valid lead byte
+ */
+int utf8_seqlen(unsigned char lead)
+{
+    if (lead < 0x80) {
+        return 1;
+    } else if (lead < 0xC2) {
+        return 0;   /* continuation byte or overlong 2-byte lead */
+    } else if (lead < 0xE0) {
+        return 2;
+    } else if (lead < 0xF0) {
+        return 3;
+    } else if (lead < 0xF5) {
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * Validates a byte string as UTF-8, rejecting overlong encodings,
+ * surrogates and codepoints above U+10FFFF
+ *
+ * @param s bytes
+ * @param len number of bytes
+ * @param cplen if not NULL, receives the number of codepoints
+ * @returns true if s is valid UTF-8
+ */
+bool utf8_validate(const char *s, long len, long *cplen)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    long i = 0, count = 0;
+
+    while (i < len) {
+        long ascii = utf8_ascii_prefix(s + i, len - i);
+        i += ascii;
+        count += ascii;
+        if (i >= len) {
+            break;
+        }
+
+        int n = utf8_seqlen(p[i]);
+        if (n == 0 || i + n > len) {
+            return false;
+        }
+
+        /* the second byte has a narrower range for some lead bytes */
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (p[i] == 0xE0) {
+            lo = 0xA0;  /* overlong */
+        } else if (p[i] == 0xED) {
+            hi = 0x9F;  /* surrogates */
+        } else if (p[i] == 0xF0) {
+            lo = 0x90;  /* overlong */
+        } else if (p[i] == 0xF4) {
+            hi = 0x8F;  /* > U+10FFFF */
+        }
+        if (n > 1 && (p[i + 1] < lo || p[i + 1] > hi)) {
+            return false;
+        }
+
+        int k;
+        for (k = 2; k < n; k++) {
+            if (!UTF8_IS_CONT(p[i + k])) {
+                return false;
+            }
+        }
+        i += n;
+        count++;
+    }
+
+    if (cplen) {
+        *cplen = count;
+    }
+    return true;
+}
+
+/**
+ * Counts the codepoints in a valid UTF-8 byte string
+ *
+ * Every byte that is not a continuation byte starts a codepoint.
+ *
+ * @param s bytes
+ * @param len number of bytes
+ * @returns number of codepoints
+ */
+long utf8_count(const char *s, long len)
+{
+    long i = 0, count = 0;
+
+#ifdef UTF8_SSE2
+    const __m128i cont = _mm_set1_epi8((char)0xC0);
+    const __m128i lead = _mm_set1_epi8((char)0x80);
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i top = _mm_and_si128(block, cont);
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(top, lead));
+        count += 16 - __builtin_popcount(mask);
+    }
+#endif
+    for (; i < len; i++) {
+        count += !UTF8_IS_CONT(s[i]);
+    }
+    return count;
+}
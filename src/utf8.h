@@ -0,0 +1,21 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file utf8.h
+ */
+
+#ifndef LUCI_UTF8_H
+#define LUCI_UTF8_H
+
+#include "luci.h"
+
+/** true if c is a UTF-8 continuation byte (10xxxxxx) */
+#define UTF8_IS_CONT(c)     (((unsigned char)(c) & 0xC0) == 0x80)
+
+bool utf8_validate(const char *s, long len, long *cplen);
+long utf8_count(const char *s, long len);
+int utf8_seqlen(unsigned char lead);
+
+#endif /* LUCI_UTF8_H */
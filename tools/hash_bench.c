@@ -0,0 +1,289 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file hash_bench.c
+ *
+ * Benchmark and collision-resistance check for Luci's string hash.
+ *
+ * Compares the seeded word-at-a-time hash in src/hash.c against the
+ * byte-at-a-time djb2/sdbm hashes it replaced, over several key-length
+ * distributions, then runs a set of collision checks. Exits non-zero
+ * if any check fails.
+ *
+ * Build and run from the repository root:
+ *
+ *     cc -O2 -Isrc -o hash_bench tools/hash_bench.c src/hash.c
+ *     ./hash_bench
+ */
+
+#include <time.h>
+
+#include "luci.h"
+#include "hash.h"
+
+/* normally provided by gc.c */
+void *alloc(size_t size)
+{
+    void *result = calloc(size, 1);
+    if (!result) {
+        fprintf(stderr, "alloc failed\n");
+        exit(1);
+    }
+    return result;
+}
+
+/** number of keys hashed per distribution */
+#define NKEYS       (1 << 20)
+/** number of passes over each key set */
+#define NPASSES     8
+
+/** a key-length distribution */
+typedef struct {
+    const char *name;   /**< description */
+    size_t min;         /**< minimum key length */
+    size_t max;         /**< maximum key length */
+} KeyDist;
+
+static const KeyDist dists[] = {
+    {"tiny (1-4)", 1, 4},
+    {"short (5-16)", 5, 16},
+    {"medium (17-64)", 17, 64},
+    {"long (65-256)", 65, 256},
+    {"mixed (1-256)", 1, 256},
+};
+
+/** djb2, as previously used for map hash 0 */
+static uint64_t djb2(const void *data, size_t len)
+{
+    const unsigned char *s = data;
+    unsigned int h = 5381;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        h = ((h << 5) + h) + s[i];
+    }
+    return h;
+}
+
+/** sdbm, as previously used for map hash 1 */
+static uint64_t sdbm(const void *data, size_t len)
+{
+    const unsigned char *s = data;
+    unsigned int h = 0;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        h = s[i] + (h << 6) + (h << 16) - h;
+    }
+    return h;
+}
+
+/** xorshift64 for reproducible key generation */
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static uint64_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/** generates NKEYS random printable keys with lengths in [min, max] */
+static char **make_keys(size_t min, size_t max, size_t *lens)
+{
+    char **keys = alloc(NKEYS * sizeof(*keys));
+    size_t i, j;
+    for (i = 0; i < NKEYS; i++) {
+        lens[i] = min + rng() % (max - min + 1);
+        keys[i] = alloc(lens[i] + 1);
+        for (j = 0; j < lens[i]; j++) {
+            keys[i][j] = 'a' + rng() % 26;
+        }
+    }
+    return keys;
+}
+
+static double time_hash(uint64_t (*h)(const void *, size_t),
+        char **keys, size_t *lens, uint64_t *sink)
+{
+    double start = now();
+    int pass;
+    size_t i;
+    for (pass = 0; pass < NPASSES; pass++) {
+        for (i = 0; i < NKEYS; i++) {
+            *sink += h(keys[i], lens[i]);
+        }
+    }
+    return now() - start;
+}
+
+static void benchmark(void)
+{
+    uint64_t sink = 0;
+    size_t *lens = alloc(NKEYS * sizeof(*lens));
+    unsigned int d;
+
+    printf("%-16s %12s %12s %12s   (ns/key)\n",
+            "distribution", "wyhash", "djb2", "sdbm");
+    for (d = 0; d < sizeof(dists) / sizeof(dists[0]); d++) {
+        char **keys = make_keys(dists[d].min, dists[d].max, lens);
+        double scale = 1e9 / ((double)NKEYS * NPASSES);
+        double tw = time_hash(hash_bytes, keys, lens, &sink);
+        double td = time_hash(djb2, keys, lens, &sink);
+        double ts = time_hash(sdbm, keys, lens, &sink);
+        printf("%-16s %12.2f %12.2f %12.2f\n", dists[d].name,
+                tw * scale, td * scale, ts * scale);
+        size_t i;
+        for (i = 0; i < NKEYS; i++) {
+            free(keys[i]);
+        }
+        free(keys);
+    }
+    free(lens);
+    printf("(checksum %llx)\n\n", (unsigned long long)sink);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Counts colliding 32-bit truncated hashes of n sequential keys
+ * ("key0", "key1", ...) and compares against the birthday bound.
+ */
+static int check_truncated_collisions(void)
+{
+    const size_t n = 1 << 20;
+    uint32_t *h = alloc(n * sizeof(*h));
+    char buf[32];
+    size_t i, collisions = 0;
+
+    for (i = 0; i < n; i++) {
+        int len = snprintf(buf, sizeof(buf), "key%lu", (unsigned long)i);
+        h[i] = (uint32_t)hash_bytes(buf, len);
+    }
+    qsort(h, n, sizeof(*h), cmp_u32);
+    for (i = 1; i < n; i++) {
+        if (h[i] == h[i - 1]) {
+            collisions++;
+        }
+    }
+    free(h);
+
+    /* expected ~ n^2 / 2^33 = 128 for n = 2^20 */
+    double expected = (double)n * n / 8589934592.0;
+    int ok = collisions < expected * 2;
+    printf("%-44s %6lu (expected ~%.0f) %s\n",
+            "32-bit collisions over 2^20 sequential keys",
+            (unsigned long)collisions, expected, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+/**
+ * Chi-squared test of group occupancy for sequential keys in a
+ * power-of-two table, selecting groups by hash >> 7 as maptype.c does
+ */
+static int check_distribution(void)
+{
+    const unsigned int nslots = 1 << 16;
+    const size_t n = nslots * 8;
+    unsigned int *slots = alloc(nslots * sizeof(*slots));
+    char buf[32];
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        int len = snprintf(buf, sizeof(buf), "%lu", (unsigned long)i);
+        slots[(hash_bytes(buf, len) >> 7) & (nslots - 1)]++;
+    }
+
+    double expected = (double)n / nslots, chi2 = 0;
+    for (i = 0; i < nslots; i++) {
+        double diff = slots[i] - expected;
+        chi2 += diff * diff / expected;
+    }
+    free(slots);
+
+    /* for k-1 degrees of freedom, chi2 / (k-1) should be close to 1 */
+    double ratio = chi2 / (nslots - 1);
+    int ok = ratio > 0.95 && ratio < 1.05;
+    printf("%-44s %6.3f %s\n", "slot chi^2 / dof (ideal 1.0)",
+            ratio, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+/**
+ * Checks that single-bit flips in the input flip about half of the
+ * output bits (avalanche), and that djb2's well-known equal-hash
+ * pairs do not collide.
+ */
+static int check_avalanche(void)
+{
+    const int trials = 20000;
+    unsigned char buf[64];
+    double total = 0;
+    int t, ok;
+
+    for (t = 0; t < trials; t++) {
+        size_t len = 1 + rng() % sizeof(buf);
+        size_t j;
+        for (j = 0; j < len; j++) {
+            buf[j] = rng();
+        }
+        uint64_t h0 = hash_bytes(buf, len);
+        size_t bit = rng() % (len * 8);
+        buf[bit / 8] ^= 1 << (bit % 8);
+        total += __builtin_popcountll(h0 ^ hash_bytes(buf, len));
+    }
+    double mean = total / trials;
+    ok = mean > 31 && mean < 33;
+    printf("%-44s %6.2f %s\n", "mean output bits flipped (ideal 32)",
+            mean, ok ? "ok" : "FAIL");
+
+    /* "Ez" and "FY" (and all concatenations thereof) collide under djb2 */
+    const char *pairs[][2] = {
+        {"Ez", "FY"}, {"EzEz", "FYFY"}, {"EzFY", "FYEz"}, {"EzEzEzEz", "FYFYFYFY"}
+    };
+    unsigned int i, djb2_hits = 0, hits = 0;
+    for (i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        size_t len = strlen(pairs[i][0]);
+        djb2_hits += djb2(pairs[i][0], len) == djb2(pairs[i][1], len);
+        hits += hash_bytes(pairs[i][0], len) == hash_bytes(pairs[i][1], len);
+    }
+    printf("%-44s %2u / %u (djb2: %u) %s\n", "known djb2 collision pairs colliding",
+            hits, i, djb2_hits, hits == 0 ? "ok" : "FAIL");
+    return ok && hits == 0;
+}
+
+/** Checks that the same key hashes differently under different seeds */
+static int check_seed(void)
+{
+    const char *key = "the same key";
+    int ok = hash_bytes_seeded(key, strlen(key), 1) !=
+            hash_bytes_seeded(key, strlen(key), 2);
+    printf("%-44s %s\n", "seed changes hash", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    hash_init();
+
+    if (!(argc > 1 && strcmp(argv[1], "-q") == 0)) {
+        benchmark();
+    }
+
+    int ok = 1;
+    ok &= check_truncated_collisions();
+    ok &= check_distribution();
+    ok &= check_avalanche();
+    ok &= check_seed();
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,349 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file map_bench.c
+ *
+ * Benchmark of Luci's map type.
+ *
+ * Compares the group-probed table in src/maptype.c against the
+ * prime-sized, quadratically probed table with parallel key and value
+ * arrays that it replaced, reproduced below. Both are timed inserting
+ * n distinct string keys, then looking up every key and n keys that
+ * are missing. The new table is also timed with int keys, which the
+ * old one didn't support, and under churn: inserting n keys while
+ * removing all but the latest n / 10, then removing the rest.
+ *
+ * Build and run from the repository root:
+ *
+ *     cc -O2 -Isrc -o map_bench tools/map_bench.c src/maptype.c \
+ *         src/stringtype.c src/inttype.c src/floattype.c src/lucitypes.c \
+ *         src/gc.c src/hash.c src/utf8.c src/strsearch.c -lm
+ *     ./map_bench [n ...]
+ *
+ * n defaults to 1000, 1000000 and 10000000.
+ */
+
+#include <time.h>
+
+#include "luci.h"
+#include "lucitypes.h"
+#include "hash.h"
+
+/* normally defined by interpret.c */
+jmp_buf LUCI_EXCEPTION_BUF;
+
+/** number of lookups timed for small maps */
+#define MIN_LOOKUPS     (1 << 22)
+
+/** prime table sizes used by the old map */
+static unsigned int old_sizes[] = {
+    7, 17, 43, 97, 193, 389, 769, 1543, 3079, 6151,
+    12289, 24593, 49157, 98317, 196613, 393241, 786433,
+    1572869, 3145739, 6291469, 12582917, 25165843,
+    50331653, 100663319, 201326611, 402653189,
+    805306457, 1610612741, 0
+};
+
+/** the old map: parallel key and value arrays */
+typedef struct {
+    LuciObject **keys;
+    LuciObject **vals;
+    unsigned int size_idx;
+    unsigned int count;
+    unsigned int size;
+} OldMap;
+
+/** the old probe sequence: quadratic in H1, starting at H0 */
+#define OLD_INDEX(H0, H1, I, N)   ( ( (H0) + ((I) * (I)) * (H1) ) % (N) )
+
+static bool old_keys_equal(LuciObject *a, LuciObject *b)
+{
+    LuciStringObj *sa = AS_STRING(a), *sb = AS_STRING(b);
+
+    if (sa == sb) {
+        return true;
+    }
+    if (sa->len != sb->len) {
+        return false;
+    }
+    if (sa->hash && sb->hash && sa->hash != sb->hash) {
+        return false;
+    }
+    return memcmp(sa->s, sb->s, sa->len) == 0;
+}
+
+static void old_init(OldMap *map, unsigned int size_idx)
+{
+    map->size_idx = size_idx;
+    map->size = old_sizes[size_idx];
+    map->count = 0;
+    map->keys = alloc(map->size * sizeof(*(map->keys)));
+    map->vals = alloc(map->size * sizeof(*(map->vals)));
+}
+
+static void old_put(OldMap *map, LuciObject *key, LuciObject *val);
+
+static void old_grow(OldMap *map)
+{
+    OldMap old = *map;
+    unsigned int i;
+
+    old_init(map, old.size_idx + 1);
+    for (i = 0; i < old.size; i++) {
+        if (old.keys[i]) {
+            old_put(map, old.keys[i], old.vals[i]);
+        }
+    }
+    free(old.keys);
+    free(old.vals);
+}
+
+static void old_put(OldMap *map, LuciObject *key, LuciObject *val)
+{
+    if (map->count > (map->size * 0.60)) {
+        old_grow(map);
+    }
+
+    uint32_t hash0 = key->type->hash0(key);
+    /* the old secondary hash was forced odd */
+    uint32_t hash1 = key->type->hash1(key) | 1;
+
+    unsigned int i, idx;
+    for (i = 0; i < map->size; i++) {
+        idx = OLD_INDEX(hash0, hash1, i, map->size);
+        if (!map->keys[idx]) {
+            map->keys[idx] = key;
+            map->vals[idx] = val;
+            map->count++;
+            return;
+        } else if (old_keys_equal(map->keys[idx], key)) {
+            map->vals[idx] = val;
+            return;
+        }
+    }
+}
+
+static LuciObject *old_get(OldMap *map, LuciObject *key)
+{
+    uint32_t hash0 = key->type->hash0(key);
+    uint32_t hash1 = key->type->hash1(key) | 1;
+
+    unsigned int i, idx;
+    for (i = 0; i < map->size; i++) {
+        idx = OLD_INDEX(hash0, hash1, i, map->size);
+        if (!map->keys[idx]) {
+            break;
+        } else if (old_keys_equal(map->keys[idx], key)) {
+            return map->vals[idx];
+        }
+    }
+    return NULL;
+}
+
+static double now(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/**
+ * Creates n string keys "k0", "k1", ... starting at first
+ *
+ * The keys are built outside of the garbage-collected heap, since
+ * the benchmark never collects.
+ */
+static LuciObject **make_string_keys(long first, long n)
+{
+    LuciStringObj *strs = alloc(n * sizeof(*strs));
+    LuciObject **keys = alloc(n * sizeof(*keys));
+    char *chars = alloc(n * 16);
+    long i;
+
+    for (i = 0; i < n; i++) {
+        char *s = chars + i * 16;
+        strs[i].base.type = &obj_string_t;
+        strs[i].s = s;
+        strs[i].len = snprintf(s, 16, "k%ld", first + i);
+        strs[i].cplen = strs[i].len;
+        keys[i] = (LuciObject *)&strs[i];
+    }
+    return keys;
+}
+
+/** Creates n int keys, spread out by a large odd stride */
+static LuciObject **make_int_keys(long first, long n)
+{
+    LuciIntObj *ints = alloc(n * sizeof(*ints));
+    LuciObject **keys = alloc(n * sizeof(*keys));
+    long i;
+
+    for (i = 0; i < n; i++) {
+        ints[i].base.type = &obj_int_t;
+        ints[i].i = (first + i) * 0x9E3779B97F4A7C15L;
+        keys[i] = (LuciObject *)&ints[i];
+    }
+    return keys;
+}
+
+/** Frees keys created by make_string_keys or make_int_keys */
+static void free_keys(LuciObject **keys)
+{
+    if (ISTYPE(keys[0], obj_string_t)) {
+        free(AS_STRING(keys[0])->s);
+    }
+    free(keys[0]);
+    free(keys);
+}
+
+/** Number of times to repeat the lookups so that each run takes a while */
+static long lookup_passes(long n)
+{
+    return n >= MIN_LOOKUPS ? 1 : MIN_LOOKUPS / n;
+}
+
+static void bench_old(LuciObject **keys, LuciObject **missing, long n)
+{
+    OldMap map;
+    long i, pass, passes = lookup_passes(n), found = 0;
+    double t0, t1, t2, t3;
+
+    old_init(&map, 0);
+    t0 = now();
+    for (i = 0; i < n; i++) {
+        old_put(&map, keys[i], keys[i]);
+    }
+    t1 = now();
+    for (pass = 0; pass < passes; pass++) {
+        for (i = 0; i < n; i++) {
+            found += old_get(&map, keys[i]) != NULL;
+        }
+    }
+    t2 = now();
+    for (pass = 0; pass < passes; pass++) {
+        for (i = 0; i < n; i++) {
+            found += old_get(&map, missing[i]) != NULL;
+        }
+    }
+    t3 = now();
+
+    if (found != n * passes) {
+        fprintf(stderr, "old map lost keys\n");
+        exit(EXIT_FAILURE);
+    }
+    printf("%-10s %-8s %10ld %12.1f %12.1f %12.1f\n", "old", "string", n,
+            (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / (n * passes),
+            (t3 - t2) * 1e9 / (n * passes));
+    free(map.keys);
+    free(map.vals);
+}
+
+static void bench_new(const char *kind, LuciObject **keys,
+        LuciObject **missing, long n)
+{
+    LuciObject *map = LuciMap_new();
+    long i, pass, passes = lookup_passes(n), found = 0;
+    double t0, t1, t2, t3;
+
+    t0 = now();
+    for (i = 0; i < n; i++) {
+        LuciMap_cput(map, keys[i], keys[i]);
+    }
+    t1 = now();
+    for (pass = 0; pass < passes; pass++) {
+        for (i = 0; i < n; i++) {
+            found += LuciMap_get(map, keys[i]) != NULL;
+        }
+    }
+    t2 = now();
+    for (pass = 0; pass < passes; pass++) {
+        for (i = 0; i < n; i++) {
+            found += LuciMap_get(map, missing[i]) != NULL;
+        }
+    }
+    t3 = now();
+
+    if (found != n * passes || AS_MAP(map)->count != n) {
+        fprintf(stderr, "new map lost keys\n");
+        exit(EXIT_FAILURE);
+    }
+    printf("%-10s %-8s %10ld %12.1f %12.1f %12.1f\n", "new", kind, n,
+            (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / (n * passes),
+            (t3 - t2) * 1e9 / (n * passes));
+    LuciMap_finalize(map);
+}
+
+/**
+ * Times a map holding a sliding window of keys, checking that its
+ * table stays the same size (emptying it doesn't shrink the table;
+ * the next insertion would)
+ */
+static void bench_churn(LuciObject **keys, long n)
+{
+    LuciObject *map = LuciMap_new();
+    long i, window = n / 10 > 0 ? n / 10 : 1;
+    unsigned int peak = 0;
+    double t0, t1;
+
+    t0 = now();
+    for (i = 0; i < n; i++) {
+        LuciMap_cput(map, keys[i], keys[i]);
+        if (i >= window) {
+            LuciMap_cdel(map, keys[i - window]);
+        }
+        if (AS_MAP(map)->size > peak) {
+            peak = AS_MAP(map)->size;
+        }
+    }
+    for (i = n - window; i < n; i++) {
+        LuciMap_cdel(map, keys[i]);
+    }
+    t1 = now();
+
+    printf("%-10s %-8s %10ld %12.1f %12u %12u\n", "churn", "int", n,
+            (t1 - t0) * 1e9 / n, peak, AS_MAP(map)->size);
+    LuciMap_finalize(map);
+}
+
+int main(int argc, char *argv[])
+{
+    long default_sizes[] = {1000, 1000000, 10000000};
+    int i, nsizes = 3;
+
+    hash_init();
+    gc_init();
+
+    printf("%-10s %-8s %10s %12s %12s %12s   (ns/op)\n",
+            "map", "keys", "n", "insert", "hit", "miss");
+    for (i = 0; i < (argc > 1 ? argc - 1 : nsizes); i++) {
+        long n = argc > 1 ? atol(argv[i + 1]) : default_sizes[i];
+        if (n <= 0) {
+            fprintf(stderr, "usage: %s [n ...]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        LuciObject **keys = make_string_keys(0, n);
+        LuciObject **missing = make_string_keys(n, n);
+        bench_old(keys, missing, n);
+        bench_new("string", keys, missing, n);
+        free_keys(keys);
+        free_keys(missing);
+
+        keys = make_int_keys(0, n);
+        missing = make_int_keys(n, n);
+        bench_new("int", keys, missing, n);
+        free_keys(keys);
+        free_keys(missing);
+    }
+
+    printf("\n%-10s %-8s %10s %12s %12s %12s\n",
+            "map", "keys", "n", "ns/put+del", "peak slots", "final slots");
+    for (i = 0; i < (argc > 1 ? argc - 1 : nsizes); i++) {
+        long n = argc > 1 ? atol(argv[i + 1]) : default_sizes[i];
+        LuciObject **keys = make_int_keys(0, n);
+        bench_churn(keys, n);
+        free_keys(keys);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,263 @@
+/*
+ * See Copyright Notice in luci.h
+ */
+
+/**
+ * @file numconv_bench.c
+ *
+ * Benchmark of Luci's number conversions.
+ *
+ * Writes a file of n ints and n floats, one per line, then reads it
+ * back. Formatting with src/numconv.c is timed against the snprintf
+ * calls it replaced ("%ld" and "%f") and against "%.17g", the
+ * shortest printf format that round-trips every double. Parsing is
+ * timed against strtol/strtod and the sscanf calls that int() and
+ * float() used to make. Every value is checked to parse back exactly.
+ *
+ * Build and run from the repository root:
+ *
+ *     cc -O2 -Isrc -o numconv_bench tools/numconv_bench.c src/numconv.c -lm
+ *     ./numconv_bench [n ...]
+ *
+ * n defaults to 1000000 and 5000000.
+ */
+
+#include <time.h>
+
+#include "luci.h"
+#include "numconv.h"
+
+/** longest line written for any number, including the newline */
+#define LINE_SIZE       40
+
+static double now(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/** xorshift64*, so every run sees the same numbers */
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Creates n ints and n floats shaped like report data
+ *
+ * Ints are spread over every magnitude up to 18 digits; floats are
+ * amounts with two decimals, ratios in [0, 1) and values with large
+ * or small exponents.
+ */
+static void make_numbers(long *ints, double *floats, long n)
+{
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        uint64_t r = next_random(&state);
+        long v = (long)(r >> 4) % 1000000000000000000L;
+        ints[i] = (r & 1) ? -(v >> (r >> 58)) : v >> (r >> 58);
+
+        r = next_random(&state);
+        switch (r & 3) {
+            case 0:
+                floats[i] = (double)(long)(r >> 40) / 100;
+                break;
+            case 1:
+                floats[i] = (double)(r >> 11) / (1ULL << 53);
+                break;
+            default:
+                floats[i] = ((double)(r >> 11) / (1ULL << 53)) *
+                        pow(10, (long)((r >> 2) % 60) - 30);
+                break;
+        }
+    }
+}
+
+/**
+ * Formats every int then every float into buf, one per line
+ *
+ * @returns the number of bytes written
+ */
+static size_t format_all(char *buf, const long *ints, const double *floats,
+        long n, const char *ffmt)
+{
+    char *p = buf;
+    long i;
+
+    if (ffmt) {
+        for (i = 0; i < n; i++) {
+            p += snprintf(p, LINE_SIZE, "%ld\n", ints[i]);
+        }
+        for (i = 0; i < n; i++) {
+            p += snprintf(p, LINE_SIZE, ffmt, floats[i]);
+        }
+    } else {
+        for (i = 0; i < n; i++) {
+            p += numconv_format_long(p, ints[i]);
+            *p++ = '\n';
+        }
+        for (i = 0; i < n; i++) {
+            p += numconv_format_double(p, floats[i]);
+            *p++ = '\n';
+        }
+    }
+    return p - buf;
+}
+
+/** the parsers being compared */
+enum { PARSE_LIBC, PARSE_SSCANF, PARSE_NUMCONV };
+
+/**
+ * Parses n ints then n floats back out of buf's nul-terminated lines
+ *
+ * @returns the number of values that differ from ints and floats
+ */
+static long parse_all(const char *buf, const long *ints,
+        const double *floats, long n, int parser)
+{
+    const char *p = buf;
+    long i, bad = 0;
+
+    for (i = 0; i < n; i++) {
+        long l = 0;
+        switch (parser) {
+            case PARSE_LIBC:
+                l = strtol(p, NULL, 10);
+                break;
+            case PARSE_SSCANF:
+                sscanf(p, "%ld", &l);
+                break;
+            default:
+                numconv_parse_long(p, &l);
+                break;
+        }
+        bad += l != ints[i];
+        p += strlen(p) + 1;
+    }
+    for (i = 0; i < n; i++) {
+        double d = 0;
+        switch (parser) {
+            case PARSE_LIBC:
+                d = strtod(p, NULL);
+                break;
+            case PARSE_SSCANF:
+                sscanf(p, "%lf", &d);
+                break;
+            default:
+                numconv_parse_double(p, &d);
+                break;
+        }
+        bad += d != floats[i];
+        p += strlen(p) + 1;
+    }
+    return bad;
+}
+
+/**
+ * Writes buf to a temporary file and reads it back
+ *
+ * Each line is nul-terminated, as a Luci string would be, since
+ * glibc's sscanf takes the length of its entire input on every call.
+ *
+ * @returns the file's contents
+ */
+static char *round_trip_file(const char *buf, size_t len)
+{
+    FILE *f = tmpfile();
+    char *contents = malloc(len + 1), *p;
+
+    if (!f || !contents || fwrite(buf, 1, len, f) != len) {
+        fprintf(stderr, "could not write temporary file\n");
+        exit(EXIT_FAILURE);
+    }
+    rewind(f);
+    if (fread(contents, 1, len, f) != len) {
+        fprintf(stderr, "could not read temporary file\n");
+        exit(EXIT_FAILURE);
+    }
+    fclose(f);
+    contents[len] = '\0';
+    for (p = contents; (p = strchr(p, '\n')); p++) {
+        *p = '\0';
+    }
+    return contents;
+}
+
+static void bench(long n)
+{
+    long *ints = malloc(n * sizeof(*ints));
+    double *floats = malloc(n * sizeof(*floats));
+    char *buf = malloc(2 * n * LINE_SIZE);
+    double t0, t1;
+    size_t len;
+    long bad;
+
+    make_numbers(ints, floats, n);
+
+    t0 = now();
+    len = format_all(buf, ints, floats, n, "%f\n");
+    t1 = now();
+    printf("%-22s %10ld %12.1f\n", "format snprintf %f", n,
+            (t1 - t0) * 1e9 / (2 * n));
+
+    t0 = now();
+    len = format_all(buf, ints, floats, n, "%.17g\n");
+    t1 = now();
+    printf("%-22s %10ld %12.1f\n", "format snprintf %.17g", n,
+            (t1 - t0) * 1e9 / (2 * n));
+    char *file = round_trip_file(buf, len);
+
+    t0 = now();
+    bad = parse_all(file, ints, floats, n, PARSE_SSCANF);
+    t1 = now();
+    printf("%-22s %10ld %12.1f   %ld mismatched\n", "parse sscanf", n,
+            (t1 - t0) * 1e9 / (2 * n), bad);
+
+    t0 = now();
+    bad = parse_all(file, ints, floats, n, PARSE_LIBC);
+    t1 = now();
+    printf("%-22s %10ld %12.1f   %ld mismatched\n", "parse strtol/strtod", n,
+            (t1 - t0) * 1e9 / (2 * n), bad);
+    free(file);
+
+    t0 = now();
+    len = format_all(buf, ints, floats, n, NULL);
+    t1 = now();
+    printf("%-22s %10ld %12.1f\n", "format numconv", n,
+            (t1 - t0) * 1e9 / (2 * n));
+    file = round_trip_file(buf, len);
+
+    t0 = now();
+    bad = parse_all(file, ints, floats, n, PARSE_NUMCONV);
+    t1 = now();
+    printf("%-22s %10ld %12.1f   %ld mismatched\n", "parse numconv", n,
+            (t1 - t0) * 1e9 / (2 * n), bad);
+    printf("%-22s %10ld %12.1f\n\n", "numconv file bytes", n,
+            (double)len / (2 * n));
+
+    free(file);
+    free(buf);
+    free(floats);
+    free(ints);
+}
+
+int main(int argc, char *argv[])
+{
+    long default_sizes[] = {1000000, 5000000};
+    int i, nsizes = 2;
+
+    printf("%-22s %10s %12s\n", "conversion", "n", "ns/number");
+    for (i = 0; i < (argc > 1 ? argc - 1 : nsizes); i++) {
+        long n = argc > 1 ? atol(argv[i + 1]) : default_sizes[i];
+        if (n <= 0) {
+            fprintf(stderr, "usage: %s [n ...]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        bench(n);
+    }
+    return EXIT_SUCCESS;
+}